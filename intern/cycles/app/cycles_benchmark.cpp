@@ -0,0 +1,307 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <OpenImageIO/filesystem.h>
+
+#include "app/cycles_benchmark.h"
+#include "app/cycles_xml.h"
+
+#include "device/device.h"
+#include "render/buffers.h"
+#include "render/camera.h"
+#include "render/stats.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+#include "util/util_function.h"
+#include "util/util_path.h"
+#include "util/util_time.h"
+#include "util/util_version.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Records when the first samples arrive, called from the session thread. */
+class BenchmarkProgress {
+ public:
+  BenchmarkProgress(Progress *progress) : progress(progress), first_sample_time(0.0)
+  {
+  }
+
+  void update()
+  {
+    if (first_sample_time == 0.0 && progress->get_progress() > 0.0f) {
+      first_sample_time = time_dt();
+    }
+  }
+
+  Progress *progress;
+  double first_sample_time;
+};
+
+static void benchmark_collect_phases(const char *manager,
+                                     const UpdateTimeStats &stats,
+                                     BenchmarkRun &run)
+{
+  foreach (const NamedTimeEntry &entry, stats.times.entries) {
+    run.phases.push_back(std::make_pair(string(manager) + "." + entry.name, entry.time));
+
+    if (entry.name.find("BVH") != string::npos) {
+      run.bvh_build_time += entry.time;
+    }
+  }
+}
+
+static void benchmark_collect_update_stats(const SceneUpdateStats &stats, BenchmarkRun &run)
+{
+  benchmark_collect_phases("scene", stats.scene, run);
+  benchmark_collect_phases("geometry", stats.geometry, run);
+  benchmark_collect_phases("light", stats.light, run);
+  benchmark_collect_phases("object", stats.object, run);
+  benchmark_collect_phases("image", stats.image, run);
+  benchmark_collect_phases("background", stats.background, run);
+  benchmark_collect_phases("bake", stats.bake, run);
+  benchmark_collect_phases("camera", stats.camera, run);
+  benchmark_collect_phases("film", stats.film, run);
+  benchmark_collect_phases("integrator", stats.integrator, run);
+  benchmark_collect_phases("osl", stats.osl, run);
+  benchmark_collect_phases("particles", stats.particles, run);
+  benchmark_collect_phases("svm", stats.svm, run);
+  benchmark_collect_phases("tables", stats.tables, run);
+}
+
+static bool benchmark_render(const string &filepath,
+                             const BenchmarkParams &params,
+                             const SessionParams &session_params,
+                             const SceneParams &scene_params,
+                             BenchmarkRun &run)
+{
+  SessionParams benchmark_session_params = session_params;
+  benchmark_session_params.background = true;
+  benchmark_session_params.write_render_cb = NULL;
+
+  Session *session = new Session(benchmark_session_params);
+  BenchmarkProgress progress(&session->progress);
+  session->progress.set_update_callback(function_bind(&BenchmarkProgress::update, &progress));
+
+  /* Read scene. */
+  const double sync_start_time = time_dt();
+
+  Scene *scene = new Scene(scene_params, session->device);
+  scene->enable_update_stats();
+  xml_read_file(scene, filepath.c_str());
+
+  Camera *camera = scene->camera;
+  if (params.width != 0 && params.height != 0) {
+    camera->set_full_width(params.width);
+    camera->set_full_height(params.height);
+    camera->set_screen_size_and_resolution(params.width, params.height, 1);
+  }
+  camera->compute_auto_viewplane();
+  session->scene = scene;
+
+  run.sync_time = time_dt() - sync_start_time;
+
+  /* Render. */
+  BufferParams buffer_params;
+  buffer_params.width = camera->get_full_width();
+  buffer_params.height = camera->get_full_height();
+  buffer_params.full_width = camera->get_full_width();
+  buffer_params.full_height = camera->get_full_height();
+
+  const double start_time = time_dt();
+  session->reset(buffer_params, benchmark_session_params.samples);
+  session->start();
+  session->wait();
+  run.total_time = time_dt() - start_time;
+
+  double total_time, render_time;
+  session->progress.get_time(total_time, render_time);
+  run.render_time = render_time;
+  run.samples_per_second = (render_time > 0.0) ? benchmark_session_params.samples / render_time :
+                                                 0.0;
+  run.time_to_first_sample = (progress.first_sample_time > 0.0) ?
+                                 progress.first_sample_time - start_time :
+                                 run.total_time;
+  run.peak_memory = session->stats.mem_peak;
+  benchmark_collect_update_stats(*scene->update_stats, run);
+
+  const bool success = !session->device->have_error() && !session->progress.get_error();
+  if (!success) {
+    fprintf(stderr,
+            "Failed to render %s: %s\n",
+            filepath.c_str(),
+            session->device->have_error() ? session->device->error_message().c_str() :
+                                            session->progress.get_error_message().c_str());
+  }
+
+  delete session;
+  return success;
+}
+
+static vector<string> benchmark_scene_files(const string &path)
+{
+  vector<string> filepaths;
+
+  if (!path_is_directory(path)) {
+    filepaths.push_back(path);
+    return filepaths;
+  }
+
+  std::vector<string> entries;
+  OIIO::Filesystem::get_directory_entries(path, entries);
+  foreach (const string &entry, entries) {
+    if (string_endswith(entry, ".xml") || string_endswith(entry, ".XML")) {
+      filepaths.push_back(entry);
+    }
+  }
+
+  /* Stable order so result files line up between runs. */
+  sort(filepaths.begin(), filepaths.end());
+  return filepaths;
+}
+
+bool benchmark_run(const BenchmarkParams &params,
+                   const SessionParams &session_params,
+                   const SceneParams &scene_params)
+{
+  const vector<string> filepaths = benchmark_scene_files(params.path);
+  if (filepaths.empty()) {
+    fprintf(stderr, "No scenes found in %s\n", params.path.c_str());
+    return false;
+  }
+
+  vector<BenchmarkScene> scenes;
+  bool success = true;
+
+  foreach (const string &filepath, filepaths) {
+    BenchmarkScene scene;
+    scene.name = path_filename(filepath);
+
+    for (int i = 0; i < params.num_runs; i++) {
+      fprintf(stderr, "Benchmark %s, run %d/%d\n", scene.name.c_str(), i + 1, params.num_runs);
+
+      BenchmarkRun run;
+      if (!benchmark_render(filepath, params, session_params, scene_params, run)) {
+        success = false;
+        break;
+      }
+      scene.runs.push_back(run);
+    }
+
+    scenes.push_back(scene);
+  }
+
+  string json = benchmark_results_json(scenes, session_params);
+
+  if (params.output_path.empty()) {
+    printf("%s", json.c_str());
+  }
+  else if (!path_write_text(params.output_path, json)) {
+    fprintf(stderr, "Failed to write %s\n", params.output_path.c_str());
+    return false;
+  }
+
+  return success;
+}
+
+/* JSON Output */
+
+static string benchmark_json_string(const string &str)
+{
+  string result = "\"";
+  foreach (char c, str) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      case '\t':
+        result += "\\t";
+        break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          result += string_printf("\\u%04x", (unsigned int)c);
+        }
+        else {
+          result += c;
+        }
+        break;
+    }
+  }
+  return result + "\"";
+}
+
+static string benchmark_json_run(const BenchmarkRun &run)
+{
+  string result = "{\n";
+  result += string_printf("          \"sync_time\": %.6f,\n", run.sync_time);
+  result += string_printf("          \"bvh_build_time\": %.6f,\n", run.bvh_build_time);
+  result += string_printf("          \"time_to_first_sample\": %.6f,\n",
+                          run.time_to_first_sample);
+  result += string_printf("          \"render_time\": %.6f,\n", run.render_time);
+  result += string_printf("          \"total_time\": %.6f,\n", run.total_time);
+  result += string_printf("          \"samples_per_second\": %.6f,\n", run.samples_per_second);
+  result += string_printf("          \"peak_memory\": %zu,\n", run.peak_memory);
+  result += "          \"phases\": {";
+
+  for (size_t i = 0; i < run.phases.size(); i++) {
+    result += (i == 0) ? "\n" : ",\n";
+    result += "            " + benchmark_json_string(run.phases[i].first) +
+              string_printf(": %.6f", run.phases[i].second);
+  }
+
+  result += run.phases.empty() ? "}\n" : "\n          }\n";
+  result += "        }";
+  return result;
+}
+
+string benchmark_results_json(const vector<BenchmarkScene> &scenes,
+                              const SessionParams &session_params)
+{
+  string result = "{\n";
+  result += "  \"version\": " + benchmark_json_string(CYCLES_VERSION_STRING) + ",\n";
+  result += "  \"device\": " + benchmark_json_string(session_params.device.description) + ",\n";
+  result += string_printf("  \"threads\": %d,\n", session_params.threads);
+  result += string_printf("  \"samples\": %d,\n", session_params.samples);
+  result += "  \"scenes\": [";
+
+  for (size_t i = 0; i < scenes.size(); i++) {
+    const BenchmarkScene &scene = scenes[i];
+    result += (i == 0) ? "\n" : ",\n";
+    result += "    {\n";
+    result += "      \"name\": " + benchmark_json_string(scene.name) + ",\n";
+    result += "      \"runs\": [";
+    for (size_t j = 0; j < scene.runs.size(); j++) {
+      result += (j == 0) ? "\n        " : ",\n        ";
+      result += benchmark_json_run(scene.runs[j]);
+    }
+    result += scene.runs.empty() ? "]\n" : "\n      ]\n";
+    result += "    }";
+  }
+
+  result += scenes.empty() ? "]\n" : "\n  ]\n";
+  result += "}\n";
+  return result;
+}
+
+CCL_NAMESPACE_END
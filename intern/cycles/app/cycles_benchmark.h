@@ -0,0 +1,92 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CYCLES_BENCHMARK_H__
+#define __CYCLES_BENCHMARK_H__
+
+#include "render/scene.h"
+#include "render/session.h"
+
+#include "util/util_string.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Benchmark
+ *
+ * Renders XML scenes a number of times without user interface and reports timings as JSON,
+ * to track performance between versions. Two result files can be compared with
+ * cycles_benchmark_compare.py. */
+
+struct BenchmarkParams {
+  /* Scene file, or directory of which all XML files are rendered. */
+  string path;
+  /* Number of times every scene is rendered. */
+  int num_runs;
+  /* File to write the JSON results to, standard output if empty. */
+  string output_path;
+  /* Resolution override, zero to use the camera resolution of the scene. */
+  int width, height;
+
+  BenchmarkParams() : num_runs(0), width(0), height(0)
+  {
+  }
+};
+
+struct BenchmarkRun {
+  /* Time to read the scene file. */
+  double sync_time;
+  /* Time to build object and scene BVHs. */
+  double bvh_build_time;
+  /* Time from session start until the first samples were rendered. */
+  double time_to_first_sample;
+  /* Time spent rendering samples and in total. */
+  double render_time;
+  double total_time;
+  double samples_per_second;
+  /* Peak memory allocated on the device. */
+  size_t peak_memory;
+  /* Scene update timings, named by manager and phase. */
+  vector<std::pair<string, double>> phases;
+
+  BenchmarkRun()
+      : sync_time(0.0),
+        bvh_build_time(0.0),
+        time_to_first_sample(0.0),
+        render_time(0.0),
+        total_time(0.0),
+        samples_per_second(0.0),
+        peak_memory(0)
+  {
+  }
+};
+
+struct BenchmarkScene {
+  string name;
+  vector<BenchmarkRun> runs;
+};
+
+/* Render all scenes and write the results, returns false if any scene failed. */
+bool benchmark_run(const BenchmarkParams &params,
+                   const SessionParams &session_params,
+                   const SceneParams &scene_params);
+
+string benchmark_results_json(const vector<BenchmarkScene> &scenes,
+                              const SessionParams &session_params);
+
+CCL_NAMESPACE_END
+
+#endif /* __CYCLES_BENCHMARK_H__ */
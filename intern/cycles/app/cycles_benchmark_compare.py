@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+#
+# Copyright 2011-2020 Blender Foundation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Compare two result files written by "cycles --benchmark", and report metrics of every
+# scene that got worse by more than the threshold. Exits with status 1 when any regression
+# was found, so it can be used in automated testing.
+
+import argparse
+import json
+import statistics
+import sys
+
+# Metric name and whether higher values are better.
+METRICS = (
+    ("sync_time", False),
+    ("bvh_build_time", False),
+    ("time_to_first_sample", False),
+    ("render_time", False),
+    ("total_time", False),
+    ("samples_per_second", True),
+    ("peak_memory", False),
+)
+
+
+def load_results(filepath):
+    with open(filepath, "r") as f:
+        results = json.load(f)
+    return {scene["name"]: scene["runs"] for scene in results["scenes"]}
+
+
+def median(runs, metric):
+    values = [run[metric] for run in runs if metric in run]
+    return statistics.median(values) if values else None
+
+
+def compare(reference, current, threshold, min_time):
+    regressions = []
+    rows = []
+
+    for name in sorted(set(reference) & set(current)):
+        for metric, higher_is_better in METRICS:
+            ref_value = median(reference[name], metric)
+            cur_value = median(current[name], metric)
+            if ref_value is None or cur_value is None or ref_value == 0:
+                continue
+
+            # Ignore noise in timings too short to measure reliably.
+            if metric.endswith("_time") and max(ref_value, cur_value) < min_time:
+                continue
+
+            change = (cur_value - ref_value) / ref_value
+            worse = -change if higher_is_better else change
+            is_regression = worse > threshold
+
+            rows.append((name, metric, ref_value, cur_value, change, worse))
+            if is_regression:
+                regressions.append((name, metric))
+
+    return rows, regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare Cycles benchmark results.")
+    parser.add_argument("reference", help="Results of the reference version")
+    parser.add_argument("current", help="Results of the version to test")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="Percentage a metric may get worse before it is a regression")
+    parser.add_argument("--min-time", type=float, default=0.05,
+                        help="Timings below this number of seconds are not compared")
+    parser.add_argument("--all", action="store_true", help="Print unchanged metrics too")
+    args = parser.parse_args()
+
+    reference = load_results(args.reference)
+    current = load_results(args.current)
+
+    for name in sorted(set(reference) ^ set(current)):
+        print("Scene %s is only in one of the result files, skipping" % name)
+
+    threshold = args.threshold / 100.0
+    rows, regressions = compare(reference, current, threshold, args.min_time)
+
+    for name, metric, ref_value, cur_value, change, worse in rows:
+        if worse > threshold:
+            status = "REGRESSION"
+        elif worse < -threshold:
+            status = "improved"
+        elif args.all:
+            status = ""
+        else:
+            continue
+        print("%-30s %-22s %14.4f -> %14.4f  %+7.1f%%  %s" %
+              (name, metric, ref_value, cur_value, change * 100.0, status))
+
+    if regressions:
+        print("%d regression(s) found" % len(regressions))
+        return 1
+
+    print("No regressions found")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -40,6 +40,7 @@
 #  include "util/util_view.h"
 #endif
 
+#include "app/cycles_benchmark.h"
 #include "app/cycles_xml.h"
 
 CCL_NAMESPACE_BEGIN
@@ -54,6 +55,7 @@ struct Options {
   bool quiet;
   bool show_help, interactive, pause;
   string output_path;
+  BenchmarkParams benchmark;
 } options;
 
 static void session_print(const string &str)
@@ -435,6 +437,13 @@ static void options_parse(int argc, const char **argv)
              "--list-devices",
              &list,
              "List information about all available devices",
+             "--benchmark %d",
+             &options.benchmark.num_runs,
+             "Render the scene, or all XML scenes in the given directory, this number of times "
+             "and report timings as JSON",
+             "--benchmark-output %s",
+             &options.benchmark.output_path,
+             "File path to write benchmark results to, instead of standard output",
 #ifdef WITH_CYCLES_LOGGING
              "--debug",
              &debug,
@@ -545,6 +554,16 @@ int main(int argc, const char **argv)
   path_init();
   options_parse(argc, argv);
 
+  if (options.benchmark.num_runs > 0) {
+    options.benchmark.path = options.filepath;
+    options.benchmark.width = options.width;
+    options.benchmark.height = options.height;
+    options.session_params.background = true;
+    return benchmark_run(options.benchmark, options.session_params, options.scene_params) ?
+               EXIT_SUCCESS :
+               EXIT_FAILURE;
+  }
+
 #ifdef WITH_CYCLES_STANDALONE_GUI
   if (options.session_params.background) {
 #endif
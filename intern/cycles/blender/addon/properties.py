@@ -390,6 +390,30 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         description="Sample all lights (for indirect samples), rather than randomly picking one",
         default=True,
     )
+    use_light_tree: BoolProperty(
+        name="Light Tree",
+        description="Pick lights by their estimated contribution at the shading point using a light hierarchy, "
+        "reducing noise in scenes with many lights. Not used when sampling all lights",
+        default=False,
+    )
+    use_path_guiding: BoolProperty(
+        name="Path Guiding",
+        description="Learn where indirect light comes from in training passes before rendering, and sample "
+        "diffuse bounces towards it. Only used by the CPU with the path tracing integrator",
+        default=False,
+    )
+    path_guiding_training_passes: IntProperty(
+        name="Training Passes",
+        description="Number of passes over a quarter of the pixels to learn the guiding distributions with",
+        min=1, max=64,
+        default=4,
+    )
+    path_guiding_probability: FloatProperty(
+        name="Guiding Probability",
+        description="Probability of sampling the guiding distribution instead of the diffuse BSDF",
+        min=0.0, max=1.0,
+        default=0.5,
+    )
     light_sampling_threshold: FloatProperty(
         name="Light Sampling Threshold",
         description="Probabilistically terminate light samples when the light contribution is below this threshold (more noise but faster rendering). "
@@ -693,6 +717,13 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default=0,
         min=0, max=16,
     )
+    bvh_cache_directory: StringProperty(
+        name="BVH Cache",
+        description="Directory to save built BVHs to and load them from when the geometry did not change, "
+        "to skip rebuilding in later renders. Not used with Embree or OptiX, empty disables the cache",
+        subtype='DIR_PATH',
+        default="",
+    )
     tile_order: EnumProperty(
         name="Tile Order",
         description="Tile order for rendering",
@@ -800,6 +831,14 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         items=enum_texture_limit
     )
 
+    texture_cache_size: IntProperty(
+        name="Texture Cache Size",
+        description="Memory in megabytes for loading image textures on demand in tiles and mipmap "
+        "levels, instead of fully before rendering. Only used for CPU rendering, 0 disables this feature",
+        min=0, max=1048576,
+        default=0,
+    )
+
     ao_bounces: IntProperty(
         name="AO Bounces",
         default=0,
@@ -832,6 +871,13 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default='EMBREE',
     )
     debug_use_cpu_split_kernel: BoolProperty(name="Split Kernel", default=False)
+    debug_cpu_split_kernel_batch_size: IntProperty(
+        name="Batch Size",
+        description="Number of paths each thread traces at once with the split kernel, "
+        "sorted by shader before shading",
+        default=1024,
+        min=1, max=65536,
+    )
 
     debug_use_cuda_adaptive_compile: BoolProperty(name="Adaptive Compile", default=False)
     debug_use_cuda_split_kernel: BoolProperty(name="Split Kernel", default=False)
@@ -315,6 +315,15 @@ class CYCLES_RENDER_PT_sampling_advanced(CyclesButtonsPanel, Panel):
         col.prop(cscene, "min_light_bounces")
         col.prop(cscene, "min_transparent_bounces")
         col.prop(cscene, "light_sampling_threshold", text="Light Threshold")
+        col.prop(cscene, "use_light_tree")
+
+        if not use_branched_path(context):
+            col = layout.column(align=True)
+            col.prop(cscene, "use_path_guiding")
+            sub = col.column(align=True)
+            sub.active = cscene.use_path_guiding
+            sub.prop(cscene, "path_guiding_training_passes")
+            sub.prop(cscene, "path_guiding_probability")
 
         if cscene.progressive != 'PATH' and use_branched_path(context):
             col = layout.column(align=True)
@@ -723,6 +732,9 @@ class CYCLES_RENDER_PT_performance_acceleration_structure(CyclesButtonsPanel, Pa
         sub = col.column()
         sub.active = not cscene.debug_use_spatial_splits and not use_embree
         sub.prop(cscene, "debug_bvh_time_steps")
+        sub = col.column()
+        sub.active = not use_embree
+        sub.prop(cscene, "bvh_cache_directory")
 
 
 class CYCLES_RENDER_PT_performance_final_render(CyclesButtonsPanel, Panel):
@@ -736,12 +748,17 @@ class CYCLES_RENDER_PT_performance_final_render(CyclesButtonsPanel, Panel):
 
         scene = context.scene
         rd = scene.render
+        cscene = scene.cycles
 
         col = layout.column()
 
         col.prop(rd, "use_save_buffers")
         col.prop(rd, "use_persistent_data", text="Persistent Images")
 
+        sub = col.column()
+        sub.active = use_cpu(context)
+        sub.prop(cscene, "texture_cache_size")
+
 
 class CYCLES_RENDER_PT_performance_viewport(CyclesButtonsPanel, Panel):
     bl_label = "Viewport"
@@ -2004,6 +2021,9 @@ class CYCLES_RENDER_PT_debug(CyclesButtonsPanel, Panel):
         row.prop(cscene, "debug_use_cpu_avx2", toggle=True)
         col.prop(cscene, "debug_bvh_layout")
         col.prop(cscene, "debug_use_cpu_split_kernel")
+        sub = col.column()
+        sub.active = cscene.debug_use_cpu_split_kernel
+        sub.prop(cscene, "debug_cpu_split_kernel_batch_size")
 
         col.separator()
 
@@ -316,6 +316,10 @@ void BlenderSync::sync_integrator()
   integrator->set_sample_all_lights_direct(get_boolean(cscene, "sample_all_lights_direct"));
   integrator->set_sample_all_lights_indirect(get_boolean(cscene, "sample_all_lights_indirect"));
   integrator->set_light_sampling_threshold(get_float(cscene, "light_sampling_threshold"));
+  integrator->set_use_light_tree(get_boolean(cscene, "use_light_tree"));
+  integrator->set_use_path_guiding(get_boolean(cscene, "use_path_guiding"));
+  integrator->set_path_guiding_training_passes(get_int(cscene, "path_guiding_training_passes"));
+  integrator->set_path_guiding_probability(get_float(cscene, "path_guiding_probability"));
 
   SamplingPattern sampling_pattern = (SamplingPattern)get_enum(
       cscene, "sampling_pattern", SAMPLING_NUM_PATTERNS, SAMPLING_PATTERN_SOBOL);
@@ -760,7 +764,9 @@ void BlenderSync::free_data_after_sync(BL::Depsgraph &b_depsgraph)
 
 /* Scene Parameters */
 
-SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene, bool background)
+SceneParams BlenderSync::get_scene_params(BL::BlendData &b_data,
+                                          BL::Scene &b_scene,
+                                          bool background)
 {
   BL::RenderSettings r = b_scene.render();
   SceneParams params;
@@ -805,6 +811,13 @@ SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene, bool background)
     params.texture_limit = 0;
   }
 
+  params.texture_cache_size = get_int(cscene, "texture_cache_size");
+
+  string bvh_cache_directory = get_string(cscene, "bvh_cache_directory");
+  if (!bvh_cache_directory.empty()) {
+    params.bvh_cache_directory = blender_absolute_path(b_data, b_scene, bvh_cache_directory);
+  }
+
   params.bvh_layout = DebugFlags().cpu.bvh_layout;
 
   params.background = background;
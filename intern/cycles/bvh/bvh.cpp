@@ -23,6 +23,7 @@
 
 #include "bvh/bvh2.h"
 #include "bvh/bvh_build.h"
+#include "bvh/bvh_cache.h"
 #include "bvh/bvh_embree.h"
 #include "bvh/bvh_node.h"
 #include "bvh/bvh_optix.h"
@@ -129,6 +130,19 @@ BVH *BVH::create(const BVHParams &params,
 
 void BVH::build(Progress &progress, Stats *)
 {
+  /* Reuse the BVH built for the same geometry and parameters by an earlier render. */
+  string cache_key, cache_filepath;
+  if (!params.cache_directory.empty()) {
+    progress.set_substatus("Looking up BVH in cache");
+    cache_key = bvh_cache_key(params, objects);
+    cache_filepath = bvh_cache_filepath(params.cache_directory, cache_key);
+
+    if (cache_read(cache_filepath, cache_key)) {
+      VLOG(1) << "Loaded BVH from cache " << cache_filepath;
+      return;
+    }
+  }
+
   progress.set_substatus("Building BVH");
 
   /* build nodes */
@@ -171,12 +185,101 @@ void BVH::build(Progress &progress, Stats *)
     return;
   }
 
+  /* Primitive indices as built, the top level offsets them when packing nodes. */
+  BVHCacheData cache_data;
+  if (!cache_filepath.empty()) {
+    cache_data.prim_type = pack.prim_type;
+    cache_data.prim_index = pack.prim_index;
+    cache_data.prim_object = pack.prim_object;
+    cache_data.prim_time = pack.prim_time;
+  }
+
   /* pack nodes */
   progress.set_substatus("Packing BVH nodes");
   pack_nodes(root);
 
   /* free build nodes */
   root->deleteSubtree();
+
+  if (!cache_filepath.empty()) {
+    cache_write(cache_filepath, cache_key, cache_data);
+  }
+}
+
+/* Cache */
+
+bool BVH::cache_read(const string &filepath, const string &key)
+{
+  BVHCacheData data;
+  if (!bvh_cache_read(filepath, key, data)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < data.prim_object.size(); i++) {
+    if (data.prim_object[i] < 0 || data.prim_object[i] >= (int)objects.size()) {
+      return false;
+    }
+  }
+
+  pack.prim_type.steal_data(data.prim_type);
+  pack.prim_index.steal_data(data.prim_index);
+  pack.prim_object.steal_data(data.prim_object);
+  pack.prim_time.steal_data(data.prim_time);
+  pack_primitives();
+
+  pack.nodes.clear();
+  pack.leaf_nodes.clear();
+  if (params.top_level) {
+    /* Merge instances the same way as pack_nodes(), with own nodes at the start. */
+    pack_instances(data.nodes.size(), data.leaf_nodes.size());
+    if (data.nodes.size()) {
+      memcpy(pack.nodes.data(), data.nodes.data(), data.nodes.size() * sizeof(int4));
+    }
+    if (data.leaf_nodes.size()) {
+      memcpy(pack.leaf_nodes.data(),
+             data.leaf_nodes.data(),
+             data.leaf_nodes.size() * sizeof(int4));
+    }
+  }
+  else {
+    pack.nodes.steal_data(data.nodes);
+    pack.leaf_nodes.steal_data(data.leaf_nodes);
+  }
+  pack.root_index = data.root_index;
+
+  return true;
+}
+
+void BVH::cache_write(const string &filepath, const string &key, BVHCacheData &data)
+{
+  /* Leave out the merged instance BVHs, they are cached separately. */
+  size_t num_nodes = pack.nodes.size();
+  size_t num_leaf_nodes = pack.leaf_nodes.size();
+  if (params.top_level) {
+    foreach (Geometry *geom, geometry) {
+      if (geom->need_build_bvh(params.bvh_layout)) {
+        num_nodes -= geom->bvh->pack.nodes.size();
+        num_leaf_nodes -= geom->bvh->pack.leaf_nodes.size();
+      }
+    }
+  }
+
+  data.nodes.resize(num_nodes);
+  if (num_nodes) {
+    memcpy(data.nodes.data(), pack.nodes.data(), num_nodes * sizeof(int4));
+  }
+  data.leaf_nodes.resize(num_leaf_nodes);
+  if (num_leaf_nodes) {
+    memcpy(data.leaf_nodes.data(), pack.leaf_nodes.data(), num_leaf_nodes * sizeof(int4));
+  }
+  data.root_index = pack.root_index;
+
+  if (bvh_cache_write(filepath, key, data)) {
+    VLOG(1) << "Saved BVH to cache " << filepath;
+  }
+  else {
+    VLOG(1) << "Failed to save BVH to cache " << filepath;
+  }
 }
 
 /* Refitting */
@@ -20,6 +20,7 @@
 
 #include "bvh/bvh_params.h"
 #include "util/util_array.h"
+#include "util/util_string.h"
 #include "util/util_types.h"
 #include "util/util_vector.h"
 
@@ -36,6 +37,7 @@ class LeafNode;
 class Geometry;
 class Object;
 class Progress;
+struct BVHCacheData;
 
 #define BVH_ALIGN 4096
 #define TRI_NODE_SIZE 3
@@ -117,6 +119,10 @@ class BVH {
   /* merge instance BVH's */
   void pack_instances(size_t nodes_size, size_t leaf_nodes_size);
 
+  /* Load from or save to the on-disk cache, see bvh_cache.h. */
+  bool cache_read(const string &filepath, const string &key);
+  void cache_write(const string &filepath, const string &key, BVHCacheData &data);
+
   /* for subclasses to implement */
   virtual void pack_nodes(const BVHNode *root) = 0;
   virtual void refit_nodes() = 0;
@@ -0,0 +1,342 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bvh/bvh_cache.h"
+#include "bvh/bvh_params.h"
+
+#include "render/hair.h"
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_map.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
+
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#  include <process.h>
+#else
+#  include <unistd.h>
+#endif
+
+CCL_NAMESPACE_BEGIN
+
+/* Bump when the file layout or the output of the BVH builder changes. */
+static const uint32_t BVH_CACHE_VERSION = 1;
+static const char BVH_CACHE_MAGIC[8] = {'C', 'Y', 'B', 'V', 'H', 'C', 'A', 'C'};
+static const size_t BVH_CACHE_ALIGN = 16;
+
+struct BVHCacheHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t root_index;
+  char key[32];
+  uint64_t num_prims;
+  uint64_t num_prim_time;
+  uint64_t num_nodes;
+  uint64_t num_leaf_nodes;
+  uint64_t pad[2];
+};
+
+static_assert(sizeof(BVHCacheHeader) % BVH_CACHE_ALIGN == 0, "BVHCacheHeader is not aligned");
+
+/* Key */
+
+static void bvh_cache_hash_data(MD5Hash &md5, const void *data, size_t size)
+{
+  /* MD5Hash takes the size as int, feed large arrays in chunks. */
+  const uint8_t *bytes = (const uint8_t *)data;
+  while (size > 0) {
+    const size_t chunk = (size < (1 << 30)) ? size : (1 << 30);
+    md5.append(bytes, (int)chunk);
+    bytes += chunk;
+    size -= chunk;
+  }
+}
+
+template<typename T> static void bvh_cache_hash_value(MD5Hash &md5, const T &value)
+{
+  bvh_cache_hash_data(md5, &value, sizeof(value));
+}
+
+/* float3 may have an uninitialized fourth component, only hash the used ones. */
+static void bvh_cache_hash_float3(MD5Hash &md5, const float3 *data, size_t size)
+{
+  float buffer[3 * 256];
+  size_t num_buffered = 0;
+
+  for (size_t i = 0; i < size; i++) {
+    buffer[num_buffered * 3 + 0] = data[i].x;
+    buffer[num_buffered * 3 + 1] = data[i].y;
+    buffer[num_buffered * 3 + 2] = data[i].z;
+
+    if (++num_buffered == 256 || i + 1 == size) {
+      bvh_cache_hash_data(md5, buffer, num_buffered * 3 * sizeof(float));
+      num_buffered = 0;
+    }
+  }
+
+  bvh_cache_hash_value(md5, size);
+}
+
+template<typename T> static void bvh_cache_hash_array(MD5Hash &md5, const array<T> &data)
+{
+  bvh_cache_hash_data(md5, data.data(), data.size() * sizeof(T));
+  bvh_cache_hash_value(md5, data.size());
+}
+
+static void bvh_cache_hash_motion(MD5Hash &md5, const Geometry *geom)
+{
+  const bool has_motion_blur = geom->has_motion_blur();
+  bvh_cache_hash_value(md5, has_motion_blur);
+
+  if (has_motion_blur) {
+    const Attribute *attr = geom->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
+    bvh_cache_hash_value(md5, geom->get_motion_steps());
+    bvh_cache_hash_float3(md5, attr->data_float3(), attr->buffer.size() / sizeof(float3));
+  }
+}
+
+static string bvh_cache_geometry_hash(const Geometry *geom)
+{
+  MD5Hash md5;
+  bvh_cache_hash_value(md5, geom->geometry_type);
+
+  if (geom->geometry_type == Geometry::MESH || geom->geometry_type == Geometry::VOLUME) {
+    const Mesh *mesh = static_cast<const Mesh *>(geom);
+    bvh_cache_hash_array(md5, mesh->get_triangles());
+    bvh_cache_hash_float3(md5, mesh->get_verts().data(), mesh->get_verts().size());
+  }
+  else if (geom->geometry_type == Geometry::HAIR) {
+    const Hair *hair = static_cast<const Hair *>(geom);
+    bvh_cache_hash_value(md5, hair->curve_shape);
+    bvh_cache_hash_array(md5, hair->get_curve_first_key());
+    bvh_cache_hash_array(md5, hair->get_curve_radius());
+    bvh_cache_hash_float3(md5, hair->get_curve_keys().data(), hair->get_curve_keys().size());
+  }
+
+  bvh_cache_hash_motion(md5, geom);
+
+  return md5.get_hex();
+}
+
+static void bvh_cache_hash_params(MD5Hash &md5, const BVHParams &params)
+{
+  bvh_cache_hash_value(md5, BVH_CACHE_VERSION);
+  bvh_cache_hash_value(md5, params.use_spatial_split);
+  bvh_cache_hash_value(md5, params.spatial_split_alpha);
+  bvh_cache_hash_value(md5, params.unaligned_split_threshold);
+  bvh_cache_hash_value(md5, params.sah_node_cost);
+  bvh_cache_hash_value(md5, params.sah_primitive_cost);
+  bvh_cache_hash_value(md5, params.min_leaf_size);
+  bvh_cache_hash_value(md5, params.max_triangle_leaf_size);
+  bvh_cache_hash_value(md5, params.max_motion_triangle_leaf_size);
+  bvh_cache_hash_value(md5, params.max_curve_leaf_size);
+  bvh_cache_hash_value(md5, params.max_motion_curve_leaf_size);
+  bvh_cache_hash_value(md5, params.top_level);
+  bvh_cache_hash_value(md5, params.bvh_layout);
+  bvh_cache_hash_value(md5, params.use_unaligned_nodes);
+  bvh_cache_hash_value(md5, params.num_motion_curve_steps);
+  bvh_cache_hash_value(md5, params.num_motion_triangle_steps);
+  bvh_cache_hash_value(md5, params.bvh_type);
+}
+
+string bvh_cache_key(const BVHParams &params, const vector<Object *> &objects)
+{
+  MD5Hash md5;
+  bvh_cache_hash_params(md5, params);
+
+  /* Geometry may be shared by many objects, hash its content only once. */
+  map<const Geometry *, string> geometry_hashes;
+
+  bvh_cache_hash_value(md5, objects.size());
+  foreach (const Object *ob, objects) {
+    const Geometry *geom = ob->get_geometry();
+    const bool is_instanced = geom->is_instanced();
+
+    bvh_cache_hash_value(md5, is_instanced);
+    bvh_cache_hash_value(md5, ob->visibility_for_tracing());
+    bvh_cache_hash_float3(md5, &ob->bounds.min, 1);
+    bvh_cache_hash_float3(md5, &ob->bounds.max, 1);
+
+    /* Instances are only referenced by their bounds in the top level. */
+    if (params.top_level && is_instanced) {
+      continue;
+    }
+
+    map<const Geometry *, string>::iterator it = geometry_hashes.find(geom);
+    if (it == geometry_hashes.end()) {
+      it = geometry_hashes.insert(std::make_pair(geom, bvh_cache_geometry_hash(geom))).first;
+    }
+    md5.append(it->second);
+  }
+
+  return md5.get_hex();
+}
+
+string bvh_cache_filepath(const string &directory, const string &key)
+{
+  return path_join(directory, "cycles_bvh_" + key + ".bin");
+}
+
+/* Reading and Writing */
+
+static size_t bvh_cache_padding(size_t size)
+{
+  return (BVH_CACHE_ALIGN - (size % BVH_CACHE_ALIGN)) % BVH_CACHE_ALIGN;
+}
+
+static size_t bvh_cache_array_size(size_t size, size_t element_size)
+{
+  return size * element_size + bvh_cache_padding(size * element_size);
+}
+
+template<typename T> static bool bvh_cache_read_array(FILE *f, array<T> &data, size_t size)
+{
+  uint8_t padding[BVH_CACHE_ALIGN];
+  const size_t num_padding = bvh_cache_padding(size * sizeof(T));
+
+  data.resize(size);
+  if (size > 0 && fread(data.data(), sizeof(T), size, f) != size) {
+    return false;
+  }
+  return num_padding == 0 || fread(padding, 1, num_padding, f) == num_padding;
+}
+
+template<typename T> static bool bvh_cache_write_array(FILE *f, const array<T> &data)
+{
+  static const uint8_t padding[BVH_CACHE_ALIGN] = {0};
+  const size_t num_padding = bvh_cache_padding(data.size() * sizeof(T));
+
+  if (data.size() > 0 && fwrite(data.data(), sizeof(T), data.size(), f) != data.size()) {
+    return false;
+  }
+  return num_padding == 0 || fwrite(padding, 1, num_padding, f) == num_padding;
+}
+
+bool bvh_cache_read(const string &filepath, const string &key, BVHCacheData &data)
+{
+  if (!path_exists(filepath)) {
+    return false;
+  }
+
+  FILE *f = path_fopen(filepath, "rb");
+  if (!f) {
+    return false;
+  }
+
+  BVHCacheHeader header;
+  bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+            memcmp(header.magic, BVH_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+            header.version == BVH_CACHE_VERSION && key.size() == sizeof(header.key) &&
+            memcmp(header.key, key.data(), sizeof(header.key)) == 0 &&
+            (header.num_prim_time == 0 || header.num_prim_time == header.num_prims);
+
+  /* Check the size before allocating, to be robust against truncated files. */
+  if (ok) {
+    const size_t expected_size = sizeof(header) +
+                                 3 * bvh_cache_array_size(header.num_prims, sizeof(int)) +
+                                 bvh_cache_array_size(header.num_prim_time, sizeof(float2)) +
+                                 bvh_cache_array_size(header.num_nodes, sizeof(int4)) +
+                                 bvh_cache_array_size(header.num_leaf_nodes, sizeof(int4));
+    ok = path_file_size(filepath) == expected_size;
+  }
+
+  ok = ok && bvh_cache_read_array(f, data.prim_type, header.num_prims) &&
+       bvh_cache_read_array(f, data.prim_index, header.num_prims) &&
+       bvh_cache_read_array(f, data.prim_object, header.num_prims) &&
+       bvh_cache_read_array(f, data.prim_time, header.num_prim_time) &&
+       bvh_cache_read_array(f, data.nodes, header.num_nodes) &&
+       bvh_cache_read_array(f, data.leaf_nodes, header.num_leaf_nodes);
+
+  fclose(f);
+
+  if (!ok) {
+    VLOG(1) << "Ignoring invalid BVH cache file " << filepath;
+    return false;
+  }
+
+  data.root_index = header.root_index;
+  return true;
+}
+
+/* Name of a temporary file next to the cache file, unique among all threads and processes
+ * writing to the cache directory. */
+static string bvh_cache_tmp_filepath(const string &filepath)
+{
+  static std::atomic<unsigned int> counter(0);
+#ifdef _WIN32
+  const int pid = _getpid();
+#else
+  const int pid = getpid();
+#endif
+  return string_printf("%s.%d.%u.tmp", filepath.c_str(), pid, counter++);
+}
+
+bool bvh_cache_write(const string &filepath, const string &key, const BVHCacheData &data)
+{
+  BVHCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BVH_CACHE_MAGIC, sizeof(header.magic));
+  header.version = BVH_CACHE_VERSION;
+  header.root_index = data.root_index;
+  if (key.size() != sizeof(header.key) || data.prim_type.size() != data.prim_index.size() ||
+      data.prim_object.size() != data.prim_index.size()) {
+    return false;
+  }
+  memcpy(header.key, key.data(), sizeof(header.key));
+  header.num_prims = data.prim_index.size();
+  header.num_prim_time = data.prim_time.size();
+  header.num_nodes = data.nodes.size();
+  header.num_leaf_nodes = data.leaf_nodes.size();
+
+  /* Write to a temporary file first, so that other renders sharing the cache directory
+   * never see a partially written file. */
+  path_create_directories(filepath);
+  const string tmp_filepath = bvh_cache_tmp_filepath(filepath);
+
+  FILE *f = path_fopen(tmp_filepath, "wb");
+  if (!f) {
+    return false;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            bvh_cache_write_array(f, data.prim_type) &&
+            bvh_cache_write_array(f, data.prim_index) &&
+            bvh_cache_write_array(f, data.prim_object) &&
+            bvh_cache_write_array(f, data.prim_time) && bvh_cache_write_array(f, data.nodes) &&
+            bvh_cache_write_array(f, data.leaf_nodes);
+
+  ok = (fclose(f) == 0) && ok;
+
+  if (ok && path_exists(filepath)) {
+    /* Written concurrently by another render, the content is the same. */
+    path_remove(tmp_filepath);
+    return true;
+  }
+
+  ok = ok && rename(tmp_filepath.c_str(), filepath.c_str()) == 0;
+  if (!ok) {
+    path_remove(tmp_filepath);
+  }
+  return ok;
+}
+
+CCL_NAMESPACE_END
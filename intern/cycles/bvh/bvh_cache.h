@@ -0,0 +1,65 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BVH_CACHE_H__
+#define __BVH_CACHE_H__
+
+#include "util/util_array.h"
+#include "util/util_string.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class BVHParams;
+class Object;
+
+/* BVH Cache Data
+ *
+ * Output of a BVH2 build that can not be cheaply derived from the geometry. Primitive
+ * indices are stored as they come out of the builder, before the top level BVH offsets
+ * them, and for the top level only the nodes of its own primitives are stored, since the
+ * instanced BVHs are merged in after loading. */
+
+struct BVHCacheData {
+  array<int> prim_type;
+  array<int> prim_index;
+  array<int> prim_object;
+  array<float2> prim_time;
+  array<int4> nodes;
+  array<int4> leaf_nodes;
+  int root_index;
+
+  BVHCacheData() : root_index(0)
+  {
+  }
+};
+
+/* Hash of everything that affects the BVH build: the build parameters, and for every object
+ * its geometry content, bounds and visibility. */
+string bvh_cache_key(const BVHParams &params, const vector<Object *> &objects);
+
+string bvh_cache_filepath(const string &directory, const string &key);
+
+/* The file is a header followed by the arrays, each aligned to 16 bytes so the file can be
+ * mapped into memory and used in place. Reading fails if the file is missing, truncated, of
+ * another version or written for another key. */
+bool bvh_cache_read(const string &filepath, const string &key, BVHCacheData &data);
+bool bvh_cache_write(const string &filepath, const string &key, const BVHCacheData &data);
+
+CCL_NAMESPACE_END
+
+#endif /* __BVH_CACHE_H__ */
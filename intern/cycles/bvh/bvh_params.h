@@ -19,6 +19,7 @@
 #define __BVH_PARAMS_H__
 
 #include "util/util_boundbox.h"
+#include "util/util_string.h"
 
 #include "kernel/kernel_types.h"
 
@@ -91,6 +92,9 @@ class BVHParams {
   /* These are needed for Embree. */
   int curve_subdivisions;
 
+  /* Directory to load and save built BVHs, empty to disable the cache. */
+  string cache_directory;
+
   /* fixed parameters */
   enum { MAX_DEPTH = 64, MAX_SPATIAL_DEPTH = 48, NUM_SPATIAL_BINS = 32 };
 
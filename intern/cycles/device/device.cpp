@@ -395,7 +395,7 @@ Device *Device::create(DeviceInfo &info, Stats &stats, Profiler &profiler, bool
 #endif
 #ifdef WITH_NETWORK
     case DEVICE_NETWORK:
-      device = device_network_create(info, stats, profiler, "127.0.0.1");
+      device = device_network_create(info, stats, profiler, NULL);
       break;
 #endif
 #ifdef WITH_OPENCL
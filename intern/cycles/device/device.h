@@ -433,8 +433,8 @@ class Device {
   }
 
 #ifdef WITH_NETWORK
-  /* networking */
-  void server_run();
+  /* networking, port 0 uses the default port */
+  void server_run(int port = 0);
 #endif
 
   /* multi device */
@@ -31,6 +31,7 @@
 #include "device/device.h"
 #include "device/device_denoising.h"
 #include "device/device_intern.h"
+#include "device/device_path_guiding.h"
 #include "device/device_split_kernel.h"
 
 // clang-format off
@@ -50,6 +51,7 @@
 #include "render/buffers.h"
 #include "render/coverage.h"
 
+#include "util/util_atomic.h"
 #include "util/util_debug.h"
 #include "util/util_foreach.h"
 #include "util/util_function.h"
@@ -62,6 +64,7 @@
 #include "util/util_system.h"
 #include "util/util_task.h"
 #include "util/util_thread.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -171,6 +174,124 @@ class CPUSplitKernel : public DeviceSplitKernel {
   virtual uint64_t state_buffer_size(device_memory &kg, device_memory &data, size_t num_threads);
 };
 
+/* Tile Rows
+ *
+ * With adaptive sampling some tiles converge long before others, so near the end of a render
+ * a few unconverged tiles keep single threads busy while the other threads ran out of tiles.
+ * Every step of samples of a tile is split into rows, which threads without tiles help render
+ * while the thread owning the tile renders them as well. Only the owner runs the adaptive
+ * filter, after all rows of a step are done. */
+
+class CPUTileRows {
+ public:
+  CPUTileRows(RenderTile &tile, int start_sample, int end_sample)
+      : tile(tile), start_sample(start_sample), end_sample(end_sample), next_row(0), num_users(0)
+  {
+  }
+
+  /* Take the next row to render, returns false when all rows were taken. */
+  bool next(int &y)
+  {
+    y = atomic_fetch_and_add_int32(&next_row, 1);
+    return y < tile.h;
+  }
+
+  bool has_rows() const
+  {
+    return next_row < tile.h;
+  }
+
+  RenderTile &tile;
+  int start_sample;
+  int end_sample;
+  int32_t next_row;
+  /* Number of helper threads rendering rows, protected by the helpers lock. */
+  int num_users;
+};
+
+class CPUTileHelpers {
+ public:
+  CPUTileHelpers() : num_tiles(0), num_waiting(0)
+  {
+  }
+
+  void tile_begin()
+  {
+    thread_scoped_lock lock(mutex);
+    num_tiles++;
+  }
+
+  void tile_end()
+  {
+    thread_scoped_lock lock(mutex);
+    num_tiles--;
+    cond.notify_all();
+  }
+
+  /* Whether any thread is waiting for rows to help with. */
+  bool has_waiting()
+  {
+    return num_waiting > 0;
+  }
+
+  void add(CPUTileRows *rows)
+  {
+    thread_scoped_lock lock(mutex);
+    tile_rows.push_back(rows);
+    cond.notify_all();
+  }
+
+  /* Remove rows once the owner rendered all of them, waiting for helpers to finish theirs. */
+  void remove(CPUTileRows *rows)
+  {
+    thread_scoped_lock lock(mutex);
+    tile_rows.erase(std::find(tile_rows.begin(), tile_rows.end(), rows));
+    while (rows->num_users > 0) {
+      cond.wait(lock);
+    }
+  }
+
+  /* Wait for rows of another tile, returns NULL once no tiles are being rendered anymore. */
+  CPUTileRows *acquire()
+  {
+    thread_scoped_lock lock(mutex);
+    num_waiting++;
+
+    for (;;) {
+      foreach (CPUTileRows *rows, tile_rows) {
+        if (rows->has_rows()) {
+          rows->num_users++;
+          num_waiting--;
+          return rows;
+        }
+      }
+
+      if (num_tiles == 0) {
+        num_waiting--;
+        return NULL;
+      }
+
+      cond.wait(lock);
+    }
+  }
+
+  void release(CPUTileRows *rows)
+  {
+    thread_scoped_lock lock(mutex);
+    if (--rows->num_users == 0) {
+      cond.notify_all();
+    }
+  }
+
+ protected:
+  thread_mutex mutex;
+  thread_condition_variable cond;
+  vector<CPUTileRows *> tile_rows;
+  /* Number of tiles being rendered that can be shared. */
+  int num_tiles;
+  volatile int num_waiting;
+};
+
 class CPUDevice : public Device {
  public:
   TaskPool task_pool;
@@ -193,6 +314,12 @@ class CPUDevice : public Device {
 
   bool use_split_kernel;
 
+  CPUTileHelpers tile_helpers;
+
+  /* Path guiding distributions, trained before rendering when the kernel data changed. */
+  PathGuidingTraining path_guiding;
+  bool path_guiding_need_training;
+
   DeviceRequestedFeatures requested_features;
 
   KernelFunctions<void (*)(KernelGlobals *, float *, int, int, int, int, int)> path_trace_kernel;
@@ -309,6 +436,9 @@ class CPUDevice : public Device {
 #ifdef WITH_OSL
     kernel_globals.osl = &osl_globals;
 #endif
+    kernel_globals.guiding = &path_guiding.guiding;
+    kernel_globals.guiding_path = NULL;
+    path_guiding_need_training = true;
 #ifdef WITH_EMBREE
     embree_device = rtcNewDevice("verbose=0");
 #endif
@@ -473,6 +603,10 @@ class CPUDevice : public Device {
   virtual void const_copy_to(const char *name, void *host, size_t size) override
   {
     kernel_const_copy(&kernel_globals, name, host, size);
+
+    if (strcmp(name, "__data") == 0) {
+      path_guiding_need_training = true;
+    }
   }
 
   void global_alloc(device_memory &mem)
@@ -514,7 +648,9 @@ class CPUDevice : public Device {
     }
 
     texture_info[slot] = mem.info;
-    texture_info[slot].data = (uint64_t)mem.host_pointer;
+    if (!mem.info.use_cache) {
+      texture_info[slot].data = (uint64_t)mem.host_pointer;
+    }
     need_texture_info = true;
   }
 
@@ -908,9 +1044,28 @@ class CPUDevice : public Device {
     }
   }
 
+  /* Render rows of a tile for a step of samples, until no rows are left. Samples of a pixel are
+   * still rendered in order, so the result is the same as rendering sample by sample. */
+  void path_trace_rows(KernelGlobals *kg, CPUTileRows &rows)
+  {
+    RenderTile &tile = rows.tile;
+    float *render_buffer = (float *)tile.buffer;
+
+    int y;
+    while (rows.next(y)) {
+      for (int x = tile.x; x < tile.x + tile.w; x++) {
+        for (int sample = rows.start_sample; sample < rows.end_sample; sample++) {
+          path_trace_kernel()(kg, render_buffer, sample, x, tile.y + y, tile.offset, tile.stride);
+        }
+      }
+    }
+  }
+
   void render(DeviceTask &task, RenderTile &tile, KernelGlobals *kg)
   {
     const bool use_coverage = kernel_data.film.cryptomatte_passes & CRYPT_ACCURATE;
+    /* Coverage is accumulated per thread, so those tiles can not be shared. */
+    const bool use_helpers = (tile.task == RenderTile::PATH_TRACE) && !use_coverage;
 
     scoped_timer timer(&tile.buffers->render_time);
 
@@ -926,7 +1081,11 @@ class CPUDevice : public Device {
     /* Needed for Embree. */
     SIMD_SET_FLUSH_TO_ZERO;
 
-    for (int sample = start_sample; sample < end_sample; sample++) {
+    if (use_helpers) {
+      tile_helpers.tile_begin();
+    }
+
+    for (int sample = start_sample; sample < end_sample;) {
       if (task.get_cancel() || task_pool.canceled()) {
         if (task.need_finish_queue == false)
           break;
@@ -937,27 +1096,54 @@ class CPUDevice : public Device {
         break;
       }
 
-      if (tile.task == RenderTile::PATH_TRACE) {
-        for (int y = tile.y; y < tile.y + tile.h; y++) {
-          for (int x = tile.x; x < tile.x + tile.w; x++) {
-            if (use_coverage) {
-              coverage.init_pixel(x, y);
-            }
-            path_trace_kernel()(kg, render_buffer, sample, x, y, tile.offset, tile.stride);
-          }
+      /* Render samples up to the next adaptive filter step at once, so that the rows of the
+       * tile are worth sharing with other threads. */
+      int step_end_sample = sample + 1;
+      if (task.adaptive_sampling.use) {
+        while (step_end_sample < end_sample &&
+               step_end_sample - sample < task.adaptive_sampling.adaptive_step &&
+               !task.adaptive_sampling.need_filter(step_end_sample - 1)) {
+          step_end_sample++;
+        }
+      }
+
+      if (use_helpers) {
+        CPUTileRows rows(tile, sample, step_end_sample);
+
+        const bool share_rows = tile_helpers.has_waiting();
+        if (share_rows) {
+          tile_helpers.add(&rows);
+        }
+
+        path_trace_rows(kg, rows);
+
+        if (share_rows) {
+          tile_helpers.remove(&rows);
         }
       }
       else {
-        for (int y = tile.y; y < tile.y + tile.h; y++) {
-          for (int x = tile.x; x < tile.x + tile.w; x++) {
-            bake_kernel()(kg, render_buffer, sample, x, y, tile.offset, tile.stride);
+        for (int step_sample = sample; step_sample < step_end_sample; step_sample++) {
+          for (int y = tile.y; y < tile.y + tile.h; y++) {
+            for (int x = tile.x; x < tile.x + tile.w; x++) {
+              if (tile.task == RenderTile::PATH_TRACE) {
+                if (use_coverage) {
+                  coverage.init_pixel(x, y);
+                }
+                path_trace_kernel()(
+                    kg, render_buffer, step_sample, x, y, tile.offset, tile.stride);
+              }
+              else {
+                bake_kernel()(kg, render_buffer, step_sample, x, y, tile.offset, tile.stride);
+              }
+            }
           }
         }
       }
-      tile.sample = sample + 1;
+      tile.sample = step_end_sample;
 
-      if (task.adaptive_sampling.use && task.adaptive_sampling.need_filter(sample)) {
-        const bool stop = adaptive_sampling_filter(kg, tile, sample);
+      const int last_sample = step_end_sample - 1;
+      if (task.adaptive_sampling.use && task.adaptive_sampling.need_filter(last_sample)) {
+        const bool stop = adaptive_sampling_filter(kg, tile, last_sample);
         if (stop) {
           const int num_progress_samples = end_sample - sample;
           tile.sample = end_sample;
@@ -966,8 +1152,14 @@ class CPUDevice : public Device {
         }
       }
 
-      task.update_progress(&tile, tile.w * tile.h);
+      task.update_progress(&tile, tile.w * tile.h * (step_end_sample - sample));
+      sample = step_end_sample;
+    }
+
+    if (use_helpers) {
+      tile_helpers.tile_end();
     }
+
     if (use_coverage) {
       coverage.finalize();
     }
@@ -1301,6 +1493,18 @@ class CPUDevice : public Device {
       }
     }
 
+    /* Out of tiles, help with rows of tiles other threads are still rendering. */
+    if ((tile_types & RenderTile::PATH_TRACE) && !use_split_kernel &&
+        !(task_pool.canceled() && task.need_finish_queue == false)) {
+      SIMD_SET_FLUSH_TO_ZERO;
+
+      CPUTileRows *rows;
+      while ((rows = tile_helpers.acquire()) != NULL) {
+        path_trace_rows(kg, *rows);
+        tile_helpers.release(rows);
+      }
+    }
+
     if (hold_denoise_lock) {
       oidn_task_lock.unlock();
     }
@@ -1430,6 +1634,26 @@ class CPUDevice : public Device {
       task.split(tasks, info.cpu_threads);
     }
 
+    if (task.type == DeviceTask::RENDER && (task.tile_types & RenderTile::PATH_TRACE) &&
+        path_guiding_need_training && !use_split_kernel &&
+        kernel_globals.__data.integrator.use_path_guiding) {
+      /* Train path guiding before rendering any tile, so the whole image is guided. */
+      path_guiding_need_training = false;
+
+      task_pool.push([=] {
+        DeviceTask task_copy = task;
+        path_guiding_train(task_copy);
+
+        foreach (const DeviceTask &subtask, tasks) {
+          task_pool.push([=] {
+            DeviceTask subtask_copy = subtask;
+            thread_run(subtask_copy);
+          });
+        }
+      });
+      return;
+    }
+
     foreach (DeviceTask &task, tasks) {
       task_pool.push([=] {
         DeviceTask task_copy = task;
@@ -1449,6 +1673,77 @@ class CPUDevice : public Device {
   }
 
  protected:
+  /* Render training passes for path guiding. Every pass traces a single sample for a quarter
+   * of the pixels of the full image, after which the distributions are fitted to the
+   * radiance recorded along the paths, so later passes are guided already. */
+  void path_guiding_train(DeviceTask &task)
+  {
+    const double start_time = time_dt();
+    const int num_passes = kernel_globals.__data.integrator.path_guiding_training_passes;
+    const int width = (int)kernel_globals.__data.cam.width;
+    const int height = (int)kernel_globals.__data.cam.height;
+
+    path_guiding.reset();
+
+    for (int pass = 0; pass < num_passes; pass++) {
+      if (task.get_cancel() || task_pool.canceled()) {
+        break;
+      }
+
+      int next_row = 0;
+      TaskPool pool;
+      for (int i = 0; i < info.cpu_threads; i++) {
+        pool.push([&] { path_guiding_train_rows(task, pass, width, height, &next_row); });
+      }
+      pool.wait_work();
+
+      path_guiding.update();
+    }
+
+    VLOG(1) << "Path guiding trained with " << num_passes << " passes in "
+            << time_dt() - start_time << " seconds, "
+            << path_guiding.guiding.distributions.size() << " leaves.";
+  }
+
+  void path_guiding_train_rows(DeviceTask &task, int pass, int width, int height, int *next_row)
+  {
+    SIMD_SET_FLUSH_TO_ZERO;
+
+    KernelGlobals *kg = new KernelGlobals(thread_kernel_globals_init());
+    PathGuidingPath path;
+    kg->guiding_path = &path;
+
+    /* Pixels only accumulate into a scratch buffer, the image is not affected. */
+    const int pass_stride = kernel_globals.__data.film.pass_stride;
+    vector<float> buffer(pass_stride);
+
+    const int pixel_x = pass & 1;
+    const int pixel_y = (pass >> 1) & 1;
+    const int num_rows = (height + 1) / 2;
+
+    int row;
+    while ((row = atomic_fetch_and_add_int32(next_row, 1)) < num_rows) {
+      const int y = row * 2 + pixel_y;
+      if (y >= height) {
+        continue;
+      }
+
+      for (int x = pixel_x; x < width; x += 2) {
+        memset(buffer.data(), 0, sizeof(float) * pass_stride);
+        path_trace_kernel()(kg, buffer.data(), pass, x, y, -x, 0);
+      }
+
+      if (task.get_cancel() || task_pool.canceled()) {
+        break;
+      }
+    }
+
+    path_guiding.add_samples(path.samples);
+
+    thread_kernel_globals_free(kg);
+    delete kg;
+  }
+
   inline KernelGlobals thread_kernel_globals_init()
   {
     KernelGlobals kg = kernel_globals;
@@ -1602,7 +1897,12 @@ int2 CPUSplitKernel::split_kernel_global_size(device_memory & /*kg*/,
                                               device_memory & /*data*/,
                                               DeviceTask & /*task*/)
 {
-  return make_int2(1, 1);
+  /* Every thread has its own split state, advancing a batch of paths through each kernel
+   * in turn. Larger batches give shader sorting more paths to group by shader, at the cost
+   * of state memory per thread. */
+  const int batch_size = max(DebugFlags().cpu.split_kernel_batch_size, 1);
+  VLOG(1) << "Using CPU split kernel batch size " << batch_size << ".";
+  return make_int2(batch_size, 1);
 }
 
 uint64_t CPUSplitKernel::state_buffer_size(device_memory &kernel_globals,
@@ -66,6 +66,25 @@ class MultiDevice : public Device {
       sub->device = Device::create(subinfo, sub->stats, profiler, background);
     }
 
+#ifdef WITH_NETWORK
+    /* try to add network devices, unless the servers were listed explicitly */
+    if (info.type != DEVICE_NETWORK) {
+      ServerDiscovery discovery(true);
+      time_sleep(1.0);
+
+      vector<string> servers = discovery.get_server_list();
+
+      foreach (string &server, servers) {
+        devices.emplace_front();
+        SubDevice *sub = &devices.front();
+        sub->device = device_network_create(info, sub->stats, profiler, server.c_str());
+        if (sub->device == NULL) {
+          devices.pop_front();
+        }
+      }
+    }
+#endif
+
     foreach (DeviceInfo &subinfo, info.denoising_devices) {
       denoising_devices.emplace_front();
       SubDevice *sub = &denoising_devices.front();
@@ -117,20 +136,6 @@ class MultiDevice : public Device {
         }
       }
     }
-
-#ifdef WITH_NETWORK
-    /* try to add network devices */
-    ServerDiscovery discovery(true);
-    time_sleep(1.0);
-
-    vector<string> servers = discovery.get_server_list();
-
-    foreach (string &server, servers) {
-      Device *device = device_network_create(info, stats, profiler, server.c_str());
-      if (device)
-        devices.push_back(SubDevice(device));
-    }
-#endif
   }
 
   ~MultiDevice()
@@ -18,11 +18,18 @@
 #include "device/device.h"
 #include "device/device_intern.h"
 
+#include "util/util_algorithm.h"
 #include "util/util_foreach.h"
+#include "util/util_half.h"
 #include "util/util_logging.h"
+#include "util/util_set.h"
+#include "util/util_time.h"
 
 #if defined(WITH_NETWORK)
 
+#  include <atomic>
+#  include <zlib.h>
+
 CCL_NAMESPACE_BEGIN
 
 typedef map<device_ptr, device_ptr> PtrMap;
@@ -41,29 +48,367 @@ static TileList::iterator tile_list_find(TileList &tile_list, RenderTile &tile)
   return tile_list.end();
 }
 
+/* Tile Pixel Compression
+ *
+ * The pixels of every finished tile are sent back along with the released tile. Floats are
+ * optionally converted to half floats, and bytes of the same significance are grouped together
+ * before compressing with zlib, which compresses render passes much better than the plain
+ * floats. Half floats are lossy, so they are only used when requested. The render buffer holds
+ * the sum of all samples, which is scaled down to the average before the conversion to half to
+ * stay within its range. Passes holding IDs or adaptive sampling state are always sent as full
+ * floats, as they are not usable after rounding. */
+
+typedef enum NetworkCompression {
+  NETWORK_COMPRESSION_NONE = 0,
+  NETWORK_COMPRESSION_LOSSLESS = 1,
+  NETWORK_COMPRESSION_HALF = 2,
+} NetworkCompression;
+
+static NetworkCompression network_compression_from_env()
+{
+  const char *compression = getenv("CYCLES_NETWORK_COMPRESSION");
+
+  if (compression == NULL || strcmp(compression, "lossless") == 0) {
+    return NETWORK_COMPRESSION_LOSSLESS;
+  }
+  else if (strcmp(compression, "half") == 0) {
+    return NETWORK_COMPRESSION_HALF;
+  }
+  else if (strcmp(compression, "none") == 0) {
+    return NETWORK_COMPRESSION_NONE;
+  }
+
+  VLOG(1) << "Unknown network compression " << compression << ", using lossless.";
+  return NETWORK_COMPRESSION_LOSSLESS;
+}
+
+/* Flags for the components of a pixel in the render buffer, set for components that are never
+ * converted to half floats. */
+static vector<int> network_pixels_lossless_components(BufferParams &params)
+{
+  vector<int> lossless_components(params.get_passes_size(), 0);
+  int offset = 0;
+
+  foreach (const Pass &pass, params.passes) {
+    switch (pass.type) {
+      case PASS_OBJECT_ID:
+      case PASS_MATERIAL_ID:
+      case PASS_CRYPTOMATTE:
+      case PASS_ADAPTIVE_AUX_BUFFER:
+      case PASS_SAMPLE_COUNT:
+        for (int i = 0; i < pass.components; i++) {
+          lossless_components[offset + i] = 1;
+        }
+        break;
+      default:
+        break;
+    }
+    offset += pass.components;
+  }
+
+  return lossless_components;
+}
+
+static size_t network_pixels_num_lossless(size_t num_pixels,
+                                          const vector<int> &lossless_components)
+{
+  const size_t pass_stride = lossless_components.size();
+  size_t num_lossless = 0;
+
+  for (size_t i = 0; i < pass_stride; i++) {
+    if (lossless_components[i]) {
+      num_lossless++;
+    }
+  }
+
+  return pass_stride ? num_lossless * (num_pixels / pass_stride) : 0;
+}
+
+static void network_pixels_pack(const float *pixels,
+                                size_t num_pixels,
+                                NetworkCompression compression,
+                                float scale,
+                                const vector<int> &lossless_components,
+                                DataVector &packed)
+{
+  packed.clear();
+
+  if (num_pixels == 0) {
+    return;
+  }
+
+  if (compression == NETWORK_COMPRESSION_NONE) {
+    packed.resize(num_pixels * sizeof(float));
+    memcpy(&packed[0], pixels, packed.size());
+    return;
+  }
+
+  /* Group bytes of the same significance. */
+  DataVector shuffled;
+
+  if (compression == NETWORK_COMPRESSION_HALF) {
+    /* Half floats first, followed by the components sent as full floats. */
+    const size_t pass_stride = lossless_components.size();
+    const size_t num_lossless = network_pixels_num_lossless(num_pixels, lossless_components);
+    const size_t num_half = num_pixels - num_lossless;
+    shuffled.resize(num_half * sizeof(half) + num_lossless * sizeof(float));
+    uint8_t *lossless_shuffled = &shuffled[num_half * sizeof(half)];
+
+    for (size_t i = 0, h = 0, f = 0; i < num_pixels; i++) {
+      if (pass_stride && lossless_components[i % pass_stride]) {
+        const uint8_t *bytes = (const uint8_t *)&pixels[i];
+        for (size_t b = 0; b < sizeof(float); b++) {
+          lossless_shuffled[b * num_lossless + f] = bytes[b];
+        }
+        f++;
+      }
+      else {
+        const unsigned short value = float_to_half(pixels[i] * scale);
+        shuffled[h] = (uint8_t)(value & 0xff);
+        shuffled[num_half + h] = (uint8_t)(value >> 8);
+        h++;
+      }
+    }
+  }
+  else {
+    const uint8_t *bytes = (const uint8_t *)pixels;
+    shuffled.resize(num_pixels * sizeof(float));
+    for (size_t i = 0; i < num_pixels; i++) {
+      for (size_t b = 0; b < sizeof(float); b++) {
+        shuffled[b * num_pixels + i] = bytes[i * sizeof(float) + b];
+      }
+    }
+  }
+
+  /* The first byte tells whether the shuffled bytes are compressed, they are sent as is when
+   * zlib fails. */
+  uLongf packed_size = compressBound(shuffled.size());
+  packed.resize(1 + packed_size);
+  if (compress2(&packed[1], &packed_size, &shuffled[0], shuffled.size(), Z_BEST_SPEED) == Z_OK) {
+    packed[0] = 1;
+    packed.resize(1 + packed_size);
+  }
+  else {
+    VLOG(1) << "Failed to compress tile pixels, sending them uncompressed.";
+    packed[0] = 0;
+    packed.resize(1 + shuffled.size());
+    memcpy(&packed[1], &shuffled[0], shuffled.size());
+  }
+}
+
+static bool network_pixels_unpack(const DataVector &packed,
+                                  size_t num_pixels,
+                                  NetworkCompression compression,
+                                  float scale,
+                                  const vector<int> &lossless_components,
+                                  float *pixels)
+{
+  if (num_pixels == 0) {
+    return packed.empty();
+  }
+
+  if (compression == NETWORK_COMPRESSION_NONE) {
+    if (packed.size() != num_pixels * sizeof(float)) {
+      return false;
+    }
+    memcpy(pixels, &packed[0], packed.size());
+    return true;
+  }
+
+  const size_t pass_stride = lossless_components.size();
+  const size_t num_lossless = (compression == NETWORK_COMPRESSION_HALF) ?
+                                  network_pixels_num_lossless(num_pixels, lossless_components) :
+                                  num_pixels;
+  const size_t num_half = num_pixels - num_lossless;
+  DataVector shuffled(num_half * sizeof(half) + num_lossless * sizeof(float));
+  uLongf shuffled_size = shuffled.size();
+
+  if (packed.empty()) {
+    return false;
+  }
+  else if (packed[0] == 0) {
+    if (packed.size() != 1 + shuffled.size()) {
+      return false;
+    }
+    memcpy(&shuffled[0], &packed[1], shuffled.size());
+  }
+  else if (uncompress(&shuffled[0], &shuffled_size, &packed[1], packed.size() - 1) != Z_OK ||
+           shuffled_size != shuffled.size()) {
+    return false;
+  }
+
+  if (compression == NETWORK_COMPRESSION_HALF) {
+    const float inv_scale = 1.0f / scale;
+    const uint8_t *lossless_shuffled = &shuffled[num_half * sizeof(half)];
+
+    for (size_t i = 0, h = 0, f = 0; i < num_pixels; i++) {
+      if (pass_stride && lossless_components[i % pass_stride]) {
+        uint8_t *bytes = (uint8_t *)&pixels[i];
+        for (size_t b = 0; b < sizeof(float); b++) {
+          bytes[b] = lossless_shuffled[b * num_lossless + f];
+        }
+        f++;
+      }
+      else {
+        const unsigned short value = shuffled[h] | (shuffled[num_half + h] << 8);
+        /* Zero has no exponent bits, which half_to_float does not handle. */
+        pixels[i] = ((value & 0x7fff) == 0) ? 0.0f : half_to_float(value) * inv_scale;
+        h++;
+      }
+    }
+  }
+  else {
+    uint8_t *bytes = (uint8_t *)pixels;
+    for (size_t i = 0; i < num_pixels; i++) {
+      for (size_t b = 0; b < sizeof(float); b++) {
+        bytes[i * sizeof(float) + b] = shuffled[b * num_pixels + i];
+      }
+    }
+  }
+
+  return true;
+}
+
+/* Tiles rendered into render buffers of their own, rather than buffers shared by all tiles as
+ * in progressive and viewport rendering. Only these can move to another server. */
+static bool network_tile_owns_buffers(const RenderTile &tile)
+{
+  const BufferParams &params = tile.buffers->params;
+  return params.full_x == tile.x && params.full_y == tile.y && params.width == tile.w &&
+         params.height == tile.h;
+}
+
+/* Scale applied to tile pixels before conversion to half floats. */
+static float network_pixels_scale(const RenderTile &tile)
+{
+  return 1.0f / max(tile.sample, 1);
+}
+
+/* Network Render Group
+ *
+ * All network devices working on a render task at the same time. Servers prefetch tiles, so at
+ * the end of a render a server that ran out of tiles can steal tiles that are still waiting in
+ * the queue of a slower server. Statistics of all servers are combined to report the scaling
+ * efficiency once the last server finished. */
+
+class NetworkDevice;
+
+struct NetworkRenderStats {
+  int num_tiles;
+  uint64_t pixel_samples;
+  /* Seconds spent rendering tiles, summed over all render threads of the server. */
+  double busy_time;
+  int num_threads;
+  size_t bytes_raw;
+  size_t bytes_received;
+  double start_time;
+  double end_time;
+
+  NetworkRenderStats()
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    num_tiles = 0;
+    pixel_samples = 0;
+    busy_time = 0.0;
+    num_threads = 0;
+    bytes_raw = 0;
+    bytes_received = 0;
+    start_time = 0.0;
+    end_time = 0.0;
+  }
+};
+
+class NetworkRenderGroup {
+ public:
+  void add(NetworkDevice *device);
+  /* Returns false if the device still has to wait for a steal request sent to its server. */
+  bool remove(NetworkDevice *device, bool force);
+
+  /* Called when the server of the thief asked for more tiles than the session had left. */
+  void steal_tile(NetworkDevice *thief, int num_tiles);
+  /* Called when the server of the victim replied to a steal request, with the tile or NULL. */
+  void steal_done(NetworkDevice *victim, RenderTile *tile);
+
+ protected:
+  void steal_tile_locked(NetworkDevice *thief);
+  void report();
+
+  thread_mutex mutex;
+  vector<NetworkDevice *> devices;
+  NetworkRenderStats stats;
+};
+
+static NetworkRenderGroup network_render_group;
+
+/* Network Device */
+
 class NetworkDevice : public Device {
  public:
   boost::asio::io_service io_service;
   tcp::socket socket;
+  string address;
   device_ptr mem_counter;
   DeviceTask the_task; /* todo: handle multiple tasks */
 
+  /* Lock for sending. While a task runs only its thread reads from the socket, replies to
+   * the server can be sent from any thread. */
   thread_mutex rpc_lock;
 
+  thread *task_thread;
+  NetworkCompression compression;
+
+  /* Tiles sent to the server and not released yet, and render buffers of which the host
+   * memory already contains the pixels sent along with the released tile. */
+  thread_mutex tile_lock;
+  TileList the_tiles;
+  set<device_ptr> received_buffers;
+
+  /* Tile stealing state, protected by the render group lock. Number of tiles requested by
+   * the server that could not be sent yet, whether a steal request for these is in progress,
+   * and the device waiting for the reply to a steal request sent to our server. */
+  int tiles_requested;
+  bool stealing;
+  NetworkDevice *steal_thief;
+
+  /* Number of tiles waiting in the queue of the server that can be stolen, as last reported
+   * by it. */
+  std::atomic<int> server_queued_tiles;
+
+  NetworkRenderStats render_stats;
+
   virtual bool show_samples() const
   {
     return false;
   }
 
   NetworkDevice(DeviceInfo &info, Stats &stats, Profiler &profiler, const char *address)
-      : Device(info, stats, profiler, true), socket(io_service)
+      : Device(info, stats, profiler, true),
+        socket(io_service),
+        address(address),
+        task_thread(NULL),
+        tiles_requested(0),
+        stealing(false),
+        steal_thief(NULL),
+        server_queued_tiles(0)
   {
     error_func = NetworkError();
-    stringstream portstr;
-    portstr << SERVER_PORT;
+    compression = network_compression_from_env();
+
+    /* Address is either "host" or "host:port". */
+    string host = address;
+    string port = string_printf("%d", SERVER_PORT);
+    size_t port_pos = host.rfind(':');
+    if (port_pos != string::npos) {
+      port = host.substr(port_pos + 1);
+      host = host.substr(0, port_pos);
+    }
 
     tcp::resolver resolver(io_service);
-    tcp::resolver::query query(address, portstr.str());
+    tcp::resolver::query query(host, port);
     tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
     tcp::resolver::iterator end;
 
@@ -81,6 +426,8 @@ class NetworkDevice : public Device {
 
   ~NetworkDevice()
   {
+    task_wait();
+
     RPCSend snd(socket, &error_func, "stop");
     snd.write();
   }
@@ -109,6 +456,10 @@ class NetworkDevice : public Device {
 
   void mem_copy_to(device_memory &mem)
   {
+    if (!mem.device_pointer) {
+      mem_alloc(mem);
+    }
+
     thread_scoped_lock lock(rpc_lock);
 
     RPCSend snd(socket, &error_func, "mem_copy_to");
@@ -120,6 +471,14 @@ class NetworkDevice : public Device {
 
   void mem_copy_from(device_memory &mem, int y, int w, int h, int elem)
   {
+    {
+      /* Pixels of render buffers were already sent along with the released tile. */
+      thread_scoped_lock tile_lock_(tile_lock);
+      if (received_buffers.count(mem.device_pointer)) {
+        return;
+      }
+    }
+
     thread_scoped_lock lock(rpc_lock);
 
     size_t data_size = mem.memory_size();
@@ -139,6 +498,15 @@ class NetworkDevice : public Device {
 
   void mem_zero(device_memory &mem)
   {
+    if (!mem.device_pointer) {
+      mem_alloc(mem);
+    }
+
+    {
+      thread_scoped_lock tile_lock_(tile_lock);
+      received_buffers.erase(mem.device_pointer);
+    }
+
     thread_scoped_lock lock(rpc_lock);
 
     RPCSend snd(socket, &error_func, "mem_zero");
@@ -150,6 +518,11 @@ class NetworkDevice : public Device {
   void mem_free(device_memory &mem)
   {
     if (mem.device_pointer) {
+      {
+        thread_scoped_lock tile_lock_(tile_lock);
+        received_buffers.erase(mem.device_pointer);
+      }
+
       thread_scoped_lock lock(rpc_lock);
 
       RPCSend snd(socket, &error_func, "mem_free");
@@ -184,7 +557,6 @@ class NetworkDevice : public Device {
 
     RPCSend snd(socket, &error_func, "load_kernels");
     snd.add(requested_features.experimental);
-    snd.add(requested_features.max_closure);
     snd.add(requested_features.max_nodes_group);
     snd.add(requested_features.nodes_features);
     snd.write();
@@ -198,106 +570,464 @@ class NetworkDevice : public Device {
 
   void task_add(DeviceTask &task)
   {
-    thread_scoped_lock lock(rpc_lock);
+    /* The server runs one task at a time. */
+    task_wait();
 
     the_task = task;
 
-    RPCSend snd(socket, &error_func, "task_add");
-    snd.add(task);
-    snd.write();
+    {
+      thread_scoped_lock lock(rpc_lock);
+
+      RPCSend snd(socket, &error_func, "task_add");
+      snd.add(task);
+      snd.add((int)compression);
+      snd.write();
+    }
+
+    {
+      thread_scoped_lock lock(rpc_lock);
+
+      RPCSend snd(socket, &error_func, "task_wait");
+      snd.write();
+    }
+
+    /* Handle requests of the server in a thread, so that the task runs on multiple servers at
+     * the same time when used in a multi device. */
+    task_thread = new thread(function_bind(&NetworkDevice::task_run, this));
   }
 
   void task_wait()
+  {
+    if (task_thread) {
+      task_thread->join();
+      delete task_thread;
+      task_thread = NULL;
+    }
+  }
+
+  void task_cancel()
+  {
+    thread_scoped_lock lock(rpc_lock);
+    RPCSend snd(socket, &error_func, "task_cancel");
+    snd.write();
+  }
+
+  int get_split_task_count(DeviceTask &)
+  {
+    return 1;
+  }
+
+  /* Send tiles to the server, which queues them for its render threads. */
+  void send_tiles(const vector<RenderTile> &tiles)
   {
     thread_scoped_lock lock(rpc_lock);
 
-    RPCSend snd(socket, &error_func, "task_wait");
+    RPCSend snd(socket, &error_func, "acquire_tile");
+    snd.add((int)tiles.size());
+    foreach (const RenderTile &tile, tiles) {
+      snd.add(tile);
+      snd.add(tile.buffers->params.get_passes_size());
+      snd.add(network_pixels_lossless_components(tile.buffers->params));
+      snd.add(network_tile_owns_buffers(tile));
+    }
     snd.write();
+  }
 
-    lock.unlock();
+  /* Tell the server no more tiles will be sent for this task. */
+  void send_no_tiles()
+  {
+    thread_scoped_lock lock(rpc_lock);
 
-    TileList the_tiles;
+    RPCSend snd(socket, &error_func, "acquire_tile_none");
+    snd.write();
+  }
 
-    /* todo: run this threaded for connecting to multiple clients */
-    for (;;) {
-      if (error_func.have_error())
-        break;
+  void send_steal_request()
+  {
+    thread_scoped_lock lock(rpc_lock);
 
-      RenderTile tile;
+    RPCSend snd(socket, &error_func, "steal_tile");
+    snd.write();
+  }
+
+  void mark_buffer_received(device_ptr buffer)
+  {
+    thread_scoped_lock lock(tile_lock);
+    received_buffers.insert(buffer);
+  }
+
+ protected:
+  void task_run()
+  {
+    const bool is_render = (the_task.type == DeviceTask::RENDER);
 
-      lock.lock();
+    if (is_render) {
+      render_stats.reset();
+      render_stats.start_time = time_dt();
+      network_render_group.add(this);
+    }
+
+    bool done = false;
+
+    while (!error_func.have_error()) {
       RPCReceive rcv(socket, &error_func);
 
       if (rcv.name == "acquire_tile") {
-        lock.unlock();
-
-        /* todo: watch out for recursive calls! */
-        if (the_task.acquire_tile(this, tile)) { /* write return as bool */
-          the_tiles.push_back(tile);
+        int num_tiles, queued_tiles;
+        rcv.read(num_tiles);
+        rcv.read(queued_tiles);
+        server_queued_tiles = queued_tiles;
 
-          lock.lock();
-          RPCSend snd(socket, &error_func, "acquire_tile");
-          snd.add(tile);
-          snd.write();
-          lock.unlock();
-        }
-        else {
-          lock.lock();
-          RPCSend snd(socket, &error_func, "acquire_tile_none");
-          snd.write();
-          lock.unlock();
-        }
+        acquire_tiles(num_tiles);
       }
       else if (rcv.name == "release_tile") {
-        rcv.read(tile);
-        lock.unlock();
-
-        TileList::iterator it = tile_list_find(the_tiles, tile);
-        if (it != the_tiles.end()) {
-          tile.buffers = it->buffers;
-          the_tiles.erase(it);
+        release_tile(rcv);
+      }
+      else if (rcv.name == "steal_tile") {
+        bool found;
+        int queued_tiles;
+        RenderTile tile;
+        rcv.read(found);
+        rcv.read(queued_tiles);
+        server_queued_tiles = queued_tiles;
+
+        if (found) {
+          rcv.read(tile);
+
+          thread_scoped_lock lock(tile_lock);
+          TileList::iterator it = tile_list_find(the_tiles, tile);
+          if (it != the_tiles.end()) {
+            tile = *it;
+            the_tiles.erase(it);
+          }
+          else {
+            found = false;
+          }
         }
 
-        assert(tile.buffers != NULL);
-
-        the_task.release_tile(tile);
-
-        lock.lock();
-        RPCSend snd(socket, &error_func, "release_tile");
-        snd.write();
-        lock.unlock();
+        network_render_group.steal_done(this, found ? &tile : NULL);
       }
       else if (rcv.name == "task_wait_done") {
-        lock.unlock();
-        break;
+        rcv.read(render_stats.busy_time);
+        rcv.read(render_stats.num_threads);
+        render_stats.end_time = time_dt();
+        done = true;
       }
-      else
-        lock.unlock();
+      else {
+        cout << "Error: unexpected RPC receive call \"" + rcv.name + "\"\n";
+      }
+
+      /* Keep reading until the reply to a pending steal request arrived. */
+      if (done && (!is_render || network_render_group.remove(this, false))) {
+        return;
+      }
+    }
+
+    if (is_render) {
+      render_stats.end_time = time_dt();
+      network_render_group.remove(this, true);
     }
   }
 
-  void task_cancel()
+  /* Acquire tiles requested by the server from the session. When the session has no more
+   * tiles, try stealing them from other servers. */
+  void acquire_tiles(int num_tiles)
   {
-    thread_scoped_lock lock(rpc_lock);
-    RPCSend snd(socket, &error_func, "task_cancel");
-    snd.write();
+    vector<RenderTile> tiles;
+
+    for (int i = 0; i < num_tiles; i++) {
+      RenderTile tile;
+      if (!the_task.acquire_tile(this, tile, the_task.tile_types)) {
+        break;
+      }
+      tiles.push_back(tile);
+    }
+
+    if (!tiles.empty()) {
+      {
+        thread_scoped_lock lock(tile_lock);
+        the_tiles.insert(the_tiles.end(), tiles.begin(), tiles.end());
+      }
+      send_tiles(tiles);
+    }
+
+    if ((int)tiles.size() < num_tiles) {
+      if (the_task.type == DeviceTask::RENDER && !the_task.get_cancel()) {
+        network_render_group.steal_tile(this, num_tiles - (int)tiles.size());
+      }
+      else {
+        send_no_tiles();
+      }
+    }
   }
 
-  int get_split_task_count(DeviceTask &)
+  /* Receive pixels of a finished tile into the host memory of its render buffers. */
+  void release_tile(RPCReceive &rcv)
   {
-    return 1;
+    RenderTile tile;
+    double tile_time;
+    int queued_tiles;
+    size_t packed_size;
+
+    rcv.read(tile);
+    rcv.read(tile_time);
+    rcv.read(queued_tiles);
+    rcv.read(packed_size);
+    server_queued_tiles = queued_tiles;
+
+    DataVector packed(packed_size);
+    if (packed_size) {
+      rcv.read_buffer(&packed[0], packed_size);
+    }
+
+    {
+      thread_scoped_lock lock(tile_lock);
+      TileList::iterator it = tile_list_find(the_tiles, tile);
+      if (it == the_tiles.end()) {
+        error_func.network_error("Network receive error: released tile was not acquired");
+        return;
+      }
+      tile.buffers = it->buffers;
+      tile.buffer = it->buffer;
+      the_tiles.erase(it);
+    }
+
+    assert(tile.buffers != NULL);
+
+    RenderBuffers *buffers = tile.buffers;
+    const int pass_stride = buffers->params.get_passes_size();
+    const size_t row_size = (size_t)tile.w * pass_stride;
+    vector<float> pixels(row_size * tile.h);
+
+    if (network_pixels_unpack(packed,
+                              pixels.size(),
+                              compression,
+                              network_pixels_scale(tile),
+                              network_pixels_lossless_components(buffers->params),
+                              pixels.data())) {
+      float *buffer = buffers->buffer.data();
+      for (int y = 0; y < tile.h; y++) {
+        const size_t index = (size_t)(tile.offset + tile.x + (tile.y + y) * tile.stride) *
+                             pass_stride;
+        memcpy(buffer + index, &pixels[y * row_size], row_size * sizeof(float));
+      }
+      mark_buffer_received(tile.buffer);
+    }
+    else {
+      error_func.network_error("Network receive error: failed to decompress tile");
+    }
+
+    render_stats.num_tiles++;
+    render_stats.pixel_samples += (uint64_t)tile.w * tile.h * tile.num_samples;
+    render_stats.bytes_raw += pixels.size() * sizeof(float);
+    render_stats.bytes_received += packed_size;
+
+    the_task.release_tile(tile);
   }
 
  private:
   NetworkError error_func;
 };
 
+void NetworkRenderGroup::add(NetworkDevice *device)
+{
+  thread_scoped_lock lock(mutex);
+
+  if (devices.empty()) {
+    stats.reset();
+    stats.start_time = device->render_stats.start_time;
+  }
+
+  devices.push_back(device);
+}
+
+bool NetworkRenderGroup::remove(NetworkDevice *device, bool force)
+{
+  thread_scoped_lock lock(mutex);
+
+  if (device->steal_thief && !force) {
+    return false;
+  }
+
+  vector<NetworkDevice *>::iterator it = std::find(devices.begin(), devices.end(), device);
+  if (it == devices.end()) {
+    return true;
+  }
+  devices.erase(it);
+
+  if (force) {
+    /* Server failed, so a thief waiting for it will not get a tile, and a steal request of
+     * this device can not be answered anymore. */
+    if (device->steal_thief) {
+      NetworkDevice *thief = device->steal_thief;
+      device->steal_thief = NULL;
+      thief->stealing = false;
+      steal_tile_locked(thief);
+    }
+    foreach (NetworkDevice *victim, devices) {
+      if (victim->steal_thief == device) {
+        victim->steal_thief = NULL;
+      }
+    }
+  }
+
+  const NetworkRenderStats &device_stats = device->render_stats;
+  const double time = device_stats.end_time - device_stats.start_time;
+  const double thread_time = time * device_stats.num_threads;
+
+  VLOG(1) << "Network server " << device->address << ": " << device_stats.num_tiles
+          << " tiles, "
+          << string_printf("%.2f", (time > 0.0) ? device_stats.pixel_samples / time * 1e-6 : 0.0)
+          << " Msamples/s, "
+          << string_printf("%.1f",
+                           (thread_time > 0.0) ? 100.0 * device_stats.busy_time / thread_time :
+                                                 0.0)
+          << "% busy, "
+          << string_human_readable_size(device_stats.bytes_received) << " received for "
+          << string_human_readable_size(device_stats.bytes_raw) << " of pixels.";
+
+  stats.num_tiles += device_stats.num_tiles;
+  stats.pixel_samples += device_stats.pixel_samples;
+  stats.busy_time += device_stats.busy_time;
+  stats.num_threads += device_stats.num_threads;
+  stats.bytes_raw += device_stats.bytes_raw;
+  stats.bytes_received += device_stats.bytes_received;
+  stats.end_time = max(stats.end_time, device_stats.end_time);
+
+  if (devices.empty()) {
+    report();
+  }
+
+  return true;
+}
+
+/* Scaling efficiency is the fraction of the time render threads of all servers spent rendering,
+ * from when the task started on the first server until the last server finished. Time lost
+ * waiting for tiles, for the network or for other servers to finish reduces it. */
+void NetworkRenderGroup::report()
+{
+  const double time = stats.end_time - stats.start_time;
+  const double thread_time = time * stats.num_threads;
+
+  if (time <= 0.0 || stats.num_tiles == 0) {
+    return;
+  }
+
+  VLOG(1) << "Network render: " << stats.num_tiles << " tiles in "
+          << string_printf("%.2f", time) << "s, "
+          << string_printf("%.2f", stats.pixel_samples / time * 1e-6) << " Msamples/s, "
+          << string_printf("%.1f",
+                           (thread_time > 0.0) ? 100.0 * stats.busy_time / thread_time : 0.0)
+          << "% scaling efficiency, "
+          << string_printf("%.2f",
+                           (stats.bytes_received > 0) ?
+                               (double)stats.bytes_raw / stats.bytes_received :
+                               1.0)
+          << "x pixel compression.";
+}
+
+void NetworkRenderGroup::steal_tile(NetworkDevice *thief, int num_tiles)
+{
+  thread_scoped_lock lock(mutex);
+  thief->tiles_requested += num_tiles;
+  steal_tile_locked(thief);
+}
+
+void NetworkRenderGroup::steal_tile_locked(NetworkDevice *thief)
+{
+  if (thief->stealing || thief->tiles_requested == 0) {
+    return;
+  }
+
+  /* Steal from the server with the most tiles waiting in its queue. */
+  NetworkDevice *victim = NULL;
+  foreach (NetworkDevice *device, devices) {
+    if (device != thief && device->steal_thief == NULL && device->server_queued_tiles > 0 &&
+        (victim == NULL || device->server_queued_tiles > victim->server_queued_tiles)) {
+      victim = device;
+    }
+  }
+
+  if (victim) {
+    thief->stealing = true;
+    victim->steal_thief = thief;
+    victim->send_steal_request();
+  }
+  else {
+    /* Nothing left to steal, the server can finish once its queue is empty. */
+    thief->tiles_requested = 0;
+    thief->send_no_tiles();
+  }
+}
+
+void NetworkRenderGroup::steal_done(NetworkDevice *victim, RenderTile *tile)
+{
+  thread_scoped_lock lock(mutex);
+
+  NetworkDevice *thief = victim->steal_thief;
+  victim->steal_thief = NULL;
+
+  if (thief == NULL) {
+    /* Thief failed in the meantime, render the tile on the victim after all. */
+    if (tile) {
+      {
+        thread_scoped_lock tile_lock(victim->tile_lock);
+        victim->the_tiles.push_back(*tile);
+      }
+      victim->send_tiles(vector<RenderTile>(1, *tile));
+    }
+    return;
+  }
+
+  thief->stealing = false;
+
+  if (tile) {
+    /* The tile was not started yet, so its pixels hold what the session initialized them
+     * with, which is zero unless baking. Only tiles owning their render buffers are stolen,
+     * so moving the buffers does not affect other tiles. */
+    RenderBuffers *buffers = tile->buffers;
+    if (tile->task == RenderTile::PATH_TRACE) {
+      const int pass_stride = buffers->params.get_passes_size();
+      float *buffer = buffers->buffer.data();
+      for (int y = 0; y < tile->h; y++) {
+        const size_t index = (size_t)(tile->offset + tile->x + (tile->y + y) * tile->stride) *
+                             pass_stride;
+        memset(buffer + index, 0, sizeof(float) * tile->w * pass_stride);
+      }
+    }
+    victim->mark_buffer_received(buffers->buffer.device_pointer);
+    buffers->buffer.move_device(thief);
+    tile->buffer = buffers->buffer.device_pointer;
+
+    {
+      thread_scoped_lock tile_lock(thief->tile_lock);
+      thief->the_tiles.push_back(*tile);
+    }
+    thief->tiles_requested--;
+    thief->send_tiles(vector<RenderTile>(1, *tile));
+
+    VLOG(2) << "Network server " << thief->address << " stole tile from "
+            << victim->address << ".";
+  }
+
+  steal_tile_locked(thief);
+}
+
 Device *device_network_create(DeviceInfo &info,
                               Stats &stats,
                               Profiler &profiler,
                               const char *address)
 {
-  return new NetworkDevice(info, stats, profiler, address);
+  /* Without explicit address, use the one from the device ID, e.g. "NETWORK_127.0.0.1:5120". */
+  string server_address = "127.0.0.1";
+  if (address) {
+    server_address = address;
+  }
+  else if (string_startswith(info.id, "NETWORK_")) {
+    server_address = info.id.substr(strlen("NETWORK_"));
+  }
+
+  return new NetworkDevice(info, stats, profiler, server_address.c_str());
 }
 
 void device_network_info(vector<DeviceInfo> &devices)
@@ -315,11 +1045,44 @@ void device_network_info(vector<DeviceInfo> &devices)
   info.has_osl = false;
   info.denoisers = DENOISER_NONE;
 
+  /* Servers can be listed explicitly as "host:port,host:port", for example to run multiple
+   * servers on the same host. Multiple servers are combined in a multi device. */
+  const char *servers = getenv("CYCLES_NETWORK_SERVERS");
+  if (servers) {
+    vector<string> addresses;
+    string_split(addresses, servers, ",");
+
+    foreach (const string &address, addresses) {
+      DeviceInfo server_info = info;
+      server_info.id = "NETWORK_" + address;
+      server_info.description = "Network Device " + address;
+
+      if (addresses.size() == 1) {
+        info = server_info;
+      }
+      else {
+        info.multi_devices.push_back(server_info);
+      }
+    }
+  }
+
   devices.push_back(info);
 }
 
+/* Server tile, with the render buffer pointer translated to the real device pointer. */
+struct ServerTile {
+  RenderTile tile;
+  device_ptr client_buffer;
+  int pass_stride;
+  vector<int> lossless_components;
+  /* Whether the tile may be given to another server. */
+  bool stealable;
+  double start_time;
+};
+
 class DeviceServer {
  public:
+  /* Lock for sending, only the listening thread reads from the socket. */
   thread_mutex rpc_lock;
 
   void network_error(const string &message)
@@ -333,34 +1096,43 @@ class DeviceServer {
   }
 
   DeviceServer(Device *device_, tcp::socket &socket_)
-      : device(device_), socket(socket_), stop(false), blocked_waiting(false)
+      : device(device_),
+        socket(socket_),
+        stop(false),
+        compression(NETWORK_COMPRESSION_LOSSLESS),
+        wait_thread(NULL)
   {
     error_func = NetworkError();
+    tiles_reset();
+  }
+
+  ~DeviceServer()
+  {
+    task_wait_join();
   }
 
   void listen()
   {
     /* receive remote function calls */
-    for (;;) {
-      listen_step();
+    while (!stop && !have_error()) {
+      RPCReceive rcv(socket, &error_func);
 
-      if (stop)
-        break;
+      if (rcv.name == "stop")
+        stop = true;
+      else
+        process(rcv);
     }
-  }
 
- protected:
-  void listen_step()
-  {
-    thread_scoped_lock lock(rpc_lock);
-    RPCReceive rcv(socket, &error_func);
+    /* Wake up render threads waiting for tiles, so the running task can finish. */
+    {
+      thread_scoped_lock lock(tile_lock);
+      tile_cond.notify_all();
+    }
 
-    if (rcv.name == "stop")
-      stop = true;
-    else
-      process(rcv, lock);
+    task_wait_join();
   }
 
+ protected:
   /* create a memory buffer for a device buffer and insert it into mem_data */
   DataVector &data_vector_insert(device_ptr client_pointer, size_t data_size)
   {
@@ -431,18 +1203,16 @@ class DeviceServer {
     return result;
   }
 
-  /* note that the lock must be already acquired upon entry.
-   * This is necessary because the caller often peeks at
-   * the header and delegates control to here when it doesn't
-   * specifically handle the current RPC.
-   * The lock must be unlocked before returning */
-  void process(RPCReceive &rcv, thread_scoped_lock &lock)
+  /* Memory maps are modified by the listening thread while render threads look up render
+   * buffers of tiles, so all access goes through mem_lock. */
+  void process(RPCReceive &rcv)
   {
     if (rcv.name == "mem_alloc") {
       string name;
       network_device_memory mem(device);
       rcv.read(mem, name);
-      lock.unlock();
+
+      thread_scoped_lock lock(mem_lock);
 
       /* Allocate host side data buffer. */
       size_t data_size = mem.memory_size();
@@ -461,35 +1231,26 @@ class DeviceServer {
       string name;
       network_device_memory mem(device);
       rcv.read(mem, name);
-      lock.unlock();
+
+      thread_scoped_lock lock(mem_lock);
 
       size_t data_size = mem.memory_size();
       device_ptr client_pointer = mem.device_pointer;
 
-      if (client_pointer) {
-        /* Lookup existing host side data buffer. */
-        DataVector &data_v = data_vector_find(client_pointer);
-        mem.host_pointer = (void *)&data_v[0];
+      /* Lookup existing host side data buffer. */
+      DataVector &data_v = data_vector_find(client_pointer);
+      mem.host_pointer = (void *)&data_v[0];
 
-        /* Translate the client pointer to a real device pointer. */
-        mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
-      }
-      else {
-        /* Allocate host side data buffer. */
-        DataVector &data_v = data_vector_insert(client_pointer, data_size);
-        mem.host_pointer = (data_size) ? (void *)&(data_v[0]) : 0;
-      }
+      /* Translate the client pointer to a real device pointer. */
+      mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
+
+      lock.unlock();
 
       /* Copy data from network into memory buffer. */
       rcv.read_buffer((uint8_t *)mem.host_pointer, data_size);
 
       /* Copy the data from the memory buffer to the device buffer. */
       device->mem_copy_to(mem);
-
-      if (!client_pointer) {
-        /* Store a mapping to/from client_pointer and real device pointer. */
-        pointer_mapping_insert(client_pointer, mem.device_pointer);
-      }
     }
     else if (rcv.name == "mem_copy_from") {
       string name;
@@ -502,59 +1263,54 @@ class DeviceServer {
       rcv.read(h);
       rcv.read(elem);
 
+      thread_scoped_lock lock(mem_lock);
+
       device_ptr client_pointer = mem.device_pointer;
       mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
 
       DataVector &data_v = data_vector_find(client_pointer);
 
-      mem.host_pointer = (device_ptr) & (data_v[0]);
+      mem.host_pointer = (void *)&data_v[0];
+
+      lock.unlock();
 
       device->mem_copy_from(mem, y, w, h, elem);
 
       size_t data_size = mem.memory_size();
 
+      thread_scoped_lock rpc_lock_(rpc_lock);
       RPCSend snd(socket, &error_func, "mem_copy_from");
       snd.write();
       snd.write_buffer((uint8_t *)mem.host_pointer, data_size);
-      lock.unlock();
     }
     else if (rcv.name == "mem_zero") {
       string name;
       network_device_memory mem(device);
       rcv.read(mem, name);
-      lock.unlock();
 
-      size_t data_size = mem.memory_size();
+      thread_scoped_lock lock(mem_lock);
+
       device_ptr client_pointer = mem.device_pointer;
 
-      if (client_pointer) {
-        /* Lookup existing host side data buffer. */
-        DataVector &data_v = data_vector_find(client_pointer);
-        mem.host_pointer = (void *)&data_v[0];
+      /* Lookup existing host side data buffer. */
+      DataVector &data_v = data_vector_find(client_pointer);
+      mem.host_pointer = (void *)&data_v[0];
 
-        /* Translate the client pointer to a real device pointer. */
-        mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
-      }
-      else {
-        /* Allocate host side data buffer. */
-        DataVector &data_v = data_vector_insert(client_pointer, data_size);
-        mem.host_pointer = (void *) ? (device_ptr) & (data_v[0]) : 0;
-      }
+      /* Translate the client pointer to a real device pointer. */
+      mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
+
+      lock.unlock();
 
       /* Zero memory. */
       device->mem_zero(mem);
-
-      if (!client_pointer) {
-        /* Store a mapping to/from client_pointer and real device pointer. */
-        pointer_mapping_insert(client_pointer, mem.device_pointer);
-      }
     }
     else if (rcv.name == "mem_free") {
       string name;
       network_device_memory mem(device);
 
       rcv.read(mem, name);
-      lock.unlock();
+
+      thread_scoped_lock lock(mem_lock);
 
       device_ptr client_pointer = mem.device_pointer;
 
@@ -571,134 +1327,222 @@ class DeviceServer {
 
       vector<char> host_vector(size);
       rcv.read_buffer(&host_vector[0], size);
-      lock.unlock();
 
       device->const_copy_to(name_string.c_str(), &host_vector[0], size);
     }
     else if (rcv.name == "load_kernels") {
       DeviceRequestedFeatures requested_features;
       rcv.read(requested_features.experimental);
-      rcv.read(requested_features.max_closure);
       rcv.read(requested_features.max_nodes_group);
       rcv.read(requested_features.nodes_features);
 
       bool result;
       result = device->load_kernels(requested_features);
+
+      thread_scoped_lock lock(rpc_lock);
       RPCSend snd(socket, &error_func, "load_kernels");
       snd.add(result);
       snd.write();
-      lock.unlock();
     }
     else if (rcv.name == "task_add") {
       DeviceTask task;
+      int task_compression;
 
       rcv.read(task);
-      lock.unlock();
+      rcv.read(task_compression);
+      compression = (NetworkCompression)task_compression;
 
-      if (task.buffer)
-        task.buffer = device_ptr_from_client_pointer(task.buffer);
+      {
+        thread_scoped_lock lock(mem_lock);
 
-      if (task.rgba_half)
-        task.rgba_half = device_ptr_from_client_pointer(task.rgba_half);
+        if (task.buffer)
+          task.buffer = device_ptr_from_client_pointer(task.buffer);
 
-      if (task.rgba_byte)
-        task.rgba_byte = device_ptr_from_client_pointer(task.rgba_byte);
+        if (task.rgba_half)
+          task.rgba_half = device_ptr_from_client_pointer(task.rgba_half);
 
-      if (task.shader_input)
-        task.shader_input = device_ptr_from_client_pointer(task.shader_input);
+        if (task.rgba_byte)
+          task.rgba_byte = device_ptr_from_client_pointer(task.rgba_byte);
 
-      if (task.shader_output)
-        task.shader_output = device_ptr_from_client_pointer(task.shader_output);
+        if (task.shader_input)
+          task.shader_input = device_ptr_from_client_pointer(task.shader_input);
+
+        if (task.shader_output)
+          task.shader_output = device_ptr_from_client_pointer(task.shader_output);
+      }
 
-      task.acquire_tile = function_bind(&DeviceServer::task_acquire_tile, this, _1, _2);
+      /* The previous task must be done before the tile queue is reset. */
+      task_wait_join();
+      tiles_reset();
+
+      task.acquire_tile = function_bind(&DeviceServer::task_acquire_tile, this, _1, _2, _3);
       task.release_tile = function_bind(&DeviceServer::task_release_tile, this, _1);
       task.update_progress_sample = function_bind(&DeviceServer::task_update_progress_sample,
                                                   this);
       task.update_tile_sample = function_bind(&DeviceServer::task_update_tile_sample, this, _1);
       task.get_cancel = function_bind(&DeviceServer::task_get_cancel, this);
+      task.get_tile_stolen = function_bind(&DeviceServer::task_get_tile_stolen, this);
 
       device->task_add(task);
     }
     else if (rcv.name == "task_wait") {
-      lock.unlock();
-
-      blocked_waiting = true;
-      device->task_wait();
-      blocked_waiting = false;
-
-      lock.lock();
-      RPCSend snd(socket, &error_func, "task_wait_done");
-      snd.write();
-      lock.unlock();
+      /* Wait in a separate thread, this one has to keep receiving tiles. */
+      task_wait_join();
+      wait_thread = new thread(function_bind(&DeviceServer::task_wait, this));
     }
     else if (rcv.name == "task_cancel") {
-      lock.unlock();
       device->task_cancel();
     }
     else if (rcv.name == "acquire_tile") {
-      AcquireEntry entry;
-      entry.name = rcv.name;
-      rcv.read(entry.tile);
-      acquire_queue.push_back(entry);
-      lock.unlock();
+      int num_tiles;
+      rcv.read(num_tiles);
+
+      vector<ServerTile> tiles(num_tiles);
+      for (int i = 0; i < num_tiles; i++) {
+        rcv.read(tiles[i].tile);
+        rcv.read(tiles[i].pass_stride);
+        rcv.read(tiles[i].lossless_components);
+        rcv.read(tiles[i].stealable);
+        tiles[i].client_buffer = tiles[i].tile.buffer;
+        tiles[i].start_time = 0.0;
+      }
+
+      {
+        thread_scoped_lock lock(mem_lock);
+        for (int i = 0; i < num_tiles; i++) {
+          tiles[i].tile.buffer = device_ptr_from_client_pointer(tiles[i].client_buffer);
+        }
+      }
+
+      thread_scoped_lock lock(tile_lock);
+      tile_queue.insert(tile_queue.end(), tiles.begin(), tiles.end());
+      tiles_requested = max(tiles_requested - num_tiles, 0);
+      tile_cond.notify_all();
     }
     else if (rcv.name == "acquire_tile_none") {
-      AcquireEntry entry;
-      entry.name = rcv.name;
-      acquire_queue.push_back(entry);
-      lock.unlock();
+      thread_scoped_lock lock(tile_lock);
+      tiles_requested = 0;
+      tiles_done = true;
+      tile_cond.notify_all();
     }
-    else if (rcv.name == "release_tile") {
-      AcquireEntry entry;
-      entry.name = rcv.name;
-      acquire_queue.push_back(entry);
-      lock.unlock();
+    else if (rcv.name == "steal_tile") {
+      /* Give back a tile that was not started yet, to be rendered by another server. */
+      bool found = false;
+      ServerTile stolen;
+      int queued_tiles;
+
+      {
+        thread_scoped_lock lock(tile_lock);
+        for (list<ServerTile>::iterator it = tile_queue.end(); it != tile_queue.begin();) {
+          --it;
+          if (it->stealable) {
+            stolen = *it;
+            tile_queue.erase(it);
+            found = true;
+            break;
+          }
+        }
+        queued_tiles = tiles_stealable();
+      }
+
+      thread_scoped_lock lock(rpc_lock);
+      RPCSend snd(socket, &error_func, "steal_tile");
+      snd.add(found);
+      snd.add(queued_tiles);
+      if (found) {
+        stolen.tile.buffer = stolen.client_buffer;
+        snd.add(stolen.tile);
+      }
+      snd.write();
     }
     else {
       cout << "Error: unexpected RPC receive call \"" + rcv.name + "\"\n";
-      lock.unlock();
     }
   }
 
-  bool task_acquire_tile(Device *, RenderTile &tile)
+  /* Number of queued tiles that can be given to other servers, call with the tile lock held. */
+  int tiles_stealable()
   {
-    thread_scoped_lock acquire_lock(acquire_mutex);
+    int num_tiles = 0;
+    foreach (const ServerTile &server_tile, tile_queue) {
+      if (server_tile.stealable) {
+        num_tiles++;
+      }
+    }
+    return num_tiles;
+  }
 
-    bool result = false;
+  void tiles_reset()
+  {
+    thread_scoped_lock lock(tile_lock);
+    tile_queue.clear();
+    busy_tiles.clear();
+    tiles_requested = 0;
+    tiles_done = false;
+    num_waiting_threads = 0;
+    max_busy_tiles = 0;
+    busy_time = 0.0;
+  }
 
-    RPCSend snd(socket, &error_func, "acquire_tile");
-    snd.write();
+  /* Request more tiles from the client, so that a tile is queued for every tile being
+   * rendered. Render threads then continue without waiting for the network. */
+  void tiles_request(thread_scoped_lock &lock)
+  {
+    if (tiles_done) {
+      return;
+    }
 
-    do {
-      if (blocked_waiting)
-        listen_step();
+    const int num_wanted = (int)busy_tiles.size() + num_waiting_threads;
+    const int num_tiles = num_wanted - ((int)tile_queue.size() + tiles_requested);
+    if (num_tiles <= 0) {
+      return;
+    }
 
-      /* todo: avoid busy wait loop */
-      thread_scoped_lock lock(rpc_lock);
+    tiles_requested += num_tiles;
+    const int queued_tiles = tiles_stealable();
+
+    lock.unlock();
+    {
+      thread_scoped_lock rpc_lock_(rpc_lock);
+      RPCSend snd(socket, &error_func, "acquire_tile");
+      snd.add(num_tiles);
+      snd.add(queued_tiles);
+      snd.write();
+    }
+    lock.lock();
+  }
 
-      if (!acquire_queue.empty()) {
-        AcquireEntry entry = acquire_queue.front();
-        acquire_queue.pop_front();
+  bool task_acquire_tile(Device *, RenderTile &tile, uint)
+  {
+    thread_scoped_lock lock(tile_lock);
 
-        if (entry.name == "acquire_tile") {
-          tile = entry.tile;
+    num_waiting_threads++;
 
-          if (tile.buffer)
-            tile.buffer = ptr_map[tile.buffer];
+    for (;;) {
+      tiles_request(lock);
 
-          result = true;
-          break;
-        }
-        else if (entry.name == "acquire_tile_none") {
-          break;
-        }
-        else {
-          cout << "Error: unexpected acquire RPC receive call \"" + entry.name + "\"\n";
-        }
+      if (!tile_queue.empty()) {
+        ServerTile server_tile = tile_queue.front();
+        tile_queue.pop_front();
+        num_waiting_threads--;
+
+        server_tile.start_time = time_dt();
+        busy_tiles[server_tile.tile.tile_index] = server_tile;
+        max_busy_tiles = max(max_busy_tiles, (int)busy_tiles.size());
+        tile = server_tile.tile;
+
+        /* Replace the tile that was just taken from the queue. */
+        tiles_request(lock);
+        return true;
       }
-    } while (acquire_queue.empty() && !stop && !have_error());
 
-    return result;
+      if (tiles_done || stop || have_error()) {
+        num_waiting_threads--;
+        return false;
+      }
+
+      tile_cond.wait(lock);
+    }
   }
 
   void task_update_progress_sample()
@@ -711,41 +1555,81 @@ class DeviceServer {
     ; /* skip */
   }
 
+  /* Send the tile back with its pixels, without waiting for a reply. */
   void task_release_tile(RenderTile &tile)
   {
-    thread_scoped_lock acquire_lock(acquire_mutex);
+    ServerTile server_tile;
+    int queued_tiles;
 
-    if (tile.buffer)
-      tile.buffer = ptr_imap[tile.buffer];
+    {
+      thread_scoped_lock lock(tile_lock);
+      map<int, ServerTile>::iterator it = busy_tiles.find(tile.tile_index);
+      assert(it != busy_tiles.end());
+      server_tile = it->second;
+      busy_tiles.erase(it);
+      queued_tiles = tiles_stealable();
+    }
+
+    const double tile_time = time_dt() - server_tile.start_time;
+
+    /* Read the rows of the tile from the device, the render buffer may be shared with other
+     * tiles when rendering progressively. */
+    const int pass_stride = server_tile.pass_stride;
+    const size_t row_size = (size_t)tile.w * pass_stride;
+    const size_t first = (size_t)(tile.offset + tile.x + tile.y * tile.stride) * pass_stride;
+    const size_t last = (size_t)(tile.offset + tile.x + (tile.y + tile.h - 1) * tile.stride) *
+                            pass_stride +
+                        row_size;
+    float *host_buffer;
 
     {
-      thread_scoped_lock lock(rpc_lock);
-      RPCSend snd(socket, &error_func, "release_tile");
-      snd.add(tile);
-      snd.write();
-      lock.unlock();
+      thread_scoped_lock lock(mem_lock);
+      DataVector &data_v = data_vector_find(server_tile.client_buffer);
+      host_buffer = (float *)&data_v[0];
     }
 
-    do {
-      if (blocked_waiting)
-        listen_step();
+    network_device_memory mem(device);
+    mem.data_type = TYPE_FLOAT;
+    mem.data_elements = 1;
+    mem.data_size = last;
+    mem.data_width = last;
+    mem.host_pointer = host_buffer;
+    mem.device_pointer = tile.buffer;
+    device->mem_copy_from(mem, first, 1, last - first, sizeof(float));
+    mem.host_pointer = 0;
+
+    vector<float> pixels(row_size * tile.h);
+    for (int y = 0; y < tile.h; y++) {
+      memcpy(&pixels[y * row_size],
+             host_buffer + first + (size_t)y * tile.stride * pass_stride,
+             row_size * sizeof(float));
+    }
 
-      /* todo: avoid busy wait loop */
-      thread_scoped_lock lock(rpc_lock);
+    DataVector packed;
+    network_pixels_pack(pixels.data(),
+                        pixels.size(),
+                        compression,
+                        network_pixels_scale(tile),
+                        server_tile.lossless_components,
+                        packed);
 
-      if (!acquire_queue.empty()) {
-        AcquireEntry entry = acquire_queue.front();
-        acquire_queue.pop_front();
+    {
+      thread_scoped_lock lock(tile_lock);
+      busy_time += tile_time;
+    }
 
-        if (entry.name == "release_tile") {
-          lock.unlock();
-          break;
-        }
-        else {
-          cout << "Error: unexpected release RPC receive call \"" + entry.name + "\"\n";
-        }
-      }
-    } while (acquire_queue.empty() && !stop);
+    tile.buffer = server_tile.client_buffer;
+
+    thread_scoped_lock lock(rpc_lock);
+    RPCSend snd(socket, &error_func, "release_tile");
+    snd.add(tile);
+    snd.add(tile_time);
+    snd.add(queued_tiles);
+    snd.add(packed.size());
+    snd.write();
+    if (packed.size()) {
+      snd.write_buffer(&packed[0], packed.size());
+    }
   }
 
   bool task_get_cancel()
@@ -753,25 +1637,66 @@ class DeviceServer {
     return false;
   }
 
+  bool task_get_tile_stolen()
+  {
+    return false;
+  }
+
+  void task_wait()
+  {
+    device->task_wait();
+
+    double task_busy_time;
+    int task_num_threads;
+    {
+      thread_scoped_lock lock(tile_lock);
+      task_busy_time = busy_time;
+      task_num_threads = max_busy_tiles;
+    }
+
+    thread_scoped_lock lock(rpc_lock);
+    RPCSend snd(socket, &error_func, "task_wait_done");
+    snd.add(task_busy_time);
+    snd.add(task_num_threads);
+    snd.write();
+  }
+
+  void task_wait_join()
+  {
+    if (wait_thread) {
+      wait_thread->join();
+      delete wait_thread;
+      wait_thread = NULL;
+    }
+  }
+
   /* properties */
   Device *device;
   tcp::socket &socket;
 
   /* mapping of remote to local pointer */
+  thread_mutex mem_lock;
   PtrMap ptr_map;
   PtrMap ptr_imap;
   DataMap mem_data;
 
-  struct AcquireEntry {
-    string name;
-    RenderTile tile;
-  };
+  /* Tiles received from the client and not started yet, and tiles being rendered by tile
+   * index. Number of tiles requested from the client and not received yet. */
+  thread_mutex tile_lock;
+  thread_condition_variable tile_cond;
+  list<ServerTile> tile_queue;
+  map<int, ServerTile> busy_tiles;
+  int tiles_requested;
+  bool tiles_done;
+  int num_waiting_threads;
 
-  thread_mutex acquire_mutex;
-  list<AcquireEntry> acquire_queue;
+  /* Statistics reported to the client when the task is done. */
+  int max_busy_tiles;
+  double busy_time;
 
-  bool stop;
-  bool blocked_waiting;
+  volatile bool stop;
+  NetworkCompression compression;
+  thread *wait_thread;
 
  private:
   NetworkError error_func;
@@ -779,16 +1704,20 @@ class DeviceServer {
   /* todo: free memory and device (osl) on network error */
 };
 
-void Device::server_run()
+void Device::server_run(int port)
 {
+  if (port == 0) {
+    port = SERVER_PORT;
+  }
+
   try {
     /* starts thread that responds to discovery requests */
-    ServerDiscovery discovery;
+    ServerDiscovery discovery(false, port);
 
     for (;;) {
       /* accept connection */
       boost::asio::io_service io_service;
-      tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
+      tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), port));
 
       tcp::socket socket(io_service);
       acceptor.accept(socket);
@@ -33,10 +33,13 @@
 #  include <iostream>
 #  include <sstream>
 
+#  include "device/device_task.h"
+
 #  include "render/buffers.h"
 
 #  include "util/util_foreach.h"
 #  include "util/util_list.h"
+#  include "util/util_logging.h"
 #  include "util/util_map.h"
 #  include "util/util_param.h"
 #  include "util/util_string.h"
@@ -118,7 +121,7 @@ class RPCSend {
   {
     archive &name_;
     error_func = e;
-    fprintf(stderr, "rpc send %s\n", name.c_str());
+    VLOG(4) << "RPC send " << name;
   }
 
   ~RPCSend()
@@ -130,7 +133,6 @@ class RPCSend {
     archive &mem.data_type &mem.data_elements &mem.data_size;
     archive &mem.data_width &mem.data_height &mem.data_depth &mem.device_pointer;
     archive &mem.type &string(mem.name);
-    archive &mem.interpolation &mem.extension;
     archive &mem.device_pointer;
   }
 
@@ -148,10 +150,13 @@ class RPCSend {
     archive &task.shader_input &task.shader_output &task.shader_eval_type;
     archive &task.shader_x &task.shader_w;
     archive &task.need_finish_queue;
+    archive &task.tile_types &task.pass_stride;
   }
 
   void add(const RenderTile &tile)
   {
+    int type = (int)tile.task;
+    archive &type &tile.tile_index;
     archive &tile.x &tile.y &tile.w &tile.h;
     archive &tile.start_sample &tile.num_samples &tile.sample;
     archive &tile.resolution &tile.offset &tile.stride;
@@ -246,7 +251,7 @@ class RPCReceive {
           archive = new i_archive(*archive_stream);
 
           *archive &name;
-          fprintf(stderr, "rpc receive %s\n", name.c_str());
+          VLOG(4) << "RPC receive " << name;
         }
         else {
           error_func->network_error("Network receive error: data size doesn't match header");
@@ -272,7 +277,6 @@ class RPCReceive {
     *archive &mem.data_type &mem.data_elements &mem.data_size;
     *archive &mem.data_width &mem.data_height &mem.data_depth &mem.device_pointer;
     *archive &mem.type &name;
-    *archive &mem.interpolation &mem.extension;
     *archive &mem.device_pointer;
 
     mem.name = name.c_str();
@@ -312,17 +316,21 @@ class RPCReceive {
     *archive &task.shader_input &task.shader_output &task.shader_eval_type;
     *archive &task.shader_x &task.shader_w;
     *archive &task.need_finish_queue;
+    *archive &task.tile_types &task.pass_stride;
 
     task.type = (DeviceTask::Type)type;
   }
 
   void read(RenderTile &tile)
   {
+    int type;
+    *archive &type &tile.tile_index;
     *archive &tile.x &tile.y &tile.w &tile.h;
     *archive &tile.start_sample &tile.num_samples &tile.sample;
     *archive &tile.resolution &tile.offset &tile.stride;
     *archive &tile.buffer;
 
+    tile.task = (RenderTile::Task)type;
     tile.buffers = NULL;
   }
 
@@ -340,8 +348,10 @@ class RPCReceive {
 
 class ServerDiscovery {
  public:
-  explicit ServerDiscovery(bool discover = false)
-      : listen_socket(io_service), collect_servers(false)
+  /* Servers reply with the port they accept connections on, so that several servers can run
+   * on the same host. */
+  explicit ServerDiscovery(bool discover = false, int server_port = SERVER_PORT)
+      : listen_socket(io_service), collect_servers(false), server_port(server_port)
   {
     /* setup listen socket */
     listen_endpoint.address(boost::asio::ip::address_v4::any());
@@ -402,8 +412,10 @@ class ServerDiscovery {
 
       /* handle incoming message */
       if (collect_servers) {
-        if (msg == DISCOVER_REPLY_MSG) {
-          string address = receive_endpoint.address().to_string();
+        if (string_startswith(msg, DISCOVER_REPLY_MSG.c_str())) {
+          /* Reply is followed by ":port" of the server. */
+          string address = receive_endpoint.address().to_string() +
+                           msg.substr(DISCOVER_REPLY_MSG.size());
 
           mutex.lock();
 
@@ -419,7 +431,7 @@ class ServerDiscovery {
       else {
         /* reply to request */
         if (msg == DISCOVER_REQUEST_MSG)
-          broadcast_message(DISCOVER_REPLY_MSG);
+          broadcast_message(string_printf("%s:%d", DISCOVER_REPLY_MSG.c_str(), server_port));
       }
     }
 
@@ -481,6 +493,7 @@ class ServerDiscovery {
   /* collection of server addresses in list */
   bool collect_servers;
   vector<string> servers;
+  int server_port;
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "device/device_path_guiding.h"
+
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_task.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Leaves are split when a pass records more samples than this for them. */
+static const int PATH_GUIDING_MAX_LEAF_SAMPLES = 4096;
+/* Leaves with fewer samples keep the distribution of the previous pass. */
+static const int PATH_GUIDING_MIN_LEAF_SAMPLES = 64;
+static const int PATH_GUIDING_MAX_DEPTH = 32;
+static const int PATH_GUIDING_EM_ITERATIONS = 8;
+
+static void path_guiding_distribution_init(PathGuidingDistribution &distribution)
+{
+  /* Wide lobes spread evenly over the sphere. */
+  for (int i = 0; i < PATH_GUIDING_NUM_LOBES; i++) {
+    const float z = 1.0f - (2.0f * i + 1.0f) / PATH_GUIDING_NUM_LOBES;
+    const float r = safe_sqrtf(1.0f - z * z);
+    const float phi = i * M_PI_F * (3.0f - sqrtf(5.0f));
+
+    PathGuidingLobe &lobe = distribution.lobes[i];
+    lobe.mean = make_float3(r * cosf(phi), r * sinf(phi), z);
+    lobe.kappa = 2.0f;
+    lobe.weight = 1.0f / PATH_GUIDING_NUM_LOBES;
+    lobe.norm = path_guiding_lobe_norm(lobe.kappa);
+  }
+}
+
+PathGuidingTraining::PathGuidingTraining()
+{
+  reset();
+}
+
+void PathGuidingTraining::reset()
+{
+  guiding.nodes.clear();
+  guiding.distributions.clear();
+  guiding.ready = false;
+  samples.clear();
+  bounds = BoundBox::empty;
+}
+
+void PathGuidingTraining::add_samples(vector<PathGuidingSample> &thread_samples)
+{
+  thread_scoped_lock lock(samples_mutex);
+  samples.insert(samples.end(), thread_samples.begin(), thread_samples.end());
+  thread_samples.clear();
+}
+
+void PathGuidingTraining::update()
+{
+  if (samples.empty()) {
+    return;
+  }
+
+  /* The first pass determines the bounds of the tree, samples outside of them in later passes
+   * end up in the leaves at the border. */
+  if (guiding.nodes.empty()) {
+    foreach (const PathGuidingSample &sample, samples) {
+      bounds.grow(sample.P);
+    }
+    bounds.max += make_float3(1e-4f, 1e-4f, 1e-4f);
+
+    PathGuidingNode root;
+    root.axis = -1;
+    root.split = 0.0f;
+    root.child = 0;
+    guiding.nodes.push_back(root);
+
+    guiding.distributions.resize(1);
+    path_guiding_distribution_init(guiding.distributions[0]);
+  }
+
+  /* Distribute samples over the tree, splitting leaves that have too many. */
+  vector<int> node_samples(samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    node_samples[i] = i;
+  }
+
+  vector<LeafSamples> leaves;
+  update_node(0, bounds, node_samples, 0, leaves);
+
+  /* Fit leaves in parallel. Distributions are not reallocated anymore at this point. */
+  TaskPool pool;
+  foreach (LeafSamples &leaf, leaves) {
+    LeafSamples *leaf_ptr = &leaf;
+    pool.push([this, leaf_ptr] {
+      fit_distribution(guiding.distributions[leaf_ptr->distribution], leaf_ptr->samples);
+    });
+  }
+  pool.wait_work();
+
+  VLOG(2) << "Path guiding fitted " << guiding.distributions.size() << " leaves to "
+          << samples.size() << " samples.";
+
+  samples.clear();
+  guiding.ready = true;
+}
+
+void PathGuidingTraining::update_node(int node_index,
+                                      const BoundBox &node_bounds,
+                                      vector<int> &node_samples,
+                                      int depth,
+                                      vector<LeafSamples> &leaves)
+{
+  PathGuidingNode node = guiding.nodes[node_index];
+
+  if (node.axis == -1) {
+    if (node_samples.size() <= PATH_GUIDING_MAX_LEAF_SAMPLES || depth == PATH_GUIDING_MAX_DEPTH) {
+      LeafSamples leaf;
+      leaf.distribution = node.child;
+      leaf.samples.swap(node_samples);
+      leaves.push_back(leaf);
+      return;
+    }
+
+    /* Split in the middle of the longest axis, both children start from the distribution of
+     * the leaf. */
+    const float3 size = node_bounds.size();
+    const int axis = (size.x > size.y) ? ((size.x > size.z) ? 0 : 2) :
+                                         ((size.y > size.z) ? 1 : 2);
+
+    PathGuidingNode left, right;
+    left.axis = right.axis = -1;
+    left.split = right.split = 0.0f;
+    left.child = node.child;
+    right.child = guiding.distributions.size();
+    guiding.distributions.push_back(guiding.distributions[node.child]);
+
+    node.axis = axis;
+    node.split = 0.5f * (node_bounds.min[axis] + node_bounds.max[axis]);
+    node.child = guiding.nodes.size();
+    guiding.nodes.push_back(left);
+    guiding.nodes.push_back(right);
+    guiding.nodes[node_index] = node;
+  }
+
+  vector<int> left_samples, right_samples;
+  foreach (int index, node_samples) {
+    if (samples[index].P[node.axis] >= node.split) {
+      right_samples.push_back(index);
+    }
+    else {
+      left_samples.push_back(index);
+    }
+  }
+  vector<int>().swap(node_samples);
+
+  BoundBox left_bounds = node_bounds, right_bounds = node_bounds;
+  left_bounds.max[node.axis] = node.split;
+  right_bounds.min[node.axis] = node.split;
+
+  update_node(node.child, left_bounds, left_samples, depth + 1, leaves);
+  update_node(node.child + 1, right_bounds, right_samples, depth + 1, leaves);
+}
+
+void PathGuidingTraining::fit_distribution(PathGuidingDistribution &distribution,
+                                           const vector<int> &leaf_samples)
+{
+  if (leaf_samples.size() < PATH_GUIDING_MIN_LEAF_SAMPLES) {
+    return;
+  }
+
+  for (int iteration = 0; iteration < PATH_GUIDING_EM_ITERATIONS; iteration++) {
+    float lobe_weight[PATH_GUIDING_NUM_LOBES] = {0.0f};
+    float3 lobe_direction[PATH_GUIDING_NUM_LOBES];
+    for (int k = 0; k < PATH_GUIDING_NUM_LOBES; k++) {
+      lobe_direction[k] = make_float3(0.0f, 0.0f, 0.0f);
+    }
+    float total_weight = 0.0f;
+
+    /* Expectation: responsibility of every lobe for every sample, weighted by radiance. */
+    foreach (int index, leaf_samples) {
+      const PathGuidingSample &sample = samples[index];
+
+      float pdf[PATH_GUIDING_NUM_LOBES];
+      float pdf_sum = 0.0f;
+      for (int k = 0; k < PATH_GUIDING_NUM_LOBES; k++) {
+        const PathGuidingLobe &lobe = distribution.lobes[k];
+        pdf[k] = lobe.weight * path_guiding_lobe_pdf(&lobe, sample.D);
+        pdf_sum += pdf[k];
+      }
+
+      if (!(pdf_sum > 0.0f)) {
+        continue;
+      }
+
+      const float scale = sample.weight / pdf_sum;
+      for (int k = 0; k < PATH_GUIDING_NUM_LOBES; k++) {
+        const float responsibility = pdf[k] * scale;
+        lobe_weight[k] += responsibility;
+        lobe_direction[k] += responsibility * sample.D;
+      }
+      total_weight += sample.weight;
+    }
+
+    if (!(total_weight > 0.0f) || !isfinite_safe(total_weight)) {
+      return;
+    }
+
+    /* Maximization. A small prior towards wide lobes with some weight avoids collapsing lobes
+     * onto a few samples. */
+    const float prior = 1e-2f * total_weight / PATH_GUIDING_NUM_LOBES;
+
+    for (int k = 0; k < PATH_GUIDING_NUM_LOBES; k++) {
+      PathGuidingLobe &lobe = distribution.lobes[k];
+      lobe.weight = (lobe_weight[k] + prior) / (total_weight + prior * PATH_GUIDING_NUM_LOBES);
+
+      const float direction_len = len(lobe_direction[k]);
+      if (direction_len > 0.0f) {
+        const float mean_cosine = min(direction_len / (lobe_weight[k] + prior), 0.999f);
+        lobe.mean = lobe_direction[k] / direction_len;
+        lobe.kappa = clamp(mean_cosine * (3.0f - mean_cosine * mean_cosine) /
+                               (1.0f - mean_cosine * mean_cosine),
+                           PATH_GUIDING_MIN_KAPPA,
+                           PATH_GUIDING_MAX_KAPPA);
+      }
+      lobe.norm = path_guiding_lobe_norm(lobe.kappa);
+    }
+  }
+}
+
+CCL_NAMESPACE_END
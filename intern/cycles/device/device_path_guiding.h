@@ -0,0 +1,76 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEVICE_PATH_GUIDING_H__
+#define __DEVICE_PATH_GUIDING_H__
+
+#include "kernel/kernel_path_guiding.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_thread.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Path Guiding Training
+ *
+ * Learns the path guiding distributions from radiance samples recorded by the kernel. Samples
+ * of a training pass are collected from all threads, after which leaves of the spatial tree
+ * that received many samples are split and the mixture of every leaf is fitted to its samples
+ * with a few iterations of weighted expectation-maximization, starting from the mixture of the
+ * previous pass. */
+
+class PathGuidingTraining {
+ public:
+  PathGuidingTraining();
+
+  /* Forget the learned distributions, for a new scene. */
+  void reset();
+
+  /* Add samples recorded by one thread, clearing the vector. Thread safe. */
+  void add_samples(vector<PathGuidingSample> &thread_samples);
+
+  /* Refine and fit the distributions to the samples added since the last update. */
+  void update();
+
+  size_t num_samples() const
+  {
+    return samples.size();
+  }
+
+  PathGuiding guiding;
+
+ protected:
+  struct LeafSamples {
+    int distribution;
+    vector<int> samples;
+  };
+
+  void update_node(int node_index,
+                   const BoundBox &node_bounds,
+                   vector<int> &node_samples,
+                   int depth,
+                   vector<LeafSamples> &leaves);
+  void fit_distribution(PathGuidingDistribution &distribution, const vector<int> &leaf_samples);
+
+  thread_mutex samples_mutex;
+  vector<PathGuidingSample> samples;
+  BoundBox bounds;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __DEVICE_PATH_GUIDING_H__ */
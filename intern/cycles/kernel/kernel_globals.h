@@ -45,6 +45,9 @@ struct OSLThreadData;
 struct OSLShadingSystem;
 #  endif
 
+struct PathGuiding;
+struct PathGuidingPath;
+
 typedef unordered_map<float, float> CoverageMap;
 
 struct Intersection;
@@ -64,6 +67,12 @@ typedef struct KernelGlobals {
   OSLThreadData *osl_tdata;
 #  endif
 
+  /* Guiding distributions shared by all threads, and the path being recorded when rendering
+   * training passes, NULL otherwise. Declared for the split kernel too, which does not use
+   * them, so the struct has the same layout in all kernels sharing it with the device. */
+  PathGuiding *guiding;
+  PathGuidingPath *guiding_path;
+
   /* **** Run-time data ****  */
 
   /* Heap-allocated storage for transparent shadows intersections. */
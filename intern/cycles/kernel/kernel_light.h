@@ -15,6 +15,7 @@
  */
 
 #include "kernel_light_background.h"
+#include "kernel_light_tree.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -153,11 +154,18 @@ ccl_device_inline bool lamp_light_sample(
     }
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
-
   return (ls->pdf > 0.0f);
 }
 
+/* Probability of picking the lamp when sampling a single light. */
+ccl_device_inline float lamp_light_select_pdf(KernelGlobals *kg, int lamp, float3 P)
+{
+  if (kernel_data.integrator.use_light_tree) {
+    return light_tree_lamp_pdf(kg, P, lamp);
+  }
+  return kernel_data.integrator.pdf_lights;
+}
+
 ccl_device bool lamp_light_eval(
     KernelGlobals *kg, int lamp, float3 P, float3 D, float t, LightSample *ls)
 {
@@ -291,7 +299,7 @@ ccl_device bool lamp_light_eval(
     return false;
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= lamp_light_select_pdf(kg, lamp, P);
 
   return true;
 }
@@ -328,12 +336,12 @@ ccl_device_inline bool triangle_world_space_vertices(
   return has_motion;
 }
 
-ccl_device_inline float triangle_light_pdf_area(KernelGlobals *kg,
+ccl_device_inline float triangle_light_pdf_area(const float pdf_triangles,
                                                 const float3 Ng,
                                                 const float3 I,
                                                 float t)
 {
-  float pdf = kernel_data.integrator.pdf_triangles;
+  float pdf = pdf_triangles;
   float cos_pi = fabsf(dot(Ng, I));
 
   if (cos_pi == 0.0f)
@@ -351,6 +359,12 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
   float3 V[3];
   bool has_motion = triangle_world_space_vertices(kg, sd->object, sd->prim, sd->time, V);
 
+  /* Probability per unit area of having picked this triangle. */
+  float pdf_triangles = kernel_data.integrator.pdf_triangles;
+  if (kernel_data.integrator.use_light_tree) {
+    pdf_triangles = light_tree_triangle_pdf(kg, sd->P + sd->I * t, sd->object, sd->prim);
+  }
+
   const float3 e0 = V[1] - V[0];
   const float3 e1 = V[2] - V[0];
   const float3 e2 = V[2] - V[1];
@@ -389,12 +403,12 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
       else {
         area = 0.5f * len(N);
       }
-      const float pdf = area * kernel_data.integrator.pdf_triangles;
+      const float pdf = area * pdf_triangles;
       return pdf / solid_angle;
     }
   }
   else {
-    float pdf = triangle_light_pdf_area(kg, sd->Ng, sd->I, t);
+    float pdf = triangle_light_pdf_area(pdf_triangles, sd->Ng, sd->I, t);
     if (has_motion) {
       const float area = 0.5f * len(N);
       if (UNLIKELY(area == 0.0f)) {
@@ -417,6 +431,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg,
                                                   float randu,
                                                   float randv,
                                                   float time,
+                                                  float pdf_triangles,
                                                   LightSample *ls,
                                                   const float3 P)
 {
@@ -542,7 +557,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg,
         triangle_world_space_vertices(kg, object, prim, -1.0f, V);
         area = triangle_area(V[0], V[1], V[2]);
       }
-      const float pdf = area * kernel_data.integrator.pdf_triangles;
+      const float pdf = area * pdf_triangles;
       ls->pdf = pdf / solid_angle;
     }
   }
@@ -564,7 +579,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg,
     ls->P = u * V[0] + v * V[1] + t * V[2];
     /* compute incoming direction, distance and pdf */
     ls->D = normalize_len(ls->P - P, &ls->t);
-    ls->pdf = triangle_light_pdf_area(kg, ls->Ng, -ls->D, ls->t);
+    ls->pdf = triangle_light_pdf_area(pdf_triangles, ls->Ng, -ls->D, ls->t);
     if (has_motion && area != 0.0f) {
       /* scale the PDF.
        * area = the area the sample was taken from
@@ -632,9 +647,27 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
                                       int bounce,
                                       LightSample *ls)
 {
+  /* Probability of picking the light, per unit area for triangles. */
+  float pdf_select = kernel_data.integrator.pdf_lights;
+
   if (lamp < 0) {
     /* sample index */
-    int index = light_distribution_sample(kg, &randu);
+    int index;
+    float pdf_triangles = kernel_data.integrator.pdf_triangles;
+
+    if (kernel_data.integrator.use_light_tree) {
+      const int emitter = light_tree_sample(kg, P, &randu, &pdf_select);
+      if (emitter < 0) {
+        return false;
+      }
+      const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(
+          __light_tree_emitters, emitter);
+      index = kemitter->distribution_index;
+      pdf_triangles = pdf_select * kemitter->inv_area;
+    }
+    else {
+      index = light_distribution_sample(kg, &randu);
+    }
 
     /* fetch light data */
     const ccl_global KernelLightDistribution *kdistribution = &kernel_tex_fetch(
@@ -645,7 +678,7 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
       int object = kdistribution->mesh_light.object_id;
       int shader_flag = kdistribution->mesh_light.shader_flag;
 
-      triangle_light_sample(kg, prim, object, randu, randv, time, ls, P);
+      triangle_light_sample(kg, prim, object, randu, randv, time, pdf_triangles, ls, P);
       ls->shader |= shader_flag;
       return (ls->pdf > 0.0f);
     }
@@ -657,7 +690,12 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
     return false;
   }
 
-  return lamp_light_sample(kg, lamp, randu, randv, P, ls);
+  if (!lamp_light_sample(kg, lamp, randu, randv, P, ls)) {
+    return false;
+  }
+
+  ls->pdf *= pdf_select;
+  return true;
 }
 
 ccl_device_inline int light_select_num_samples(KernelGlobals *kg, int index)
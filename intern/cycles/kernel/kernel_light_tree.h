@@ -0,0 +1,330 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree
+ *
+ * Hierarchy over the local emitters of the light distribution, used to pick a light
+ * proportional to its estimated contribution at the shading point rather than only to its
+ * area or power. Based on "Importance Sampling of Many Lights with Adaptive Tree Splitting"
+ * by Alejandro Conty Estevez and Christopher Kulla.
+ *
+ * Distant and background lights are not part of the tree, they keep the probability they
+ * have in the flat distribution and the tree is sampled with the remaining probability. */
+
+/* Estimate of the contribution of a cluster of emitters to point P, from its bounding box,
+ * the cone bounding its normals (axis and theta_o) and the emission spread theta_e.
+ *
+ * The receiver orientation is deliberately ignored so that the estimate only depends on P,
+ * which is all that is known when evaluating the pdf for MIS. */
+ccl_device float light_tree_importance(const float3 P,
+                                       const float3 bbox_min,
+                                       const float3 bbox_max,
+                                       const float3 axis,
+                                       const float theta_o,
+                                       const float theta_e,
+                                       const float energy)
+{
+  if (energy == 0.0f) {
+    return 0.0f;
+  }
+
+  const float3 centroid = 0.5f * (bbox_min + bbox_max);
+  const float radius_squared = 0.25f * len_squared(bbox_max - bbox_min);
+  float distance;
+  const float3 D = normalize_len(P - centroid, &distance);
+  const float distance_squared = distance * distance;
+
+  if (distance_squared <= radius_squared) {
+    /* Inside the bounds every orientation is possible. */
+    return energy / max(radius_squared, 1e-12f);
+  }
+
+  /* Angle between the cone axis and P, minus the spread of the normals and the angle
+   * subtended by the bounding sphere. */
+  const float theta = safe_acosf(dot(axis, D));
+  const float theta_u = safe_asinf(sqrtf(radius_squared / distance_squared));
+  const float theta_prime = max(theta - theta_o - theta_u, 0.0f);
+
+  if (theta_prime >= theta_e) {
+    return 0.0f;
+  }
+
+  return energy * cosf(theta_prime) / distance_squared;
+}
+
+ccl_device_inline float light_tree_node_importance(KernelGlobals *kg, const float3 P, int index)
+{
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, index);
+  return light_tree_importance(
+      P,
+      make_float3(knode->bbox_min[0], knode->bbox_min[1], knode->bbox_min[2]),
+      make_float3(knode->bbox_max[0], knode->bbox_max[1], knode->bbox_max[2]),
+      make_float3(knode->axis[0], knode->axis[1], knode->axis[2]),
+      knode->theta_o,
+      knode->theta_e,
+      knode->energy);
+}
+
+ccl_device_inline float light_tree_emitter_importance(KernelGlobals *kg,
+                                                      const float3 P,
+                                                      int index)
+{
+  const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters,
+                                                                        index);
+  return light_tree_importance(
+      P,
+      make_float3(kemitter->bbox_min[0], kemitter->bbox_min[1], kemitter->bbox_min[2]),
+      make_float3(kemitter->bbox_max[0], kemitter->bbox_max[1], kemitter->bbox_max[2]),
+      make_float3(kemitter->axis[0], kemitter->axis[1], kemitter->axis[2]),
+      kemitter->theta_o,
+      kemitter->theta_e,
+      kemitter->energy);
+}
+
+/* Probability of picking a local emitter with the tree, as opposed to a distant or
+ * background light. */
+ccl_device_inline float light_tree_local_probability(KernelGlobals *kg)
+{
+  return 1.0f - kernel_data.integrator.light_tree_num_infinite * kernel_data.integrator.pdf_lights;
+}
+
+/* Traverse the tree choosing children proportional to their importance. The random number
+ * is rescaled at every level so it can be reused for sampling the emitter itself. Returns
+ * the emitter index, or -1 if no emitter can contribute to P. */
+ccl_device int light_tree_sample_local(KernelGlobals *kg, const float3 P, float *randu, float *pdf)
+{
+  float r = *randu;
+  float node_pdf = 1.0f;
+  int index = 0;
+
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, index);
+
+  while (knode->num_emitters == 0) {
+    const int left = index + 1;
+    const int right = knode->child_index;
+    const float left_importance = light_tree_node_importance(kg, P, left);
+    const float right_importance = light_tree_node_importance(kg, P, right);
+    const float total_importance = left_importance + right_importance;
+
+    if (total_importance == 0.0f) {
+      return -1;
+    }
+
+    const float left_probability = left_importance / total_importance;
+
+    if (r < left_probability) {
+      index = left;
+      r = r / left_probability;
+      node_pdf *= left_probability;
+    }
+    else {
+      index = right;
+      r = (r - left_probability) / (1.0f - left_probability);
+      node_pdf *= 1.0f - left_probability;
+    }
+
+    /* Guard against float rounding pushing the number outside of the unit interval. */
+    r = clamp(r, 0.0f, 1.0f - FLT_EPSILON);
+    knode = &kernel_tex_fetch(__light_tree_nodes, index);
+  }
+
+  /* Pick an emitter in the leaf, proportional to its own importance. */
+  const int first = knode->child_index;
+  const int num_emitters = knode->num_emitters;
+
+  if (num_emitters == 1) {
+    *randu = r;
+    *pdf = node_pdf;
+    return first;
+  }
+
+  float total_importance = 0.0f;
+  for (int i = 0; i < num_emitters; i++) {
+    total_importance += light_tree_emitter_importance(kg, P, first + i);
+  }
+
+  if (total_importance == 0.0f) {
+    return -1;
+  }
+
+  /* Fall back to the last emitter that can contribute in case of float rounding. */
+  float cdf = 0.0f;
+  float emitter_probability = 0.0f;
+  int emitter = -1;
+  for (int i = 0; i < num_emitters; i++) {
+    const float probability = light_tree_emitter_importance(kg, P, first + i) /
+                              total_importance;
+    if (probability == 0.0f) {
+      continue;
+    }
+    emitter = first + i;
+    emitter_probability = probability;
+    if (r < cdf + probability) {
+      break;
+    }
+    cdf += probability;
+  }
+
+  *randu = clamp((r - cdf) / emitter_probability, 0.0f, 1.0f - FLT_EPSILON);
+  *pdf = node_pdf * emitter_probability;
+  return emitter;
+}
+
+/* Pick an emitter for shading point P, returning its index in __light_tree_emitters and the
+ * probability of having picked it. Emitters past light_tree_num_emitters are the distant and
+ * background lights, chosen uniformly like in the flat distribution. */
+ccl_device int light_tree_sample(KernelGlobals *kg, const float3 P, float *randu, float *pdf)
+{
+  const int num_infinite = kernel_data.integrator.light_tree_num_infinite;
+  const float local_probability = light_tree_local_probability(kg);
+  const float infinite_probability = 1.0f - local_probability;
+  float r = *randu;
+
+  if (r < infinite_probability) {
+    const float u = r / infinite_probability * num_infinite;
+    const int i = min((int)u, num_infinite - 1);
+    *randu = clamp(u - i, 0.0f, 1.0f - FLT_EPSILON);
+    *pdf = kernel_data.integrator.pdf_lights;
+    return kernel_data.integrator.light_tree_num_emitters + i;
+  }
+
+  *randu = clamp((r - infinite_probability) / local_probability, 0.0f, 1.0f - FLT_EPSILON);
+
+  float tree_pdf;
+  const int emitter = light_tree_sample_local(kg, P, randu, &tree_pdf);
+  if (emitter < 0) {
+    return -1;
+  }
+
+  *pdf = local_probability * tree_pdf;
+  return emitter;
+}
+
+/* Probability of light_tree_sample() picking the given emitter from P. */
+ccl_device float light_tree_emitter_pdf(KernelGlobals *kg, const float3 P, int emitter)
+{
+  if (emitter < 0) {
+    return 0.0f;
+  }
+  if (emitter >= kernel_data.integrator.light_tree_num_emitters) {
+    return kernel_data.integrator.pdf_lights;
+  }
+
+  uint bit_trail = kernel_tex_fetch(__light_tree_emitters, emitter).bit_trail;
+  float pdf = light_tree_local_probability(kg);
+  int index = 0;
+
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, index);
+
+  while (knode->num_emitters == 0) {
+    const int left = index + 1;
+    const int right = knode->child_index;
+    const float left_importance = light_tree_node_importance(kg, P, left);
+    const float right_importance = light_tree_node_importance(kg, P, right);
+    const float total_importance = left_importance + right_importance;
+
+    if (total_importance == 0.0f) {
+      return 0.0f;
+    }
+
+    if (bit_trail & 1) {
+      index = right;
+      pdf *= right_importance / total_importance;
+    }
+    else {
+      index = left;
+      pdf *= left_importance / total_importance;
+    }
+
+    bit_trail >>= 1;
+    knode = &kernel_tex_fetch(__light_tree_nodes, index);
+  }
+
+  if (knode->num_emitters == 1) {
+    return pdf;
+  }
+
+  const int first = knode->child_index;
+  float total_importance = 0.0f;
+  for (int i = 0; i < knode->num_emitters; i++) {
+    total_importance += light_tree_emitter_importance(kg, P, first + i);
+  }
+
+  if (total_importance == 0.0f) {
+    return 0.0f;
+  }
+
+  return pdf * light_tree_emitter_importance(kg, P, emitter) / total_importance;
+}
+
+/* Probability of picking a lamp, to be used in place of pdf_lights. */
+ccl_device float light_tree_lamp_pdf(KernelGlobals *kg, const float3 P, int lamp)
+{
+  const int index = kernel_data.integrator.num_distribution -
+                    kernel_data.integrator.num_all_lights + lamp;
+  const int emitter = kernel_tex_fetch(__light_tree_distribution_emitter, index);
+  return light_tree_emitter_pdf(kg, P, emitter);
+}
+
+/* Probability per unit area of picking an emissive triangle, to be used in place of
+ * pdf_triangles. */
+ccl_device float light_tree_triangle_pdf(KernelGlobals *kg,
+                                         const float3 P,
+                                         int object,
+                                         int prim)
+{
+  /* Triangles come first in the light distribution, sorted by object and primitive. */
+  int first = 0;
+  int len = kernel_data.integrator.num_distribution - kernel_data.integrator.num_all_lights;
+
+  while (len > 0) {
+    const int half_len = len >> 1;
+    const int middle = first + half_len;
+    const ccl_global KernelLightDistribution *kdistribution = &kernel_tex_fetch(
+        __light_distribution, middle);
+    const int middle_object = kdistribution->mesh_light.object_id;
+
+    if (middle_object < object || (middle_object == object && kdistribution->prim < prim)) {
+      first = middle + 1;
+      len = len - half_len - 1;
+    }
+    else {
+      len = half_len;
+    }
+  }
+
+  if (first >= kernel_data.integrator.num_distribution - kernel_data.integrator.num_all_lights) {
+    return 0.0f;
+  }
+
+  const ccl_global KernelLightDistribution *kdistribution = &kernel_tex_fetch(
+      __light_distribution, first);
+  if (kdistribution->mesh_light.object_id != object || kdistribution->prim != prim) {
+    return 0.0f;
+  }
+
+  const int emitter = kernel_tex_fetch(__light_tree_distribution_emitter, first);
+  if (emitter < 0) {
+    return 0.0f;
+  }
+
+  return light_tree_emitter_pdf(kg, P, emitter) *
+         kernel_tex_fetch(__light_tree_emitters, emitter).inv_area;
+}
+
+CCL_NAMESPACE_END
@@ -612,6 +612,10 @@ ccl_device_forceinline void kernel_path_integrate(KernelGlobals *kg,
         }
 #  endif /* __SUBSURFACE__ */
 
+#  ifdef __PATH_GUIDING__
+        kernel_path_guiding_prepare(kg, &sd);
+#  endif
+
 #  ifdef __EMISSION__
         /* direct lighting */
         kernel_path_surface_connect_light(kg, &sd, emission_sd, throughput, state, L);
@@ -624,8 +628,16 @@ ccl_device_forceinline void kernel_path_integrate(KernelGlobals *kg,
       /* compute direct lighting and next bounce */
       if (!kernel_path_surface_bounce(kg, &sd, &throughput, state, &L->state, ray))
         break;
+
+#  ifdef __PATH_GUIDING__
+      kernel_path_guiding_record_bounce(kg, &sd, state, ray, throughput, L);
+#  endif
     }
 
+#  ifdef __PATH_GUIDING__
+    kernel_path_guiding_record_path(kg, L);
+#  endif
+
 #  ifdef __SUBSURFACE__
     /* Trace indirect subsurface rays by restarting the loop. this uses less
      * stack memory than invoking kernel_path_indirect.
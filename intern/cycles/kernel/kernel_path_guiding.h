@@ -0,0 +1,176 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_PATH_GUIDING_H__
+#define __KERNEL_PATH_GUIDING_H__
+
+#include "util/util_math.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Path Guiding
+ *
+ * Spatial-directional distribution of incident radiance learned while rendering, used to
+ * sample bounce directions towards where light comes from. Space is subdivided by a kd-tree,
+ * and every leaf stores a mixture of von Mises-Fisher lobes fitted to the radiance recorded
+ * inside it. Based on "On-line Learning of Parametric Mixture Models for Light Transport
+ * Simulation" by Vorba et al., with the spatial subdivision of "Practical Path Guiding for
+ * Efficient Light-Transport Simulation" by Muller et al.
+ *
+ * The distributions are trained on the CPU device and only read by the kernel, so unlike
+ * other kernel data they live in host memory rather than in kernel textures. */
+
+#define PATH_GUIDING_NUM_LOBES 8
+#define PATH_GUIDING_MAX_VERTICES 16
+#define PATH_GUIDING_MIN_KAPPA 1e-2f
+#define PATH_GUIDING_MAX_KAPPA 1000.0f
+
+typedef struct PathGuidingLobe {
+  float3 mean;
+  float kappa;
+  float weight;
+  /* Normalization of the lobe pdf, kappa / (2 * pi * (1 - exp(-2 * kappa))). */
+  float norm;
+} PathGuidingLobe;
+
+typedef struct PathGuidingDistribution {
+  PathGuidingLobe lobes[PATH_GUIDING_NUM_LOBES];
+} PathGuidingDistribution;
+
+typedef struct PathGuidingNode {
+  /* Split axis, or -1 for leaves. */
+  int axis;
+  float split;
+  /* First of the two children for inner nodes, distribution index for leaves. */
+  int child;
+} PathGuidingNode;
+
+typedef struct PathGuiding {
+  vector<PathGuidingNode> nodes;
+  vector<PathGuidingDistribution> distributions;
+  /* Distributions were fitted and can be sampled. */
+  bool ready;
+
+  PathGuiding() : ready(false)
+  {
+  }
+} PathGuiding;
+
+/* Radiance arriving at P from direction D, divided by the pdf D was sampled with. */
+typedef struct PathGuidingSample {
+  float3 P;
+  float3 D;
+  float weight;
+} PathGuidingSample;
+
+typedef struct PathGuidingVertex {
+  float3 P;
+  float3 D;
+  float pdf;
+  /* Path throughput after the bounce, and the radiance the path had gathered until then. */
+  float3 throughput;
+  float3 L;
+} PathGuidingVertex;
+
+/* Bounces of the path being traced while training, per thread. */
+typedef struct PathGuidingPath {
+  PathGuidingVertex vertices[PATH_GUIDING_MAX_VERTICES];
+  int num_vertices;
+  vector<PathGuidingSample> samples;
+
+  PathGuidingPath() : num_vertices(0)
+  {
+  }
+} PathGuidingPath;
+
+ccl_device_inline float path_guiding_lobe_norm(float kappa)
+{
+  return kappa / (M_2PI_F * (1.0f - expf(-2.0f * kappa)));
+}
+
+ccl_device_inline float path_guiding_lobe_pdf(const PathGuidingLobe *lobe, const float3 D)
+{
+  return lobe->norm * expf(lobe->kappa * (dot(lobe->mean, D) - 1.0f));
+}
+
+ccl_device_inline const PathGuidingDistribution *path_guiding_lookup(const PathGuiding *guiding,
+                                                                    const float3 P)
+{
+  const PathGuidingNode *nodes = guiding->nodes.data();
+  int node_index = 0;
+
+  while (nodes[node_index].axis != -1) {
+    const PathGuidingNode *node = &nodes[node_index];
+    node_index = node->child + ((P[node->axis] >= node->split) ? 1 : 0);
+  }
+
+  return &guiding->distributions[nodes[node_index].child];
+}
+
+ccl_device_inline float path_guiding_pdf(const PathGuidingDistribution *distribution,
+                                         const float3 D)
+{
+  float pdf = 0.0f;
+  for (int i = 0; i < PATH_GUIDING_NUM_LOBES; i++) {
+    const PathGuidingLobe *lobe = &distribution->lobes[i];
+    if (lobe->weight > 0.0f) {
+      pdf += lobe->weight * path_guiding_lobe_pdf(lobe, D);
+    }
+  }
+  return pdf;
+}
+
+/* Pick a lobe with randw, and sample a direction from it with randu and randv. */
+ccl_device_inline float3 path_guiding_sample(const PathGuidingDistribution *distribution,
+                                             float randu,
+                                             float randv,
+                                             float randw)
+{
+  const PathGuidingLobe *lobe = &distribution->lobes[PATH_GUIDING_NUM_LOBES - 1];
+  for (int i = 0; i < PATH_GUIDING_NUM_LOBES; i++) {
+    const float weight = distribution->lobes[i].weight;
+    if (randw < weight) {
+      lobe = &distribution->lobes[i];
+      break;
+    }
+    randw -= weight;
+  }
+
+  /* Sample cosine to the mean, numerically stable for large kappa. */
+  const float kappa = lobe->kappa;
+  const float w = 1.0f + logf(randu + (1.0f - randu) * expf(-2.0f * kappa)) / kappa;
+  const float sin_theta = safe_sqrtf(1.0f - w * w);
+  const float phi = M_2PI_F * randv;
+
+  float3 T, B;
+  make_orthonormals(lobe->mean, &T, &B);
+  return normalize(T * (cosf(phi) * sin_theta) + B * (sinf(phi) * sin_theta) + lobe->mean * w);
+}
+
+/* One-sample MIS combination of guiding and BSDF sampling. */
+ccl_device_inline float path_guiding_mix_pdf(const PathGuidingDistribution *distribution,
+                                             float probability,
+                                             const float3 D,
+                                             float bsdf_pdf)
+{
+  return probability * path_guiding_pdf(distribution, D) + (1.0f - probability) * bsdf_pdf;
+}
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_PATH_GUIDING_H__ */
@@ -266,6 +266,149 @@ ccl_device_inline void kernel_path_surface_connect_light(KernelGlobals *kg,
 #endif
 }
 
+#ifdef __PATH_GUIDING__
+/* Path guiding: decide if the bounce at the shading point samples the guiding distribution.
+ * Only the diffuse part of the BSDF is guided, glossy closures are sampled well enough by the
+ * BSDF itself. Must be called before direct lighting, since light MIS depends on it. */
+ccl_device_inline void kernel_path_guiding_prepare(KernelGlobals *kg, ShaderData *sd)
+{
+  if (!kernel_data.integrator.use_path_guiding || kg->guiding == NULL || !kg->guiding->ready ||
+      !(sd->flag & SD_BSDF_HAS_EVAL)) {
+    return;
+  }
+
+  float diffuse_weight = 0.0f;
+  float sum_weight = 0.0f;
+
+  for (int i = 0; i < sd->num_closure; i++) {
+    const ShaderClosure *sc = &sd->closure[i];
+
+    if (CLOSURE_IS_BSDF(sc->type)) {
+      sum_weight += sc->sample_weight;
+
+      if (CLOSURE_IS_BSDF_DIFFUSE(sc->type)) {
+        diffuse_weight += sc->sample_weight;
+      }
+    }
+  }
+
+  if (diffuse_weight == 0.0f) {
+    return;
+  }
+
+  sd->guiding_distribution = path_guiding_lookup(kg->guiding, sd->P);
+  sd->guiding_probability = kernel_data.integrator.path_guiding_probability * diffuse_weight /
+                            sum_weight;
+}
+
+/* Sample either the guiding distribution or the BSDF, with the pdf of the combination. */
+ccl_device_inline int kernel_path_guiding_sample(KernelGlobals *kg,
+                                                 ShaderData *sd,
+                                                 ccl_addr_space PathState *state,
+                                                 float bsdf_u,
+                                                 float bsdf_v,
+                                                 BsdfEval *bsdf_eval,
+                                                 float3 *omega_in,
+                                                 differential3 *domega_in,
+                                                 float *pdf)
+{
+  const float probability = sd->guiding_probability;
+  const float guide_rand = path_state_rng_1D_hash(kg, state, 0x5e8a3f71);
+
+  if (guide_rand < probability) {
+    *omega_in = path_guiding_sample(
+        sd->guiding_distribution, bsdf_u, bsdf_v, guide_rand / probability);
+    *domega_in = differential3_zero();
+
+    float bsdf_pdf;
+    bsdf_eval_init(bsdf_eval,
+                   NBUILTIN_CLOSURES,
+                   make_float3(0.0f, 0.0f, 0.0f),
+                   kernel_data.film.use_light_pass);
+    _shader_bsdf_multi_eval(kg, sd, *omega_in, &bsdf_pdf, NULL, bsdf_eval, 0.0f, 0.0f);
+
+    *pdf = path_guiding_mix_pdf(sd->guiding_distribution, probability, *omega_in, bsdf_pdf);
+    return LABEL_DIFFUSE | ((dot(sd->Ng, *omega_in) > 0.0f) ? LABEL_REFLECT : LABEL_TRANSMIT);
+  }
+
+  int label = shader_bsdf_sample(kg, sd, bsdf_u, bsdf_v, bsdf_eval, omega_in, domega_in, pdf);
+
+  if (*pdf != 0.0f) {
+    if (label & (LABEL_SINGULAR | LABEL_TRANSPARENT)) {
+      /* Only reachable through BSDF sampling. */
+      *pdf *= 1.0f - probability;
+    }
+    else {
+      *pdf = path_guiding_mix_pdf(sd->guiding_distribution, probability, *omega_in, *pdf);
+    }
+  }
+
+  return label;
+}
+
+/* Radiance gathered by the path so far, before splitting into passes. */
+ccl_device_inline float3 kernel_path_guiding_radiance(const PathRadiance *L)
+{
+#  ifdef __PASSES__
+  if (L->use_light_pass) {
+    return L->emission + L->background + L->direct_diffuse + L->direct_glossy +
+           L->direct_transmission + L->direct_volume + L->direct_emission + L->indirect;
+  }
+#  endif
+  return L->emission;
+}
+
+/* When rendering training passes, remember the bounce so the radiance found further along
+ * the path can be recorded for it. */
+ccl_device_inline void kernel_path_guiding_record_bounce(KernelGlobals *kg,
+                                                         ShaderData *sd,
+                                                         ccl_addr_space PathState *state,
+                                                         ccl_addr_space Ray *ray,
+                                                         float3 throughput,
+                                                         const PathRadiance *L)
+{
+  PathGuidingPath *path = kg->guiding_path;
+  if (path == NULL || path->num_vertices == PATH_GUIDING_MAX_VERTICES ||
+      !(sd->flag & SD_BSDF) || (state->flag & (PATH_RAY_TRANSPARENT | PATH_RAY_SINGULAR))) {
+    return;
+  }
+
+  PathGuidingVertex *vertex = &path->vertices[path->num_vertices++];
+  vertex->P = sd->P;
+  vertex->D = ray->D;
+  vertex->pdf = state->ray_pdf;
+  vertex->throughput = throughput;
+  vertex->L = kernel_path_guiding_radiance(L);
+}
+
+/* Turn the bounces of a finished path into samples of incident radiance. Light sampled
+ * directly at a bounce is not part of its sample, only what arrives along the bounce ray. */
+ccl_device_inline void kernel_path_guiding_record_path(KernelGlobals *kg, const PathRadiance *L)
+{
+  PathGuidingPath *path = kg->guiding_path;
+  if (path == NULL) {
+    return;
+  }
+
+  const float3 L_total = kernel_path_guiding_radiance(L);
+
+  for (int i = 0; i < path->num_vertices; i++) {
+    const PathGuidingVertex *vertex = &path->vertices[i];
+    const float radiance = average(safe_divide_color(L_total - vertex->L, vertex->throughput));
+
+    if (radiance > 0.0f && isfinite_safe(radiance)) {
+      PathGuidingSample sample;
+      sample.P = vertex->P;
+      sample.D = vertex->D;
+      sample.weight = radiance / vertex->pdf;
+      path->samples.push_back(sample);
+    }
+  }
+
+  path->num_vertices = 0;
+}
+#endif /* __PATH_GUIDING__ */
+
 /* path tracing: bounce off or through surface to with new direction stored in ray */
 ccl_device bool kernel_path_surface_bounce(KernelGlobals *kg,
                                            ShaderData *sd,
@@ -287,8 +430,17 @@ ccl_device bool kernel_path_surface_bounce(KernelGlobals *kg,
     path_state_rng_2D(kg, state, PRNG_BSDF_U, &bsdf_u, &bsdf_v);
     int label;
 
-    label = shader_bsdf_sample(
-        kg, sd, bsdf_u, bsdf_v, &bsdf_eval, &bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+#ifdef __PATH_GUIDING__
+    if (sd->guiding_probability > 0.0f) {
+      label = kernel_path_guiding_sample(
+          kg, sd, state, bsdf_u, bsdf_v, &bsdf_eval, &bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+    }
+    else
+#endif
+    {
+      label = shader_bsdf_sample(
+          kg, sd, bsdf_u, bsdf_v, &bsdf_eval, &bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+    }
 
     if (bsdf_pdf == 0.0f || bsdf_eval_is_zero(&bsdf_eval))
       return false;
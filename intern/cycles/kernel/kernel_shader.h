@@ -32,6 +32,10 @@
 
 #include "kernel/svm/svm.h"
 
+#ifdef __PATH_GUIDING__
+#  include "kernel/kernel_path_guiding.h"
+#endif
+
 CCL_NAMESPACE_BEGIN
 
 /* ShaderData setup from incoming ray */
@@ -628,6 +632,12 @@ ccl_device_inline
   {
     float pdf;
     _shader_bsdf_multi_eval(kg, sd, omega_in, &pdf, NULL, eval, 0.0f, 0.0f);
+#ifdef __PATH_GUIDING__
+    /* Bounce rays of guided shading points are sampled from the mixture. */
+    if (sd->guiding_probability > 0.0f) {
+      pdf = path_guiding_mix_pdf(sd->guiding_distribution, sd->guiding_probability, omega_in, pdf);
+    }
+#endif
     if (use_mis) {
       float weight = power_heuristic(light_pdf, pdf);
       bsdf_eval_mis(eval, weight);
@@ -1075,6 +1085,9 @@ ccl_device void shader_eval_surface(KernelGlobals *kg,
 
   sd->num_closure = 0;
   sd->num_closure_left = max_closures;
+#ifdef __PATH_GUIDING__
+  sd->guiding_probability = 0.0f;
+#endif
 
 #ifdef __OSL__
   if (kg->osl) {
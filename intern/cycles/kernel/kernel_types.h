@@ -128,6 +128,9 @@ CCL_NAMESPACE_BEGIN
 #  endif
 #  define __VOLUME_DECOUPLED__
 #  define __VOLUME_RECORD_ALL__
+#  ifndef __SPLIT_KERNEL__
+#    define __PATH_GUIDING__
+#  endif
 #endif /* __KERNEL_CPU__ */
 
 #ifdef __KERNEL_CUDA__
@@ -999,6 +1002,14 @@ typedef ccl_addr_space struct ccl_align(16) ShaderData
   struct PathState *osl_path_state;
 #endif
 
+#ifdef __KERNEL_CPU__
+  /* Directional distribution learned for the shading point, and the probability of sampling
+   * it instead of the BSDF. Zero when the bounce is not guided. Not used by the split kernel,
+   * but declared for it too to keep the layout the same in all CPU kernels. */
+  const struct PathGuidingDistribution *guiding_distribution;
+  float guiding_probability;
+#endif
+
   /* LCG state for closures that require additional random numbers. */
   uint lcg_state;
 
@@ -1387,7 +1398,15 @@ typedef struct KernelIntegrator {
 
   int max_closures;
 
-  int pad1, pad2;
+  /* light tree */
+  int use_light_tree;
+  int light_tree_num_emitters;
+  int light_tree_num_infinite;
+
+  /* path guiding */
+  int use_path_guiding;
+  int path_guiding_training_passes;
+  float path_guiding_probability;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
 
@@ -1546,6 +1565,39 @@ typedef struct KernelLightDistribution {
 } KernelLightDistribution;
 static_assert_align(KernelLightDistribution, 16);
 
+/* Light tree node, bounding the position, orientation and energy of the emitters below it.
+ * Inner nodes store their left child right after themselves and the right child at
+ * child_index, leaf nodes reference num_emitters emitters starting at child_index. */
+typedef struct KernelLightTreeNode {
+  float bbox_min[3];
+  float energy;
+  float bbox_max[3];
+  float theta_o;
+  float axis[3];
+  float theta_e;
+  int child_index;
+  int num_emitters;
+  int pad1, pad2;
+} KernelLightTreeNode;
+static_assert_align(KernelLightTreeNode, 16);
+
+/* Light tree emitter, one per entry of the light distribution. bit_trail encodes the path
+ * from the root to the leaf containing the emitter, one bit per level with 1 meaning the
+ * right child. */
+typedef struct KernelLightTreeEmitter {
+  float bbox_min[3];
+  float energy;
+  float bbox_max[3];
+  float theta_o;
+  float axis[3];
+  float theta_e;
+  int distribution_index;
+  uint bit_trail;
+  float inv_area;
+  int pad1;
+} KernelLightTreeEmitter;
+static_assert_align(KernelLightTreeEmitter, 16);
+
 typedef struct KernelParticle {
   int index;
   float age;
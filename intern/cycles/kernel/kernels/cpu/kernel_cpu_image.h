@@ -17,6 +17,8 @@
 #ifndef __KERNEL_CPU_IMAGE_H__
 #define __KERNEL_CPU_IMAGE_H__
 
+#include "util/util_image_cache.h"
+
 #ifdef WITH_NANOVDB
 #  define NANOVDB_USE_INTRINSICS
 #  include <nanovdb/NanoVDB.h>
@@ -582,12 +584,125 @@ template<typename T> struct NanoVDBInterpolator {
 };
 #endif
 
+/* Images loaded on demand through the image cache, which stores RGBA float texels in tiles
+ * for every MIP level. */
+struct ImageCacheInterpolator {
+  static ccl_always_inline float4
+  read(ImageCacheTexture *texture, int level, int x, int y, int width, int height)
+  {
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+      return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    return texture->fetch(level, x, y);
+  }
+
+  static ccl_always_inline int wrap(int x, int width, uint extension)
+  {
+    switch (extension) {
+      case EXTENSION_REPEAT:
+        return TextureInterpolator<float4>::wrap_periodic(x, width);
+      case EXTENSION_EXTEND:
+        return TextureInterpolator<float4>::wrap_clamp(x, width);
+      default:
+        /* Texels outside of the image are read as transparent. */
+        return x;
+    }
+  }
+
+  static ccl_always_inline float4
+  interp_level(const TextureInfo &info, ImageCacheTexture *texture, int level, float x, float y)
+  {
+    const int width = texture->width(level);
+    const int height = texture->height(level);
+    int ix, iy;
+
+    if (info.interpolation == INTERPOLATION_CLOSEST) {
+      frac(x * (float)width, &ix);
+      frac(y * (float)height, &iy);
+      if (info.extension == EXTENSION_CLIP) {
+        if (x < 0.0f || y < 0.0f || x > 1.0f || y > 1.0f) {
+          return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+        }
+        ix = TextureInterpolator<float4>::wrap_clamp(ix, width);
+        iy = TextureInterpolator<float4>::wrap_clamp(iy, height);
+      }
+      return texture->fetch(
+          level, wrap(ix, width, info.extension), wrap(iy, height, info.extension));
+    }
+
+    const float tx = frac(x * (float)width - 0.5f, &ix);
+    const float ty = frac(y * (float)height - 0.5f, &iy);
+
+    if (info.interpolation == INTERPOLATION_LINEAR) {
+      const int x0 = wrap(ix, width, info.extension);
+      const int y0 = wrap(iy, height, info.extension);
+      const int x1 = wrap(ix + 1, width, info.extension);
+      const int y1 = wrap(iy + 1, height, info.extension);
+
+      return (1.0f - ty) * (1.0f - tx) * read(texture, level, x0, y0, width, height) +
+             (1.0f - ty) * tx * read(texture, level, x1, y0, width, height) +
+             ty * (1.0f - tx) * read(texture, level, x0, y1, width, height) +
+             ty * tx * read(texture, level, x1, y1, width, height);
+    }
+
+    int xc[4], yc[4];
+    for (int i = 0; i < 4; i++) {
+      xc[i] = wrap(ix + i - 1, width, info.extension);
+      yc[i] = wrap(iy + i - 1, height, info.extension);
+    }
+
+    float u[4], v[4];
+    SET_CUBIC_SPLINE_WEIGHTS(u, tx);
+    SET_CUBIC_SPLINE_WEIGHTS(v, ty);
+
+    float4 r = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+    for (int j = 0; j < 4; j++) {
+      float4 row = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+      for (int i = 0; i < 4; i++) {
+        row += u[i] * read(texture, level, xc[i], yc[j], width, height);
+      }
+      r += v[j] * row;
+    }
+    return r;
+  }
+
+  /* Trilinear filtering between the two MIP levels around lod. Closest interpolation always
+   * uses the finest level, to keep the pixelated look. */
+  static ccl_always_inline float4 interp(const TextureInfo &info, float x, float y, float lod)
+  {
+    ImageCacheTexture *texture = (ImageCacheTexture *)info.data;
+    if (UNLIKELY(!texture)) {
+      return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    const int max_level = texture->num_levels() - 1;
+    if (info.interpolation == INTERPOLATION_CLOSEST) {
+      lod = 0.0f;
+    }
+    lod = clamp(lod, (float)texture->min_level(), (float)max_level);
+
+    int level;
+    const float t = frac(lod, &level);
+    const float4 r = interp_level(info, texture, level, x, y);
+
+    if (t == 0.0f || level == max_level) {
+      return r;
+    }
+
+    return (1.0f - t) * r + t * interp_level(info, texture, level + 1, x, y);
+  }
+};
+
 #undef SET_CUBIC_SPLINE_WEIGHTS
 
 ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, float y)
 {
   const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
 
+  if (info.use_cache) {
+    return ImageCacheInterpolator::interp(info, x, y, 0.0f);
+  }
+
   switch (info.data_type) {
     case IMAGE_DATA_TYPE_HALF:
       return TextureInterpolator<half>::interp(info, x, y);
@@ -612,6 +727,28 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, fl
   }
 }
 
+/* Lookup with the footprint of the shading point in texture coordinates, given by the
+ * derivatives of x and y. Selects the MIP level for images in the image cache, other images
+ * are always looked up at full resolution. */
+ccl_device float4 kernel_tex_image_interp_footprint(
+    KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy)
+{
+  const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
+
+  if (!info.use_cache) {
+    return kernel_tex_image_interp(kg, id, x, y);
+  }
+
+  const float2 size = make_float2((float)info.width, (float)info.height);
+  const float footprint = max(len(dx * size), len(dy * size));
+
+  /* Bias towards the finer level to stay as sharp as the full resolution image, the pixel
+   * filter already averages over the footprint. */
+  const float lod = (footprint > 0.0f) ? log2f(footprint) - 1.0f : 0.0f;
+
+  return ImageCacheInterpolator::interp(info, x, y, lod);
+}
+
 ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg,
                                              int id,
                                              float3 P,
@@ -16,6 +16,47 @@
 
 CCL_NAMESPACE_BEGIN
 
+#ifdef __KERNEL_CPU__
+/* The CPU runs this kernel with a local size of one, so a single invocation has the whole
+ * block to itself. Radix sort the indices by shader, which is stable so paths with the same
+ * shader keep their order. Passes are skipped when all keys share the digit, which for the
+ * typically small shader indices leaves one or two passes. */
+ccl_device void kernel_shader_sort_block_cpu(const uint *value, ushort *index)
+{
+  ushort temp[SHADER_SORT_BLOCK_SIZE];
+  ushort *src = index;
+  ushort *dst = temp;
+
+  for (uint shift = 0; shift < 32; shift += 8) {
+    uint count[256] = {0};
+    for (uint i = 0; i < SHADER_SORT_BLOCK_SIZE; i++) {
+      count[(value[src[i]] >> shift) & 0xff]++;
+    }
+    if (count[(value[src[0]] >> shift) & 0xff] == SHADER_SORT_BLOCK_SIZE) {
+      continue;
+    }
+
+    uint offset = 0;
+    for (uint digit = 0; digit < 256; digit++) {
+      const uint digit_count = count[digit];
+      count[digit] = offset;
+      offset += digit_count;
+    }
+    for (uint i = 0; i < SHADER_SORT_BLOCK_SIZE; i++) {
+      dst[count[(value[src[i]] >> shift) & 0xff]++] = src[i];
+    }
+
+    ushort *swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  if (src != index) {
+    memcpy(index, src, sizeof(ushort) * SHADER_SORT_BLOCK_SIZE);
+  }
+}
+#endif /* __KERNEL_CPU__ */
+
 ccl_device void kernel_shader_sort(KernelGlobals *kg, ccl_local_param ShaderSortLocals *locals)
 {
 #ifndef __KERNEL_CUDA__
@@ -54,7 +95,6 @@ ccl_device void kernel_shader_sort(KernelGlobals *kg, ccl_local_param ShaderSort
   }
   ccl_barrier(CCL_LOCAL_MEM_FENCE);
 
-  /* skip sorting for cpu split kernel */
 #  ifdef __KERNEL_OPENCL__
 
   /* bitonic sort */
@@ -77,6 +117,8 @@ ccl_device void kernel_shader_sort(KernelGlobals *kg, ccl_local_param ShaderSort
       }
     }
   }
+#  elif defined(__KERNEL_CPU__)
+  kernel_shader_sort_block_cpu(local_value, local_index);
 #  endif /* __KERNEL_OPENCL__ */
 
   /* copy to destination */
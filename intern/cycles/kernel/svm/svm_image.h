@@ -16,14 +16,8 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint flags)
+ccl_device_inline float4 svm_image_texture_flags(float4 r, uint flags)
 {
-  if (id == -1) {
-    return make_float4(
-        TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
-  }
-
-  float4 r = kernel_tex_image_interp(kg, id, x, y);
   const float alpha = r.w;
 
   if ((flags & NODE_IMAGE_ALPHA_UNASSOCIATE) && alpha != 1.0f && alpha != 0.0f) {
@@ -38,6 +32,39 @@ ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y,
   return r;
 }
 
+ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint flags)
+{
+  if (id == -1) {
+    return make_float4(
+        TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
+  }
+
+  return svm_image_texture_flags(kernel_tex_image_interp(kg, id, x, y), flags);
+}
+
+#ifdef __KERNEL_CPU__
+/* Lookup using the ray differentials of the default UV map, so images loaded through the
+ * image cache can use a coarser MIP level. */
+ccl_device float4 svm_image_texture_uv_differentials(
+    KernelGlobals *kg, ShaderData *sd, int id, float x, float y, uint flags)
+{
+  if (id == -1) {
+    return make_float4(
+        TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
+  }
+
+  float2 dx = make_float2(0.0f, 0.0f);
+  float2 dy = make_float2(0.0f, 0.0f);
+
+  const AttributeDescriptor desc = find_attribute(kg, sd, ATTR_STD_UV);
+  if (desc.offset != ATTR_STD_NOT_FOUND) {
+    primitive_surface_attribute_float2(kg, sd, desc, &dx, &dy);
+  }
+
+  return svm_image_texture_flags(kernel_tex_image_interp_footprint(kg, id, x, y, dx, dy), flags);
+}
+#endif
+
 /* Remap coordnate from 0..1 box to -1..-1 */
 ccl_device_inline float3 texco_remap_square(float3 co)
 {
@@ -108,7 +135,16 @@ ccl_device void svm_node_tex_image(
     id = -num_nodes;
   }
 
-  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, flags);
+  float4 f;
+#ifdef __KERNEL_CPU__
+  if (flags & NODE_IMAGE_UV_DIFFERENTIALS) {
+    f = svm_image_texture_uv_differentials(kg, sd, id, tex_co.x, tex_co.y, flags);
+  }
+  else
+#endif
+  {
+    f = svm_image_texture(kg, id, tex_co.x, tex_co.y, flags);
+  }
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -28,7 +28,14 @@ CCL_NAMESPACE_BEGIN
 
 Attribute::Attribute(
     ustring name, TypeDesc type, AttributeElement element, Geometry *geom, AttributePrimitive prim)
-    : name(name), std(ATTR_STD_NONE), type(type), element(element), flags(0)
+    : name(name),
+      std(ATTR_STD_NONE),
+      type(type),
+      element(element),
+      flags(0),
+      modified(true),
+      device_offset(-1),
+      prev_device_offset(-1)
 {
   /* string and matrix not supported! */
   assert(type == TypeDesc::TypeFloat || type == TypeDesc::TypeColor ||
@@ -62,6 +69,7 @@ void Attribute::resize(Geometry *geom, AttributePrimitive prim, bool reserve_onl
     }
     else {
       buffer.resize(buffer_size(geom, prim), 0);
+      modified = true;
     }
   }
 }
@@ -70,6 +78,7 @@ void Attribute::resize(size_t num_elements)
 {
   if (element != ATTR_ELEMENT_VOXEL) {
     buffer.resize(num_elements * data_sizeof(), 0);
+    modified = true;
   }
 }
 
@@ -400,9 +409,11 @@ Attribute *AttributeSet::add(ustring name, TypeDesc type, AttributeElement eleme
   Attribute *attr = find(name);
 
   if (attr) {
-    /* return if same already exists */
-    if (attr->type == type && attr->element == element)
+    /* return if same already exists, the caller will write new data into it */
+    if (attr->type == type && attr->element == element) {
+      attr->modified = true;
       return attr;
+    }
 
     /* overwrite attribute with same name but different type/element */
     remove(name);
@@ -627,6 +638,65 @@ void AttributeSet::clear(bool preserve_voxel_data)
   }
 }
 
+Attribute *AttributeSet::find_matching(const Attribute &other)
+{
+  foreach (Attribute &attr, attributes) {
+    if (attr.name == other.name && attr.std == other.std && attr.type == other.type &&
+        attr.element == other.element) {
+      return &attr;
+    }
+  }
+  return NULL;
+}
+
+void AttributeSet::update(AttributeSet &&new_attributes)
+{
+  /* Remove attributes that no longer exist or of which the data changed. */
+  list<Attribute>::iterator it;
+  for (it = attributes.begin(); it != attributes.end();) {
+    Attribute *new_attr = new_attributes.find_matching(*it);
+    if (new_attr == NULL || it->element == ATTR_ELEMENT_VOXEL ||
+        new_attr->flags != it->flags || new_attr->buffer != it->buffer) {
+      attributes.erase(it++);
+    }
+    else {
+      it++;
+    }
+  }
+
+  /* Add the new and changed attributes. */
+  foreach (Attribute &attr, new_attributes.attributes) {
+    if (find_matching(attr) == NULL) {
+      attributes.push_back(std::move(attr));
+    }
+  }
+
+  new_attributes.clear();
+}
+
+void AttributeSet::clear_modified()
+{
+  foreach (Attribute &attr, attributes) {
+    attr.modified = false;
+  }
+}
+
+void AttributeSet::device_offsets_begin()
+{
+  foreach (Attribute &attr, attributes) {
+    attr.prev_device_offset = attr.device_offset;
+    attr.device_offset = -1;
+  }
+}
+
+void AttributeSet::device_offsets_invalidate()
+{
+  foreach (Attribute &attr, attributes) {
+    attr.prev_device_offset = -1;
+    attr.device_offset = -1;
+  }
+}
+
 /* AttributeRequest */
 
 AttributeRequest::AttributeRequest(ustring name_)
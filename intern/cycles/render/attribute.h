@@ -54,6 +54,16 @@ class Attribute {
   AttributeElement element;
   uint flags; /* enum AttributeFlag */
 
+  /* Data changed since the last device update. Code writing to the buffer of an existing
+   * attribute must set this. */
+  bool modified;
+  /* Offset in the device array the data was copied to by the last device update, or -1 when
+   * the data is not in the array anymore. Unmodified data that stays in place is not copied
+   * again. */
+  int device_offset;
+  /* Value of device_offset when the current device update started. */
+  int prev_device_offset;
+
   Attribute(ustring name,
             TypeDesc type,
             AttributeElement element,
@@ -194,6 +204,20 @@ class AttributeSet {
 
   void resize(bool reserve_only = false);
   void clear(bool preserve_voxel_data = false);
+
+  /* Replace the attributes with the given ones, keeping existing attributes of which the
+   * data did not change so they are not copied to the device again. */
+  void update(AttributeSet &&new_attributes);
+  void clear_modified();
+
+  /* Start packing attributes into the device arrays, attributes that are not packed again
+   * lose their place in the arrays. */
+  void device_offsets_begin();
+  /* Copy all data again on the next device update, for updates that did not finish. */
+  void device_offsets_invalidate();
+
+ private:
+  Attribute *find_matching(const Attribute &other);
 };
 
 /* AttributeRequest
@@ -61,6 +61,7 @@ Geometry::Geometry(const NodeType *node_type, const Type type)
     : Node(node_type), geometry_type(type), attributes(this, ATTR_PRIM_GEOMETRY)
 {
   need_update_rebuild = false;
+  need_update_offsets = true;
 
   transform_applied = false;
   transform_negative_scaled = false;
@@ -232,6 +233,7 @@ void Geometry::compute_bvh(
       bparams.num_motion_curve_steps = params->num_bvh_time_steps;
       bparams.bvh_type = params->bvh_type;
       bparams.curve_subdivisions = params->curve_subdivisions();
+      bparams.cache_directory = params->bvh_cache_directory;
 
       delete bvh;
       bvh = BVH::create(bparams, geometry, objects, device);
@@ -239,7 +241,6 @@ void Geometry::compute_bvh(
     }
   }
 
-  clear_modified();
   need_update_rebuild = false;
 }
 
@@ -261,7 +262,11 @@ bool Geometry::has_voxel_attributes() const
 
 void Geometry::tag_update(Scene *scene, bool rebuild)
 {
-  tag_modified();
+  /* Keep the flags of individual sockets when they were set, so the device update only
+   * packs the arrays that changed. */
+  if (!is_modified()) {
+    tag_modified();
+  }
 
   if (rebuild) {
     need_update_rebuild = true;
@@ -568,7 +573,9 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
                                                       Attribute *mattr,
                                                       AttributePrimitive prim,
                                                       TypeDesc &type,
-                                                      AttributeDescriptor &desc)
+                                                      AttributeDescriptor &desc,
+                                                      bool copy_all,
+                                                      bool &copied)
 {
   if (mattr) {
     /* store element and type */
@@ -582,6 +589,10 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
     AttributeElement &element = desc.element;
     int &offset = desc.offset;
 
+    /* Data that did not change and is still at the same location in the array does not
+     * need to be copied again. */
+    const bool copy_data = copy_all || mattr->modified;
+
     if (mattr->element == ATTR_ELEMENT_VOXEL) {
       /* store slot in offset value */
       ImageHandle &handle = mattr->data_voxel();
@@ -592,9 +603,13 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
       offset = attr_uchar4_offset;
 
       assert(attr_uchar4.size() >= offset + size);
-      for (size_t k = 0; k < size; k++) {
-        attr_uchar4[offset + k] = data[k];
+      if (copy_data || mattr->prev_device_offset != offset) {
+        for (size_t k = 0; k < size; k++) {
+          attr_uchar4[offset + k] = data[k];
+        }
+        copied = true;
       }
+      mattr->device_offset = offset;
       attr_uchar4_offset += size;
     }
     else if (mattr->type == TypeDesc::TypeFloat) {
@@ -602,9 +617,13 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
       offset = attr_float_offset;
 
       assert(attr_float.size() >= offset + size);
-      for (size_t k = 0; k < size; k++) {
-        attr_float[offset + k] = data[k];
+      if (copy_data || mattr->prev_device_offset != offset) {
+        for (size_t k = 0; k < size; k++) {
+          attr_float[offset + k] = data[k];
+        }
+        copied = true;
       }
+      mattr->device_offset = offset;
       attr_float_offset += size;
     }
     else if (mattr->type == TypeFloat2) {
@@ -612,9 +631,13 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
       offset = attr_float2_offset;
 
       assert(attr_float2.size() >= offset + size);
-      for (size_t k = 0; k < size; k++) {
-        attr_float2[offset + k] = data[k];
+      if (copy_data || mattr->prev_device_offset != offset) {
+        for (size_t k = 0; k < size; k++) {
+          attr_float2[offset + k] = data[k];
+        }
+        copied = true;
       }
+      mattr->device_offset = offset;
       attr_float2_offset += size;
     }
     else if (mattr->type == TypeDesc::TypeMatrix) {
@@ -622,9 +645,13 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
       offset = attr_float3_offset;
 
       assert(attr_float3.size() >= offset + size * 3);
-      for (size_t k = 0; k < size * 3; k++) {
-        attr_float3[offset + k] = (&tfm->x)[k];
+      if (copy_data || mattr->prev_device_offset != offset) {
+        for (size_t k = 0; k < size * 3; k++) {
+          attr_float3[offset + k] = (&tfm->x)[k];
+        }
+        copied = true;
       }
+      mattr->device_offset = offset;
       attr_float3_offset += size * 3;
     }
     else {
@@ -632,9 +659,13 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
       offset = attr_float3_offset;
 
       assert(attr_float3.size() >= offset + size);
-      for (size_t k = 0; k < size; k++) {
-        attr_float3[offset + k] = data[k];
+      if (copy_data || mattr->prev_device_offset != offset) {
+        for (size_t k = 0; k < size; k++) {
+          attr_float3[offset + k] = data[k];
+        }
+        copied = true;
       }
+      mattr->device_offset = offset;
       attr_float3_offset += size;
     }
 
@@ -681,6 +712,31 @@ void GeometryManager::update_attribute_element_offset(Geometry *geom,
   }
 }
 
+/* Data of attributes that are not packed by an update is overwritten by other attributes, so
+ * their previous offsets must not be trusted by later updates. */
+static void geometry_attributes_device_offsets_begin(Scene *scene)
+{
+  foreach (Geometry *geom, scene->geometry) {
+    geom->attributes.device_offsets_begin();
+    if (geom->is_mesh()) {
+      Mesh *mesh = static_cast<Mesh *>(geom);
+      mesh->subd_attributes.device_offsets_begin();
+    }
+  }
+}
+
+/* Host arrays of a cancelled update may not match the device, copy everything next time. */
+static void geometry_attributes_device_offsets_invalidate(Scene *scene)
+{
+  foreach (Geometry *geom, scene->geometry) {
+    geom->attributes.device_offsets_invalidate();
+    if (geom->is_mesh()) {
+      Mesh *mesh = static_cast<Mesh *>(geom);
+      mesh->subd_attributes.device_offsets_invalidate();
+    }
+  }
+}
+
 void GeometryManager::device_update_attributes(Device *device,
                                                DeviceScene *dscene,
                                                Scene *scene,
@@ -793,6 +849,15 @@ void GeometryManager::device_update_attributes(Device *device,
     }
   }
 
+  /* Arrays that keep their size keep their data, so only attributes that changed or moved
+   * have to be copied into them. */
+  const bool copy_all = dscene->attributes_float.size() != attr_float_size ||
+                        dscene->attributes_float2.size() != attr_float2_size ||
+                        dscene->attributes_float3.size() != attr_float3_size ||
+                        dscene->attributes_uchar4.size() != attr_uchar4_size;
+
+  bool copied = false;
+
   dscene->attributes_float.alloc(attr_float_size);
   dscene->attributes_float2.alloc(attr_float2_size);
   dscene->attributes_float3.alloc(attr_float3_size);
@@ -803,6 +868,8 @@ void GeometryManager::device_update_attributes(Device *device,
   size_t attr_float3_offset = 0;
   size_t attr_uchar4_offset = 0;
 
+  geometry_attributes_device_offsets_begin(scene);
+
   /* Fill in attributes. */
   for (size_t i = 0; i < scene->geometry.size(); i++) {
     Geometry *geom = scene->geometry[i];
@@ -824,7 +891,9 @@ void GeometryManager::device_update_attributes(Device *device,
                                       attr,
                                       ATTR_PRIM_GEOMETRY,
                                       req.type,
-                                      req.desc);
+                                      req.desc,
+                                      copy_all,
+                                      copied);
 
       if (geom->is_mesh()) {
         Mesh *mesh = static_cast<Mesh *>(geom);
@@ -842,11 +911,15 @@ void GeometryManager::device_update_attributes(Device *device,
                                         subd_attr,
                                         ATTR_PRIM_SUBD,
                                         req.subd_type,
-                                        req.subd_desc);
+                                        req.subd_desc,
+                                        copy_all,
+                                        copied);
       }
 
-      if (progress.get_cancel())
+      if (progress.get_cancel()) {
+        geometry_attributes_device_offsets_invalidate(scene);
         return;
+      }
     }
   }
 
@@ -870,14 +943,18 @@ void GeometryManager::device_update_attributes(Device *device,
                                       attr,
                                       ATTR_PRIM_GEOMETRY,
                                       req.type,
-                                      req.desc);
+                                      req.desc,
+                                      copy_all,
+                                      copied);
 
       /* object attributes don't care about subdivision */
       req.subd_type = req.type;
       req.subd_desc = req.desc;
 
-      if (progress.get_cancel())
+      if (progress.get_cancel()) {
+        geometry_attributes_device_offsets_invalidate(scene);
         return;
+      }
     }
   }
 
@@ -887,23 +964,27 @@ void GeometryManager::device_update_attributes(Device *device,
 
   update_svm_attributes(device, dscene, scene, geom_attributes, object_attributes);
 
-  if (progress.get_cancel())
+  if (progress.get_cancel()) {
+    geometry_attributes_device_offsets_invalidate(scene);
     return;
+  }
 
   /* copy to device */
   progress.set_status("Updating Mesh", "Copying Attributes to device");
 
-  if (dscene->attributes_float.size()) {
-    dscene->attributes_float.copy_to_device();
-  }
-  if (dscene->attributes_float2.size()) {
-    dscene->attributes_float2.copy_to_device();
-  }
-  if (dscene->attributes_float3.size()) {
-    dscene->attributes_float3.copy_to_device();
-  }
-  if (dscene->attributes_uchar4.size()) {
-    dscene->attributes_uchar4.copy_to_device();
+  if (copied) {
+    if (dscene->attributes_float.size()) {
+      dscene->attributes_float.copy_to_device();
+    }
+    if (dscene->attributes_float2.size()) {
+      dscene->attributes_float2.copy_to_device();
+    }
+    if (dscene->attributes_float3.size()) {
+      dscene->attributes_float3.copy_to_device();
+    }
+    if (dscene->attributes_uchar4.size()) {
+      dscene->attributes_uchar4.copy_to_device();
+    }
   }
 
   if (progress.get_cancel())
@@ -932,6 +1013,12 @@ void GeometryManager::mesh_calc_offset(Scene *scene)
     if (geom->geometry_type == Geometry::MESH || geom->geometry_type == Geometry::VOLUME) {
       Mesh *mesh = static_cast<Mesh *>(geom);
 
+      if (mesh->vert_offset != vert_size || mesh->prim_offset != tri_size ||
+          mesh->patch_offset != patch_size || mesh->face_offset != face_size ||
+          mesh->corner_offset != corner_size) {
+        mesh->need_update_offsets = true;
+      }
+
       mesh->vert_offset = vert_size;
       mesh->prim_offset = tri_size;
 
@@ -962,6 +1049,10 @@ void GeometryManager::mesh_calc_offset(Scene *scene)
     else if (geom->is_hair()) {
       Hair *hair = static_cast<Hair *>(geom);
 
+      if (hair->curvekey_offset != curve_key_size || hair->prim_offset != curve_size) {
+        hair->need_update_offsets = true;
+      }
+
       hair->curvekey_offset = curve_key_size;
       hair->prim_offset = curve_size;
 
@@ -1037,11 +1128,21 @@ void GeometryManager::device_update_mesh(
     }
   }
 
-  /* Fill in all the arrays. */
+  /* Shader IDs are packed into the arrays, they change when shaders are added or removed. */
+  const bool shaders_modified = (packed_shaders != scene->shaders);
+
+  /* Fill in all the arrays. Arrays that keep their size keep their data, so then only the
+   * data of geometry that changed or moved is packed, and arrays that were not written to
+   * are not copied to the device. */
   if (tri_size != 0) {
     /* normals */
     progress.set_status("Updating Mesh", "Computing normals");
 
+    const bool pack_all = for_displacement || dscene->tri_shader.size() != tri_size ||
+                          dscene->tri_vnormal.size() != vert_size;
+    bool tri_shader_modified = pack_all;
+    bool vnormal_modified = pack_all;
+
     uint *tri_shader = dscene->tri_shader.alloc(tri_size);
     float4 *vnormal = dscene->tri_vnormal.alloc(vert_size);
     uint4 *tri_vindex = dscene->tri_vindex.alloc(tri_size);
@@ -1051,8 +1152,26 @@ void GeometryManager::device_update_mesh(
     foreach (Geometry *geom, scene->geometry) {
       if (geom->geometry_type == Geometry::MESH || geom->geometry_type == Geometry::VOLUME) {
         Mesh *mesh = static_cast<Mesh *>(geom);
-        mesh->pack_shaders(scene, &tri_shader[mesh->prim_offset]);
-        mesh->pack_normals(&vnormal[mesh->vert_offset]);
+        /* Tessellation and volume meshing write the arrays without tagging sockets. */
+        const bool pack_mesh = pack_all || mesh->need_update_offsets ||
+                               (mesh->is_modified() &&
+                                (mesh->geometry_type == Geometry::VOLUME ||
+                                 mesh->get_num_subd_faces() != 0));
+
+        if (pack_mesh || shaders_modified || mesh->shader_is_modified() ||
+            mesh->smooth_is_modified() || mesh->used_shaders_is_modified()) {
+          mesh->pack_shaders(scene, &tri_shader[mesh->prim_offset]);
+          tri_shader_modified = true;
+        }
+
+        Attribute *attr_vN = mesh->attributes.find(ATTR_STD_VERTEX_NORMAL);
+        if (pack_mesh || mesh->verts_is_modified() || (attr_vN && attr_vN->modified)) {
+          mesh->pack_normals(&vnormal[mesh->vert_offset]);
+          vnormal_modified = true;
+        }
+
+        /* Primitive indices follow the order of the BVH, which is built again on every
+         * update, so these are always packed. */
         mesh->pack_verts(tri_prim_index,
                          &tri_vindex[mesh->prim_offset],
                          &tri_patch[mesh->prim_offset],
@@ -1067,8 +1186,12 @@ void GeometryManager::device_update_mesh(
     /* vertex coordinates */
     progress.set_status("Updating Mesh", "Copying Mesh to device");
 
-    dscene->tri_shader.copy_to_device();
-    dscene->tri_vnormal.copy_to_device();
+    if (tri_shader_modified) {
+      dscene->tri_shader.copy_to_device();
+    }
+    if (vnormal_modified) {
+      dscene->tri_vnormal.copy_to_device();
+    }
     dscene->tri_vindex.copy_to_device();
     dscene->tri_patch.copy_to_device();
     dscene->tri_patch_uv.copy_to_device();
@@ -1077,33 +1200,53 @@ void GeometryManager::device_update_mesh(
   if (curve_size != 0) {
     progress.set_status("Updating Mesh", "Copying Strands to device");
 
+    const bool pack_all = dscene->curve_keys.size() != curve_key_size ||
+                          dscene->curves.size() != curve_size;
+    bool curves_modified = pack_all;
+
     float4 *curve_keys = dscene->curve_keys.alloc(curve_key_size);
     float4 *curves = dscene->curves.alloc(curve_size);
 
     foreach (Geometry *geom, scene->geometry) {
       if (geom->is_hair()) {
         Hair *hair = static_cast<Hair *>(geom);
+        if (!(pack_all || shaders_modified || hair->need_update_offsets ||
+              hair->is_modified())) {
+          continue;
+        }
+
         hair->pack_curves(scene,
                           &curve_keys[hair->curvekey_offset],
                           &curves[hair->prim_offset],
                           hair->curvekey_offset);
+        curves_modified = true;
         if (progress.get_cancel())
           return;
       }
     }
 
-    dscene->curve_keys.copy_to_device();
-    dscene->curves.copy_to_device();
+    if (curves_modified) {
+      dscene->curve_keys.copy_to_device();
+      dscene->curves.copy_to_device();
+    }
   }
 
   if (patch_size != 0) {
     progress.set_status("Updating Mesh", "Copying Patches to device");
 
+    const bool pack_all = dscene->patches.size() != patch_size;
+    bool patches_modified = pack_all;
+
     uint *patch_data = dscene->patches.alloc(patch_size);
 
     foreach (Geometry *geom, scene->geometry) {
       if (geom->is_mesh()) {
         Mesh *mesh = static_cast<Mesh *>(geom);
+        if (!(pack_all || mesh->need_update_offsets || mesh->is_modified())) {
+          continue;
+        }
+
+        patches_modified = true;
         mesh->pack_patches(&patch_data[mesh->patch_offset],
                            mesh->vert_offset,
                            mesh->face_offset,
@@ -1119,7 +1262,9 @@ void GeometryManager::device_update_mesh(
       }
     }
 
-    dscene->patches.copy_to_device();
+    if (patches_modified) {
+      dscene->patches.copy_to_device();
+    }
   }
 
   if (for_displacement) {
@@ -1138,6 +1283,9 @@ void GeometryManager::device_update_mesh(
     }
     dscene->prim_tri_verts.copy_to_device();
   }
+  else {
+    packed_shaders = scene->shaders;
+  }
 }
 
 void GeometryManager::device_update_bvh(Device *device,
@@ -1159,6 +1307,7 @@ void GeometryManager::device_update_bvh(Device *device,
   bparams.num_motion_curve_steps = scene->params.num_bvh_time_steps;
   bparams.bvh_type = scene->params.bvh_type;
   bparams.curve_subdivisions = scene->params.curve_subdivisions();
+  bparams.cache_directory = scene->params.bvh_cache_directory;
 
   VLOG(1) << "Using " << bvh_layout_name(bparams.bvh_layout) << " layout.";
 
@@ -1483,8 +1632,9 @@ void GeometryManager::device_update(Device *device,
     scene->object_manager->device_update_flags(device, dscene, scene, progress, false);
   }
 
-  /* Device update. */
-  device_free(device, dscene);
+  /* Device update. Geometry and attribute arrays are kept so that only changed data needs to
+   * be packed, except when displacement needs to run kernels on partially updated arrays. */
+  device_free(device, dscene, true_displacement_used);
 
   mesh_calc_offset(scene);
   if (true_displacement_used) {
@@ -1638,6 +1788,16 @@ void GeometryManager::device_update(Device *device,
     }
   }
 
+  foreach (Geometry *geom, scene->geometry) {
+    geom->clear_modified();
+    geom->need_update_offsets = false;
+    geom->attributes.clear_modified();
+    if (geom->is_mesh()) {
+      Mesh *mesh = static_cast<Mesh *>(geom);
+      mesh->subd_attributes.clear_modified();
+    }
+  }
+
   need_update = false;
 
   if (true_displacement_used) {
@@ -1651,7 +1811,7 @@ void GeometryManager::device_update(Device *device,
   }
 }
 
-void GeometryManager::device_free(Device *device, DeviceScene *dscene)
+void GeometryManager::device_free(Device *device, DeviceScene *dscene, bool force_free)
 {
 #ifdef WITH_EMBREE
   if (dscene->data.bvh.scene) {
@@ -1671,19 +1831,23 @@ void GeometryManager::device_free(Device *device, DeviceScene *dscene)
   dscene->prim_index.free();
   dscene->prim_object.free();
   dscene->prim_time.free();
-  dscene->tri_shader.free();
-  dscene->tri_vnormal.free();
-  dscene->tri_vindex.free();
-  dscene->tri_patch.free();
-  dscene->tri_patch_uv.free();
-  dscene->curves.free();
-  dscene->curve_keys.free();
-  dscene->patches.free();
   dscene->attributes_map.free();
-  dscene->attributes_float.free();
-  dscene->attributes_float2.free();
-  dscene->attributes_float3.free();
-  dscene->attributes_uchar4.free();
+
+  if (force_free) {
+    dscene->tri_shader.free();
+    dscene->tri_vnormal.free();
+    dscene->tri_vindex.free();
+    dscene->tri_patch.free();
+    dscene->tri_patch_uv.free();
+    dscene->curves.free();
+    dscene->curve_keys.free();
+    dscene->patches.free();
+    dscene->attributes_float.free();
+    dscene->attributes_float2.free();
+    dscene->attributes_float3.free();
+    dscene->attributes_uchar4.free();
+    packed_shaders.clear();
+  }
 
   /* Signal for shaders like displacement not to do ray tracing. */
   dscene->data.bvh.bvh_layout = BVH_LAYOUT_NONE;
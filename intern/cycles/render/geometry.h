@@ -89,6 +89,8 @@ class Geometry : public Node {
 
   /* Update Flags */
   bool need_update_rebuild;
+  /* Offsets in the global arrays changed, so all device data has to be packed again. */
+  bool need_update_offsets;
 
   /* Index into scene->geometry (only valid during update) */
   size_t index;
@@ -171,7 +173,7 @@ class GeometryManager {
   /* Device Updates */
   void device_update_preprocess(Device *device, Scene *scene, Progress &progress);
   void device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress &progress);
-  void device_free(Device *device, DeviceScene *dscene);
+  void device_free(Device *device, DeviceScene *dscene, bool force_free = true);
 
   /* Updates */
   void tag_update(Scene *scene);
@@ -216,6 +218,9 @@ class GeometryManager {
 
   void device_update_volume_images(Device *device, Scene *scene, Progress &progress);
 
+  /* Shaders of which the IDs were used when packing the geometry device arrays. */
+  vector<Shader *> packed_shaders;
+
  private:
   static void update_attribute_element_offset(Geometry *geom,
                                               device_vector<float> &attr_float,
@@ -229,7 +234,9 @@ class GeometryManager {
                                               Attribute *mattr,
                                               AttributePrimitive prim,
                                               TypeDesc &type,
-                                              AttributeDescriptor &desc);
+                                              AttributeDescriptor &desc,
+                                              bool copy_all,
+                                              bool &copied);
 };
 
 CCL_NAMESPACE_END
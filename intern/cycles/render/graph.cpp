@@ -776,6 +776,26 @@ void ShaderGraph::compute_displacement_hash()
   displacement_hash = md5.get_hex();
 }
 
+string ShaderGraph::compute_hash()
+{
+  /* Compute hash of all nodes and their links, to detect if the shader needs
+   * to be compiled again. Used after finalization so that changes which get
+   * optimized away do not cause recompilation. */
+  MD5Hash md5;
+  foreach (ShaderNode *node, nodes) {
+    node->hash(md5);
+    node->runtime_hash(md5);
+    foreach (ShaderInput *input, node->inputs) {
+      int link_id = (input->link) ? input->link->parent->id : 0;
+      md5.append((uint8_t *)&link_id, sizeof(link_id));
+      md5.append((input->link) ? input->link->name().c_str() : "");
+    }
+    md5.append((uint8_t *)&node->bump, sizeof(node->bump));
+  }
+
+  return md5.get_hex();
+}
+
 void ShaderGraph::clean(Scene *scene)
 {
   /* Graph simplification */
@@ -180,6 +180,12 @@ class ShaderNode : public Node {
    */
   virtual void simplify_settings(Scene * /*scene*/){};
 
+  /* Hash state that is not stored in sockets but affects the compiled shader,
+   * like slots assigned by the image manager. */
+  virtual void runtime_hash(MD5Hash & /*md5*/)
+  {
+  }
+
   virtual bool has_surface_emission()
   {
     return false;
@@ -335,6 +341,7 @@ class ShaderGraph : public NodeOwner {
 
   void remove_proxy_nodes();
   void compute_displacement_hash();
+  string compute_hash();
   void simplify(Scene *scene);
   void finalize(Scene *scene,
                 bool do_bump = false,
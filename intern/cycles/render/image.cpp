@@ -24,6 +24,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_image.h"
+#include "util/util_image_cache.h"
 #include "util/util_image_impl.h"
 #include "util/util_logging.h"
 #include "util/util_path.h"
@@ -274,6 +275,17 @@ ImageLoader::ImageLoader()
 {
 }
 
+int ImageLoader::load_region_levels(const ImageMetaData &, const bool, bool *)
+{
+  return 0;
+}
+
+bool ImageLoader::load_pixels_region(
+    const ImageMetaData &, const int, const int, const int, const int, const int, float *)
+{
+  return false;
+}
+
 ustring ImageLoader::osl_filepath() const
 {
   return ustring();
@@ -448,6 +460,7 @@ int ImageManager::add_image_slot(ImageLoader *loader,
   img->builtin = builtin;
   img->users = 1;
   img->mem = NULL;
+  img->cache_texture = NULL;
 
   images[slot] = img;
 
@@ -646,6 +659,137 @@ bool ImageManager::file_load_image(Image *img, int texture_limit)
   return true;
 }
 
+/* Image Cache Loader
+ *
+ * Loads regions for the CPU image cache through the image loader, with the same processing
+ * that file_load_image() applies to fully loaded images. */
+class ImageManagerCacheLoader : public ImageCacheLoader {
+ public:
+  ImageManagerCacheLoader(ImageManager::Image *img, int num_levels, bool tiled)
+      : img(img), num_levels_(num_levels), tiled(tiled)
+  {
+  }
+
+  int num_levels() const override
+  {
+    return num_levels_;
+  }
+
+  bool is_tiled() const override
+  {
+    return tiled;
+  }
+
+  bool read_region(int level, int x, int y, int width, int height, float4 *pixels) override
+  {
+    if (!img->loader->load_pixels_region(
+            img->metadata, level, x, y, width, height, (float *)pixels)) {
+      return false;
+    }
+
+    const size_t num_pixels = ((size_t)width) * height;
+    const bool is_rgba = (img->metadata.type == IMAGE_DATA_TYPE_FLOAT4 ||
+                          img->metadata.type == IMAGE_DATA_TYPE_HALF4 ||
+                          img->metadata.type == IMAGE_DATA_TYPE_BYTE4 ||
+                          img->metadata.type == IMAGE_DATA_TYPE_USHORT4);
+
+    if (is_rgba) {
+      /* Disable alpha if requested by the user. */
+      if (img->params.alpha_type == IMAGE_ALPHA_IGNORE) {
+        for (size_t i = 0; i < num_pixels; i++) {
+          pixels[i].w = 1.0f;
+        }
+      }
+
+      if (img->metadata.colorspace != u_colorspace_raw &&
+          img->metadata.colorspace != u_colorspace_srgb) {
+        /* Convert to scene linear. */
+        ColorSpaceManager::to_scene_linear(img->metadata.colorspace,
+                                           (float *)pixels,
+                                           num_pixels,
+                                           img->metadata.compress_as_srgb);
+      }
+    }
+
+    /* Make sure we don't have buggy values. */
+    for (size_t i = 0; i < num_pixels; i++) {
+      float4 &pixel = pixels[i];
+      if (!isfinite(pixel.x) || !isfinite(pixel.y) || !isfinite(pixel.z) ||
+          !isfinite(pixel.w)) {
+        pixel = (is_rgba) ? make_float4(0.0f, 0.0f, 0.0f, 0.0f) :
+                            make_float4(0.0f, 0.0f, 0.0f, 1.0f);
+      }
+    }
+
+    return true;
+  }
+
+ protected:
+  ImageManager::Image *img;
+  int num_levels_;
+  bool tiled;
+};
+
+bool ImageManager::cache_load_image(Device *device, Scene *scene, Image *img)
+{
+  /* Only 2D images on the CPU, where the kernel can call into the cache. */
+  const size_t texture_cache_size = scene->params.texture_cache_size;
+  if (texture_cache_size == 0 || device->info.type != DEVICE_CPU) {
+    return false;
+  }
+
+  const ImageMetaData &metadata = img->metadata;
+  if (!(metadata.channels >= 1 && metadata.channels <= 4) || metadata.depth > 1 ||
+      metadata.width == 0 || metadata.height == 0 ||
+      metadata.type == IMAGE_DATA_TYPE_NANOVDB_FLOAT ||
+      metadata.type == IMAGE_DATA_TYPE_NANOVDB_FLOAT3) {
+    return false;
+  }
+
+  bool tiled = false;
+  const int num_levels = img->loader->load_region_levels(
+      metadata, image_associate_alpha(img), &tiled);
+  if (num_levels == 0) {
+    return false;
+  }
+
+  /* The texture limit becomes the finest MIP level that may be used. */
+  const size_t max_size = max(metadata.width, metadata.height);
+  const int texture_limit = scene->params.texture_limit;
+  int min_level = 0;
+  if (texture_limit > 0) {
+    while ((max_size >> min_level) > texture_limit) {
+      min_level++;
+    }
+  }
+
+  thread_scoped_lock device_lock(device_mutex);
+
+  if (!image_cache) {
+    image_cache.reset(new ImageCache(texture_cache_size * 1024 * 1024));
+  }
+  else {
+    image_cache->set_memory_limit(texture_cache_size * 1024 * 1024);
+  }
+
+  ImageCacheLoader *loader = new ImageManagerCacheLoader(img, num_levels, tiled);
+  img->cache_texture = image_cache->add_texture(
+      loader, metadata.width, metadata.height, min_level);
+
+  /* Placeholder so the device registers the texture slot, the kernel reads texels through the
+   * cache instead. */
+  memset(img->mem->alloc(1, 1), 0, img->mem->memory_size());
+  img->mem->info.width = metadata.width;
+  img->mem->info.height = metadata.height;
+  img->mem->info.use_cache = 1;
+  img->mem->info.data = (uint64_t)img->cache_texture;
+
+  VLOG(1) << "Loading image " << img->loader->name() << " on demand, " << num_levels
+          << " MIP levels in " << (tiled ? "tiled" : "scanline") << " file.";
+
+  return true;
+}
+
 void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Progress *progress)
 {
   if (progress->get_cancel()) {
@@ -665,6 +809,10 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
   img->mem_name = string_printf("__tex_image_%s_%03d", name_from_type(type), slot);
 
   /* Free previous texture in slot. */
+  if (img->cache_texture) {
+    image_cache->remove_texture(img->cache_texture);
+    img->cache_texture = NULL;
+  }
   if (img->mem) {
     thread_scoped_lock device_lock(device_mutex);
     delete img->mem;
@@ -677,7 +825,10 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
   img->mem->info.transform_3d = img->metadata.transform_3d;
 
   /* Create new texture. */
-  if (type == IMAGE_DATA_TYPE_FLOAT4) {
+  if (cache_load_image(device, scene, img)) {
+    /* Pixels are loaded on demand during rendering. */
+  }
+  else if (type == IMAGE_DATA_TYPE_FLOAT4) {
     if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
@@ -798,6 +949,10 @@ void ImageManager::device_free_image(Device *, int slot)
 #endif
   }
 
+  if (img->cache_texture) {
+    image_cache->remove_texture(img->cache_texture);
+  }
+
   if (img->mem) {
     thread_scoped_lock device_lock(device_mutex);
     delete img->mem;
@@ -31,6 +31,8 @@ CCL_NAMESPACE_BEGIN
 
 class Device;
 class DeviceInfo;
+class ImageCache;
+class ImageCacheTexture;
 class ImageHandle;
 class ImageKey;
 class ImageMetaData;
@@ -113,6 +115,23 @@ class ImageLoader {
                            const size_t pixels_size,
                            const bool associate_alpha) = 0;
 
+  /* Optional loading of regions on demand, for the CPU image cache. Returns the number of
+   * MIP levels that can be loaded, or zero if not supported. Tiled is set when regions can
+   * be read without decoding full rows of the image. */
+  virtual int load_region_levels(const ImageMetaData &metadata,
+                                 const bool associate_alpha,
+                                 bool *tiled);
+
+  /* Load a region of a MIP level as RGBA floats, with rows ordered from top to bottom as
+   * stored in the file. May be called from multiple threads during rendering. */
+  virtual bool load_pixels_region(const ImageMetaData &metadata,
+                                  const int level,
+                                  const int x,
+                                  const int y,
+                                  const int width,
+                                  const int height,
+                                  float *pixels);
+
   /* Name for logs and stats. */
   virtual string name() const = 0;
 
@@ -203,6 +222,7 @@ class ImageManager {
 
     string mem_name;
     device_texture *mem;
+    ImageCacheTexture *cache_texture;
 
     int users;
     thread_mutex mutex;
@@ -218,6 +238,9 @@ class ImageManager {
   vector<Image *> images;
   void *osl_texture_system;
 
+  /* Tiled and mipmapped textures loaded on demand, for the CPU device. */
+  unique_ptr<ImageCache> image_cache;
+
   int add_image_slot(ImageLoader *loader, const ImageParams &params, const bool builtin);
   void add_image_user(int slot);
   void remove_image_user(int slot);
@@ -226,6 +249,7 @@ class ImageManager {
 
   template<TypeDesc::BASETYPE FileFormat, typename StorageType>
   bool file_load_image(Image *img, int texture_limit);
+  bool cache_load_image(Device *device, Scene *scene, Image *img);
 
   void device_load_image(Device *device, Scene *scene, int slot, Progress *progress);
   void device_free_image(Device *device, int slot);
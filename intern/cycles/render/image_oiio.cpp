@@ -16,18 +16,29 @@
 
 #include "render/image_oiio.h"
 
+#include "util/util_algorithm.h"
 #include "util/util_image.h"
+#include "util/util_image_cache.h"
+#include "util/util_list.h"
 #include "util/util_logging.h"
 #include "util/util_path.h"
 
 CCL_NAMESPACE_BEGIN
 
-OIIOImageLoader::OIIOImageLoader(const string &filepath) : filepath(filepath)
+/* Loaders with a file open for loading regions, most recently used first. The number of
+ * open files is limited to stay below the operating system limit on file handles. */
+static const size_t OIIO_REGION_MAX_OPEN_FILES = 128;
+static list<OIIOImageLoader *> oiio_region_open_loaders;
+static thread_mutex oiio_region_open_mutex;
+
+OIIOImageLoader::OIIOImageLoader(const string &filepath)
+    : filepath(filepath), region_associate_alpha(false)
 {
 }
 
 OIIOImageLoader::~OIIOImageLoader()
 {
+  region_in_remove();
 }
 
 bool OIIOImageLoader::load_metadata(ImageMetaData &metadata)
@@ -219,6 +230,231 @@ bool OIIOImageLoader::load_pixels(const ImageMetaData &metadata,
   return true;
 }
 
+/* Open the file for loading regions, call with the region mutex locked. */
+bool OIIOImageLoader::region_in_open(ImageSpec &spec)
+{
+  region_in = unique_ptr<ImageInput>(ImageInput::create(filepath.string()));
+  if (!region_in) {
+    return false;
+  }
+
+  ImageSpec config = ImageSpec();
+
+  if (!region_associate_alpha) {
+    config.attribute("oiio:UnassociatedAlpha", 1);
+  }
+
+  if (!region_in->open(filepath.string(), spec, config)) {
+    region_in.reset();
+    return false;
+  }
+
+  thread_scoped_lock open_lock(oiio_region_open_mutex);
+
+  oiio_region_open_loaders.push_front(this);
+
+  /* Close the least recently used files. Loaders busy reading are skipped rather than
+   * waited for, they may be waiting for this list themselves. */
+  auto it = oiio_region_open_loaders.end();
+  while (oiio_region_open_loaders.size() > OIIO_REGION_MAX_OPEN_FILES &&
+         it != oiio_region_open_loaders.begin()) {
+    --it;
+    OIIOImageLoader *loader = *it;
+    if (loader == this || !loader->region_mutex.try_lock()) {
+      continue;
+    }
+
+    loader->region_in.reset();
+    loader->region_mutex.unlock();
+    it = oiio_region_open_loaders.erase(it);
+  }
+
+  return true;
+}
+
+/* Mark the open file as most recently used, call with the region mutex locked. */
+void OIIOImageLoader::region_in_touch()
+{
+  thread_scoped_lock open_lock(oiio_region_open_mutex);
+
+  auto it = std::find(oiio_region_open_loaders.begin(), oiio_region_open_loaders.end(), this);
+  if (it != oiio_region_open_loaders.end()) {
+    oiio_region_open_loaders.splice(
+        oiio_region_open_loaders.begin(), oiio_region_open_loaders, it);
+  }
+}
+
+void OIIOImageLoader::region_in_remove()
+{
+  thread_scoped_lock open_lock(oiio_region_open_mutex);
+  oiio_region_open_loaders.remove(this);
+}
+
+/* Regions can be read directly from tiled files when cache tiles are made of whole file
+ * tiles, other files are read in full rows of tiles. */
+static bool oiio_spec_is_tiled(const ImageSpec &spec)
+{
+  return spec.tile_width > 0 && spec.tile_height > 0 && spec.tile_depth <= 1 &&
+         ImageCacheTexture::TILE_SIZE % spec.tile_width == 0 &&
+         ImageCacheTexture::TILE_SIZE % spec.tile_height == 0;
+}
+
+int OIIOImageLoader::load_region_levels(const ImageMetaData &metadata,
+                                        const bool associate_alpha,
+                                        bool *tiled)
+{
+  if (metadata.depth > 1) {
+    return 0;
+  }
+
+  /* NOTE: Error logging is done in meta data acquisition. */
+  if (!path_exists(filepath.string()) || path_is_directory(filepath.string())) {
+    return 0;
+  }
+
+  thread_scoped_lock lock(region_mutex);
+
+  if (region_in) {
+    region_in.reset();
+    region_in_remove();
+  }
+
+  region_associate_alpha = associate_alpha;
+
+  ImageSpec spec = ImageSpec();
+  if (!region_in_open(spec)) {
+    return 0;
+  }
+
+  *tiled = oiio_spec_is_tiled(spec);
+
+  /* Use MIP levels stored in the file as long as they have the sizes the image cache
+   * expects, the remaining levels are generated by the cache. */
+  int num_levels = 1;
+  ImageSpec level_spec;
+  while (region_in->seek_subimage(0, num_levels, level_spec) &&
+         level_spec.width == max(spec.width >> num_levels, 1) &&
+         level_spec.height == max(spec.height >> num_levels, 1) &&
+         level_spec.nchannels == spec.nchannels && oiio_spec_is_tiled(level_spec) == *tiled) {
+    num_levels++;
+  }
+
+  region_in->seek_subimage(0, 0, level_spec);
+
+  return num_levels;
+}
+
+bool OIIOImageLoader::load_pixels_region(const ImageMetaData &metadata,
+                                         const int level,
+                                         const int x,
+                                         const int y,
+                                         const int width,
+                                         const int height,
+                                         float *pixels)
+{
+  const int components = metadata.channels;
+  vector<float> readpixels;
+  bool cmyk;
+
+  {
+    thread_scoped_lock lock(region_mutex);
+
+    ImageSpec spec;
+    if (region_in) {
+      region_in_touch();
+    }
+    else if (!region_in_open(spec)) {
+      return false;
+    }
+
+    if (!region_in->seek_subimage(0, level, spec)) {
+      return false;
+    }
+
+    if (oiio_spec_is_tiled(spec)) {
+      readpixels.resize(((size_t)width) * height * components);
+      if (!region_in->read_tiles(0,
+                                 level,
+                                 spec.x + x,
+                                 spec.x + x + width,
+                                 spec.y + y,
+                                 spec.y + y + height,
+                                 spec.z,
+                                 spec.z + 1,
+                                 0,
+                                 components,
+                                 TypeDesc::FLOAT,
+                                 readpixels.data())) {
+        return false;
+      }
+    }
+    else {
+      /* Read full rows and keep the requested columns. */
+      vector<float> rows(((size_t)spec.width) * height * components);
+      if (!region_in->read_scanlines(0,
+                                     level,
+                                     spec.y + y,
+                                     spec.y + y + height,
+                                     spec.z,
+                                     0,
+                                     components,
+                                     TypeDesc::FLOAT,
+                                     rows.data())) {
+        return false;
+      }
+
+      if (x == 0 && width == spec.width) {
+        readpixels.swap(rows);
+      }
+      else {
+        readpixels.resize(((size_t)width) * height * components);
+        for (int j = 0; j < height; j++) {
+          const float *src = &rows[(((size_t)j) * spec.width + x) * components];
+          std::copy(src, src + width * components, &readpixels[((size_t)j) * width * components]);
+        }
+      }
+    }
+
+    cmyk = strcmp(region_in->format_name(), "jpeg") == 0 && components == 4;
+  }
+
+  /* The image cache stores RGBA, like the kernel reads images. */
+  const size_t num_pixels = ((size_t)width) * height;
+  for (size_t i = 0; i < num_pixels; i++) {
+    const float *src = &readpixels[i * components];
+    float *dst = &pixels[i * 4];
+
+    if (components == 1) {
+      dst[0] = dst[1] = dst[2] = src[0];
+      dst[3] = 1.0f;
+    }
+    else if (components == 2) {
+      dst[0] = dst[1] = dst[2] = src[0];
+      dst[3] = src[1];
+    }
+    else if (components == 3) {
+      dst[0] = src[0];
+      dst[1] = src[1];
+      dst[2] = src[2];
+      dst[3] = 1.0f;
+    }
+    else if (cmyk) {
+      dst[0] = (1.0f - src[0]) * (1.0f - src[3]);
+      dst[1] = (1.0f - src[1]) * (1.0f - src[3]);
+      dst[2] = (1.0f - src[2]) * (1.0f - src[3]);
+      dst[3] = 1.0f;
+    }
+    else {
+      dst[0] = src[0];
+      dst[1] = src[1];
+      dst[2] = src[2];
+      dst[3] = src[3];
+    }
+  }
+
+  return true;
+}
+
 string OIIOImageLoader::name() const
 {
   return path_filename(filepath.string());
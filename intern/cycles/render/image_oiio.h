@@ -19,6 +19,8 @@
 
 #include "render/image.h"
 
+#include "util/util_image.h"
+
 CCL_NAMESPACE_BEGIN
 
 class OIIOImageLoader : public ImageLoader {
@@ -33,6 +35,18 @@ class OIIOImageLoader : public ImageLoader {
                    const size_t pixels_size,
                    const bool associate_alpha) override;
 
+  int load_region_levels(const ImageMetaData &metadata,
+                         const bool associate_alpha,
+                         bool *tiled) override;
+
+  bool load_pixels_region(const ImageMetaData &metadata,
+                          const int level,
+                          const int x,
+                          const int y,
+                          const int width,
+                          const int height,
+                          float *pixels) override;
+
   string name() const override;
 
   ustring osl_filepath() const override;
@@ -41,6 +55,16 @@ class OIIOImageLoader : public ImageLoader {
 
  protected:
   ustring filepath;
+
+  /* File kept open for loading regions, closed when too many files are open and
+   * reopened on demand. */
+  unique_ptr<ImageInput> region_in;
+  bool region_associate_alpha;
+  thread_mutex region_mutex;
+
+  bool region_in_open(ImageSpec &spec);
+  void region_in_touch();
+  void region_in_remove();
 };
 
 CCL_NAMESPACE_END
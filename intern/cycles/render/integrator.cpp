@@ -79,6 +79,10 @@ NODE_DEFINE(Integrator)
   SOCKET_BOOLEAN(sample_all_lights_direct, "Sample All Lights Direct", true);
   SOCKET_BOOLEAN(sample_all_lights_indirect, "Sample All Lights Indirect", true);
   SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+  SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
+  SOCKET_BOOLEAN(use_path_guiding, "Use Path Guiding", false);
+  SOCKET_INT(path_guiding_training_passes, "Path Guiding Training Passes", 4);
+  SOCKET_FLOAT(path_guiding_probability, "Path Guiding Probability", 0.5f);
 
   static NodeEnum method_enum;
   method_enum.insert("path", PATH);
@@ -188,6 +192,12 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
     kintegrator->sample_all_lights_indirect = false;
   }
 
+  /* Path guiding is trained and used by the CPU device, for the path integrator. */
+  kintegrator->use_path_guiding = use_path_guiding && method == PATH &&
+                                  path_guiding_training_passes > 0;
+  kintegrator->path_guiding_training_passes = path_guiding_training_passes;
+  kintegrator->path_guiding_probability = clamp(path_guiding_probability, 0.0f, 1.0f);
+
   kintegrator->sampling_pattern = sampling_pattern;
   kintegrator->aa_samples = aa_samples;
   if (aa_samples > 0 && adaptive_min_samples == 0) {
@@ -280,6 +290,11 @@ void Integrator::tag_update(Scene *scene)
       break;
     }
   }
+  /* Light tree usage depends on how lights are sampled. */
+  if (use_light_tree_is_modified() || method_is_modified() ||
+      sample_all_lights_direct_is_modified() || sample_all_lights_indirect_is_modified()) {
+    scene->light_manager->tag_update(scene);
+  }
   tag_modified();
 }
 
@@ -74,6 +74,11 @@ class Integrator : public Node {
   NODE_SOCKET_API(bool, sample_all_lights_direct)
   NODE_SOCKET_API(bool, sample_all_lights_indirect)
   NODE_SOCKET_API(float, light_sampling_threshold)
+  NODE_SOCKET_API(bool, use_light_tree)
+
+  NODE_SOCKET_API(bool, use_path_guiding)
+  NODE_SOCKET_API(int, path_guiding_training_passes)
+  NODE_SOCKET_API(float, path_guiding_probability)
 
   NODE_SOCKET_API(int, adaptive_min_samples)
   NODE_SOCKET_API(float, adaptive_threshold)
@@ -20,6 +20,7 @@
 #include "render/film.h"
 #include "render/graph.h"
 #include "render/integrator.h"
+#include "render/light_tree.h"
 #include "render/mesh.h"
 #include "render/nodes.h"
 #include "render/object.h"
@@ -326,6 +327,16 @@ void LightManager::device_update_distribution(Device *,
   size_t num_distribution = num_triangles + num_lights;
   VLOG(1) << "Total " << num_distribution << " of light distribution primitives.";
 
+  /* The light tree is only used when picking a single light, as sampling all lights
+   * evaluates the MIS weights against the flat distribution. */
+  const Integrator *integrator = scene->integrator;
+  const bool use_light_tree = integrator->get_use_light_tree() &&
+                              !(integrator->get_method() == Integrator::BRANCHED_PATH &&
+                                (integrator->get_sample_all_lights_direct() ||
+                                 integrator->get_sample_all_lights_indirect()));
+  vector<LightTreePrimitive> light_tree_prims;
+  vector<int> light_tree_infinite;
+
   /* emission area */
   KernelLightDistribution *distribution = dscene->light_distribution.alloc(num_distribution + 1);
   float totarea = 0.0f;
@@ -394,7 +405,22 @@ void LightManager::device_update_distribution(Device *,
           p3 = transform_point(&tfm, p3);
         }
 
-        totarea += triangle_area(p1, p2, p3);
+        const float area = triangle_area(p1, p2, p3);
+        totarea += area;
+
+        if (use_light_tree && area > 0.0f) {
+          /* Mesh lights emit on both sides. */
+          LightTreePrimitive prim;
+          prim.bbox.grow(p1);
+          prim.bbox.grow(p2);
+          prim.bbox.grow(p3);
+          prim.orientation = LightTreeOrientation(
+              safe_normalize(cross(p2 - p1, p3 - p1)), M_PI_F, M_PI_2_F);
+          prim.energy = area;
+          prim.inv_area = 1.0f / area;
+          prim.distribution_index = offset - 1;
+          light_tree_prims.push_back(prim);
+        }
       }
     }
 
@@ -406,6 +432,8 @@ void LightManager::device_update_distribution(Device *,
   /* point lights */
   float lightarea = (totarea > 0.0f) ? totarea / num_lights : 1.0f;
   bool use_lamp_mis = false;
+  const size_t num_light_tree_triangles = light_tree_prims.size();
+  float light_tree_lamp_strength = 0.0f;
 
   int light_index = 0;
   foreach (Light *light, scene->lights) {
@@ -418,6 +446,16 @@ void LightManager::device_update_distribution(Device *,
     distribution[offset].lamp.size = light->size;
     totarea += lightarea;
 
+    if (use_light_tree) {
+      if (light->light_type == LIGHT_DISTANT || light->light_type == LIGHT_BACKGROUND) {
+        light_tree_infinite.push_back(offset);
+      }
+      else {
+        light_tree_prims.push_back(light_tree_lamp_primitive(light, offset));
+        light_tree_lamp_strength += light_tree_prims.back().energy;
+      }
+    }
+
     if (light->light_type == LIGHT_DISTANT) {
       use_lamp_mis |= (light->angle > 0.0f && light->use_mis);
     }
@@ -436,6 +474,16 @@ void LightManager::device_update_distribution(Device *,
     offset++;
   }
 
+  /* Distribute the share lamps have in the flat distribution by their strength, so the
+   * balance between lamps and mesh lights stays the same. */
+  const size_t num_light_tree_lamps = light_tree_prims.size() - num_light_tree_triangles;
+  for (size_t i = num_light_tree_triangles; i < light_tree_prims.size(); i++) {
+    LightTreePrimitive &prim = light_tree_prims[i];
+    prim.energy = (light_tree_lamp_strength > 0.0f) ?
+                      lightarea * num_light_tree_lamps * prim.energy / light_tree_lamp_strength :
+                      lightarea;
+  }
+
   /* normalize cumulative distribution functions */
   distribution[num_distribution].totarea = totarea;
   distribution[num_distribution].prim = 0.0f;
@@ -495,6 +543,15 @@ void LightManager::device_update_distribution(Device *,
     /* CDF */
     dscene->light_distribution.copy_to_device();
 
+    /* Light tree */
+    kintegrator->use_light_tree = false;
+    kintegrator->light_tree_num_emitters = 0;
+    kintegrator->light_tree_num_infinite = 0;
+
+    if (!light_tree_prims.empty()) {
+      device_update_light_tree(dscene, light_tree_prims, light_tree_infinite, num_distribution);
+    }
+
     /* Portals */
     if (num_portals > 0) {
       kbackground->portal_offset = light_index;
@@ -518,6 +575,9 @@ void LightManager::device_update_distribution(Device *,
     kintegrator->pdf_triangles = 0.0f;
     kintegrator->pdf_lights = 0.0f;
     kintegrator->use_lamp_mis = false;
+    kintegrator->use_light_tree = false;
+    kintegrator->light_tree_num_emitters = 0;
+    kintegrator->light_tree_num_infinite = 0;
 
     kbackground->num_portals = 0;
     kbackground->portal_offset = 0;
@@ -529,6 +589,80 @@ void LightManager::device_update_distribution(Device *,
   }
 }
 
+LightTreePrimitive LightManager::light_tree_lamp_primitive(const Light *light,
+                                                          int distribution_index)
+{
+  LightTreePrimitive prim;
+  prim.distribution_index = distribution_index;
+  prim.energy = average(light->strength);
+
+  if (light->light_type == LIGHT_AREA) {
+    /* One sided, with cosine falloff. */
+    const float3 axisu = light->axisu * (0.5f * light->sizeu * light->size);
+    const float3 axisv = light->axisv * (0.5f * light->sizev * light->size);
+    prim.bbox.grow(light->co - axisu - axisv);
+    prim.bbox.grow(light->co - axisu + axisv);
+    prim.bbox.grow(light->co + axisu - axisv);
+    prim.bbox.grow(light->co + axisu + axisv);
+    prim.orientation = LightTreeOrientation(safe_normalize(light->dir), 0.0f, M_PI_2_F);
+  }
+  else if (light->light_type == LIGHT_SPOT) {
+    prim.bbox.grow(light->co, light->size);
+    prim.orientation = LightTreeOrientation(
+        safe_normalize(light->dir), 0.0f, min(light->spot_angle * 0.5f, M_PI_F));
+  }
+  else {
+    prim.bbox.grow(light->co, light->size);
+    prim.orientation = LightTreeOrientation(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F);
+  }
+
+  return prim;
+}
+
+void LightManager::device_update_light_tree(DeviceScene *dscene,
+                                            vector<LightTreePrimitive> &prims,
+                                            const vector<int> &infinite,
+                                            size_t num_distribution)
+{
+  const LightTree light_tree(prims);
+
+  VLOG(1) << "Light tree with " << light_tree.nodes.size() << " nodes over "
+          << light_tree.emitters.size() << " emitters, " << infinite.size()
+          << " distant lights.";
+
+  KernelLightTreeNode *nodes = dscene->light_tree_nodes.alloc(light_tree.nodes.size());
+  std::copy(light_tree.nodes.begin(), light_tree.nodes.end(), nodes);
+
+  /* Distant and background lights are appended after the tree emitters. */
+  const size_t num_emitters = light_tree.emitters.size();
+  KernelLightTreeEmitter *emitters = dscene->light_tree_emitters.alloc(num_emitters +
+                                                                       infinite.size());
+  std::copy(light_tree.emitters.begin(), light_tree.emitters.end(), emitters);
+
+  int *distribution_emitter = dscene->light_tree_distribution_emitter.alloc(num_distribution);
+  std::fill(distribution_emitter, distribution_emitter + num_distribution, -1);
+
+  for (size_t i = 0; i < num_emitters; i++) {
+    distribution_emitter[emitters[i].distribution_index] = i;
+  }
+
+  for (size_t i = 0; i < infinite.size(); i++) {
+    KernelLightTreeEmitter &kemitter = emitters[num_emitters + i];
+    memset((void *)&kemitter, 0, sizeof(kemitter));
+    kemitter.distribution_index = infinite[i];
+    distribution_emitter[infinite[i]] = num_emitters + i;
+  }
+
+  dscene->light_tree_nodes.copy_to_device();
+  dscene->light_tree_emitters.copy_to_device();
+  dscene->light_tree_distribution_emitter.copy_to_device();
+
+  KernelIntegrator *kintegrator = &dscene->data.integrator;
+  kintegrator->use_light_tree = true;
+  kintegrator->light_tree_num_emitters = num_emitters;
+  kintegrator->light_tree_num_infinite = infinite.size();
+}
+
 static void background_cdf(
     int start, int end, int res_x, int res_y, const vector<float3> *pixels, float2 *cond_cdf)
 {
@@ -1007,6 +1141,9 @@ void LightManager::device_update(Device *device,
 void LightManager::device_free(Device *, DeviceScene *dscene, const bool free_background)
 {
   dscene->light_distribution.free();
+  dscene->light_tree_nodes.free();
+  dscene->light_tree_emitters.free();
+  dscene->light_tree_distribution_emitter.free();
   dscene->lights.free();
   if (free_background) {
     dscene->light_background_marginal_cdf.free();
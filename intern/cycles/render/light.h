@@ -35,6 +35,7 @@ CCL_NAMESPACE_BEGIN
 class Device;
 class DeviceScene;
 class Object;
+struct LightTreePrimitive;
 class Progress;
 class Scene;
 class Shader;
@@ -125,6 +126,10 @@ class LightManager {
                                   DeviceScene *dscene,
                                   Scene *scene,
                                   Progress &progress);
+  void device_update_light_tree(DeviceScene *dscene,
+                                vector<LightTreePrimitive> &prims,
+                                const vector<int> &infinite,
+                                size_t num_distribution);
   void device_update_background(Device *device,
                                 DeviceScene *dscene,
                                 Scene *scene,
@@ -134,6 +139,9 @@ class LightManager {
   /* Check whether light manager can use the object as a light-emissive. */
   bool object_usable_as_light(Object *object);
 
+  /* Bounds and energy of a point, spot or area light for the light tree. */
+  LightTreePrimitive light_tree_lamp_primitive(const Light *light, int distribution_index);
+
   struct IESSlot {
     IESFile ies;
     uint hash;
@@ -0,0 +1,312 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/light_tree.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Orientation Bounds */
+
+void LightTreeOrientation::grow(const LightTreeOrientation &other)
+{
+  if (other.empty()) {
+    return;
+  }
+  if (empty()) {
+    *this = other;
+    return;
+  }
+
+  theta_e = max(theta_e, other.theta_e);
+
+  /* Let a be the wider cone. */
+  LightTreeOrientation a = *this;
+  LightTreeOrientation b = other;
+  if (b.theta_o > a.theta_o) {
+    swap(a, b);
+  }
+
+  const float theta_d = safe_acosf(dot(a.axis, b.axis));
+
+  if (min(theta_d + b.theta_o, M_PI_F) <= a.theta_o) {
+    /* b is contained in a. */
+    axis = a.axis;
+    theta_o = a.theta_o;
+    return;
+  }
+
+  const float theta_merged = 0.5f * (a.theta_o + theta_d + b.theta_o);
+  const float3 rotation_axis = cross(a.axis, b.axis);
+
+  if (theta_merged >= M_PI_F || len_squared(rotation_axis) == 0.0f) {
+    axis = a.axis;
+    theta_o = M_PI_F;
+    return;
+  }
+
+  /* Rotate the axis of a towards b so the merged cone covers both. */
+  axis = normalize(
+      rotate_around_axis(a.axis, normalize(rotation_axis), theta_merged - a.theta_o));
+  theta_o = theta_merged;
+}
+
+float LightTreeOrientation::measure() const
+{
+  if (empty()) {
+    return 0.0f;
+  }
+
+  const float theta_w = min(theta_o + theta_e, M_PI_F);
+  const float cos_o = cosf(theta_o);
+  const float sin_o = sinf(theta_o);
+
+  return M_2PI_F * (1.0f - cos_o) +
+         M_PI_2_F * (2.0f * theta_w * sin_o - cosf(theta_o - 2.0f * theta_w) -
+                     2.0f * theta_o * sin_o + cos_o);
+}
+
+/* Light Tree */
+
+static const int LIGHT_TREE_NUM_BUCKETS = 12;
+
+static void light_tree_pack_bounds(const BoundBox &bbox,
+                                   const LightTreeOrientation &orientation,
+                                   float energy,
+                                   float bbox_min[3],
+                                   float bbox_max[3],
+                                   float axis[3],
+                                   float *theta_o,
+                                   float *theta_e,
+                                   float *r_energy)
+{
+  bbox_min[0] = bbox.min.x;
+  bbox_min[1] = bbox.min.y;
+  bbox_min[2] = bbox.min.z;
+  bbox_max[0] = bbox.max.x;
+  bbox_max[1] = bbox.max.y;
+  bbox_max[2] = bbox.max.z;
+  axis[0] = orientation.axis.x;
+  axis[1] = orientation.axis.y;
+  axis[2] = orientation.axis.z;
+  *theta_o = orientation.theta_o;
+  *theta_e = orientation.theta_e;
+  *r_energy = energy;
+}
+
+LightTree::LightTree(vector<LightTreePrimitive> &prims) : prims(prims)
+{
+  if (prims.empty()) {
+    return;
+  }
+
+  emitters.resize(prims.size());
+  nodes.reserve(2 * prims.size());
+
+  recursive_build(0, prims.size(), 0, 0);
+
+  /* Primitives have been reordered by the build, emitters follow the final order. */
+  for (size_t i = 0; i < prims.size(); i++) {
+    const LightTreePrimitive &prim = prims[i];
+    KernelLightTreeEmitter &kemitter = emitters[i];
+
+    light_tree_pack_bounds(prim.bbox,
+                           prim.orientation,
+                           prim.energy,
+                           kemitter.bbox_min,
+                           kemitter.bbox_max,
+                           kemitter.axis,
+                           &kemitter.theta_o,
+                           &kemitter.theta_e,
+                           &kemitter.energy);
+    kemitter.distribution_index = prim.distribution_index;
+    kemitter.inv_area = prim.inv_area;
+    kemitter.pad1 = 0;
+  }
+}
+
+int LightTree::recursive_build(int start, int end, int depth, uint bit_trail)
+{
+  BoundBox bbox = BoundBox::empty;
+  BoundBox centroid_bounds = BoundBox::empty;
+  LightTreeOrientation orientation;
+  float energy = 0.0f;
+
+  for (int i = start; i < end; i++) {
+    const LightTreePrimitive &prim = prims[i];
+    bbox.grow(prim.bbox);
+    centroid_bounds.grow(prim.centroid());
+    orientation.grow(prim.orientation);
+    energy += prim.energy;
+  }
+
+  const int index = nodes.size();
+  nodes.push_back(KernelLightTreeNode());
+
+  KernelLightTreeNode &knode = nodes[index];
+  light_tree_pack_bounds(bbox,
+                         orientation,
+                         energy,
+                         knode.bbox_min,
+                         knode.bbox_max,
+                         knode.axis,
+                         &knode.theta_o,
+                         &knode.theta_e,
+                         &knode.energy);
+  knode.pad1 = 0;
+  knode.pad2 = 0;
+
+  const int num_prims = end - start;
+
+  if (num_prims == 1 || depth >= MAX_DEPTH) {
+    knode.child_index = start;
+    knode.num_emitters = num_prims;
+
+    for (int i = start; i < end; i++) {
+      emitters[i].bit_trail = bit_trail;
+    }
+
+    return index;
+  }
+
+  int split;
+  if (!find_split(start, end, centroid_bounds, &split)) {
+    /* Fall back to a median split along the largest extent, which always makes progress
+     * even when all centroids coincide. */
+    const float3 extent = centroid_bounds.size();
+    const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 :
+                     (extent.y >= extent.z)                         ? 1 :
+                                                                      2;
+    split = start + num_prims / 2;
+    std::nth_element(prims.begin() + start,
+                     prims.begin() + split,
+                     prims.begin() + end,
+                     [axis](const LightTreePrimitive &a, const LightTreePrimitive &b) {
+                       return a.centroid()[axis] < b.centroid()[axis];
+                     });
+  }
+
+  recursive_build(start, split, depth + 1, bit_trail);
+  const int right = recursive_build(split, end, depth + 1, bit_trail | (1u << depth));
+
+  /* Vector may have been reallocated during recursion. */
+  nodes[index].child_index = right;
+  nodes[index].num_emitters = 0;
+
+  return index;
+}
+
+/* Binned surface area orientation heuristic, weighting the cost of each child by its
+ * energy, bounding box area and orientation bounds measure. */
+bool LightTree::find_split(int start, int end, const BoundBox &centroid_bounds, int *r_split)
+{
+  struct Bucket {
+    BoundBox bbox;
+    LightTreeOrientation orientation;
+    float energy;
+    int count;
+
+    Bucket() : bbox(BoundBox::empty), energy(0.0f), count(0)
+    {
+    }
+  };
+
+  const float3 extent = centroid_bounds.size();
+  const float max_extent = max(extent.x, max(extent.y, extent.z));
+
+  float min_cost = FLT_MAX;
+  int min_axis = -1;
+  int min_bucket = -1;
+
+  for (int axis = 0; axis < 3; axis++) {
+    if (extent[axis] == 0.0f) {
+      continue;
+    }
+
+    Bucket buckets[LIGHT_TREE_NUM_BUCKETS];
+    const float inv_extent = 1.0f / extent[axis];
+
+    for (int i = start; i < end; i++) {
+      const LightTreePrimitive &prim = prims[i];
+      const float offset = (prim.centroid()[axis] - centroid_bounds.min[axis]) * inv_extent;
+      const int bucket_index = clamp(
+          (int)(offset * LIGHT_TREE_NUM_BUCKETS), 0, LIGHT_TREE_NUM_BUCKETS - 1);
+      Bucket &bucket = buckets[bucket_index];
+      bucket.bbox.grow(prim.bbox);
+      bucket.orientation.grow(prim.orientation);
+      bucket.energy += prim.energy;
+      bucket.count++;
+    }
+
+    /* Sweep from the right to get the cost of every right side. */
+    float right_costs[LIGHT_TREE_NUM_BUCKETS];
+    int right_counts[LIGHT_TREE_NUM_BUCKETS];
+    Bucket right;
+    for (int i = LIGHT_TREE_NUM_BUCKETS - 1; i > 0; i--) {
+      right.bbox.grow(buckets[i].bbox);
+      right.orientation.grow(buckets[i].orientation);
+      right.energy += buckets[i].energy;
+      right.count += buckets[i].count;
+      right_costs[i] = right.energy * right.bbox.safe_area() * right.orientation.measure();
+      right_counts[i] = right.count;
+    }
+
+    /* Regularization against long thin boxes. */
+    const float regularization = max_extent * inv_extent;
+
+    Bucket left;
+    for (int i = 0; i < LIGHT_TREE_NUM_BUCKETS - 1; i++) {
+      left.bbox.grow(buckets[i].bbox);
+      left.orientation.grow(buckets[i].orientation);
+      left.energy += buckets[i].energy;
+      left.count += buckets[i].count;
+
+      if (left.count == 0 || right_counts[i + 1] == 0) {
+        continue;
+      }
+
+      const float left_cost = left.energy * left.bbox.safe_area() * left.orientation.measure();
+      const float cost = regularization * (left_cost + right_costs[i + 1]);
+
+      if (cost < min_cost) {
+        min_cost = cost;
+        min_axis = axis;
+        min_bucket = i;
+      }
+    }
+  }
+
+  if (min_axis == -1) {
+    return false;
+  }
+
+  const float min_offset = centroid_bounds.min[min_axis];
+  const float inv_extent = 1.0f / extent[min_axis];
+  LightTreePrimitive *middle = std::partition(
+      &prims[start], &prims[end - 1] + 1, [&](const LightTreePrimitive &prim) {
+        const float offset = (prim.centroid()[min_axis] - min_offset) * inv_extent;
+        const int bucket_index = clamp(
+            (int)(offset * LIGHT_TREE_NUM_BUCKETS), 0, LIGHT_TREE_NUM_BUCKETS - 1);
+        return bucket_index <= min_bucket;
+      });
+
+  *r_split = middle - &prims[0];
+  return *r_split > start && *r_split < end;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Cone bounding the normals of a set of emitters (axis and theta_o), together with the
+ * maximum angle around the normal into which they emit (theta_e). */
+struct LightTreeOrientation {
+  float3 axis;
+  float theta_o;
+  float theta_e;
+
+  LightTreeOrientation() : axis(make_float3(0.0f, 0.0f, 1.0f)), theta_o(-1.0f), theta_e(0.0f)
+  {
+  }
+
+  LightTreeOrientation(const float3 &axis, float theta_o, float theta_e)
+      : axis(axis), theta_o(theta_o), theta_e(theta_e)
+  {
+  }
+
+  bool empty() const
+  {
+    return theta_o < 0.0f;
+  }
+
+  void grow(const LightTreeOrientation &other);
+
+  /* Solid angle measure used by the surface area orientation heuristic. */
+  float measure() const;
+};
+
+/* Emitter as seen by the tree builder, one per light distribution entry. */
+struct LightTreePrimitive {
+  BoundBox bbox;
+  LightTreeOrientation orientation;
+  float energy;
+  /* Inverse of the area the distribution pdf was computed from, zero for lamps. */
+  float inv_area;
+  int distribution_index;
+
+  LightTreePrimitive() : bbox(BoundBox::empty), energy(0.0f), inv_area(0.0f), distribution_index(0)
+  {
+  }
+
+  float3 centroid() const
+  {
+    return bbox.center();
+  }
+};
+
+/* Light Tree
+ *
+ * Binary tree over the emitters, built top-down with the surface area orientation
+ * heuristic. Nodes are stored in depth-first order so the left child of an inner node
+ * directly follows it, emitters are stored in the order the leaves reference them. */
+class LightTree {
+ public:
+  /* The bit trail stored per emitter limits the tree depth. */
+  static const int MAX_DEPTH = 32;
+
+  LightTree(vector<LightTreePrimitive> &prims);
+
+  vector<KernelLightTreeNode> nodes;
+  vector<KernelLightTreeEmitter> emitters;
+
+ protected:
+  int recursive_build(int start, int end, int depth, uint bit_trail);
+  bool find_split(int start, int end, const BoundBox &centroid_bounds, int *r_split);
+
+  vector<LightTreePrimitive> &prims;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
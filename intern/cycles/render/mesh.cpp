@@ -508,6 +508,8 @@ void Mesh::apply_transform(const Transform &tfm, const bool apply_to_motion)
   for (size_t i = 0; i < verts.size(); i++)
     verts[i] = transform_point(&tfm, verts[i]);
 
+  tag_verts_modified();
+
   if (apply_to_motion) {
     Attribute *attr = attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
 
@@ -517,6 +519,8 @@ void Mesh::apply_transform(const Transform &tfm, const bool apply_to_motion)
 
       for (size_t i = 0; i < steps_size; i++)
         vert_steps[i] = transform_point(&tfm, vert_steps[i]);
+
+      attr->modified = true;
     }
 
     Attribute *attr_N = attributes.find(ATTR_STD_MOTION_VERTEX_NORMAL);
@@ -528,6 +532,8 @@ void Mesh::apply_transform(const Transform &tfm, const bool apply_to_motion)
 
       for (size_t i = 0; i < steps_size; i++)
         normal_steps[i] = normalize(transform_direction(&ntfm, normal_steps[i]));
+
+      attr_N->modified = true;
     }
   }
 }
@@ -31,6 +31,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_md5.h"
 #include "util/util_transform.h"
 
 #include "kernel/svm/svm_color_util.h"
@@ -206,6 +207,23 @@ void TextureMapping::compile(OSLCompiler &compiler)
   }
 }
 
+/* Image Slot Texture */
+
+static void image_handle_hash(ImageHandle &handle, MD5Hash &md5)
+{
+  const int num_tiles = handle.num_tiles();
+  md5.append((uint8_t *)&num_tiles, sizeof(num_tiles));
+  for (int i = 0; i < num_tiles; i++) {
+    const int slot = handle.svm_slot(i);
+    md5.append((uint8_t *)&slot, sizeof(slot));
+  }
+}
+
+void ImageSlotTextureNode::runtime_hash(MD5Hash &md5)
+{
+  image_handle_hash(handle, md5);
+}
+
 /* Image Texture */
 
 NODE_DEFINE(ImageTextureNode)
@@ -360,6 +378,24 @@ void ImageTextureNode::attributes(Shader *shader, AttributeRequestSet *attribute
   ShaderNode::attributes(shader, attributes);
 }
 
+bool ImageTextureNode::use_uv_differentials(Scene *scene)
+{
+  /* Only the image cache selects MIP levels from the footprint, and the differentials are
+   * only known for the default UV map without any mapping. */
+  if (scene->params.texture_cache_size == 0 || projection != NODE_IMAGE_PROJ_FLAT ||
+      !tex_mapping.skip()) {
+    return false;
+  }
+
+  ShaderInput *vector_in = input("Vector");
+  if (vector_in->link == NULL) {
+    return false;
+  }
+
+  ShaderNode *node = vector_in->link->parent;
+  return node->type == TextureCoordinateNode::node_type && vector_in->link == node->output("UV");
+}
+
 void ImageTextureNode::compile(SVMCompiler &compiler)
 {
   ShaderInput *vector_in = input("Vector");
@@ -392,6 +428,9 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
       flags |= NODE_IMAGE_ALPHA_UNASSOCIATE;
     }
   }
+  if (use_uv_differentials(compiler.scene)) {
+    flags |= NODE_IMAGE_UV_DIFFERENTIALS;
+  }
 
   if (projection != NODE_IMAGE_PROJ_BOX) {
     /* If there only is one image (a very common case), we encode it as a negative value. */
@@ -823,6 +862,11 @@ SkyTextureNode::SkyTextureNode() : TextureNode(node_type)
 {
 }
 
+void SkyTextureNode::runtime_hash(MD5Hash &md5)
+{
+  image_handle_hash(handle, md5);
+}
+
 void SkyTextureNode::compile(SVMCompiler &compiler)
 {
   ShaderInput *vector_in = input("Vector");
@@ -1257,6 +1301,11 @@ IESLightNode::~IESLightNode()
   }
 }
 
+void IESLightNode::runtime_hash(MD5Hash &md5)
+{
+  md5.append((uint8_t *)&slot, sizeof(slot));
+}
+
 void IESLightNode::get_slot()
 {
   assert(light_manager);
@@ -1788,6 +1837,11 @@ PointDensityTextureNode::~PointDensityTextureNode()
 {
 }
 
+void PointDensityTextureNode::runtime_hash(MD5Hash &md5)
+{
+  image_handle_hash(handle, md5);
+}
+
 ShaderNode *PointDensityTextureNode::clone(ShaderGraph *graph) const
 {
   /* Increase image user count for new node. We need to ensure to not call
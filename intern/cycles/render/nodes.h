@@ -97,6 +97,8 @@ class ImageSlotTextureNode : public TextureNode {
     return TextureNode::equals(other) && handle == other_node.handle;
   }
 
+  void runtime_hash(MD5Hash &md5);
+
   ImageHandle handle;
 };
 
@@ -132,6 +134,7 @@ class ImageTextureNode : public ImageSlotTextureNode {
 
  protected:
   void cull_tiles(Scene *scene, ShaderGraph *graph);
+  bool use_uv_differentials(Scene *scene);
 };
 
 class EnvironmentTextureNode : public ImageSlotTextureNode {
@@ -191,6 +194,8 @@ class SkyTextureNode : public TextureNode {
   NODE_SOCKET_API(float3, vector)
   ImageHandle handle;
 
+  void runtime_hash(MD5Hash &md5);
+
   float get_sun_size()
   {
     /* Clamping for numerical precision. */
@@ -435,6 +440,8 @@ class PointDensityTextureNode : public ShaderNode {
     const PointDensityTextureNode &other_node = (const PointDensityTextureNode &)other;
     return ShaderNode::equals(other) && handle == other_node.handle;
   }
+
+  void runtime_hash(MD5Hash &md5);
 };
 
 class IESLightNode : public TextureNode {
@@ -454,6 +461,8 @@ class IESLightNode : public TextureNode {
   NODE_SOCKET_API(float, strength)
   NODE_SOCKET_API(float3, vector)
 
+  void runtime_hash(MD5Hash &md5);
+
  private:
   LightManager *light_manager;
   int slot;
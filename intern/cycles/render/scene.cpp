@@ -76,6 +76,9 @@ DeviceScene::DeviceScene(Device *device)
       lights(device, "__lights", MEM_GLOBAL),
       light_background_marginal_cdf(device, "__light_background_marginal_cdf", MEM_GLOBAL),
       light_background_conditional_cdf(device, "__light_background_conditional_cdf", MEM_GLOBAL),
+      light_tree_nodes(device, "__light_tree_nodes", MEM_GLOBAL),
+      light_tree_emitters(device, "__light_tree_emitters", MEM_GLOBAL),
+      light_tree_distribution_emitter(device, "__light_tree_distribution_emitter", MEM_GLOBAL),
       particles(device, "__particles", MEM_GLOBAL),
       svm_nodes(device, "__svm_nodes", MEM_GLOBAL),
       shaders(device, "__shaders", MEM_GLOBAL),
@@ -112,6 +112,9 @@ class DeviceScene {
   device_vector<KernelLight> lights;
   device_vector<float2> light_background_marginal_cdf;
   device_vector<float2> light_background_conditional_cdf;
+  device_vector<KernelLightTreeNode> light_tree_nodes;
+  device_vector<KernelLightTreeEmitter> light_tree_emitters;
+  device_vector<int> light_tree_distribution_emitter;
 
   /* particles */
   device_vector<KernelParticle> particles;
@@ -176,6 +179,10 @@ class SceneParams {
   CurveShapeType hair_shape;
   bool persistent_data;
   int texture_limit;
+  /* Memory budget in megabytes for loading image textures on demand, zero to disable. */
+  int texture_cache_size;
+  /* Directory to load and save built BVHs, empty to disable the cache. */
+  string bvh_cache_directory;
 
   bool background;
 
@@ -191,6 +198,7 @@ class SceneParams {
     hair_shape = CURVE_RIBBON;
     persistent_data = false;
     texture_limit = 0;
+    texture_cache_size = 0;
     background = true;
   }
 
@@ -202,7 +210,9 @@ class SceneParams {
              use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes &&
              num_bvh_time_steps == params.num_bvh_time_steps &&
              hair_subdivisions == params.hair_subdivisions && hair_shape == params.hair_shape &&
-             persistent_data == params.persistent_data && texture_limit == params.texture_limit);
+             persistent_data == params.persistent_data && texture_limit == params.texture_limit &&
+             texture_cache_size == params.texture_cache_size &&
+             bvh_cache_directory == params.bvh_cache_directory);
   }
 
   int curve_subdivisions()
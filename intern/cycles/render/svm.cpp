@@ -17,7 +17,10 @@
 #include "device/device.h"
 
 #include "render/background.h"
+#include "render/film.h"
 #include "render/graph.h"
+#include "render/image.h"
+#include "render/integrator.h"
 #include "render/light.h"
 #include "render/mesh.h"
 #include "render/nodes.h"
@@ -28,6 +31,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_md5.h"
 #include "util/util_progress.h"
 #include "util/util_task.h"
 
@@ -35,6 +39,57 @@ CCL_NAMESPACE_BEGIN
 
 /* Shader Manager */
 
+SVMShaderManager::CompiledShader::CompiledShader()
+    : device_offset(0),
+      device_size(0),
+      modified(false),
+      has_surface(false),
+      has_surface_emission(false),
+      has_surface_transparent(false),
+      has_surface_bssrdf(false),
+      has_bump(false),
+      has_bssrdf_bump(false),
+      has_volume(false),
+      has_displacement(false),
+      has_surface_spatial_varying(false),
+      has_volume_spatial_varying(false),
+      has_volume_attribute_dependency(false),
+      has_integrator_dependency(false)
+{
+}
+
+void SVMShaderManager::CompiledShader::store_flags(const Shader *shader)
+{
+  has_surface = shader->has_surface;
+  has_surface_emission = shader->has_surface_emission;
+  has_surface_transparent = shader->has_surface_transparent;
+  has_surface_bssrdf = shader->has_surface_bssrdf;
+  has_bump = shader->has_bump;
+  has_bssrdf_bump = shader->has_bssrdf_bump;
+  has_volume = shader->has_volume;
+  has_displacement = shader->has_displacement;
+  has_surface_spatial_varying = shader->has_surface_spatial_varying;
+  has_volume_spatial_varying = shader->has_volume_spatial_varying;
+  has_volume_attribute_dependency = shader->has_volume_attribute_dependency;
+  has_integrator_dependency = shader->has_integrator_dependency;
+}
+
+void SVMShaderManager::CompiledShader::restore_flags(Shader *shader) const
+{
+  shader->has_surface = has_surface;
+  shader->has_surface_emission = has_surface_emission;
+  shader->has_surface_transparent = has_surface_transparent;
+  shader->has_surface_bssrdf = has_surface_bssrdf;
+  shader->has_bump = has_bump;
+  shader->has_bssrdf_bump = has_bssrdf_bump;
+  shader->has_volume = has_volume;
+  shader->has_displacement = has_displacement;
+  shader->has_surface_spatial_varying = has_surface_spatial_varying;
+  shader->has_volume_spatial_varying = has_volume_spatial_varying;
+  shader->has_volume_attribute_dependency = has_volume_attribute_dependency;
+  shader->has_integrator_dependency = has_integrator_dependency;
+}
+
 SVMShaderManager::SVMShaderManager()
 {
 }
@@ -45,30 +100,129 @@ SVMShaderManager::~SVMShaderManager()
 
 void SVMShaderManager::reset(Scene * /*scene*/)
 {
+  free_compiled_shaders();
+}
+
+static string svm_shader_hash(Shader *shader, bool background)
+{
+  MD5Hash md5;
+  md5.append(shader->graph->compute_hash());
+  shader->hash(md5);
+  md5.append((uint8_t *)&background, sizeof(background));
+  return md5.get_hex();
 }
 
 void SVMShaderManager::device_update_shader(Scene *scene,
                                             Shader *shader,
                                             Progress *progress,
-                                            array<int4> *svm_nodes)
+                                            CompiledShader *compiled,
+                                            bool force_compile)
 {
   if (progress->get_cancel()) {
     return;
   }
   assert(shader->graph);
 
-  svm_nodes->push_back_slow(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
-
   SVMCompiler::Summary summary;
   SVMCompiler compiler(scene);
   compiler.background = (shader == scene->background->get_shader(scene));
-  compiler.compile(shader, *svm_nodes, 0, &summary);
+
+  /* Hash the graph after finalization, so edits that get optimized away by constant
+   * folding and simplification do not cause the shader to be compiled again. */
+  compiler.finalize(shader, &summary);
+
+  if (!force_compile && !compiled->svm_nodes.empty() &&
+      compiled->hash == svm_shader_hash(shader, compiler.background)) {
+    compiled->restore_flags(shader);
+    return;
+  }
+
+  compiled->svm_nodes.clear();
+  compiled->svm_nodes.push_back_slow(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
+  compiler.compile(shader, compiled->svm_nodes, 0, &summary);
+
+  /* Compilation assigns image and IES slots to nodes, so hash again to match the graph
+   * as it will be found in the next update. */
+  compiled->hash = svm_shader_hash(shader, compiler.background);
+  compiled->store_flags(shader);
+  compiled->modified = true;
 
   VLOG(2) << "Compilation summary:\n"
           << "Shader name: " << shader->name << "\n"
           << summary.full_report();
 }
 
+void SVMShaderManager::device_copy_nodes(DeviceScene *dscene, Scene *scene)
+{
+  const int num_shaders = scene->shaders.size();
+
+  /* When no shader was added or removed and the compiled shaders kept their size, only
+   * the nodes of the compiled shaders are patched in the existing array. */
+  bool update_in_place = (device_shaders == scene->shaders) && dscene->svm_nodes.size() != 0;
+
+  for (int i = 0; i < num_shaders && update_in_place; i++) {
+    const CompiledShader &compiled = compiled_shaders[scene->shaders[i]];
+    /* Since we're not copying the local jump node, the size ends up being one node lower. */
+    if (compiled.modified && (int)compiled.svm_nodes.size() - 1 != compiled.device_size) {
+      update_in_place = false;
+    }
+  }
+
+  int4 *svm_nodes;
+
+  if (update_in_place) {
+    svm_nodes = dscene->svm_nodes.data();
+  }
+  else {
+    /* The global node list contains a jump table (one node per shader)
+     * followed by the nodes of all shaders. */
+    int svm_nodes_size = num_shaders;
+    for (int i = 0; i < num_shaders; i++) {
+      CompiledShader &compiled = compiled_shaders[scene->shaders[i]];
+      compiled.device_offset = svm_nodes_size;
+      compiled.device_size = compiled.svm_nodes.size() - 1;
+      svm_nodes_size += compiled.device_size;
+    }
+
+    svm_nodes = dscene->svm_nodes.alloc(svm_nodes_size);
+  }
+
+  int num_copied = 0;
+
+  for (int i = 0; i < num_shaders; i++) {
+    Shader *shader = scene->shaders[i];
+    CompiledShader &compiled = compiled_shaders[shader];
+
+    if (update_in_place && !compiled.modified) {
+      continue;
+    }
+
+    /* Update the global jump table.
+     * Each compiled shader starts with a jump node that has offsets local
+     * to the shader, so copy those and add the offset into the global node list. */
+    int4 &global_jump_node = svm_nodes[shader->id];
+    const int4 &local_jump_node = compiled.svm_nodes[0];
+
+    global_jump_node.x = NODE_SHADER_JUMP;
+    global_jump_node.y = local_jump_node.y - 1 + compiled.device_offset;
+    global_jump_node.z = local_jump_node.z - 1 + compiled.device_offset;
+    global_jump_node.w = local_jump_node.w - 1 + compiled.device_offset;
+
+    /* Copy the nodes of the shader into the correct location. */
+    memcpy(svm_nodes + compiled.device_offset,
+           &compiled.svm_nodes[1],
+           sizeof(int4) * compiled.device_size);
+
+    compiled.modified = false;
+    num_copied++;
+  }
+
+  device_shaders = scene->shaders;
+
+  VLOG(1) << (update_in_place ? "Patched " : "Copied ") << num_copied
+          << " shaders into the SVM nodes.";
+}
+
 void SVMShaderManager::device_update(Device *device,
                                      DeviceScene *dscene,
                                      Scene *scene,
@@ -89,19 +243,41 @@ void SVMShaderManager::device_update(Device *device,
 
   double start_time = time_dt();
 
-  /* test if we need to update */
-  device_free(device, dscene, scene);
+  /* The SVM nodes are kept, so they can be patched in place. */
+  device_free_common(device, dscene, scene);
+
+  /* Images, AOVs and integrator settings affect the compiled nodes in ways not covered
+   * by the graph hash, compile all shaders when they changed. */
+  const bool force_compile = scene->image_manager->need_update || scene->film->is_modified() ||
+                             scene->integrator->is_modified();
+
+  /* Forget shaders that were removed from the scene. */
+  unordered_set<Shader *> scene_shaders(scene->shaders.begin(), scene->shaders.end());
+  for (auto it = compiled_shaders.begin(); it != compiled_shaders.end();) {
+    if (scene_shaders.find(it->first) == scene_shaders.end()) {
+      it = compiled_shaders.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  /* Create the entries up front, the map must not be modified by the tasks. */
+  vector<CompiledShader *> shader_compiled(num_shaders);
+  for (int i = 0; i < num_shaders; i++) {
+    shader_compiled[i] = &compiled_shaders[scene->shaders[i]];
+  }
 
   /* Build all shaders. */
   TaskPool task_pool;
-  vector<array<int4>> shader_svm_nodes(num_shaders);
   for (int i = 0; i < num_shaders; i++) {
     task_pool.push(function_bind(&SVMShaderManager::device_update_shader,
                                  this,
                                  scene,
                                  scene->shaders[i],
                                  &progress,
-                                 &shader_svm_nodes[i]));
+                                 shader_compiled[i],
+                                 force_compile));
   }
   task_pool.wait_work();
 
@@ -109,17 +285,7 @@ void SVMShaderManager::device_update(Device *device,
     return;
   }
 
-  /* The global node list contains a jump table (one node per shader)
-   * followed by the nodes of all shaders. */
-  int svm_nodes_size = num_shaders;
-  for (int i = 0; i < num_shaders; i++) {
-    /* Since we're not copying the local jump node, the size ends up being one node lower. */
-    svm_nodes_size += shader_svm_nodes[i].size() - 1;
-  }
-
-  int4 *svm_nodes = dscene->svm_nodes.alloc(svm_nodes_size);
-
-  int node_offset = num_shaders;
+  int num_compiled = 0;
   for (int i = 0; i < num_shaders; i++) {
     Shader *shader = scene->shaders[i];
 
@@ -128,28 +294,12 @@ void SVMShaderManager::device_update(Device *device,
       scene->light_manager->need_update = true;
     }
 
-    /* Update the global jump table.
-     * Each compiled shader starts with a jump node that has offsets local
-     * to the shader, so copy those and add the offset into the global node list. */
-    int4 &global_jump_node = svm_nodes[shader->id];
-    int4 &local_jump_node = shader_svm_nodes[i][0];
-
-    global_jump_node.x = NODE_SHADER_JUMP;
-    global_jump_node.y = local_jump_node.y - 1 + node_offset;
-    global_jump_node.z = local_jump_node.z - 1 + node_offset;
-    global_jump_node.w = local_jump_node.w - 1 + node_offset;
-
-    node_offset += shader_svm_nodes[i].size() - 1;
+    if (shader_compiled[i]->modified) {
+      num_compiled++;
+    }
   }
 
-  /* Copy the nodes of each shader into the correct location. */
-  svm_nodes += num_shaders;
-  for (int i = 0; i < num_shaders; i++) {
-    int shader_size = shader_svm_nodes[i].size() - 1;
-
-    memcpy(svm_nodes, &shader_svm_nodes[i][1], sizeof(int4) * shader_size);
-    svm_nodes += shader_size;
-  }
+  device_copy_nodes(dscene, scene);
 
   if (progress.get_cancel()) {
     return;
@@ -161,8 +311,8 @@ void SVMShaderManager::device_update(Device *device,
 
   need_update = false;
 
-  VLOG(1) << "Shader manager updated " << num_shaders << " shaders in " << time_dt() - start_time
-          << " seconds.";
+  VLOG(1) << "Shader manager compiled " << num_compiled << " of " << num_shaders
+          << " shaders in " << time_dt() - start_time << " seconds.";
 }
 
 void SVMShaderManager::device_free(Device *device, DeviceScene *dscene, Scene *scene)
@@ -170,6 +320,13 @@ void SVMShaderManager::device_free(Device *device, DeviceScene *dscene, Scene *s
   device_free_common(device, dscene, scene);
 
   dscene->svm_nodes.free();
+  free_compiled_shaders();
+}
+
+void SVMShaderManager::free_compiled_shaders()
+{
+  compiled_shaders.clear();
+  device_shaders.clear();
 }
 
 /* Graph Compiler */
@@ -832,25 +989,30 @@ void SVMCompiler::compile_type(Shader *shader, ShaderGraph *graph, ShaderType ty
   }
 }
 
+static bool shader_has_bump(Shader *shader)
+{
+  ShaderNode *output = shader->graph->output();
+  return (shader->get_displacement_method() != DISPLACE_TRUE) &&
+         output->input("Surface")->link && output->input("Displacement")->link;
+}
+
+void SVMCompiler::finalize(Shader *shader, Summary *summary)
+{
+  scoped_timer timer((summary != NULL) ? &summary->time_finalize : NULL);
+  shader->graph->finalize(scene,
+                          shader_has_bump(shader),
+                          shader->has_integrator_dependency,
+                          shader->get_displacement_method() == DISPLACE_BOTH);
+}
+
 void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Summary *summary)
 {
   /* copy graph for shader with bump mapping */
-  ShaderNode *output = shader->graph->output();
   int start_num_svm_nodes = svm_nodes.size();
 
   const double time_start = time_dt();
 
-  bool has_bump = (shader->get_displacement_method() != DISPLACE_TRUE) &&
-                  output->input("Surface")->link && output->input("Displacement")->link;
-
-  /* finalize */
-  {
-    scoped_timer timer((summary != NULL) ? &summary->time_finalize : NULL);
-    shader->graph->finalize(scene,
-                            has_bump,
-                            shader->has_integrator_dependency,
-                            shader->get_displacement_method() == DISPLACE_BOTH);
-  }
+  bool has_bump = shader_has_bump(shader);
 
   current_shader = shader;
 
@@ -905,7 +1067,7 @@ void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Sum
 
   /* Fill in summary information. */
   if (summary != NULL) {
-    summary->time_total = time_dt() - time_start;
+    summary->time_total = summary->time_finalize + time_dt() - time_start;
     summary->peak_stack_usage = max_stack_use;
     summary->num_svm_nodes = svm_nodes.size() - start_num_svm_nodes;
   }
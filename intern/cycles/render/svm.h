@@ -22,6 +22,7 @@
 #include "render/shader.h"
 
 #include "util/util_array.h"
+#include "util/util_map.h"
 #include "util/util_set.h"
 #include "util/util_string.h"
 #include "util/util_thread.h"
@@ -50,10 +51,51 @@ class SVMShaderManager : public ShaderManager {
   void device_free(Device *device, DeviceScene *dscene, Scene *scene);
 
  protected:
+  /* Compiled nodes of a shader, kept between updates so that only shaders of which the
+   * finalized graph changed are compiled again. */
+  struct CompiledShader {
+    CompiledShader();
+
+    void store_flags(const Shader *shader);
+    void restore_flags(Shader *shader) const;
+
+    /* Hash of the finalized graph, shader settings and background flag. */
+    string hash;
+    /* Local jump node followed by the nodes of the shader. */
+    array<int4> svm_nodes;
+    /* Location of the nodes in the device array, excluding the local jump node. */
+    int device_offset;
+    int device_size;
+    /* Compiled in the current update. */
+    bool modified;
+
+    /* Flags set by the compiler. */
+    bool has_surface;
+    bool has_surface_emission;
+    bool has_surface_transparent;
+    bool has_surface_bssrdf;
+    bool has_bump;
+    bool has_bssrdf_bump;
+    bool has_volume;
+    bool has_displacement;
+    bool has_surface_spatial_varying;
+    bool has_volume_spatial_varying;
+    bool has_volume_attribute_dependency;
+    bool has_integrator_dependency;
+  };
+
   void device_update_shader(Scene *scene,
                             Shader *shader,
                             Progress *progress,
-                            array<int4> *svm_nodes);
+                            CompiledShader *compiled,
+                            bool force_compile);
+  void device_copy_nodes(DeviceScene *dscene, Scene *scene);
+  void free_compiled_shaders();
+
+  unordered_map<Shader *, CompiledShader> compiled_shaders;
+  /* Shaders in the order they were last copied to the device, to detect when the
+   * device nodes can be patched in place. */
+  vector<Shader *> device_shaders;
 };
 
 /* Graph Compiler */
@@ -92,6 +134,8 @@ class SVMCompiler {
   };
 
   SVMCompiler(Scene *scene);
+  /* The graph must be finalized before it is compiled. */
+  void finalize(Shader *shader, Summary *summary = NULL);
   void compile(Shader *shader, array<int4> &svm_nodes, int index, Summary *summary = NULL);
 
   int stack_assign(ShaderOutput *output);
@@ -82,6 +82,9 @@ class DebugFlags {
 
     /* Whether split kernel is used */
     bool split_kernel;
+
+    /* Number of paths each thread advances through the split kernel at once. */
+    int split_kernel_batch_size;
   };
 
   /* Descriptor of CUDA feature-set to be used. */
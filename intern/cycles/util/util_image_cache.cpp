@@ -0,0 +1,406 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_image_cache.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+#include "util/util_texture.h"
+
+#include <atomic>
+#include <memory>
+
+CCL_NAMESPACE_BEGIN
+
+using std::shared_ptr;
+
+/* Number of locks protecting the tile pointers of a level, a tile is protected by the lock
+ * with its index modulo this number. */
+static const int IMAGE_CACHE_NUM_LOCKS = 64;
+
+/* Number of tiles every thread keeps a reference to, so that most lookups don't have to
+ * take any lock. Must be a power of two. */
+static const int IMAGE_CACHE_THREAD_TILES = 16;
+
+struct ImageCacheTile {
+  std::once_flag loaded;
+  /* Cleared by the eviction clock, set again on access. */
+  std::atomic<bool> referenced;
+  int width, height;
+  vector<float4> pixels;
+
+  ImageCacheTile() : referenced(true), width(0), height(0)
+  {
+  }
+
+  size_t memory_size() const
+  {
+    return sizeof(ImageCacheTile) + pixels.size() * sizeof(float4);
+  }
+};
+
+struct ImageCacheLevel {
+  int width, height;
+  int tiles_x, tiles_y;
+  vector<shared_ptr<ImageCacheTile>> tiles;
+  thread_mutex locks[IMAGE_CACHE_NUM_LOCKS];
+};
+
+namespace {
+
+struct ImageCacheThreadTile {
+  uint64_t texture_id;
+  int level, tx, ty;
+  shared_ptr<ImageCacheTile> tile;
+
+  ImageCacheThreadTile() : texture_id(0), level(0), tx(0), ty(0)
+  {
+  }
+};
+
+/* Texture ids are never reused, so references to tiles of removed textures can not be
+ * mistaken for tiles of new textures. They only keep a little memory alive until replaced. */
+thread_local ImageCacheThreadTile thread_tiles[IMAGE_CACHE_THREAD_TILES];
+std::atomic<uint64_t> image_cache_next_texture_id(1);
+
+}  // namespace
+
+/* Image Cache Texture */
+
+ImageCacheTexture::ImageCacheTexture(
+    ImageCache *cache, ImageCacheLoader *loader, int width, int height, int min_level)
+    : cache(cache), loader(loader), width_(width), height_(height)
+{
+  id = image_cache_next_texture_id++;
+
+  num_levels_ = 1;
+  while ((width >> num_levels_) > 0 || (height >> num_levels_) > 0) {
+    num_levels_++;
+  }
+
+  num_file_levels = clamp(loader->num_levels(), 1, num_levels_);
+  min_level_ = clamp(min_level, 0, num_levels_ - 1);
+
+  levels = new ImageCacheLevel[num_levels_];
+  for (int level = 0; level < num_levels_; level++) {
+    ImageCacheLevel &l = levels[level];
+    l.width = this->width(level);
+    l.height = this->height(level);
+    l.tiles_x = divide_up(l.width, TILE_SIZE);
+    l.tiles_y = divide_up(l.height, TILE_SIZE);
+    l.tiles.resize(l.tiles_x * l.tiles_y);
+  }
+}
+
+ImageCacheTexture::~ImageCacheTexture()
+{
+  delete[] levels;
+}
+
+float4 ImageCacheTexture::fetch(int level, int x, int y)
+{
+  /* Tiles are laid out in file order, from top to bottom. */
+  return texel(level, x, levels[level].height - 1 - y);
+}
+
+float4 ImageCacheTexture::texel(int level, int x, int y)
+{
+  const int tx = x >> TILE_SHIFT;
+  const int ty = y >> TILE_SHIFT;
+
+  /* Neighboring tiles, as accessed by interpolation across tile borders, map to different
+   * entries. */
+  ImageCacheThreadTile &entry =
+      thread_tiles[(tx + 2 * ty + 4 * level + 8 * id) & (IMAGE_CACHE_THREAD_TILES - 1)];
+
+  if (!(entry.tile && entry.texture_id == id && entry.level == level && entry.tx == tx &&
+        entry.ty == ty)) {
+    entry.tile = acquire_tile(level, tx, ty);
+    entry.texture_id = id;
+    entry.level = level;
+    entry.tx = tx;
+    entry.ty = ty;
+  }
+
+  ImageCacheTile &tile = *entry.tile;
+
+  /* Avoid writing to memory shared between threads unless the flag was cleared. */
+  if (!tile.referenced.load(std::memory_order_relaxed)) {
+    tile.referenced.store(true, std::memory_order_relaxed);
+  }
+
+  return tile.pixels[(y - (ty << TILE_SHIFT)) * tile.width + (x - (tx << TILE_SHIFT))];
+}
+
+shared_ptr<ImageCacheTile> ImageCacheTexture::acquire_tile(int level, int tx, int ty)
+{
+  ImageCacheLevel &l = levels[level];
+  const int index = ty * l.tiles_x + tx;
+  shared_ptr<ImageCacheTile> tile;
+
+  {
+    thread_scoped_lock lock(l.locks[index % IMAGE_CACHE_NUM_LOCKS]);
+    if (!l.tiles[index]) {
+      l.tiles[index] = std::make_shared<ImageCacheTile>();
+    }
+    tile = l.tiles[index];
+  }
+
+  /* Other threads accessing the same tile wait for it to be loaded. */
+  std::call_once(tile->loaded, [&]() { load_tile(*tile, level, tx, ty); });
+
+  return tile;
+}
+
+void ImageCacheTexture::load_tile(ImageCacheTile &tile, int level, int tx, int ty)
+{
+  const ImageCacheLevel &l = levels[level];
+  const int x = tx * TILE_SIZE;
+  const int y = ty * TILE_SIZE;
+
+  tile.width = min(TILE_SIZE, l.width - x);
+  tile.height = min(TILE_SIZE, l.height - y);
+  tile.pixels.resize(((size_t)tile.width) * tile.height);
+
+  bool success = true;
+  if (level >= num_file_levels) {
+    downsample_tile(tile, level, tx, ty);
+  }
+  else if (!loader->is_tiled()) {
+    success = load_tile_row(tile, level, tx, ty);
+  }
+  else {
+    success = loader->read_region(level, x, y, tile.width, tile.height, tile.pixels.data());
+  }
+
+  if (!success) {
+    /* Show the same color as missing images. */
+    std::fill(tile.pixels.begin(),
+              tile.pixels.end(),
+              make_float4(TEX_IMAGE_MISSING_R,
+                          TEX_IMAGE_MISSING_G,
+                          TEX_IMAGE_MISSING_B,
+                          TEX_IMAGE_MISSING_A));
+  }
+
+  cache->tile_loaded(this, level, ty * l.tiles_x + tx, tile.memory_size());
+}
+
+bool ImageCacheTexture::load_tile_row(ImageCacheTile &tile, int level, int tx, int ty)
+{
+  ImageCacheLevel &l = levels[level];
+  const int y = ty * TILE_SIZE;
+
+  vector<float4> row(((size_t)l.width) * tile.height);
+  if (!loader->read_region(level, 0, y, l.width, tile.height, row.data())) {
+    return false;
+  }
+
+  for (int i = 0; i < l.tiles_x; i++) {
+    shared_ptr<ImageCacheTile> other;
+    ImageCacheTile *target = &tile;
+
+    if (i != tx) {
+      other = std::make_shared<ImageCacheTile>();
+      other->width = min(TILE_SIZE, l.width - i * TILE_SIZE);
+      other->height = tile.height;
+      other->pixels.resize(((size_t)other->width) * other->height);
+      /* Not referenced yet, these are the first to go when memory runs out. */
+      other->referenced = false;
+      target = other.get();
+    }
+
+    for (int j = 0; j < target->height; j++) {
+      const float4 *src = &row[((size_t)j) * l.width + i * TILE_SIZE];
+      std::copy(src, src + target->width, &target->pixels[((size_t)j) * target->width]);
+    }
+
+    if (other) {
+      /* Mark as loaded before making it visible. Tiles that are already present are left
+       * alone, another thread may be loading them. */
+      std::call_once(other->loaded, []() {});
+
+      const int index = ty * l.tiles_x + i;
+      bool inserted = false;
+      {
+        thread_scoped_lock lock(l.locks[index % IMAGE_CACHE_NUM_LOCKS]);
+        if (!l.tiles[index]) {
+          l.tiles[index] = other;
+          inserted = true;
+        }
+      }
+
+      if (inserted) {
+        cache->tile_loaded(this, level, index, other->memory_size());
+      }
+    }
+  }
+
+  return true;
+}
+
+void ImageCacheTexture::downsample_tile(ImageCacheTile &tile, int level, int tx, int ty)
+{
+  /* Box filter of the next finer level. For odd sizes the last row or column is skipped,
+   * like OpenImageIO does when generating MIP levels. */
+  const ImageCacheLevel &fine = levels[level - 1];
+  const int x = tx * TILE_SIZE;
+  const int y = ty * TILE_SIZE;
+
+  for (int j = 0; j < tile.height; j++) {
+    const int y0 = min(2 * (y + j), fine.height - 1);
+    const int y1 = min(y0 + 1, fine.height - 1);
+
+    for (int i = 0; i < tile.width; i++) {
+      const int x0 = min(2 * (x + i), fine.width - 1);
+      const int x1 = min(x0 + 1, fine.width - 1);
+
+      tile.pixels[j * tile.width + i] = 0.25f * (texel(level - 1, x0, y0) +
+                                                 texel(level - 1, x1, y0) +
+                                                 texel(level - 1, x0, y1) +
+                                                 texel(level - 1, x1, y1));
+    }
+  }
+}
+
+bool ImageCacheTexture::evict_tile(int level, int index)
+{
+  ImageCacheLevel &l = levels[level];
+  thread_scoped_lock lock(l.locks[index % IMAGE_CACHE_NUM_LOCKS]);
+
+  shared_ptr<ImageCacheTile> &tile = l.tiles[index];
+  if (tile && tile->referenced.exchange(false)) {
+    /* Accessed since the clock last passed, give it another chance. */
+    return false;
+  }
+
+  /* Threads still using the tile keep it alive until they move on. */
+  tile.reset();
+  return true;
+}
+
+/* Image Cache */
+
+ImageCache::ImageCache(size_t memory_limit)
+    : clock_hand(0), memory_used(0), memory_limit(memory_limit)
+{
+}
+
+ImageCache::~ImageCache()
+{
+  foreach (ImageCacheTexture *texture, textures) {
+    delete texture;
+  }
+}
+
+ImageCacheTexture *ImageCache::add_texture(ImageCacheLoader *loader,
+                                           int width,
+                                           int height,
+                                           int min_level)
+{
+  ImageCacheTexture *texture = new ImageCacheTexture(this, loader, width, height, min_level);
+
+  thread_scoped_lock lock(mutex);
+  textures.push_back(texture);
+
+  return texture;
+}
+
+void ImageCache::remove_texture(ImageCacheTexture *texture)
+{
+  {
+    thread_scoped_lock lock(mutex);
+
+    for (size_t i = 0; i < resident_tiles.size();) {
+      if (resident_tiles[i].texture == texture) {
+        memory_used -= resident_tiles[i].size;
+        resident_tiles[i] = resident_tiles.back();
+        resident_tiles.pop_back();
+      }
+      else {
+        i++;
+      }
+    }
+
+    textures.erase(std::remove(textures.begin(), textures.end(), texture), textures.end());
+  }
+
+  delete texture;
+}
+
+void ImageCache::set_memory_limit(size_t memory_limit_)
+{
+  thread_scoped_lock lock(mutex);
+  memory_limit = memory_limit_;
+  evict();
+}
+
+size_t ImageCache::memory_usage()
+{
+  thread_scoped_lock lock(mutex);
+  return memory_used;
+}
+
+void ImageCache::tile_loaded(ImageCacheTexture *texture, int level, int index, size_t size)
+{
+  thread_scoped_lock lock(mutex);
+
+  ResidentTile resident;
+  resident.texture = texture;
+  resident.level = level;
+  resident.index = index;
+  resident.size = size;
+  resident_tiles.push_back(resident);
+
+  memory_used += size;
+  evict();
+}
+
+void ImageCache::evict()
+{
+  if (memory_used <= memory_limit) {
+    return;
+  }
+
+  /* Free a bit more than needed, so that we don't evict on every tile load once full. */
+  const size_t target = memory_limit - memory_limit / 8;
+  const size_t max_steps = 2 * resident_tiles.size();
+
+  for (size_t step = 0; step < max_steps && memory_used > target && !resident_tiles.empty();
+       step++) {
+    if (clock_hand >= resident_tiles.size()) {
+      clock_hand = 0;
+    }
+
+    ResidentTile &resident = resident_tiles[clock_hand];
+    if (resident.texture->evict_tile(resident.level, resident.index)) {
+      memory_used -= resident.size;
+      resident = resident_tiles.back();
+      resident_tiles.pop_back();
+    }
+    else {
+      clock_hand++;
+    }
+  }
+
+  if (memory_used > memory_limit) {
+    VLOG(2) << "Image cache over budget, " << memory_used << " bytes in use.";
+  }
+}
+
+CCL_NAMESPACE_END
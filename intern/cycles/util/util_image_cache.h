@@ -0,0 +1,152 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_IMAGE_CACHE_H__
+#define __UTIL_IMAGE_CACHE_H__
+
+#include "util/util_math.h"
+#include "util/util_thread.h"
+#include "util/util_types.h"
+#include "util/util_unique_ptr.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class ImageCache;
+struct ImageCacheLevel;
+struct ImageCacheTile;
+
+/* Image Cache Loader
+ *
+ * Source of the pixels of a texture in the image cache, typically an image file. */
+class ImageCacheLoader {
+ public:
+  virtual ~ImageCacheLoader()
+  {
+  }
+
+  /* Number of MIP levels that can be read, at least one. Coarser levels are generated by
+   * downsampling the finest level available. */
+  virtual int num_levels() const = 0;
+
+  /* Whether arbitrary regions can be read efficiently. If not, full rows of tiles are read at
+   * once, since the file has to be decoded that way anyway. */
+  virtual bool is_tiled() const = 0;
+
+  /* Read RGBA pixels of a region of a MIP level, with rows ordered from top to bottom as
+   * they are stored in the file. */
+  virtual bool read_region(int level, int x, int y, int width, int height, float4 *pixels) = 0;
+};
+
+/* Image Cache Texture
+ *
+ * 2D texture of which the tiles of every MIP level are loaded on first access, and may be
+ * evicted again when the cache runs out of memory. Used by the CPU kernel in place of a
+ * fully loaded image. */
+class ImageCacheTexture {
+ public:
+  static const int TILE_SHIFT = 6;
+  static const int TILE_SIZE = 1 << TILE_SHIFT;
+
+  int width(int level) const
+  {
+    return max(width_ >> level, 1);
+  }
+
+  int height(int level) const
+  {
+    return max(height_ >> level, 1);
+  }
+
+  int num_levels() const
+  {
+    return num_levels_;
+  }
+
+  /* Finest level that may be used, to respect the texture size limit. */
+  int min_level() const
+  {
+    return min_level_;
+  }
+
+  /* RGBA texel of a MIP level, with y pointing up as in the kernel. Coordinates must be
+   * inside the level. */
+  float4 fetch(int level, int x, int y);
+
+ protected:
+  friend class ImageCache;
+
+  ImageCacheTexture(
+      ImageCache *cache, ImageCacheLoader *loader, int width, int height, int min_level);
+  ~ImageCacheTexture();
+
+  float4 texel(int level, int x, int y);
+  std::shared_ptr<ImageCacheTile> acquire_tile(int level, int tx, int ty);
+  void load_tile(ImageCacheTile &tile, int level, int tx, int ty);
+  bool load_tile_row(ImageCacheTile &tile, int level, int tx, int ty);
+  void downsample_tile(ImageCacheTile &tile, int level, int tx, int ty);
+  bool evict_tile(int level, int index);
+
+  ImageCache *cache;
+  unique_ptr<ImageCacheLoader> loader;
+  ImageCacheLevel *levels;
+  uint64_t id;
+  int width_, height_;
+  int num_levels_;
+  int num_file_levels;
+  int min_level_;
+};
+
+/* Image Cache
+ *
+ * Keeps the tiles of image cache textures in memory within a budget. When the budget is
+ * exceeded, tiles that have not been accessed recently are evicted in clock order. */
+class ImageCache {
+ public:
+  explicit ImageCache(size_t memory_limit);
+  ~ImageCache();
+
+  /* Takes ownership of the loader. */
+  ImageCacheTexture *add_texture(ImageCacheLoader *loader, int width, int height, int min_level);
+  void remove_texture(ImageCacheTexture *texture);
+
+  void set_memory_limit(size_t memory_limit);
+  size_t memory_usage();
+
+ protected:
+  friend class ImageCacheTexture;
+
+  void tile_loaded(ImageCacheTexture *texture, int level, int index, size_t size);
+  void evict();
+
+  struct ResidentTile {
+    ImageCacheTexture *texture;
+    int level;
+    int index;
+    size_t size;
+  };
+
+  thread_mutex mutex;
+  vector<ImageCacheTexture *> textures;
+  vector<ResidentTile> resident_tiles;
+  size_t clock_hand;
+  size_t memory_used;
+  size_t memory_limit;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_IMAGE_CACHE_H__ */
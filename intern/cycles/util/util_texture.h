@@ -103,6 +103,8 @@ typedef struct TextureInfo {
   uint interpolation, extension;
   /* Dimensions. */
   uint width, height, depth;
+  /* Image cache on the CPU, data then points to an ImageCacheTexture. */
+  uint use_cache;
   /* Transform for 3D textures. */
   uint use_transform_3d;
   Transform transform_3d;
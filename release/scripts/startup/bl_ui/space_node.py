@@ -657,6 +657,12 @@ class NODE_PT_quality(bpy.types.Panel):
         snode = context.space_data
         tree = snode.node_tree
 
+        col = layout.column()
+        col.prop(tree, "execution_mode")
+        if tree.execution_mode == 'FULL_FRAME':
+            col.prop(tree, "cache_limit")
+            col.label(text="Cache: %d hits, %d misses" % (tree.cache_hits, tree.cache_misses))
+
         col = layout.column()
         col.prop(tree, "render_quality", text="Render")
         col.prop(tree, "edit_quality", text="Edit")
@@ -1365,6 +1365,9 @@ class USERPREF_PT_saveload_blend(SaveLoadPanel, CenterAlignMixIn, Panel):
         col.prop(paths, "use_file_compression")
         col.prop(paths, "use_load_ui")
 
+        col = layout.column(heading="Load")
+        col.prop(paths, "use_defer_packed_data")
+
         col = layout.column(heading="Text Files")
         col.prop(paths, "use_tabs_as_spaces")
 
@@ -97,7 +97,9 @@ IFACEMETHODIMP CBlendThumb::Initialize(IStream *pStream, DWORD)
 #include "Wincodec.h"
 #include <math.h>
 #include <zlib.h>
+#include <zstd.h>
 const unsigned char gzip_magic[3] = {0x1f, 0x8b, 0x08};
+const unsigned char zstd_magic[4] = {0x28, 0xb5, 0x2f, 0xfd};
 
 // IThumbnailProvider
 IFACEMETHODIMP CBlendThumb::GetThumbnail(UINT cx, HBITMAP *phbmp, WTS_ALPHATYPE *pdwAlpha)
@@ -107,14 +109,20 @@ IFACEMETHODIMP CBlendThumb::GetThumbnail(UINT cx, HBITMAP *phbmp, WTS_ALPHATYPE
   LARGE_INTEGER SeekPos;
 
   // Compressed?
-  unsigned char in_magic[3];
-  _pStream->Read(&in_magic, 3, &BytesRead);
-  bool gzipped = true;
-  for (int i = 0; i < 3; i++)
+  unsigned char in_magic[4];
+  _pStream->Read(&in_magic, 4, &BytesRead);
+  bool gzipped = (BytesRead >= 3);
+  for (int i = 0; i < 3 && gzipped; i++)
     if (in_magic[i] != gzip_magic[i]) {
       gzipped = false;
       break;
     }
+  bool zstd_compressed = (BytesRead == 4);
+  for (int i = 0; i < 4 && zstd_compressed; i++)
+    if (in_magic[i] != zstd_magic[i]) {
+      zstd_compressed = false;
+      break;
+    }
 
   if (gzipped) {
     // Zlib inflate
@@ -167,6 +175,43 @@ IFACEMETHODIMP CBlendThumb::GetThumbnail(UINT cx, HBITMAP *phbmp, WTS_ALPHATYPE
     delete[] src;
     delete[] dest;
   }
+  else if (zstd_compressed) {
+    // Only decompress the start of the file, the thumbnail is inside the first 65KB.
+    const size_t dest_size = 1024 * 70;
+    Bytef *dest = new Bytef[dest_size];
+    ZSTD_outBuffer output = {dest, dest_size, 0};
+
+    const size_t src_size = ZSTD_DStreamInSize();
+    Bytef *src = new Bytef[src_size];
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+
+    SeekPos.QuadPart = 0;
+    _pStream->Seek(SeekPos, STREAM_SEEK_SET, NULL);
+    bool error = false;
+    while (!error && output.pos < output.size) {
+      ULONG read_size = 0;
+      _pStream->Read(src, (ULONG)src_size, &read_size);
+      if (read_size == 0) {
+        break;
+      }
+      // Files are a sequence of frames, decompressStream continues with the next one.
+      ZSTD_inBuffer input = {src, read_size, 0};
+      while (input.pos < input.size && output.pos < output.size) {
+        if (ZSTD_isError(ZSTD_decompressStream(dctx, &output, &input))) {
+          error = true;
+          break;
+        }
+      }
+    }
+    ZSTD_freeDCtx(dctx);
+
+    // Replace the IStream, which is read-only
+    _pStream->Release();
+    _pStream = SHCreateMemStream(dest, (UINT)output.pos);
+
+    delete[] src;
+    delete[] dest;
+  }
 
   // Blender version, early out if sub 2.5
   SeekPos.QuadPart = 9;
@@ -49,6 +49,11 @@ enum {
   IDTYPE_FLAGS_NO_MAKELOCAL = 1 << 2,
   /** Indicates that the given IDType does not have animation data. */
   IDTYPE_FLAGS_NO_ANIMDATA = 1 << 3,
+  /**
+   * Indicates that the `blend_read_data` callback of the given IDType only touches data owned by
+   * the ID itself, so that multiple IDs of this type can be read from a file in parallel.
+   */
+  IDTYPE_FLAGS_THREADED_READ_DATA = 1 << 4,
 };
 
 typedef struct IDCacheKey {
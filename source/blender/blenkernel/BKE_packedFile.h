@@ -103,6 +103,7 @@ int BKE_packedfile_write_to_file(struct ReportList *reports,
 
 /* free */
 void BKE_packedfile_free(struct PackedFile *pf);
+bool BKE_packedfile_data_ensure(struct PackedFile *pf);
 
 /* info */
 int BKE_packedfile_count_all(struct Main *bmain);
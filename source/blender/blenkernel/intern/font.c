@@ -264,6 +264,7 @@ static VFontData *vfont_get_data(VFont *vfont)
     else {
       if (vfont->packedfile) {
         pf = vfont->packedfile;
+        BKE_packedfile_data_ensure(pf);
 
         /* We need to copy a tmp font to memory unless it is already there */
         if (vfont->temp_pf == NULL) {
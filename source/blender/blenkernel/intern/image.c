@@ -312,7 +312,7 @@ IDTypeInfo IDType_ID_IM = {
     .name = "Image",
     .name_plural = "images",
     .translation_context = BLT_I18NCONTEXT_ID_IMAGE,
-    .flags = IDTYPE_FLAGS_NO_ANIMDATA,
+    .flags = IDTYPE_FLAGS_NO_ANIMDATA | IDTYPE_FLAGS_THREADED_READ_DATA,
 
     .init_data = image_init_data,
     .copy_data = image_copy_data,
@@ -4390,6 +4390,7 @@ static ImBuf *load_image_single(Image *ima,
 
     imapf = BLI_findlink(&ima->packedfiles, view_id);
     if (imapf->packedfile) {
+      BKE_packedfile_data_ensure(imapf->packedfile);
       ibuf = IMB_ibImageFromMemory((unsigned char *)imapf->packedfile->data,
                                    imapf->packedfile->size,
                                    flag,
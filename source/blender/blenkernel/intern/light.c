@@ -194,7 +194,7 @@ IDTypeInfo IDType_ID_LA = {
     .name = "Light",
     .name_plural = "lights",
     .translation_context = BLT_I18NCONTEXT_ID_LIGHT,
-    .flags = 0,
+    .flags = IDTYPE_FLAGS_THREADED_READ_DATA,
 
     .init_data = light_init_data,
     .copy_data = light_copy_data,
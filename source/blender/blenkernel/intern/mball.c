@@ -189,7 +189,7 @@ IDTypeInfo IDType_ID_MB = {
     .name = "Metaball",
     .name_plural = "metaballs",
     .translation_context = BLT_I18NCONTEXT_ID_METABALL,
-    .flags = 0,
+    .flags = IDTYPE_FLAGS_THREADED_READ_DATA,
 
     .init_data = metaball_init_data,
     .copy_data = metaball_copy_data,
@@ -1142,7 +1142,7 @@ IDTypeInfo IDType_ID_OB = {
     .name = "Object",
     .name_plural = "objects",
     .translation_context = BLT_I18NCONTEXT_ID_OBJECT,
-    .flags = 0,
+    .flags = IDTYPE_FLAGS_THREADED_READ_DATA,
 
     .init_data = object_init_data,
     .copy_data = object_copy_data,
@@ -41,6 +41,7 @@
 #include "DNA_volume_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_font.h"
@@ -55,6 +56,7 @@
 #include "IMB_imbuf_types.h"
 
 #include "BLO_read_write.h"
+#include "BLO_readfile.h"
 
 int BKE_packedfile_seek(PackedFile *pf, int offset, int whence)
 {
@@ -95,7 +97,7 @@ void BKE_packedfile_rewind(PackedFile *pf)
 
 int BKE_packedfile_read(PackedFile *pf, void *data, int size)
 {
-  if ((pf != NULL) && (size >= 0) && (data != NULL)) {
+  if ((pf != NULL) && (size >= 0) && (data != NULL) && BKE_packedfile_data_ensure(pf)) {
     if (size + pf->seek > pf->size) {
       size = pf->size - pf->seek;
     }
@@ -155,9 +157,12 @@ int BKE_packedfile_count_all(Main *bmain)
 void BKE_packedfile_free(PackedFile *pf)
 {
   if (pf) {
-    BLI_assert(pf->data != NULL);
+    BLI_assert(pf->data != NULL || pf->deferred_data != NULL);
 
     MEM_SAFE_FREE(pf->data);
+    if (pf->deferred_data != NULL) {
+      BLO_deferred_data_free(pf->deferred_data);
+    }
     MEM_freeN(pf);
   }
   else {
@@ -168,16 +173,48 @@ void BKE_packedfile_free(PackedFile *pf)
 PackedFile *BKE_packedfile_duplicate(const PackedFile *pf_src)
 {
   BLI_assert(pf_src != NULL);
-  BLI_assert(pf_src->data != NULL);
+  BLI_assert(pf_src->data != NULL || pf_src->deferred_data != NULL);
 
   PackedFile *pf_dst;
 
   pf_dst = MEM_dupallocN(pf_src);
-  pf_dst->data = MEM_dupallocN(pf_src->data);
+  if (pf_src->deferred_data != NULL) {
+    pf_dst->deferred_data = BLO_deferred_data_duplicate(pf_src->deferred_data);
+  }
+  else {
+    pf_dst->data = MEM_dupallocN(pf_src->data);
+  }
 
   return pf_dst;
 }
 
+/**
+ * Read the data of a packed file that was left in the .blend file while reading it,
+ * see #BLO_READ_DEFER_PACKED_DATA. Must be called before accessing `pf->data` of packed files
+ * that come from a .blend file. Returns false when the data could not be read, in which case
+ * it is filled with zeros.
+ */
+bool BKE_packedfile_data_ensure(PackedFile *pf)
+{
+  static ThreadMutex deferred_data_mutex = BLI_MUTEX_INITIALIZER;
+  bool success = true;
+
+  BLI_mutex_lock(&deferred_data_mutex);
+  if (pf->deferred_data != NULL) {
+    pf->data = BLO_deferred_data_read(pf->deferred_data);
+    if (pf->data == NULL) {
+      printf("%s: error reading packed file data from .blend file\n", __func__);
+      pf->data = MEM_callocN(pf->size, __func__);
+      success = false;
+    }
+    BLO_deferred_data_free(pf->deferred_data);
+    pf->deferred_data = NULL;
+  }
+  BLI_mutex_unlock(&deferred_data_mutex);
+
+  return success;
+}
+
 PackedFile *BKE_packedfile_new_from_memory(void *mem, int memlen)
 {
   BLI_assert(mem != NULL);
@@ -339,7 +376,7 @@ int BKE_packedfile_write_to_file(ReportList *reports,
     ret_value = RET_ERROR;
   }
   else {
-    if (write(file, pf->data, pf->size) != pf->size) {
+    if (!BKE_packedfile_data_ensure(pf) || write(file, pf->data, pf->size) != pf->size) {
       BKE_reportf(reports, RPT_ERROR, "Error writing file '%s'", name);
       ret_value = RET_ERROR;
     }
@@ -408,6 +445,7 @@ enum ePF_FileCompare BKE_packedfile_compare_to_file(const char *ref_file_name,
     }
     else {
       ret_val = PF_CMP_EQUAL;
+      BKE_packedfile_data_ensure(pf);
 
       for (int i = 0; i < pf->size; i += sizeof(buf)) {
         int len = pf->size - i;
@@ -535,7 +573,8 @@ static void unpack_generate_paths(const char *name,
     if (id_type == ID_IM) {
       ImagePackedFile *imapf = ((Image *)id)->packedfiles.last;
       if (imapf != NULL && imapf->packedfile != NULL) {
-        const PackedFile *pf = imapf->packedfile;
+        PackedFile *pf = imapf->packedfile;
+        BKE_packedfile_data_ensure(pf);
         enum eImbFileType ftype = IMB_ispic_type_from_memory((const uchar *)pf->data, pf->size);
         if (ftype != IMB_FTYPE_NONE) {
           const int imtype = BKE_image_ftype_to_imtype(ftype, NULL);
@@ -878,6 +917,14 @@ void BKE_packedfile_blend_write(BlendWriter *writer, PackedFile *pf)
   if (pf == NULL) {
     return;
   }
+  /* Undo steps don't need to read data that is still in the .blend file, the struct is written
+   * with the deferred data pointer instead. */
+  if (pf->deferred_data != NULL && BLO_write_deferred_data(writer, pf->deferred_data)) {
+    BLO_write_struct(writer, PackedFile, pf);
+    return;
+  }
+  /* Also clears the deferred data pointer written with the struct. */
+  BKE_packedfile_data_ensure(pf);
   BLO_write_struct(writer, PackedFile, pf);
   BLO_write_raw(writer, pf->size, pf->data);
 }
@@ -890,6 +937,20 @@ void BKE_packedfile_blend_read(BlendDataReader *reader, PackedFile **pf_p)
     return;
   }
 
+  /* Referenced by the undo step being read, see #BKE_packedfile_blend_write. */
+  if (pf->deferred_data != NULL && BLO_read_data_is_undo(reader)) {
+    pf->deferred_data = BLO_deferred_data_duplicate(pf->deferred_data);
+    pf->data = NULL;
+    return;
+  }
+
+  /* Leave the data in the file until it is needed, when reading allows it. */
+  pf->deferred_data = BLO_read_get_deferred_data(reader, pf->data);
+  if (pf->deferred_data != NULL) {
+    pf->data = NULL;
+    return;
+  }
+
   BLO_read_packed_address(reader, &pf->data);
   if (pf->data == NULL) {
     /* We cannot allow a PackedFile with a NULL data field,
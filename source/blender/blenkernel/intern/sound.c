@@ -544,6 +544,7 @@ static void sound_load_audio(Main *bmain, bSound *sound, bool free_waveform)
 
     /* but we need a packed file then */
     if (pf) {
+      BKE_packedfile_data_ensure(pf);
       sound->handle = AUD_Sound_bufferFile((unsigned char *)pf->data, pf->size);
     }
     else {
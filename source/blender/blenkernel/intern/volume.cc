@@ -621,7 +621,7 @@ IDTypeInfo IDType_ID_VO = {
     /* name */ "Volume",
     /* name_plural */ "volumes",
     /* translation_context */ BLT_I18NCONTEXT_ID_VOLUME,
-    /* flags */ 0,
+    /* flags */ IDTYPE_FLAGS_THREADED_READ_DATA,
 
     /* init_data */ volume_init_data,
     /* copy_data */ volume_copy_data,
@@ -162,6 +162,52 @@ int BLI_cpu_support_sse41(void)
   return 0;
 }
 
+/* AVX2 together with FMA, as enabled by compiling with -mavx2 -mfma. */
+int BLI_cpu_support_avx2(void)
+{
+  int result[4], num;
+  __cpuid(result, 0);
+  num = result[0];
+  if (num < 7) {
+    return 0;
+  }
+
+  __cpuid(result, 0x00000001);
+  const bool cpu_fma_support = (result[2] & ((int)1 << 12)) != 0;
+  const bool os_uses_xsave_xrestore = (result[2] & ((int)1 << 27)) != 0;
+  const bool cpu_avx_support = (result[2] & ((int)1 << 28)) != 0;
+  if (!(cpu_fma_support && os_uses_xsave_xrestore && cpu_avx_support)) {
+    return 0;
+  }
+
+  /* Check if the OS will save the YMM registers. */
+  unsigned int xcr_feature_mask;
+#if defined(_MSC_VER)
+  xcr_feature_mask = (unsigned int)_xgetbv(0);
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  unsigned int edx; /* not used */
+  /* actual opcode for xgetbv */
+  __asm__(".byte 0x0f, 0x01, 0xd0" : "=a"(xcr_feature_mask), "=d"(edx) : "c"(0));
+#else
+  xcr_feature_mask = 0;
+#endif
+  if ((xcr_feature_mask & 0x6) != 0x6) {
+    return 0;
+  }
+
+  /* Extended features, sub-leaf 0. */
+#if defined(_MSC_VER)
+  __cpuidex(result, 0x00000007, 0);
+#elif defined(__GNUC__) && defined(__x86_64__)
+  asm("cpuid"
+      : "=a"(result[0]), "=b"(result[1]), "=c"(result[2]), "=d"(result[3])
+      : "a"(0x00000007), "c"(0));
+#else
+  return 0;
+#endif
+  return (result[1] & ((int)1 << 5)) != 0;
+}
+
 void BLI_hostname_get(char *buffer, size_t bufsize)
 {
 #ifndef WIN32
@@ -54,6 +54,7 @@ typedef struct BlendExpander BlendExpander;
 typedef struct BlendLibReader BlendLibReader;
 typedef struct BlendWriter BlendWriter;
 
+struct BlendDeferredData;
 struct Main;
 struct ReportList;
 
@@ -166,6 +167,7 @@ void BLO_write_string(BlendWriter *writer, const char *data_ptr);
 
 /* Misc. */
 bool BLO_write_is_undo(BlendWriter *writer);
+bool BLO_write_deferred_data(BlendWriter *writer, struct BlendDeferredData *deferred_data);
 
 /* Blend Read Data API
  * ===================
@@ -198,6 +200,10 @@ void *BLO_read_get_new_packed_address(BlendDataReader *reader, const void *old_a
 #define BLO_read_packed_address(reader, ptr_p) \
   *((void **)ptr_p) = BLO_read_get_new_packed_address((reader), *(ptr_p))
 
+/* Data that was left in the file to be read later, NULL when it was read already. */
+struct BlendDeferredData *BLO_read_get_deferred_data(BlendDataReader *reader,
+                                                    const void *old_address);
+
 typedef void (*BlendReadListFn)(BlendDataReader *reader, void *data);
 void BLO_read_list_cb(BlendDataReader *reader, struct ListBase *list, BlendReadListFn callback);
 void BLO_read_list(BlendDataReader *reader, struct ListBase *list);
@@ -81,7 +81,7 @@ typedef struct BlendFileData {
 } BlendFileData;
 
 struct BlendFileReadParams {
-  uint skip_flags : 3; /* eBLOReadSkip */
+  uint skip_flags : 4; /* eBLOReadSkip */
   uint is_startup : 1;
 
   /** Whether we are reading the memfile for an undo (< 0) or a redo (> 0). */
@@ -95,6 +95,12 @@ typedef enum eBLOReadSkip {
   BLO_READ_SKIP_DATA = (1 << 1),
   /** Do not attempt to re-use IDs from old bmain for unchanged ones in case of undo. */
   BLO_READ_SKIP_UNDO_OLD_MAIN = (1 << 2),
+  /**
+   * Do not read the contents of packed files up front, but only when they are first needed,
+   * see #BKE_packedfile_data_ensure. Only has an effect for uncompressed files that can be
+   * memory-mapped, the mapping is kept until all packed files were read.
+   */
+  BLO_READ_DEFER_PACKED_DATA = (1 << 3),
 } eBLOReadSkip;
 #define BLO_READ_SKIP_ALL (BLO_READ_SKIP_USERDEF | BLO_READ_SKIP_DATA)
 
@@ -115,6 +121,21 @@ void BLO_blendfiledata_free(BlendFileData *bfd);
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLO Deferred Data API
+ *
+ * Blocks of data that were left in the file while reading it, see #BLO_READ_DEFER_PACKED_DATA.
+ * \{ */
+
+struct BlendDeferredData;
+
+void *BLO_deferred_data_read(const struct BlendDeferredData *deferred_data);
+struct BlendDeferredData *BLO_deferred_data_duplicate(
+    const struct BlendDeferredData *deferred_data);
+void BLO_deferred_data_free(struct BlendDeferredData *deferred_data);
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLO Blend File Handle API
  * \{ */
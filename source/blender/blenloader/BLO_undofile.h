@@ -25,14 +25,18 @@
  */
 
 struct GHash;
+struct MemFileBuffer;
 struct Scene;
 
 typedef struct {
   void *next, *prev;
+  /** Data of #MemFileChunk.buffer, NULL while compressed (see #BLO_memfile_decompress). */
   const char *buf;
+  /** Reference counted memory, shared by all chunks with the same content. */
+  struct MemFileBuffer *buffer;
   /** Size in bytes. */
   size_t size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** When true, this chunk is identical to the matching #MemFileChunk of the previous step. */
   bool is_identical;
   /** When true, this chunk is also identical to the one in the next step (used by undo code to
    * detect unchanged IDs).
@@ -46,6 +50,8 @@ typedef struct {
 typedef struct MemFile {
   ListBase chunks;
   size_t size;
+  /** #LinkData of #BlendDeferredData referenced by the chunks instead of their data. */
+  ListBase deferred_data;
 } MemFile;
 
 typedef struct MemFileWriteData {
@@ -78,6 +84,8 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
 extern void BLO_memfile_free(MemFile *memfile);
 extern void BLO_memfile_merge(MemFile *first, MemFile *second);
 extern void BLO_memfile_clear_future(MemFile *memfile);
+extern void BLO_memfile_compress(MemFile *memfile);
+extern void BLO_memfile_decompress(MemFile *memfile);
 
 /* utilities */
 extern struct Main *BLO_memfile_main_get(struct MemFile *memfile,
@@ -72,3 +72,23 @@ extern bool BLO_write_file_mem(struct Main *mainvar,
                                int write_flags);
 
 /** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name BLO Write File Snapshot API
+ *
+ * Split #BLO_write_file into serializing on the main thread and writing from any thread.
+ * \{ */
+
+typedef struct BlendFileWriteSnapshot BlendFileWriteSnapshot;
+
+extern BlendFileWriteSnapshot *BLO_write_file_snapshot(struct Main *mainvar,
+                                                       const char *filepath,
+                                                       const int write_flags,
+                                                       const struct BlendFileWriteParams *params,
+                                                       struct ReportList *reports);
+extern bool BLO_write_file_snapshot_to_disk(BlendFileWriteSnapshot *snapshot,
+                                            float *progress,
+                                            struct ReportList *reports);
+extern void BLO_write_file_snapshot_free(BlendFileWriteSnapshot *snapshot);
+
+/** \} */
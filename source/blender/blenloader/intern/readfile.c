@@ -58,6 +58,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_blenlib.h"
 #include "BLI_endian_switch.h"
 #include "BLI_ghash.h"
@@ -65,6 +67,8 @@
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BLT_translation.h"
@@ -107,6 +111,8 @@
 
 #include <errno.h>
 
+#include <zstd.h>
+
 /* Make preferences read-only. */
 #define U (*((const UserDef *)&U))
 
@@ -228,11 +234,17 @@ void BLO_reportf_wrap(ReportList *reports, ReportType type, const char *format,
 
   fixed_buf[sizeof(fixed_buf) - 1] = '\0';
 
+  /* Data of datablocks may be read from multiple threads, see #read_libblocks_data. */
+  static ThreadMutex reports_mutex = BLI_MUTEX_INITIALIZER;
+  BLI_mutex_lock(&reports_mutex);
+
   BKE_report(reports, type, fixed_buf);
 
   if (G.background == 0) {
     printf("%s: %s\n", BKE_report_type_str(type), fixed_buf);
   }
+
+  BLI_mutex_unlock(&reports_mutex);
 }
 
 /* for reporting linking messages */
@@ -404,7 +416,7 @@ static void *oldnewmap_liblookup(OldNewMap *onm, const void *addr, const void *l
 
 static void oldnewmap_clear(OldNewMap *onm)
 {
-  /* Free unused data. */
+  /* Free unused data. Deferred data was not read, see #OLDNEW_DEFERRED. */
   for (int i = 0; i < onm->nentries; i++) {
     OldNew *entry = &onm->entries[i];
     if (entry->nr == 0) {
@@ -434,6 +446,108 @@ static void oldnewmap_free(OldNewMap *onm)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Deferred Data
+ *
+ * With #BLO_READ_DEFER_PACKED_DATA, large blocks of raw data are not read together with the
+ * datablock they belong to. Their block header is stored in the datamap instead, so they are
+ * only read when looked up. Packed files take a #BlendDeferredData instead, which keeps the
+ * memory-mapped file alive until they read it.
+ * \{ */
+
+/* User count of datamap entries that were not read yet, their new address is the #BHead. */
+#define OLDNEW_DEFERRED -1
+
+/* Smaller blocks are not worth the bookkeeping. */
+#define DEFERRED_DATA_MIN_SIZE (64 * 1024)
+
+typedef struct BlendDeferredSource {
+  BLI_mmap_file *mmap_file;
+  int users;
+} BlendDeferredSource;
+
+/* Shared by packed files and undo steps using the same data, see #BKE_packedfile_blend_write. */
+typedef struct BlendDeferredData {
+  BlendDeferredSource *source;
+  size_t offset;
+  size_t size;
+  int users;
+} BlendDeferredData;
+
+static void deferred_source_init(FileData *fd)
+{
+  BLI_assert(fd->deferred_source == NULL);
+  if ((fd->skip_flags & BLO_READ_DEFER_PACKED_DATA) == 0 || fd->mmap_file == NULL ||
+      fd->memfile != NULL) {
+    return;
+  }
+  fd->deferred_source = MEM_mallocN(sizeof(*fd->deferred_source), __func__);
+  fd->deferred_source->mmap_file = fd->mmap_file;
+  fd->deferred_source->users = 1;
+}
+
+static void deferred_source_release(BlendDeferredSource *source)
+{
+  if (atomic_sub_and_fetch_int32(&source->users, 1) == 0) {
+    BLI_mmap_free(source->mmap_file);
+    MEM_freeN(source);
+  }
+}
+
+static bool blo_bhead_use_deferred(FileData *fd, BHead *bhead)
+{
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  /* Only raw data that does not need any conversion. */
+  return (fd->deferred_source != NULL) && (bhead->SDNAnr == 0) &&
+         (fd->compflags[0] == SDNA_CMP_EQUAL) && (bhead->len >= DEFERRED_DATA_MIN_SIZE) &&
+         !BHEADN_FROM_BHEAD(bhead)->has_data;
+#else
+  UNUSED_VARS(fd, bhead);
+  return false;
+#endif
+}
+
+static BlendDeferredData *deferred_data_new(FileData *fd, BHead *bhead)
+{
+  BlendDeferredData *deferred_data = MEM_mallocN(sizeof(*deferred_data), __func__);
+  deferred_data->source = fd->deferred_source;
+  deferred_data->offset = (size_t)BHEADN_FROM_BHEAD(bhead)->file_offset;
+  deferred_data->size = (size_t)bhead->len;
+  deferred_data->users = 1;
+  atomic_add_and_fetch_int32(&fd->deferred_source->users, 1);
+  return deferred_data;
+}
+
+/* Read the data into newly allocated memory, returns NULL when reading fails. */
+void *BLO_deferred_data_read(const BlendDeferredData *deferred_data)
+{
+  void *data = MEM_mallocN(deferred_data->size, "Deferred data");
+  if (!BLI_mmap_read(
+          deferred_data->source->mmap_file, data, deferred_data->offset, deferred_data->size)) {
+    MEM_freeN(data);
+    return NULL;
+  }
+  return data;
+}
+
+/* The data never changes, so duplicates are additional users of the same handle. */
+BlendDeferredData *BLO_deferred_data_duplicate(const BlendDeferredData *deferred_data)
+{
+  BlendDeferredData *deferred_data_dst = (BlendDeferredData *)deferred_data;
+  atomic_add_and_fetch_int32(&deferred_data_dst->users, 1);
+  return deferred_data_dst;
+}
+
+void BLO_deferred_data_free(BlendDeferredData *deferred_data)
+{
+  if (atomic_sub_and_fetch_int32(&deferred_data->users, 1) == 0) {
+    deferred_source_release(deferred_data->source);
+    MEM_freeN(deferred_data);
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Helper Functions
  * \{ */
@@ -645,6 +759,9 @@ static Main *blo_find_main(FileData *fd, const char *filepath, const char *relab
 
 typedef struct BlendDataReader {
   FileData *fd;
+  /* Direct data of the datablock being read, separate from fd->datamap when multiple
+   * datablocks are read in parallel. */
+  struct OldNewMap *datamap;
 } BlendDataReader;
 
 typedef struct BlendLibReader {
@@ -923,6 +1040,11 @@ static bool blo_bhead_read_data(FileData *fd, BHead *thisblock, void *buf)
   bool success = true;
   BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
   BLI_assert(new_bhead->has_data == false && new_bhead->file_offset != 0);
+  if (fd->mmap_file != NULL) {
+    /* No seeking needed, which also makes this safe to call from multiple threads. */
+    return BLI_mmap_read(
+        fd->mmap_file, buf, (size_t)new_bhead->file_offset, (size_t)new_bhead->bhead.len);
+  }
   off64_t offset_backup = fd->file_offset;
   if (UNLIKELY(fd->seek(fd, new_bhead->file_offset, SEEK_SET) == -1)) {
     success = false;
@@ -939,6 +1061,24 @@ static bool blo_bhead_read_data(FileData *fd, BHead *thisblock, void *buf)
   return success;
 }
 
+/**
+ * Data of a block that was not read yet, directly in the memory-mapped file.
+ * Returns NULL when the file is not mapped, the data has to be read then.
+ */
+static const void *blo_bhead_data_mapped(FileData *fd, BHead *thisblock)
+{
+  if (fd->mmap_file == NULL) {
+    return NULL;
+  }
+  const char *memory = BLI_mmap_get_pointer(fd->mmap_file);
+  if (memory == NULL) {
+    return NULL;
+  }
+  BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
+  BLI_assert(new_bhead->has_data == false && new_bhead->file_offset != 0);
+  return memory + new_bhead->file_offset;
+}
+
 static BHead *blo_bhead_read_full(FileData *fd, BHead *thisblock)
 {
   BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
@@ -1124,6 +1264,51 @@ static off64_t fd_seek_data_from_file(FileData *filedata, off64_t offset, int wh
   return filedata->file_offset;
 }
 
+/* Memory-mapped file reading. */
+
+static ssize_t fd_read_from_mmap(FileData *filedata,
+                                 void *buffer,
+                                 size_t size,
+                                 bool *UNUSED(r_is_memchunck_identical))
+{
+  /* Don't read more bytes than there are available in the file. */
+  const size_t readsize = MIN2(size, filedata->buffersize - (size_t)filedata->file_offset);
+
+  if (!BLI_mmap_read(filedata->mmap_file, buffer, (size_t)filedata->file_offset, readsize)) {
+    return EOF;
+  }
+
+  filedata->file_offset += readsize;
+
+  return (ssize_t)readsize;
+}
+
+static off64_t fd_seek_from_mmap(FileData *filedata, off64_t offset, int whence)
+{
+  off64_t new_offset;
+
+  switch (whence) {
+    case SEEK_SET:
+      new_offset = offset;
+      break;
+    case SEEK_CUR:
+      new_offset = filedata->file_offset + offset;
+      break;
+    case SEEK_END:
+      new_offset = (off64_t)filedata->buffersize + offset;
+      break;
+    default:
+      return -1;
+  }
+
+  if (new_offset < 0 || new_offset > (off64_t)filedata->buffersize) {
+    return -1;
+  }
+
+  filedata->file_offset = new_offset;
+  return new_offset;
+}
+
 /* GZip file reading. */
 
 static ssize_t fd_read_gzip_from_file(FileData *filedata,
@@ -1145,6 +1330,400 @@ static ssize_t fd_read_gzip_from_file(FileData *filedata,
   return readsize;
 }
 
+/* Zstd file reading. */
+
+/**
+ * Decompressed frames, with offsets into the seek table of #FileDataZstd.
+ */
+typedef struct ZstdFrameCache {
+  int first_frame;
+  int num_frames;
+  char *data;
+  size_t data_size;
+} ZstdFrameCache;
+
+/**
+ * Files written by Blender end with a seek table of their frames, see
+ * #zstd_write_seekable_frames. With it, sequential reading decompresses batches of frames in
+ * parallel, and seeking only decompresses the frame it lands in. Without it (files compressed
+ * with external tools, or memory buffers), the data is decompressed as a stream.
+ */
+typedef struct FileDataZstd {
+  /** Start offsets of the frames, with an extra entry for the end of the last frame. */
+  int num_frames;
+  size_t *compressed_offset;
+  size_t *uncompressed_offset;
+
+  /** Frames decompressed for sequential reading, and for the last seek elsewhere. */
+  ZstdFrameCache batch;
+  ZstdFrameCache seek;
+  int batch_max_frames;
+  bool batch_error;
+
+  char *compressed_data;
+  size_t compressed_data_size;
+
+  /** Streaming decompression, when there is no seek table. */
+  ZSTD_DCtx *dctx;
+  ZSTD_inBuffer in_buf;
+  /** Input read from the file, NULL when decompressing #FileData.buffer. */
+  char *in_data;
+} FileDataZstd;
+
+/* Magic numbers of the seek table frame. */
+#define ZSTD_SEEKABLE_SKIPPABLE_MAGIC 0x184D2A5E
+#define ZSTD_SEEKABLE_MAGIC 0x8F92EAB1
+#define ZSTD_SEEKABLE_FOOTER_SIZE 9
+#define ZSTD_SEEKABLE_CHECKSUM_FLAG (1 << 7)
+
+static bool zstd_is_magic(const char *header)
+{
+  return ((uchar)header[0] == 0x28 && (uchar)header[1] == 0xB5 && (uchar)header[2] == 0x2F &&
+          (uchar)header[3] == 0xFD);
+}
+
+static uint32_t zstd_read_u32_le(const char *data)
+{
+  const uchar *bytes = (const uchar *)data;
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) |
+         ((uint32_t)bytes[3] << 24);
+}
+
+static bool zstd_read_exact(int file, off64_t offset, void *buffer, size_t size)
+{
+  if (BLI_lseek(file, offset, SEEK_SET) == -1) {
+    return false;
+  }
+  return read(file, buffer, size) == (ssize_t)size;
+}
+
+/**
+ * Read the seek table at the end of the file, returns false when there is none or it is invalid.
+ */
+static bool zstd_read_seek_table(FileDataZstd *zstd, int file)
+{
+  const off64_t file_size = BLI_lseek(file, 0, SEEK_END);
+  if (file_size < ZSTD_SEEKABLE_FOOTER_SIZE + 8) {
+    return false;
+  }
+
+  char footer[ZSTD_SEEKABLE_FOOTER_SIZE];
+  if (!zstd_read_exact(file, file_size - ZSTD_SEEKABLE_FOOTER_SIZE, footer, sizeof(footer))) {
+    return false;
+  }
+
+  const uint32_t num_frames = zstd_read_u32_le(footer);
+  const uchar flags = (uchar)footer[4];
+  if (zstd_read_u32_le(footer + 5) != ZSTD_SEEKABLE_MAGIC) {
+    return false;
+  }
+  /* Reserved bits must be zero. */
+  if (flags & 0x7C) {
+    return false;
+  }
+
+  const size_t entry_size = (flags & ZSTD_SEEKABLE_CHECKSUM_FLAG) ? 12 : 8;
+  const size_t table_size = num_frames * entry_size + ZSTD_SEEKABLE_FOOTER_SIZE;
+  if (num_frames == 0 || (off64_t)table_size + 8 > file_size) {
+    return false;
+  }
+
+  const off64_t table_offset = file_size - (off64_t)table_size - 8;
+  char *table = MEM_mallocN(table_size + 8, __func__);
+  bool ok = zstd_read_exact(file, table_offset, table, table_size + 8) &&
+            zstd_read_u32_le(table) == ZSTD_SEEKABLE_SKIPPABLE_MAGIC &&
+            zstd_read_u32_le(table + 4) == table_size;
+
+  if (ok) {
+    zstd->num_frames = (int)num_frames;
+    zstd->compressed_offset = MEM_malloc_arrayN(num_frames + 1, sizeof(size_t), __func__);
+    zstd->uncompressed_offset = MEM_malloc_arrayN(num_frames + 1, sizeof(size_t), __func__);
+
+    size_t compressed_offset = 0, uncompressed_offset = 0;
+    for (uint32_t i = 0; i < num_frames; i++) {
+      const char *entry = table + 8 + i * entry_size;
+      zstd->compressed_offset[i] = compressed_offset;
+      zstd->uncompressed_offset[i] = uncompressed_offset;
+      compressed_offset += zstd_read_u32_le(entry);
+      uncompressed_offset += zstd_read_u32_le(entry + 4);
+    }
+    zstd->compressed_offset[num_frames] = compressed_offset;
+    zstd->uncompressed_offset[num_frames] = uncompressed_offset;
+
+    /* The frames must exactly fill the file up to the seek table. */
+    ok = (compressed_offset == (size_t)table_offset);
+  }
+
+  MEM_freeN(table);
+
+  if (!ok) {
+    MEM_SAFE_FREE(zstd->compressed_offset);
+    MEM_SAFE_FREE(zstd->uncompressed_offset);
+    zstd->num_frames = 0;
+  }
+
+  return ok;
+}
+
+static FileDataZstd *zstd_filedata_new(void)
+{
+  FileDataZstd *zstd = MEM_callocN(sizeof(FileDataZstd), __func__);
+  /* Enough frames to decompress in parallel, without using too much memory. */
+  zstd->batch_max_frames = max_ii(1, BLI_system_thread_count());
+  return zstd;
+}
+
+static void zstd_filedata_free(FileDataZstd *zstd)
+{
+  MEM_SAFE_FREE(zstd->compressed_offset);
+  MEM_SAFE_FREE(zstd->uncompressed_offset);
+  MEM_SAFE_FREE(zstd->batch.data);
+  MEM_SAFE_FREE(zstd->seek.data);
+  MEM_SAFE_FREE(zstd->compressed_data);
+  MEM_SAFE_FREE(zstd->in_data);
+  if (zstd->dctx) {
+    ZSTD_freeDCtx(zstd->dctx);
+  }
+  MEM_freeN(zstd);
+}
+
+/* Find the frame containing the uncompressed offset. */
+static int zstd_frame_find(const FileDataZstd *zstd, size_t offset)
+{
+  int low = 0, high = zstd->num_frames;
+  while (low + 1 < high) {
+    const int mid = (low + high) / 2;
+    if (zstd->uncompressed_offset[mid] <= offset) {
+      low = mid;
+    }
+    else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+static bool zstd_frame_cache_contains(const FileDataZstd *zstd,
+                                      const ZstdFrameCache *cache,
+                                      size_t offset)
+{
+  return (cache->num_frames != 0) &&
+         (offset >= zstd->uncompressed_offset[cache->first_frame]) &&
+         (offset < zstd->uncompressed_offset[cache->first_frame + cache->num_frames]);
+}
+
+typedef struct ZstdDecompressData {
+  FileDataZstd *zstd;
+  ZstdFrameCache *cache;
+} ZstdDecompressData;
+
+static void zstd_decompress_frame_cb(void *__restrict userdata,
+                                     const int iter,
+                                     const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ZstdDecompressData *data = userdata;
+  FileDataZstd *zstd = data->zstd;
+  const int first_frame = data->cache->first_frame;
+  const int frame = first_frame + iter;
+
+  const size_t compressed_size = zstd->compressed_offset[frame + 1] -
+                                 zstd->compressed_offset[frame];
+  const size_t uncompressed_size = zstd->uncompressed_offset[frame + 1] -
+                                   zstd->uncompressed_offset[frame];
+  const char *src = zstd->compressed_data +
+                    (zstd->compressed_offset[frame] - zstd->compressed_offset[first_frame]);
+  char *dst = data->cache->data +
+              (zstd->uncompressed_offset[frame] - zstd->uncompressed_offset[first_frame]);
+
+  const size_t result = ZSTD_decompress(dst, uncompressed_size, src, compressed_size);
+  if (ZSTD_isError(result) || result != uncompressed_size) {
+    zstd->batch_error = true;
+  }
+}
+
+/* Read and decompress frames into the cache, in parallel. */
+static bool zstd_frame_cache_load(
+    FileData *fd, ZstdFrameCache *cache, int first_frame, int num_frames)
+{
+  FileDataZstd *zstd = fd->zstd;
+  num_frames = min_ii(num_frames, zstd->num_frames - first_frame);
+
+  const size_t compressed_size = zstd->compressed_offset[first_frame + num_frames] -
+                                 zstd->compressed_offset[first_frame];
+  const size_t uncompressed_size = zstd->uncompressed_offset[first_frame + num_frames] -
+                                   zstd->uncompressed_offset[first_frame];
+
+  if (compressed_size > zstd->compressed_data_size) {
+    MEM_SAFE_FREE(zstd->compressed_data);
+    zstd->compressed_data = MEM_mallocN(compressed_size, "zstd compressed frames");
+    zstd->compressed_data_size = compressed_size;
+  }
+  if (uncompressed_size > cache->data_size) {
+    MEM_SAFE_FREE(cache->data);
+    cache->data = MEM_mallocN(uncompressed_size, "zstd decompressed frames");
+    cache->data_size = uncompressed_size;
+  }
+
+  cache->num_frames = 0;
+
+  if (!zstd_read_exact(fd->filedes,
+                       (off64_t)zstd->compressed_offset[first_frame],
+                       zstd->compressed_data,
+                       compressed_size)) {
+    return false;
+  }
+
+  cache->first_frame = first_frame;
+  zstd->batch_error = false;
+
+  ZstdDecompressData data = {
+      .zstd = zstd,
+      .cache = cache,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, num_frames, &data, zstd_decompress_frame_cb, &settings);
+
+  if (zstd->batch_error) {
+    return false;
+  }
+
+  cache->num_frames = num_frames;
+  return true;
+}
+
+static ssize_t fd_read_zstd_seekable(FileData *filedata,
+                                     void *buffer,
+                                     size_t size,
+                                     bool *UNUSED(r_is_memchunck_identical))
+{
+  FileDataZstd *zstd = filedata->zstd;
+  const size_t file_size = zstd->uncompressed_offset[zstd->num_frames];
+  size_t totread = 0;
+
+  while (totread < size && (size_t)filedata->file_offset < file_size) {
+    const size_t offset = (size_t)filedata->file_offset;
+    ZstdFrameCache *cache = NULL;
+
+    if (zstd_frame_cache_contains(zstd, &zstd->batch, offset)) {
+      cache = &zstd->batch;
+    }
+    else if (zstd_frame_cache_contains(zstd, &zstd->seek, offset)) {
+      cache = &zstd->seek;
+    }
+    else {
+      /* Continue sequential reading with the next batch, other jumps only decompress a single
+       * frame so seeking back and forth for read-on-demand keeps the batch. */
+      const int frame = zstd_frame_find(zstd, offset);
+      const ZstdFrameCache *batch = &zstd->batch;
+      if (batch->num_frames == 0 || frame == batch->first_frame + batch->num_frames) {
+        cache = &zstd->batch;
+        if (!zstd_frame_cache_load(filedata, cache, frame, zstd->batch_max_frames)) {
+          return EOF;
+        }
+      }
+      else {
+        cache = &zstd->seek;
+        if (!zstd_frame_cache_load(filedata, cache, frame, 1)) {
+          return EOF;
+        }
+      }
+    }
+
+    const size_t cache_offset = zstd->uncompressed_offset[cache->first_frame];
+    const size_t cache_end = zstd->uncompressed_offset[cache->first_frame + cache->num_frames];
+    const size_t readsize = MIN2(size - totread, cache_end - offset);
+
+    memcpy(POINTER_OFFSET(buffer, totread), cache->data + (offset - cache_offset), readsize);
+    totread += readsize;
+    filedata->file_offset += readsize;
+  }
+
+  return (ssize_t)totread;
+}
+
+static off64_t fd_seek_zstd_seekable(FileData *filedata, off64_t offset, int whence)
+{
+  const FileDataZstd *zstd = filedata->zstd;
+  const off64_t file_size = (off64_t)zstd->uncompressed_offset[zstd->num_frames];
+  off64_t new_offset;
+
+  switch (whence) {
+    case SEEK_SET:
+      new_offset = offset;
+      break;
+    case SEEK_CUR:
+      new_offset = filedata->file_offset + offset;
+      break;
+    case SEEK_END:
+      new_offset = file_size + offset;
+      break;
+    default:
+      return -1;
+  }
+
+  if (new_offset < 0 || new_offset > file_size) {
+    return -1;
+  }
+
+  filedata->file_offset = new_offset;
+  return new_offset;
+}
+
+static ssize_t fd_read_zstd_stream(FileData *filedata,
+                                   void *buffer,
+                                   size_t size,
+                                   bool *UNUSED(r_is_memchunck_identical))
+{
+  FileDataZstd *zstd = filedata->zstd;
+  ZSTD_outBuffer output = {buffer, size, 0};
+
+  while (output.pos < output.size) {
+    if (zstd->in_buf.pos == zstd->in_buf.size) {
+      if (zstd->in_data == NULL) {
+        /* All of the memory buffer was decompressed. */
+        break;
+      }
+      const ssize_t readsize = read(filedata->filedes, zstd->in_data, ZSTD_DStreamInSize());
+      if (readsize < 0) {
+        return EOF;
+      }
+      if (readsize == 0) {
+        break;
+      }
+      zstd->in_buf.src = zstd->in_data;
+      zstd->in_buf.size = (size_t)readsize;
+      zstd->in_buf.pos = 0;
+    }
+
+    const size_t result = ZSTD_decompressStream(zstd->dctx, &output, &zstd->in_buf);
+    if (ZSTD_isError(result)) {
+      BKE_reportf(filedata->reports,
+                  RPT_ERROR,
+                  "Failed to decompress blend file '%s': %s",
+                  filedata->relabase,
+                  ZSTD_getErrorName(result));
+      return EOF;
+    }
+  }
+
+  filedata->file_offset += output.pos;
+  return (ssize_t)output.pos;
+}
+
+static void zstd_stream_init(FileDataZstd *zstd, const void *mem, size_t memsize)
+{
+  zstd->dctx = ZSTD_createDCtx();
+  if (mem != NULL) {
+    zstd->in_buf.src = mem;
+    zstd->in_buf.size = memsize;
+  }
+  else {
+    zstd->in_data = MEM_mallocN(ZSTD_DStreamInSize(), "zstd input buffer");
+  }
+}
+
 /* Memory reading. */
 
 static ssize_t fd_read_from_memory(FileData *filedata,
@@ -1290,6 +1869,8 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
 
   gzFile gzfile = (gzFile)Z_NULL;
+  FileDataZstd *zstd = NULL;
+  BLI_mmap_file *mmap_file = NULL;
 
   char header[7];
 
@@ -1308,8 +1889,20 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   /* Regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
-    read_fn = fd_read_data_from_file;
-    seek_fn = fd_seek_data_from_file;
+    /* Map the file, so blocks are copied from the page cache once, without a system call per
+     * block, and DNA reconstruction reads the mapped file directly. Fall back to reading when
+     * mapping fails (e.g. for files on some network file systems). */
+    mmap_file = BLI_mmap_open(file);
+    BLI_lseek(file, 0, SEEK_SET);
+
+    if (mmap_file != NULL) {
+      read_fn = fd_read_from_mmap;
+      seek_fn = fd_seek_from_mmap;
+    }
+    else {
+      read_fn = fd_read_data_from_file;
+      seek_fn = fd_seek_data_from_file;
+    }
   }
 
   /* Gzip file. */
@@ -1333,6 +1926,20 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
     file = -1;
   }
 
+  /* Zstd file. */
+  if ((read_fn == NULL) && zstd_is_magic(header)) {
+    zstd = zstd_filedata_new();
+    if (zstd_read_seek_table(zstd, file)) {
+      read_fn = fd_read_zstd_seekable;
+      seek_fn = fd_seek_zstd_seekable;
+    }
+    else {
+      zstd_stream_init(zstd, NULL, 0);
+      read_fn = fd_read_zstd_stream;
+    }
+    BLI_lseek(file, 0, SEEK_SET);
+  }
+
   if (read_fn == NULL) {
     BKE_reportf(reports, RPT_WARNING, "Unrecognized file format '%s'", filepath);
     return NULL;
@@ -1342,6 +1949,11 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+  fd->zstd = zstd;
+  fd->mmap_file = mmap_file;
+  if (mmap_file != NULL) {
+    fd->buffersize = BLI_mmap_get_length(mmap_file);
+  }
 
   fd->read = read_fn;
   fd->seek = seek_fn;
@@ -1463,6 +2075,11 @@ FileData *blo_filedata_from_memory(const void *mem, int memsize, ReportList *rep
       return NULL;
     }
   }
+  else if (zstd_is_magic(cp)) {
+    fd->zstd = zstd_filedata_new();
+    zstd_stream_init(fd->zstd, mem, (size_t)memsize);
+    fd->read = fd_read_zstd_stream;
+  }
   else {
     fd->read = fd_read_from_memory;
   }
@@ -1481,6 +2098,9 @@ FileData *blo_filedata_from_memfile(MemFile *memfile,
     return NULL;
   }
 
+  /* Cold undo steps may be compressed. */
+  BLO_memfile_decompress(memfile);
+
   FileData *fd = filedata_new();
   fd->memfile = memfile;
   fd->undo_direction = params->undo_direction;
@@ -1508,6 +2128,17 @@ void blo_filedata_free(FileData *fd)
       }
     }
 
+    if (fd->zstd != NULL) {
+      zstd_filedata_free(fd->zstd);
+    }
+
+    if (fd->deferred_source != NULL) {
+      deferred_source_release(fd->deferred_source);
+    }
+    else if (fd->mmap_file != NULL) {
+      BLI_mmap_free(fd->mmap_file);
+    }
+
     if (fd->buffer && !(fd->flags & FD_FLAGS_NOT_MY_BUFFER)) {
       MEM_freeN((void *)fd->buffer);
       fd->buffer = NULL;
@@ -1700,16 +2331,31 @@ BlendThumbnail *BLO_thumbnail_from_file(const char *filepath)
 /** \name Old/New Pointer Map
  * \{ */
 
-/* only direct databocks */
-static void *newdataadr(FileData *fd, const void *adr)
+/* Direct data, reading it when it was deferred. */
+static void *datamap_lookup_and_inc(FileData *fd,
+                                    OldNewMap *datamap,
+                                    const void *adr,
+                                    bool increase_users)
 {
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, true);
+  OldNew *entry = oldnewmap_lookup_entry(datamap, adr);
+  if (entry == NULL) {
+    return NULL;
+  }
+  if (entry->nr == OLDNEW_DEFERRED) {
+    /* Needed while reading after all. */
+    entry->newp = read_struct(fd, entry->newp, "Deferred data");
+    entry->nr = 0;
+  }
+  if (increase_users) {
+    entry->nr++;
+  }
+  return entry->newp;
 }
 
 /* only direct databocks */
-static void *newdataadr_no_us(FileData *fd, const void *adr)
+static void *newdataadr(FileData *fd, const void *adr)
 {
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, false);
+  return datamap_lookup_and_inc(fd, fd->datamap, adr, true);
 }
 
 /* direct datablocks with global linking */
@@ -1725,7 +2371,7 @@ static void *newpackedadr(FileData *fd, const void *adr)
     return oldnewmap_lookup_and_inc(fd->packedmap, adr, true);
   }
 
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, true);
+  return datamap_lookup_and_inc(fd, fd->datamap, adr, true);
 }
 
 /* only lib data */
@@ -2093,16 +2739,22 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 
     if (fd->compflags[bh->SDNAnr] != SDNA_CMP_REMOVED) {
       if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
+        const void *data = (bh + 1);
 #ifdef USE_BHEAD_READ_ON_DEMAND
         if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
-          bh = blo_bhead_read_full(fd, bh);
-          if (UNLIKELY(bh == NULL)) {
-            fd->flags &= ~FD_FLAGS_FILE_OK;
-            return NULL;
+          /* Reconstruct from the mapped file, instead of reading a temporary copy first. */
+          data = blo_bhead_data_mapped(fd, bh);
+          if (data == NULL) {
+            bh = blo_bhead_read_full(fd, bh);
+            if (UNLIKELY(bh == NULL)) {
+              fd->flags &= ~FD_FLAGS_FILE_OK;
+              return NULL;
+            }
+            data = (bh + 1);
           }
         }
 #endif
-        temp = DNA_struct_reconstruct(fd->reconstruct_info, bh->SDNAnr, bh->nr, (bh + 1));
+        temp = DNA_struct_reconstruct(fd->reconstruct_info, bh->SDNAnr, bh->nr, data);
       }
       else {
         /* SDNA_CMP_EQUAL */
@@ -3009,7 +3661,7 @@ static void direct_link_library(FileData *fd, Library *lib, Main *main)
   //  printf("direct_link_library: filepath %s\n", lib->filepath);
   //  printf("direct_link_library: filepath_abs %s\n", lib->filepath_abs);
 
-  BlendDataReader reader = {fd};
+  BlendDataReader reader = {fd, fd->datamap};
   BKE_packedfile_blend_read(&reader, &lib->packedfile);
 
   /* new main */
@@ -3182,9 +3834,10 @@ static const char *dataname(short id_code)
   return "Data from Lib Block";
 }
 
-static bool direct_link_id(FileData *fd, Main *main, const int tag, ID *id, ID *id_old)
+static bool direct_link_id(
+    FileData *fd, OldNewMap *datamap, Main *main, const int tag, ID *id, ID *id_old)
 {
-  BlendDataReader reader = {fd};
+  BlendDataReader reader = {fd, datamap};
 
   /* Read part of datablock that is common between real and embedded datablocks. */
   direct_link_id_common(&reader, main->curlib, id, id_old, tag);
@@ -3226,7 +3879,10 @@ static bool direct_link_id(FileData *fd, Main *main, const int tag, ID *id, ID *
 }
 
 /* Read all data associated with a datablock into datamap. */
-static BHead *read_data_into_datamap(FileData *fd, BHead *bhead, const char *allocname)
+static BHead *read_data_into_datamap(FileData *fd,
+                                     OldNewMap *datamap,
+                                     BHead *bhead,
+                                     const char *allocname)
 {
   bhead = blo_bhead_next(fd, bhead);
 
@@ -3247,9 +3903,15 @@ static BHead *read_data_into_datamap(FileData *fd, BHead *bhead, const char *all
     }
 #endif
 
+    if (blo_bhead_use_deferred(fd, bhead)) {
+      oldnewmap_insert(datamap, bhead->old, bhead, OLDNEW_DEFERRED);
+      bhead = blo_bhead_next(fd, bhead);
+      continue;
+    }
+
     void *data = read_struct(fd, bhead, allocname);
     if (data) {
-      oldnewmap_insert(fd->datamap, bhead->old, data, 0);
+      oldnewmap_insert(datamap, bhead->old, data, 0);
     }
 
     bhead = blo_bhead_next(fd, bhead);
@@ -3494,19 +4156,32 @@ static bool read_libblock_undo_restore(
   return false;
 }
 
+/* Datablock of which reading the direct data was deferred, see #read_libblocks_data. */
+typedef struct LibblockDataTask {
+  struct LibblockDataTask *next, *prev;
+  Main *main;
+  BHead *bhead;
+  ID *id;
+  int id_tag;
+} LibblockDataTask;
+
 /* This routine reads a datablock and its direct data, and advances bhead to
  * the next datablock. For library linked datablocks, only a placeholder will
  * be generated, to be replaced in read_library_linked_ids.
  *
  * When reading for undo, libraries, linked datablocks and unchanged datablocks
  * will be restored from the old database. Only new or changed datablocks will
- * actually be read. */
-static BHead *read_libblock(FileData *fd,
-                            Main *main,
-                            BHead *bhead,
-                            const int tag,
-                            const bool placeholder_set_indirect_extern,
-                            ID **r_id)
+ * actually be read.
+ *
+ * When r_data_tasks is given, reading the direct data of datablocks that support it is
+ * deferred, and a task for it is added to the list instead. */
+static BHead *read_libblock_ex(FileData *fd,
+                               Main *main,
+                               BHead *bhead,
+                               const int tag,
+                               const bool placeholder_set_indirect_extern,
+                               ListBase *r_data_tasks,
+                               ID **r_id)
 {
   /* First attempt to restore existing datablocks for undo.
    * When datablocks are changed but still exist, we restore them at the old
@@ -3574,15 +4249,32 @@ static BHead *read_libblock(FileData *fd,
       }
     }
 
-    direct_link_id(fd, main, id_tag, id, id_old);
+    direct_link_id(fd, fd->datamap, main, id_tag, id, id_old);
     return blo_bhead_next(fd, bhead);
   }
 
+  if (r_data_tasks != NULL && id_old == NULL &&
+      (BKE_idtype_get_info_from_idcode(idcode)->flags & IDTYPE_FLAGS_THREADED_READ_DATA)) {
+    LibblockDataTask *task = MEM_mallocN(sizeof(*task), __func__);
+    task->main = main;
+    task->bhead = bhead;
+    task->id = id;
+    task->id_tag = id_tag;
+    BLI_addtail(r_data_tasks, task);
+
+    /* Only index the direct data for now, it is all read at once later. */
+    bhead = blo_bhead_next(fd, bhead);
+    while (bhead && bhead->code == DATA) {
+      bhead = blo_bhead_next(fd, bhead);
+    }
+    return bhead;
+  }
+
   /* Read datablock contents.
    * Use convenient malloc name for debugging and better memory link prints. */
   const char *allocname = dataname(idcode);
-  bhead = read_data_into_datamap(fd, bhead, allocname);
-  const bool success = direct_link_id(fd, main, id_tag, id, id_old);
+  bhead = read_data_into_datamap(fd, fd->datamap, bhead, allocname);
+  const bool success = direct_link_id(fd, fd->datamap, main, id_tag, id, id_old);
   oldnewmap_clear(fd->datamap);
 
   if (!success) {
@@ -3603,6 +4295,81 @@ static BHead *read_libblock(FileData *fd,
   return bhead;
 }
 
+static BHead *read_libblock(FileData *fd,
+                            Main *main,
+                            BHead *bhead,
+                            const int tag,
+                            const bool placeholder_set_indirect_extern,
+                            ID **r_id)
+{
+  return read_libblock_ex(fd, main, bhead, tag, placeholder_set_indirect_extern, NULL, r_id);
+}
+
+static void read_libblocks_data_cb(void *__restrict userdata,
+                                   void *item,
+                                   int UNUSED(index),
+                                   const TaskParallelTLS *__restrict tls)
+{
+  FileData *fd = userdata;
+  LibblockDataTask *task = item;
+  OldNewMap **datamap_p = tls->userdata_chunk;
+  if (*datamap_p == NULL) {
+    *datamap_p = oldnewmap_new();
+  }
+  OldNewMap *datamap = *datamap_p;
+
+  const char *allocname = dataname(GS(task->id->name));
+  read_data_into_datamap(fd, datamap, task->bhead, allocname);
+  const bool success = direct_link_id(fd, datamap, task->main, task->id_tag, task->id, NULL);
+  BLI_assert(success);
+  UNUSED_VARS_NDEBUG(success);
+  oldnewmap_clear(datamap);
+}
+
+static void read_libblocks_data_free(const void *__restrict UNUSED(userdata),
+                                     void *__restrict chunk)
+{
+  OldNewMap **datamap_p = chunk;
+  if (*datamap_p != NULL) {
+    oldnewmap_free(*datamap_p);
+  }
+}
+
+/**
+ * Read the direct data of datablocks for which it was deferred by #read_libblock_ex.
+ * Once all datablocks are indexed, this only reads blocks and reconstructs their structs without
+ * changing the state of the #FileData, so datablocks are read in parallel, each with their own
+ * map of data addresses.
+ */
+static void read_libblocks_data(FileData *fd, ListBase *data_tasks)
+{
+  OldNewMap *datamap = NULL;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.userdata_chunk = &datamap;
+  settings.userdata_chunk_size = sizeof(datamap);
+  settings.func_free = read_libblocks_data_free;
+  BLI_task_parallel_listbase(data_tasks, fd, read_libblocks_data_cb, &settings);
+
+  /* Without threads the loop uses the chunk passed in directly, while #func_free is only called
+   * for a copy made before the loop ran. */
+  if (datamap != NULL) {
+    oldnewmap_free(datamap);
+  }
+
+  BLI_freelistN(data_tasks);
+}
+
+/* Whether the direct data of datablocks can be read by #read_libblocks_data. */
+static bool read_libblocks_data_use_threading(FileData *fd)
+{
+  /* Undo restores datablocks in place and is expected to be fast already. Reading data on demand
+   * seeks in the file, which is only possible from multiple threads when it is memory-mapped. */
+  return (fd->memfile == NULL) && (fd->skip_flags & BLO_READ_SKIP_DATA) == 0 &&
+         (fd->seek == NULL || fd->mmap_file != NULL);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -3852,9 +4619,9 @@ static BHead *read_userdef(BlendFileData *bfd, FileData *fd, BHead *bhead)
   user->subversionfile = bfd->main->subversionfile;
 
   /* read all data into fd->datamap */
-  bhead = read_data_into_datamap(fd, bhead, "user def");
+  bhead = read_data_into_datamap(fd, fd->datamap, bhead, "user def");
 
-  BlendDataReader reader_ = {fd};
+  BlendDataReader reader_ = {fd, fd->datamap};
   BlendDataReader *reader = &reader_;
 
   BLO_read_list(reader, &user->themes);
@@ -3979,6 +4746,12 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  deferred_source_init(fd);
+
+  /* Datablocks of which the direct data is read in parallel, once all datablocks are known. */
+  ListBase data_tasks = {NULL, NULL};
+  ListBase *r_data_tasks = read_libblocks_data_use_threading(fd) ? &data_tasks : NULL;
+
   while (bhead) {
     switch (bhead->code) {
       case DATA:
@@ -4025,11 +4798,23 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
           bhead = blo_bhead_next(fd, bhead);
         }
         else {
-          bhead = read_libblock(fd, bfd->main, bhead, LIB_TAG_LOCAL, false, NULL);
+          bhead = read_libblock_ex(
+              fd, bfd->main, bhead, LIB_TAG_LOCAL, false, r_data_tasks, NULL);
         }
     }
   }
 
+  if (!BLI_listbase_is_empty(&data_tasks)) {
+    read_libblocks_data(fd, &data_tasks);
+  }
+
+  if (fd->mmap_file != NULL && BLI_mmap_any_io_error(fd->mmap_file)) {
+    BKE_reportf(fd->reports,
+                RPT_ERROR,
+                "Error reading blend file '%s', it may have been modified while loading",
+                fd->relabase);
+  }
+
   /* do before read_libraries, but skip undo case */
   if (fd->memfile == NULL) {
     if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
@@ -4239,13 +5024,63 @@ static BHead *find_bhead_from_idname(FileData *fd, const char *idname)
 #endif
 }
 
+static void expand_idname_map_free(void *idname_map)
+{
+  BLI_ghash_free(idname_map, NULL, NULL);
+}
+
+/* Map from names to IDs in mainvar, only available while expanding. */
+static GHash *expand_idname_map_ensure(FileData *fd, Main *mainvar)
+{
+  if (fd->expand_idname_maps == NULL) {
+    return NULL;
+  }
+
+  void **idname_map_p;
+  if (!BLI_ghash_ensure_p(fd->expand_idname_maps, mainvar, &idname_map_p)) {
+    GHash *idname_map = BLI_ghash_str_new(__func__);
+    ListBase *lbarray[MAX_LIBARRAY];
+    int a = set_listbasepointers(mainvar, lbarray);
+    while (a--) {
+      LISTBASE_FOREACH (ID *, id, lbarray[a]) {
+        /* Keep the first ID with a name, like #BLI_findstring. */
+        void **id_p;
+        if (!BLI_ghash_ensure_p(idname_map, id->name, &id_p)) {
+          *id_p = id;
+        }
+      }
+    }
+    *idname_map_p = idname_map;
+  }
+  return *idname_map_p;
+}
+
 static ID *is_yet_read(FileData *fd, Main *mainvar, BHead *bhead)
 {
   const char *idname = blo_bhead_id_name(fd, bhead);
+
+  /* Expanding the data of many linked IDs looks up a lot of names, avoid scanning all IDs. */
+  GHash *idname_map = expand_idname_map_ensure(fd, mainvar);
+  if (idname_map != NULL) {
+    return BLI_ghash_lookup(idname_map, idname);
+  }
+
   /* which_libbase can be NULL, intentionally not using idname+2 */
   return BLI_findstring(which_libbase(mainvar, GS(idname)), idname, offsetof(ID, name));
 }
 
+/* Read a datablock found while expanding, keeping the map of names up to date. */
+static void read_libblock_for_expand(FileData *fd, Main *mainvar, BHead *bhead, const int tag)
+{
+  ID *id;
+  read_libblock(fd, mainvar, bhead, tag, false, &id);
+
+  GHash *idname_map = expand_idname_map_ensure(fd, mainvar);
+  if (id != NULL && idname_map != NULL) {
+    BLI_ghash_reinsert(idname_map, id->name, id, NULL, NULL);
+  }
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -4287,7 +5122,7 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
     if (id == NULL) {
       /* ID has not been read yet, add placeholder to the main of the
        * library it belongs to, so that it will be read later. */
-      read_libblock(fd, libmain, bhead, LIB_TAG_INDIRECT, false, NULL);
+      read_libblock_for_expand(fd, libmain, bhead, LIB_TAG_INDIRECT);
       /* commented because this can print way too much */
       // if (G.debug & G_DEBUG) printf("expand_doit: other lib %s\n", lib->filepath);
 
@@ -4342,7 +5177,7 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
 
     ID *id = is_yet_read(fd, mainvar, bhead);
     if (id == NULL) {
-      read_libblock(fd, mainvar, bhead, LIB_TAG_NEED_EXPAND | LIB_TAG_INDIRECT, false, NULL);
+      read_libblock_for_expand(fd, mainvar, bhead, LIB_TAG_NEED_EXPAND | LIB_TAG_INDIRECT);
     }
     else {
       /* Convert any previously read weak link to regular link
@@ -4427,6 +5262,12 @@ void BLO_expand_main(void *fdhandle, Main *mainvar)
 
   BlendExpander expander = {fd, mainvar};
 
+  /* The file data is NULL when expanding for partial writes. */
+  if (fd != NULL) {
+    BLI_assert(fd->expand_idname_maps == NULL);
+    fd->expand_idname_maps = BLI_ghash_ptr_new(__func__);
+  }
+
   while (do_it) {
     do_it = false;
 
@@ -4449,6 +5290,11 @@ void BLO_expand_main(void *fdhandle, Main *mainvar)
       }
     }
   }
+
+  if (fd != NULL) {
+    BLI_ghash_free(fd->expand_idname_maps, NULL, expand_idname_map_free);
+    fd->expand_idname_maps = NULL;
+  }
 }
 
 /** \} */
@@ -5250,6 +6096,7 @@ static FileData *read_library_file_data(FileData *basefd,
                      TIP_("Read packed library:  '%s', parent '%s'"),
                      mainptr->curlib->filepath,
                      library_parent_filepath(mainptr->curlib));
+    BKE_packedfile_data_ensure(pf);
     fd = blo_filedata_from_memory(pf->data, pf->size, basefd->reports);
 
     /* Needed for library_append and read_libraries. */
@@ -5398,17 +6245,32 @@ static void read_libraries(FileData *basefd, ListBase *mainlist)
 
 void *BLO_read_get_new_data_address(BlendDataReader *reader, const void *old_address)
 {
-  return newdataadr(reader->fd, old_address);
+  return datamap_lookup_and_inc(reader->fd, reader->datamap, old_address, true);
 }
 
 void *BLO_read_get_new_data_address_no_us(BlendDataReader *reader, const void *old_address)
 {
-  return newdataadr_no_us(reader->fd, old_address);
+  return datamap_lookup_and_inc(reader->fd, reader->datamap, old_address, false);
 }
 
 void *BLO_read_get_new_packed_address(BlendDataReader *reader, const void *old_address)
 {
-  return newpackedadr(reader->fd, old_address);
+  if (reader->fd->packedmap && old_address) {
+    return newpackedadr(reader->fd, old_address);
+  }
+  return datamap_lookup_and_inc(reader->fd, reader->datamap, old_address, true);
+}
+
+BlendDeferredData *BLO_read_get_deferred_data(BlendDataReader *reader, const void *old_address)
+{
+  if (old_address == NULL) {
+    return NULL;
+  }
+  OldNew *entry = oldnewmap_lookup_entry(reader->datamap, old_address);
+  if (entry == NULL || entry->nr != OLDNEW_DEFERRED) {
+    return NULL;
+  }
+  return deferred_data_new(reader->fd, entry->newp);
 }
 
 ID *BLO_read_get_new_id_address(BlendLibReader *reader, Library *lib, ID *id)
@@ -5527,7 +6389,7 @@ void BLO_read_pointer_array(BlendDataReader *reader, void **ptr_p)
 {
   FileData *fd = reader->fd;
 
-  void *orig_array = newdataadr(fd, *ptr_p);
+  void *orig_array = BLO_read_get_new_data_address(reader, *ptr_p);
   if (orig_array == NULL) {
     *ptr_p = NULL;
     return;
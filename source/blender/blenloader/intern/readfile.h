@@ -33,7 +33,9 @@
 #include "DNA_windowmanager_types.h" /* for ReportType */
 #include "zlib.h"
 
+struct BLI_mmap_file;
 struct BLOCacheStorage;
+struct FileDataZstd;
 struct GSet;
 struct IDNameLib_Map;
 struct Key;
@@ -85,6 +87,10 @@ typedef struct FileData {
 
   /** Regular file reading. */
   int filedes;
+  /** Memory-mapped uncompressed file, when mapping it succeeded. */
+  struct BLI_mmap_file *mmap_file;
+  /** Owns the mapped file when data is left in it, see #BLO_READ_DEFER_PACKED_DATA. */
+  struct BlendDeferredSource *deferred_source;
 
   /** Variables needed for reading from memory / stream. */
   const char *buffer;
@@ -98,6 +104,8 @@ typedef struct FileData {
   gzFile gzfiledes;
   /** Gzip stream for memory decompression. */
   z_stream strm;
+  /** Zstd decompression, for files and memory. */
+  struct FileDataZstd *zstd;
 
   /** Now only in use for library appending. */
   char relabase[FILE_MAX];
@@ -129,6 +137,8 @@ typedef struct FileData {
 
   /** See: #USE_GHASH_BHEAD. */
   struct GHash *bhead_idname_hash;
+  /** IDs in the Main databases being expanded, by name, see #BLO_expand_main. */
+  struct GHash *expand_idname_maps;
 
   ListBase *mainlist;
   /** Used for undo. */
@@ -36,12 +36,16 @@
 #  include <io.h>
 #endif
 
+#include <zstd.h>
+
 #include "MEM_guardedalloc.h"
 
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
 #include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_threads.h"
 
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
@@ -52,6 +56,151 @@
 /* keep last */
 #include "BLI_strict_flags.h"
 
+/* -------------------------------------------------------------------- */
+/** \name Shared Chunk Buffers
+ *
+ * The memory of all chunks is stored in a pool addressed by content,
+ * so data is only stored once no matter which undo step or position in the file it comes from.
+ * \{ */
+
+/** Chunks smaller than this aren't worth compressing. */
+#define MEMFILE_COMPRESS_MIN_SIZE 4096
+/** Favor speed, compression runs when pushing undo steps. */
+#define MEMFILE_COMPRESS_LEVEL 1
+
+typedef struct MemFileBuffer {
+  /** NULL while compressed. */
+  const char *buf;
+  size_t size;
+  uint hash;
+  /** Number of #MemFileChunk using this buffer. */
+  uint users;
+  /**
+   * The memfile whose #MemFile.size includes this buffer, so shared data is only counted once.
+   * NULL when the owner has been freed, the next memfile using the buffer takes it over.
+   */
+  MemFile *owner;
+  /** The buffer can be found in #g_memfile_buffers (not the case when compressed). */
+  bool in_pool;
+  /** Only set when the buffer isn't shared with other chunks. */
+  void *compressed_buf;
+  size_t compressed_size;
+} MemFileBuffer;
+
+static struct {
+  GSet *buffers;
+  ThreadMutex mutex;
+} g_memfile_buffers = {NULL, BLI_MUTEX_INITIALIZER};
+
+static uint memfile_buffer_hash(const void *key)
+{
+  return ((const MemFileBuffer *)key)->hash;
+}
+
+static bool memfile_buffer_cmp(const void *a, const void *b)
+{
+  const MemFileBuffer *buffer_a = a, *buffer_b = b;
+  return !((buffer_a->hash == buffer_b->hash) && (buffer_a->size == buffer_b->size) &&
+           (memcmp(buffer_a->buf, buffer_b->buf, buffer_a->size) == 0));
+}
+
+/* Lock #g_memfile_buffers.mutex before calling. */
+static GSet *memfile_buffers_ensure(void)
+{
+  if (g_memfile_buffers.buffers == NULL) {
+    g_memfile_buffers.buffers = BLI_gset_new(memfile_buffer_hash, memfile_buffer_cmp, __func__);
+  }
+  return g_memfile_buffers.buffers;
+}
+
+/** Memory used by the buffer data, compressed or not. */
+static size_t memfile_buffer_stored_size(const MemFileBuffer *buffer)
+{
+  return (buffer->buf != NULL) ? buffer->size : buffer->compressed_size;
+}
+
+/* Lock #g_memfile_buffers.mutex before calling. */
+static void memfile_buffer_owner_ensure(MemFileBuffer *buffer, MemFile *memfile)
+{
+  if (buffer->owner == NULL) {
+    buffer->owner = memfile;
+    memfile->size += memfile_buffer_stored_size(buffer);
+  }
+}
+
+/**
+ * \return A buffer holding a copy of \a buf, shared with existing chunks with the same content.
+ */
+static MemFileBuffer *memfile_buffer_acquire(MemFile *memfile, const char *buf, size_t size)
+{
+  MemFileBuffer key = {
+      .buf = buf,
+      .size = size,
+      .hash = BLI_hash_mm2((const uchar *)buf, size, 0),
+  };
+
+  BLI_mutex_lock(&g_memfile_buffers.mutex);
+
+  MemFileBuffer *buffer = BLI_gset_lookup(memfile_buffers_ensure(), &key);
+  if (buffer != NULL) {
+    buffer->users++;
+  }
+  else {
+    char *buf_new = MEM_mallocN(size, "Chunk buffer");
+    memcpy(buf_new, buf, size);
+
+    buffer = MEM_mallocN(sizeof(*buffer), __func__);
+    *buffer = key;
+    buffer->buf = buf_new;
+    buffer->users = 1;
+    buffer->in_pool = true;
+    BLI_gset_insert(g_memfile_buffers.buffers, buffer);
+  }
+  memfile_buffer_owner_ensure(buffer, memfile);
+
+  BLI_mutex_unlock(&g_memfile_buffers.mutex);
+
+  return buffer;
+}
+
+static void memfile_buffer_user_add(MemFile *memfile, MemFileBuffer *buffer)
+{
+  BLI_mutex_lock(&g_memfile_buffers.mutex);
+  buffer->users++;
+  memfile_buffer_owner_ensure(buffer, memfile);
+  BLI_mutex_unlock(&g_memfile_buffers.mutex);
+}
+
+static void memfile_buffer_release(MemFile *memfile, MemFileBuffer *buffer)
+{
+  BLI_mutex_lock(&g_memfile_buffers.mutex);
+
+  BLI_assert(buffer->users > 0);
+  if (buffer->owner == memfile) {
+    buffer->owner = NULL;
+  }
+  if (--buffer->users == 0) {
+    if (buffer->in_pool) {
+      BLI_gset_remove(g_memfile_buffers.buffers, buffer, NULL);
+    }
+    if (buffer->buf) {
+      MEM_freeN((void *)buffer->buf);
+    }
+    MEM_SAFE_FREE(buffer->compressed_buf);
+    MEM_freeN(buffer);
+
+    /* Don't keep the pool around when all undo steps are freed. */
+    if (g_memfile_buffers.buffers && (BLI_gset_len(g_memfile_buffers.buffers) == 0)) {
+      BLI_gset_free(g_memfile_buffers.buffers, NULL);
+      g_memfile_buffers.buffers = NULL;
+    }
+  }
+
+  BLI_mutex_unlock(&g_memfile_buffers.mutex);
+}
+
+/** \} */
+
 /* **************** support for memory-write, for undo buffers *************** */
 
 /* not memfile itself */
@@ -60,47 +209,52 @@ void BLO_memfile_free(MemFile *memfile)
   MemFileChunk *chunk;
 
   while ((chunk = BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    memfile_buffer_release(memfile, chunk->buffer);
     MEM_freeN(chunk);
   }
   memfile->size = 0;
+
+  LISTBASE_FOREACH (LinkData *, link, &memfile->deferred_data) {
+    BLO_deferred_data_free(link->data);
+  }
+  BLI_freelistN(&memfile->deferred_data);
 }
 
 /* to keep list of memfiles consistent, 'first' is always first in list */
 /* result is that 'first' is being freed */
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-  /* We use this mapping to store the memory buffers from second memfile chunks which are not owned
-   * by it (i.e. shared with some previous memory steps). */
-  GHash *buffer_to_second_memchunk = BLI_ghash_new(
-      BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, __func__);
-
-  /* First, detect all memchunks in second memfile that are not owned by it. */
-  for (MemFileChunk *sc = second->chunks.first; sc != NULL; sc = sc->next) {
-    if (sc->is_identical) {
-      BLI_ghash_insert(buffer_to_second_memchunk, (void *)sc->buf, sc);
+  /* Buffers are reference counted, only their size accounting moves to the second memfile.
+   * Chunks of the second memfile identical to chunks that changed in the first one (the one we
+   * are removing) did change compared to the step before the first one, which is now the previous
+   * step. */
+  GSet *changed_first_buffers = BLI_gset_ptr_new(__func__);
+
+  LISTBASE_FOREACH (MemFileChunk *, fc, &first->chunks) {
+    if (!fc->is_identical) {
+      BLI_gset_add(changed_first_buffers, fc->buffer);
     }
   }
 
-  /* Now, check all chunks from first memfile (the one we are removing), and if a memchunk owned by
-   * it is also used by the second memfile, transfer the ownership. */
-  for (MemFileChunk *fc = first->chunks.first; fc != NULL; fc = fc->next) {
-    if (!fc->is_identical) {
-      MemFileChunk *sc = BLI_ghash_lookup(buffer_to_second_memchunk, fc->buf);
-      if (sc != NULL) {
-        BLI_assert(sc->is_identical);
-        sc->is_identical = false;
-        fc->is_identical = true;
-      }
-      /* Note that if the second memfile does not use that chunk, we assume that the first one
-       * fully owns it without sharing it with any other memfile, and hence it should be freed with
-       * it. */
+  LISTBASE_FOREACH (MemFileChunk *, sc, &second->chunks) {
+    if (sc->is_identical && BLI_gset_haskey(changed_first_buffers, sc->buffer)) {
+      sc->is_identical = false;
     }
   }
 
-  BLI_ghash_free(buffer_to_second_memchunk, NULL, NULL);
+  BLI_gset_free(changed_first_buffers, NULL);
+
+  /* Data stored by the first memfile and still used by the second is now counted there. */
+  BLI_mutex_lock(&g_memfile_buffers.mutex);
+  LISTBASE_FOREACH (MemFileChunk *, sc, &second->chunks) {
+    MemFileBuffer *buffer = sc->buffer;
+    if (buffer->owner == first) {
+      buffer->owner = second;
+      first->size -= memfile_buffer_stored_size(buffer);
+      second->size += memfile_buffer_stored_size(buffer);
+    }
+  }
+  BLI_mutex_unlock(&g_memfile_buffers.mutex);
 
   BLO_memfile_free(first);
 }
@@ -113,6 +267,86 @@ void BLO_memfile_clear_future(MemFile *memfile)
   }
 }
 
+/**
+ * Compress the chunks that are only used by \a memfile (the data that changed in this step),
+ * for undo steps that are unlikely to be read soon.
+ * The data is decompressed by #BLO_memfile_decompress before the memfile is read.
+ */
+void BLO_memfile_compress(MemFile *memfile)
+{
+  BLI_mutex_lock(&g_memfile_buffers.mutex);
+
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    MemFileBuffer *buffer = chunk->buffer;
+    if ((buffer->users != 1) || (buffer->buf == NULL) ||
+        (buffer->size < MEMFILE_COMPRESS_MIN_SIZE)) {
+      continue;
+    }
+
+    const size_t bound = ZSTD_compressBound(buffer->size);
+    void *compressed_buf = MEM_mallocN(bound, "Chunk buffer compressed");
+    const size_t compressed_size = ZSTD_compress(
+        compressed_buf, bound, buffer->buf, buffer->size, MEMFILE_COMPRESS_LEVEL);
+
+    /* Keep data that doesn't compress well as-is, it's cheaper to read. */
+    if (ZSTD_isError(compressed_size) || (compressed_size > (buffer->size / 4) * 3)) {
+      MEM_freeN(compressed_buf);
+      continue;
+    }
+
+    if (buffer->in_pool) {
+      BLI_gset_remove(g_memfile_buffers.buffers, buffer, NULL);
+      buffer->in_pool = false;
+    }
+    MEM_freeN((void *)buffer->buf);
+    buffer->buf = NULL;
+    buffer->compressed_buf = MEM_reallocN(compressed_buf, compressed_size);
+    buffer->compressed_size = compressed_size;
+
+    chunk->buf = NULL;
+    if (buffer->owner == memfile) {
+      memfile->size -= buffer->size - compressed_size;
+    }
+    memfile_buffer_owner_ensure(buffer, memfile);
+  }
+
+  BLI_mutex_unlock(&g_memfile_buffers.mutex);
+}
+
+void BLO_memfile_decompress(MemFile *memfile)
+{
+  BLI_mutex_lock(&g_memfile_buffers.mutex);
+
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    MemFileBuffer *buffer = chunk->buffer;
+    if (buffer->buf != NULL) {
+      continue;
+    }
+
+    char *buf = MEM_mallocN(buffer->size, "Chunk buffer");
+    const size_t size = ZSTD_decompress(
+        buf, buffer->size, buffer->compressed_buf, buffer->compressed_size);
+    BLI_assert(size == buffer->size);
+    UNUSED_VARS_NDEBUG(size);
+
+    if (buffer->owner == memfile) {
+      memfile->size += buffer->size - buffer->compressed_size;
+    }
+    MEM_freeN(buffer->compressed_buf);
+    buffer->compressed_buf = NULL;
+    buffer->compressed_size = 0;
+    buffer->buf = buf;
+    memfile_buffer_owner_ensure(buffer, memfile);
+
+    /* Identical data may have been added to the pool in the meantime, keep that one then. */
+    buffer->in_pool = BLI_gset_add(memfile_buffers_ensure(), buffer);
+
+    chunk->buf = buf;
+  }
+
+  BLI_mutex_unlock(&g_memfile_buffers.mutex);
+}
+
 void BLO_memfile_write_init(MemFileWriteData *mem_data,
                             MemFile *written_memfile,
                             MemFile *reference_memfile)
@@ -162,6 +396,7 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   MemFileChunk *curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
   curchunk->size = size;
   curchunk->buf = NULL;
+  curchunk->buffer = NULL;
   curchunk->is_identical = false;
   /* This is unsafe in the sense that an app handler or other code that does not
    * perform an undo push may make changes after the last undo push that
@@ -173,9 +408,10 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   /* we compare compchunk with buf */
   if (*compchunk_step != NULL) {
     MemFileChunk *compchunk = *compchunk_step;
-    if (compchunk->size == curchunk->size) {
+    if ((compchunk->size == curchunk->size) && (compchunk->buf != NULL)) {
       if (memcmp(compchunk->buf, buf, size) == 0) {
-        curchunk->buf = compchunk->buf;
+        curchunk->buffer = compchunk->buffer;
+        memfile_buffer_user_add(memfile, curchunk->buffer);
         curchunk->is_identical = true;
         compchunk->is_identical_future = true;
       }
@@ -184,12 +420,11 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   }
 
   /* not equal... */
-  if (curchunk->buf == NULL) {
-    char *buf_new = MEM_mallocN(size, "Chunk buffer");
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+  if (curchunk->buffer == NULL) {
+    /* The data may still exist elsewhere (reordered or unchanged data of another step). */
+    curchunk->buffer = memfile_buffer_acquire(memfile, buf, size);
   }
+  curchunk->buf = curchunk->buffer->buf;
 }
 
 struct Main *BLO_memfile_main_get(struct MemFile *memfile,
@@ -218,19 +453,26 @@ struct Main *BLO_memfile_main_get(struct MemFile *memfile,
 /**
  * Saves .blend using undo buffer.
  *
- * \return success.
+ * \return success, false when the undo buffer references data left in the loaded .blend file,
+ * which isn't part of it (see #BLO_READ_DEFER_PACKED_DATA).
  */
 bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename)
 {
   MemFileChunk *chunk;
   int file, oflags;
 
+  if (!BLI_listbase_is_empty(&memfile->deferred_data)) {
+    return false;
+  }
+
   /* note: This is currently used for autosave and 'quit.blend',
    * where _not_ following symlinks is OK,
    * however if this is ever executed explicitly by the user,
    * we may want to allow writing to symlinks.
    */
 
+  BLO_memfile_decompress(memfile);
+
   oflags = O_BINARY | O_WRONLY | O_CREAT | O_TRUNC;
 #ifdef O_NOFOLLOW
   /* use O_NOFOLLOW to avoid writing to a symlink - use 'O_EXCL' (CVE-2008-1103) */
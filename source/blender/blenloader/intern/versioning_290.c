@@ -1243,5 +1243,14 @@ void blo_do_versions_290(FileData *fd, Library *UNUSED(lib), Main *bmain)
    */
   {
     /* Keep this block, even when empty. */
+
+    /* Compositor result cache, enabled for new trees by default. */
+    if (!DNA_struct_elem_find(fd->filesdna, "bNodeTree", "int", "cache_limit")) {
+      LISTBASE_FOREACH (Scene *, scene, &bmain->scenes) {
+        if (scene->nodetree != NULL) {
+          scene->nodetree->cache_limit = 1024;
+        }
+      }
+    }
   }
 }
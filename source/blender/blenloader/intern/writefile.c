@@ -99,7 +99,9 @@
 
 #include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
+#include "BLI_endian_switch.h"
 #include "BLI_mempool.h"
+#include "BLI_threads.h"
 #include "MEM_guardedalloc.h" /* MEM_freeN */
 
 #include "BKE_blender_version.h"
@@ -127,6 +129,8 @@
 
 #include <errno.h>
 
+#include <zstd.h>
+
 /* Make preferences read-only. */
 #define U (*((const UserDef *)&U))
 
@@ -136,6 +140,13 @@
 #define MYWRITE_BUFFER_SIZE (MEM_SIZE_OPTIMAL(1 << 17)) /* 128kb */
 #define MYWRITE_MAX_CHUNK (MEM_SIZE_OPTIMAL(1 << 15))   /* ~32kb */
 
+/* Compressed files are written in independent frames of this size, large enough to compress
+ * well while giving enough frames to keep all threads busy and to seek into when reading. */
+#define ZSTD_BUFFER_SIZE (1 << 21) /* 2mb */
+#define ZSTD_MAX_CHUNK (1 << 20)   /* 1mb */
+
+#define ZSTD_COMPRESSION_LEVEL 3
+
 /** Use if we want to store how many bytes have been written to the file. */
 // #define USE_WRITE_DATA_LEN
 
@@ -146,8 +157,18 @@
 typedef enum {
   WW_WRAP_NONE = 1,
   WW_WRAP_ZLIB,
+  WW_WRAP_ZSTD,
+  /** Keep the file in memory (see #BLO_write_file_snapshot). */
+  WW_WRAP_MEMFILE,
 } eWriteWrapType;
 
+typedef struct ZstdFrame {
+  struct ZstdFrame *next, *prev;
+
+  uint32_t compressed_size;
+  uint32_t uncompressed_size;
+} ZstdFrame;
+
 typedef struct WriteWrap WriteWrap;
 struct WriteWrap {
   /* callbacks */
@@ -157,12 +178,31 @@ struct WriteWrap {
 
   /* Buffer output (we only want when output isn't already buffered). */
   bool use_buf;
+  /* Size of the output buffer and of the chunks larger writes are split into. */
+  size_t buf_size;
+  size_t max_chunk;
 
   /* internal */
   union {
     int file_handle;
     gzFile gz_handle;
+    MemFileWriteData mem;
   } _user_data;
+
+  /* Zstd frames are compressed in a thread pool and written to #_user_data.file_handle in
+   * order, the frame sizes are kept to write the seek table at the end of the file. */
+  struct {
+    ListBase threadpool;
+    ListBase tasks;
+    ThreadMutex mutex;
+    ThreadCondition condition;
+    int next_frame;
+    int num_frames;
+
+    ListBase frames;
+
+    bool write_error;
+  } zstd;
 };
 
 /* none */
@@ -217,12 +257,190 @@ static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
+/* zstd */
+
+typedef struct ZstdWriteBlockTask {
+  struct ZstdWriteBlockTask *next, *prev;
+  void *data;
+  size_t size;
+  int frame_number;
+  WriteWrap *ww;
+} ZstdWriteBlockTask;
+
+static void *zstd_write_task(void *userdata)
+{
+  ZstdWriteBlockTask *task = userdata;
+  WriteWrap *ww = task->ww;
+
+  size_t out_buf_len = ZSTD_compressBound(task->size);
+  void *out_buf = MEM_mallocN(out_buf_len, "Zstd out buffer");
+  size_t out_size = ZSTD_compress(
+      out_buf, out_buf_len, task->data, task->size, ZSTD_COMPRESSION_LEVEL);
+
+  MEM_freeN(task->data);
+
+  BLI_mutex_lock(&ww->zstd.mutex);
+
+  /* Frames are compressed in any order, but must be written in the order they were added. */
+  while (ww->zstd.next_frame != task->frame_number) {
+    BLI_condition_wait(&ww->zstd.condition, &ww->zstd.mutex);
+  }
+
+  if (ZSTD_isError(out_size)) {
+    ww->zstd.write_error = true;
+  }
+  else {
+    if (ww_write_none(ww, out_buf, out_size) == out_size) {
+      ZstdFrame *frameinfo = MEM_mallocN(sizeof(ZstdFrame), "zstd frameinfo");
+      frameinfo->uncompressed_size = task->size;
+      frameinfo->compressed_size = out_size;
+      BLI_addtail(&ww->zstd.frames, frameinfo);
+    }
+    else {
+      ww->zstd.write_error = true;
+    }
+  }
+
+  ww->zstd.next_frame++;
+
+  BLI_mutex_unlock(&ww->zstd.mutex);
+  BLI_condition_notify_all(&ww->zstd.condition);
+
+  MEM_freeN(out_buf);
+  return NULL;
+}
+
+static bool ww_open_zstd(WriteWrap *ww, const char *filepath)
+{
+  if (!ww_open_none(ww, filepath)) {
+    return false;
+  }
+
+  /* Leave one thread for the main writing logic, unless there is only one. */
+  const int num_threads = MAX2(1, BLI_system_thread_count() - 1);
+  BLI_threadpool_init(&ww->zstd.threadpool, zstd_write_task, num_threads);
+  BLI_mutex_init(&ww->zstd.mutex);
+  BLI_condition_init(&ww->zstd.condition);
+
+  return true;
+}
+
+static void zstd_write_u32_le(WriteWrap *ww, uint32_t val)
+{
+#ifdef __BIG_ENDIAN__
+  BLI_endian_switch_uint32(&val);
+#endif
+  ww_write_none(ww, (char *)&val, sizeof(uint32_t));
+}
+
+/**
+ * Append a skippable frame with the size of all other frames, so the file can be decompressed
+ * in parallel and seeked into when reading. This follows the upstream seekable format:
+ * https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+ *
+ * Files without it (e.g. compressed with external tools) can still be read, but only
+ * sequentially.
+ */
+static void zstd_write_seekable_frames(WriteWrap *ww)
+{
+  /* Seek table header: skippable frame magic number and frame size. */
+  zstd_write_u32_le(ww, 0x184D2A5E);
+
+  /* Might not match #WriteWrap.zstd.num_frames if there was a write error. */
+  const uint32_t num_frames = BLI_listbase_count(&ww->zstd.frames);
+  /* Two u32 per frame, followed by a footer of two u32 and one byte. */
+  const uint32_t frame_size = num_frames * 8 + 9;
+  zstd_write_u32_le(ww, frame_size);
+
+  LISTBASE_FOREACH (ZstdFrame *, frame, &ww->zstd.frames) {
+    zstd_write_u32_le(ww, frame->compressed_size);
+    zstd_write_u32_le(ww, frame->uncompressed_size);
+  }
+
+  /* Seek table footer: number of frames, flags (no checksums) and the seekable magic number. */
+  zstd_write_u32_le(ww, num_frames);
+  const char flags = 0;
+  ww_write_none(ww, &flags, 1);
+  zstd_write_u32_le(ww, 0x8F92EAB1);
+}
+
+static bool ww_close_zstd(WriteWrap *ww)
+{
+  BLI_threadpool_end(&ww->zstd.threadpool);
+  BLI_freelistN(&ww->zstd.tasks);
+
+  BLI_mutex_end(&ww->zstd.mutex);
+  BLI_condition_end(&ww->zstd.condition);
+
+  zstd_write_seekable_frames(ww);
+  BLI_freelistN(&ww->zstd.frames);
+
+  return ww_close_none(ww) && !ww->zstd.write_error;
+}
+
+static size_t ww_write_zstd(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+  if (ww->zstd.write_error) {
+    return 0;
+  }
+
+  ZstdWriteBlockTask *task = MEM_mallocN(sizeof(ZstdWriteBlockTask), __func__);
+  task->data = MEM_mallocN(buf_len, __func__);
+  memcpy(task->data, buf, buf_len);
+  task->size = buf_len;
+  task->frame_number = ww->zstd.num_frames++;
+  task->ww = ww;
+
+  BLI_mutex_lock(&ww->zstd.mutex);
+  BLI_addtail(&ww->zstd.tasks, task);
+  ZstdWriteBlockTask *first_task = ww->zstd.tasks.first;
+  BLI_mutex_unlock(&ww->zstd.mutex);
+
+  /* Without a free thread, wait for the earliest task to finish. The mutex is released before
+   * joining the thread, which might still be waiting to write its frame. */
+  if (!BLI_available_threads(&ww->zstd.threadpool)) {
+    /* When the task list was empty before adding this task, a thread is always free. */
+    BLI_assert(first_task != task);
+    BLI_threadpool_remove(&ww->zstd.threadpool, first_task);
+
+    BLI_mutex_lock(&ww->zstd.mutex);
+    BLI_remlink(&ww->zstd.tasks, first_task);
+    BLI_mutex_unlock(&ww->zstd.mutex);
+    MEM_freeN(first_task);
+  }
+  BLI_threadpool_insert(&ww->zstd.threadpool, task);
+
+  return buf_len;
+}
+
+/* memfile */
+#define MEMFILE_DATA(ww) (ww)->_user_data.mem
+
+static bool ww_open_memfile(WriteWrap *ww, const char *UNUSED(filepath))
+{
+  return MEMFILE_DATA(ww).written_memfile != NULL;
+}
+static bool ww_close_memfile(WriteWrap *ww)
+{
+  BLO_memfile_write_finalize(&MEMFILE_DATA(ww));
+  return true;
+}
+static size_t ww_write_memfile(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+  BLO_memfile_chunk_add(&MEMFILE_DATA(ww), buf, buf_len);
+  return buf_len;
+}
+#undef MEMFILE_DATA
+
 /* --- end compression types --- */
 
 static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
 {
   memset(r_ww, 0, sizeof(*r_ww));
 
+  r_ww->buf_size = MYWRITE_BUFFER_SIZE;
+  r_ww->max_chunk = MYWRITE_MAX_CHUNK;
+
   switch (ww_type) {
     case WW_WRAP_ZLIB: {
       r_ww->open = ww_open_zlib;
@@ -231,6 +449,27 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
       r_ww->use_buf = false;
       break;
     }
+    case WW_WRAP_ZSTD: {
+      r_ww->open = ww_open_zstd;
+      r_ww->close = ww_close_zstd;
+      r_ww->write = ww_write_zstd;
+      /* Every write is compressed as a frame, buffer into frames of a useful size. */
+      r_ww->use_buf = true;
+      r_ww->buf_size = ZSTD_BUFFER_SIZE;
+      r_ww->max_chunk = ZSTD_MAX_CHUNK;
+      break;
+    }
+    case WW_WRAP_MEMFILE: {
+      r_ww->open = ww_open_memfile;
+      r_ww->close = ww_close_memfile;
+      r_ww->write = ww_write_memfile;
+      /* Chunks are written to disk one by one later on,
+       * use the compressed frame size so they are compressed equally well. */
+      r_ww->use_buf = true;
+      r_ww->buf_size = ZSTD_BUFFER_SIZE;
+      r_ww->max_chunk = ZSTD_MAX_CHUNK;
+      break;
+    }
     default: {
       r_ww->open = ww_open_none;
       r_ww->close = ww_close_none;
@@ -250,10 +489,13 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
 typedef struct {
   const struct SDNA *sdna;
 
-  /** Use for file and memory writing (fixed size of #MYWRITE_BUFFER_SIZE). */
+  /** Use for file and memory writing (#MYWRITE_BUFFER_SIZE, or the size of the wrapper). */
   uchar *buf;
   /** Number of bytes used in #WriteData.buf (flushed when exceeded). */
   size_t buf_used_len;
+  /** Size of #WriteData.buf, and of the chunks larger writes are split into. */
+  size_t buf_size;
+  size_t max_chunk;
 
 #ifdef USE_WRITE_DATA_LEN
   /** Total number of bytes written. */
@@ -288,8 +530,12 @@ static WriteData *writedata_new(WriteWrap *ww)
 
   wd->ww = ww;
 
+  /* Undo keeps the default, its chunk size affects de-duplication of unchanged data. */
+  wd->buf_size = (ww != NULL) ? ww->buf_size : MYWRITE_BUFFER_SIZE;
+  wd->max_chunk = (ww != NULL) ? ww->max_chunk : MYWRITE_MAX_CHUNK;
+
   if ((ww == NULL) || (ww->use_buf)) {
-    wd->buf = MEM_mallocN(MYWRITE_BUFFER_SIZE, "wd->buf");
+    wd->buf = MEM_mallocN(wd->buf_size, "wd->buf");
   }
 
   return wd;
@@ -373,14 +619,14 @@ static void mywrite(WriteData *wd, const void *adr, size_t len)
   else {
     /* if we have a single big chunk, write existing data in
      * buffer and write out big chunk in smaller pieces */
-    if (len > MYWRITE_MAX_CHUNK) {
+    if (len > wd->max_chunk) {
       if (wd->buf_used_len != 0) {
         writedata_do_write(wd, wd->buf, wd->buf_used_len);
         wd->buf_used_len = 0;
       }
 
       do {
-        size_t writelen = MIN2(len, MYWRITE_MAX_CHUNK);
+        size_t writelen = MIN2(len, wd->max_chunk);
         writedata_do_write(wd, adr, writelen);
         adr = (const char *)adr + writelen;
         len -= writelen;
@@ -390,7 +636,7 @@ static void mywrite(WriteData *wd, const void *adr, size_t len)
     }
 
     /* if data would overflow buffer, write out the buffer */
-    if (len + wd->buf_used_len > MYWRITE_BUFFER_SIZE - 1) {
+    if (len + wd->buf_used_len > wd->buf_size - 1) {
       writedata_do_write(wd, wd->buf, wd->buf_used_len);
       wd->buf_used_len = 0;
     }
@@ -1111,6 +1357,120 @@ static bool do_history(const char *name, ReportList *reports)
 /** \name File Writing (Public)
  * \{ */
 
+/**
+ * Remap relative paths to the new file location.
+ *
+ * \return The paths to restore with #write_file_paths_restore (when saving a copy) or NULL.
+ */
+static void *write_file_paths_remap(Main *mainvar,
+                                    const char *filepath,
+                                    eBLO_WritePathRemap remap_mode,
+                                    const bool use_save_as_copy)
+{
+  void *path_list_backup = NULL;
+  const int path_list_flag = (BKE_BPATH_TRAVERSE_SKIP_LIBRARY | BKE_BPATH_TRAVERSE_SKIP_MULTIFILE);
+
+  if (remap_mode == BLO_WRITE_PATH_REMAP_NONE) {
+    return NULL;
+  }
+
+  if (remap_mode == BLO_WRITE_PATH_REMAP_RELATIVE) {
+    /* Make all relative as none of the existing paths can be relative in an unsaved document.
+     */
+    if (G.relbase_valid == false) {
+      remap_mode = BLO_WRITE_PATH_REMAP_RELATIVE_ALL;
+    }
+  }
+
+  char dir_src[FILE_MAX];
+  char dir_dst[FILE_MAX];
+  BLI_split_dir_part(mainvar->name, dir_src, sizeof(dir_src));
+  BLI_split_dir_part(filepath, dir_dst, sizeof(dir_dst));
+
+  /* Just in case there is some subtle difference. */
+  BLI_path_normalize(mainvar->name, dir_dst);
+  BLI_path_normalize(mainvar->name, dir_src);
+
+  /* Only for relative, not relative-all, as this means making existing paths relative. */
+  if (remap_mode == BLO_WRITE_PATH_REMAP_RELATIVE) {
+    if (G.relbase_valid && (BLI_path_cmp(dir_dst, dir_src) == 0)) {
+      /* Saved to same path. Nothing to do. */
+      remap_mode = BLO_WRITE_PATH_REMAP_NONE;
+    }
+  }
+  else if (remap_mode == BLO_WRITE_PATH_REMAP_ABSOLUTE) {
+    if (G.relbase_valid == false) {
+      /* Unsaved, all paths are absolute.Even if the user manages to set a relative path,
+       * there is no base-path that can be used to make it absolute. */
+      remap_mode = BLO_WRITE_PATH_REMAP_NONE;
+    }
+  }
+
+  if (remap_mode != BLO_WRITE_PATH_REMAP_NONE) {
+    /* Check if we need to backup and restore paths. */
+    if (UNLIKELY(use_save_as_copy)) {
+      path_list_backup = BKE_bpath_list_backup(mainvar, path_list_flag);
+    }
+
+    switch (remap_mode) {
+      case BLO_WRITE_PATH_REMAP_RELATIVE:
+        /* Saved, make relative paths relative to new location (if possible). */
+        BKE_bpath_relative_rebase(mainvar, dir_src, dir_dst, NULL);
+        break;
+      case BLO_WRITE_PATH_REMAP_RELATIVE_ALL:
+        /* Make all relative (when requested or unsaved). */
+        BKE_bpath_relative_convert(mainvar, dir_dst, NULL);
+        break;
+      case BLO_WRITE_PATH_REMAP_ABSOLUTE:
+        /* Make all absolute (when requested or unsaved). */
+        BKE_bpath_absolute_convert(mainvar, dir_src, NULL);
+        break;
+      case BLO_WRITE_PATH_REMAP_NONE:
+        BLI_assert(0); /* Unreachable. */
+        break;
+    }
+  }
+
+  return path_list_backup;
+}
+
+static void write_file_paths_restore(Main *mainvar, void *path_list_backup)
+{
+  const int path_list_flag = (BKE_BPATH_TRAVERSE_SKIP_LIBRARY | BKE_BPATH_TRAVERSE_SKIP_MULTIFILE);
+
+  if (UNLIKELY(path_list_backup)) {
+    BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
+    BKE_bpath_list_free(path_list_backup);
+  }
+}
+
+/**
+ * Move the temporary file written next to \a filepath in place,
+ * the file at \a filepath is left untouched until then.
+ */
+static bool write_file_temp_finalize(const char *tempname,
+                                     const char *filepath,
+                                     const bool use_save_versions,
+                                     ReportList *reports)
+{
+  /* file save to temporary file was successful */
+  /* now do reverse file history (move .blend1 -> .blend2, .blend -> .blend1) */
+  if (use_save_versions) {
+    const bool err_hist = do_history(filepath, reports);
+    if (err_hist) {
+      BKE_report(reports, RPT_ERROR, "Version backup failed (file saved with @)");
+      return false;
+    }
+  }
+
+  if (BLI_rename(tempname, filepath) != 0) {
+    BKE_report(reports, RPT_ERROR, "Cannot change old file (file saved with @)");
+    return false;
+  }
+
+  return true;
+}
+
 /**
  * \return Success.
  */
@@ -1124,16 +1484,10 @@ bool BLO_write_file(Main *mainvar,
   eWriteWrapType ww_type;
   WriteWrap ww;
 
-  eBLO_WritePathRemap remap_mode = params->remap_mode;
   const bool use_save_versions = params->use_save_versions;
-  const bool use_save_as_copy = params->use_save_as_copy;
   const bool use_userdef = params->use_userdef;
   const BlendThumbnail *thumb = params->thumb;
 
-  /* path backup/restore */
-  void *path_list_backup = NULL;
-  const int path_list_flag = (BKE_BPATH_TRAVERSE_SKIP_LIBRARY | BKE_BPATH_TRAVERSE_SKIP_MULTIFILE);
-
   if (G.debug & G_DEBUG_IO && mainvar->lock != NULL) {
     BKE_report(reports, RPT_INFO, "Checking sanity of current .blend file *BEFORE* save to disk");
     BLO_main_validate_libraries(mainvar, reports);
@@ -1144,7 +1498,7 @@ bool BLO_write_file(Main *mainvar,
   BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
   if (write_flags & G_FILE_COMPRESS) {
-    ww_type = WW_WRAP_ZLIB;
+    ww_type = WW_WRAP_ZSTD;
   }
   else {
     ww_type = WW_WRAP_NONE;
@@ -1159,75 +1513,15 @@ bool BLO_write_file(Main *mainvar,
   }
 
   /* Remapping of relative paths to new file location. */
-  if (remap_mode != BLO_WRITE_PATH_REMAP_NONE) {
-
-    if (remap_mode == BLO_WRITE_PATH_REMAP_RELATIVE) {
-      /* Make all relative as none of the existing paths can be relative in an unsaved document.
-       */
-      if (G.relbase_valid == false) {
-        remap_mode = BLO_WRITE_PATH_REMAP_RELATIVE_ALL;
-      }
-    }
-
-    char dir_src[FILE_MAX];
-    char dir_dst[FILE_MAX];
-    BLI_split_dir_part(mainvar->name, dir_src, sizeof(dir_src));
-    BLI_split_dir_part(filepath, dir_dst, sizeof(dir_dst));
-
-    /* Just in case there is some subtle difference. */
-    BLI_path_normalize(mainvar->name, dir_dst);
-    BLI_path_normalize(mainvar->name, dir_src);
-
-    /* Only for relative, not relative-all, as this means making existing paths relative. */
-    if (remap_mode == BLO_WRITE_PATH_REMAP_RELATIVE) {
-      if (G.relbase_valid && (BLI_path_cmp(dir_dst, dir_src) == 0)) {
-        /* Saved to same path. Nothing to do. */
-        remap_mode = BLO_WRITE_PATH_REMAP_NONE;
-      }
-    }
-    else if (remap_mode == BLO_WRITE_PATH_REMAP_ABSOLUTE) {
-      if (G.relbase_valid == false) {
-        /* Unsaved, all paths are absolute.Even if the user manages to set a relative path,
-         * there is no base-path that can be used to make it absolute. */
-        remap_mode = BLO_WRITE_PATH_REMAP_NONE;
-      }
-    }
-
-    if (remap_mode != BLO_WRITE_PATH_REMAP_NONE) {
-      /* Check if we need to backup and restore paths. */
-      if (UNLIKELY(use_save_as_copy)) {
-        path_list_backup = BKE_bpath_list_backup(mainvar, path_list_flag);
-      }
-
-      switch (remap_mode) {
-        case BLO_WRITE_PATH_REMAP_RELATIVE:
-          /* Saved, make relative paths relative to new location (if possible). */
-          BKE_bpath_relative_rebase(mainvar, dir_src, dir_dst, NULL);
-          break;
-        case BLO_WRITE_PATH_REMAP_RELATIVE_ALL:
-          /* Make all relative (when requested or unsaved). */
-          BKE_bpath_relative_convert(mainvar, dir_dst, NULL);
-          break;
-        case BLO_WRITE_PATH_REMAP_ABSOLUTE:
-          /* Make all absolute (when requested or unsaved). */
-          BKE_bpath_absolute_convert(mainvar, dir_src, NULL);
-          break;
-        case BLO_WRITE_PATH_REMAP_NONE:
-          BLI_assert(0); /* Unreachable. */
-          break;
-      }
-    }
-  }
+  void *path_list_backup = write_file_paths_remap(
+      mainvar, filepath, params->remap_mode, params->use_save_as_copy);
 
   /* actual file writing */
   const bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, use_userdef, thumb);
 
   ww.close(&ww);
 
-  if (UNLIKELY(path_list_backup)) {
-    BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
-    BKE_bpath_list_free(path_list_backup);
-  }
+  write_file_paths_restore(mainvar, path_list_backup);
 
   if (err) {
     BKE_report(reports, RPT_ERROR, strerror(errno));
@@ -1236,18 +1530,7 @@ bool BLO_write_file(Main *mainvar,
     return 0;
   }
 
-  /* file save to temporary file was successful */
-  /* now do reverse file history (move .blend1 -> .blend2, .blend -> .blend1) */
-  if (use_save_versions) {
-    const bool err_hist = do_history(filepath, reports);
-    if (err_hist) {
-      BKE_report(reports, RPT_ERROR, "Version backup failed (file saved with @)");
-      return 0;
-    }
-  }
-
-  if (BLI_rename(tempname, filepath) != 0) {
-    BKE_report(reports, RPT_ERROR, "Cannot change old file (file saved with @)");
+  if (!write_file_temp_finalize(tempname, filepath, use_save_versions, reports)) {
     return 0;
   }
 
@@ -1272,6 +1555,137 @@ bool BLO_write_file_mem(Main *mainvar, MemFile *compare, MemFile *current, int w
   return (err == 0);
 }
 
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name File Writing Snapshot (Public)
+ *
+ * Saving is split in two steps, serializing the file into memory must be done from the main
+ * thread, writing (and compressing) it to disk can run in a background job while editing
+ * continues.
+ * \{ */
+
+struct BlendFileWriteSnapshot {
+  /** The file as it's written to disk (unlike undo memfiles, this isn't 'is_undo' data). */
+  MemFile memfile;
+  char filepath[FILE_MAX];
+  int write_flags;
+  bool use_save_versions;
+};
+
+/**
+ * Serialize \a mainvar for #BLO_write_file_snapshot_to_disk.
+ *
+ * \return The snapshot or NULL on failure.
+ */
+BlendFileWriteSnapshot *BLO_write_file_snapshot(Main *mainvar,
+                                                const char *filepath,
+                                                const int write_flags,
+                                                const struct BlendFileWriteParams *params,
+                                                ReportList *reports)
+{
+  WriteWrap ww;
+
+  if (G.debug & G_DEBUG_IO && mainvar->lock != NULL) {
+    BKE_report(reports, RPT_INFO, "Checking sanity of current .blend file *BEFORE* save to disk");
+    BLO_main_validate_libraries(mainvar, reports);
+    BLO_main_validate_shapekeys(mainvar, reports);
+  }
+
+  BlendFileWriteSnapshot *snapshot = MEM_callocN(sizeof(*snapshot), __func__);
+  BLI_strncpy(snapshot->filepath, filepath, sizeof(snapshot->filepath));
+  snapshot->write_flags = write_flags;
+  snapshot->use_save_versions = params->use_save_versions;
+
+  ww_handle_init(WW_WRAP_MEMFILE, &ww);
+  BLO_memfile_write_init(&ww._user_data.mem, &snapshot->memfile, NULL);
+  ww.open(&ww, filepath);
+
+  void *path_list_backup = write_file_paths_remap(
+      mainvar, filepath, params->remap_mode, params->use_save_as_copy);
+
+  const bool err = write_file_handle(
+      mainvar, &ww, NULL, NULL, write_flags, params->use_userdef, params->thumb);
+
+  ww.close(&ww);
+
+  write_file_paths_restore(mainvar, path_list_backup);
+
+  if (err) {
+    BKE_reportf(reports, RPT_ERROR, "Cannot write file %s", filepath);
+    BLO_write_file_snapshot_free(snapshot);
+    return NULL;
+  }
+
+  return snapshot;
+}
+
+/**
+ * Write a snapshot to disk, doesn't access any #Main data so this may run from any thread.
+ * As with #BLO_write_file, a temporary file is written first so the existing file is only
+ * replaced once the snapshot has been written completely.
+ *
+ * \param progress: Optionally set to the fraction of the snapshot written so far.
+ * \return Success.
+ */
+bool BLO_write_file_snapshot_to_disk(BlendFileWriteSnapshot *snapshot,
+                                     float *progress,
+                                     ReportList *reports)
+{
+  char tempname[FILE_MAX + 1];
+  WriteWrap ww;
+  bool err = false;
+
+  BLI_snprintf(tempname, sizeof(tempname), "%s@", snapshot->filepath);
+
+  ww_handle_init((snapshot->write_flags & G_FILE_COMPRESS) ? WW_WRAP_ZSTD : WW_WRAP_NONE, &ww);
+
+  if (ww.open(&ww, tempname) == false) {
+    BKE_reportf(
+        reports, RPT_ERROR, "Cannot open file %s for writing: %s", tempname, strerror(errno));
+    return false;
+  }
+
+  /* Not #MemFile.size, which doesn't include data shared with undo steps. */
+  size_t total_len = 0;
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &snapshot->memfile.chunks) {
+    total_len += chunk->size;
+  }
+
+  size_t written_len = 0;
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &snapshot->memfile.chunks) {
+    if (ww.write(&ww, chunk->buf, chunk->size) != chunk->size) {
+      err = true;
+      break;
+    }
+    written_len += chunk->size;
+    if (progress) {
+      *progress = (float)((double)written_len / (double)total_len);
+    }
+  }
+
+  if (ww.close(&ww) == false) {
+    err = true;
+  }
+
+  if (err) {
+    BKE_reportf(reports, RPT_ERROR, "Cannot write file %s: %s", tempname, strerror(errno));
+    remove(tempname);
+    return false;
+  }
+
+  return write_file_temp_finalize(
+      tempname, snapshot->filepath, snapshot->use_save_versions, reports);
+}
+
+void BLO_write_file_snapshot_free(BlendFileWriteSnapshot *snapshot)
+{
+  BLO_memfile_free(&snapshot->memfile);
+  MEM_freeN(snapshot);
+}
+
+/** \} */
+
 void BLO_write_raw(BlendWriter *writer, size_t size_in_bytes, const void *data_ptr)
 {
   writedata(writer->wd, DATA, size_in_bytes, data_ptr);
@@ -1398,4 +1812,27 @@ bool BLO_write_is_undo(BlendWriter *writer)
   return writer->wd->use_memfile;
 }
 
+/**
+ * Let the undo step being written reference data that was left in the .blend file while reading
+ * it, instead of storing a copy. The pointer itself is written, and stays valid as long as the
+ * undo step exists.
+ *
+ * \return false when the data has to be written as usual.
+ */
+bool BLO_write_deferred_data(BlendWriter *writer, struct BlendDeferredData *deferred_data)
+{
+#ifdef WIN32
+  /* Keeping the file mapped for undo would prevent saving over it. */
+  UNUSED_VARS(writer, deferred_data);
+  return false;
+#else
+  if (!writer->wd->use_memfile) {
+    return false;
+  }
+  BLI_addtail(&writer->wd->mem.written_memfile->deferred_data,
+              BLI_genericNodeN(BLO_deferred_data_duplicate(deferred_data)));
+  return true;
+#endif
+}
+
 /** \} */
@@ -58,6 +58,18 @@ typedef enum CompositorPriority {
   COM_PRIORITY_LOW = 0,
 } CompositorPriority;
 
+/**
+ * \brief Possible execution models
+ * \see CompositorContext.getExecutionModel
+ * \ingroup Execution
+ */
+typedef enum ExecutionModel {
+  /** \brief Execution groups pull tiles through their operations */
+  COM_EM_TILED = 0,
+  /** \brief Operations are calculated one after the other into whole buffers */
+  COM_EM_FULL_FRAME = 1,
+} ExecutionModel;
+
 // configurable items
 
 // chunk size determination
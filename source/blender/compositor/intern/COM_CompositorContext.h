@@ -255,6 +255,17 @@ class CompositorContext {
     return this->getbNodeTree()->chunksize;
   }
 
+  /**
+   * \brief get the execution model selected in the bnodetree
+   */
+  ExecutionModel getExecutionModel() const
+  {
+    if (this->getbNodeTree()->execution_mode == NTREE_EXECUTION_MODE_FULL_FRAME) {
+      return COM_EM_FULL_FRAME;
+    }
+    return COM_EM_TILED;
+  }
+
   void setFastCalculation(bool fastCalculation)
   {
     this->m_fastCalculation = fastCalculation;
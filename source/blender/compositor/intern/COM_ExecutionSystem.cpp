@@ -28,6 +28,7 @@
 #include "COM_Converter.h"
 #include "COM_Debug.h"
 #include "COM_ExecutionGroup.h"
+#include "COM_FullFrameExecution.h"
 #include "COM_NodeOperation.h"
 #include "COM_NodeOperationBuilder.h"
 #include "COM_ReadBufferOperation.h"
@@ -134,6 +135,12 @@ void ExecutionSystem::execute()
 
   DebugInfo::execute_started(this);
 
+  if (this->m_context.getExecutionModel() == COM_EM_FULL_FRAME) {
+    FullFrameExecution execution(this->m_context, this->m_operations);
+    execution.execute();
+    return;
+  }
+
   unsigned int order = 0;
   for (vector<NodeOperation *>::iterator iter = this->m_operations.begin();
        iter != this->m_operations.end();
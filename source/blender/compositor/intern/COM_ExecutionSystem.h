@@ -174,6 +174,8 @@ class ExecutionSystem {
    * - initialize the NodeOperation's and ExecutionGroup's
    * - schedule the output ExecutionGroup's based on their priority
    * - deinitialize the ExecutionGroup's and NodeOperation's
+   * \note in full-frame execution there are no ExecutionGroup's,
+   * see FullFrameExecution
    */
   void execute();
 
@@ -0,0 +1,540 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#include "COM_FFTConvolution.h"
+#include "COM_ResultCache.h"
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "BLI_math.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+
+/* Number of kernel spectra kept between convolutions. */
+#define COM_FFT_CONVOLUTION_CACHE_SIZE 8
+/* Smallest transform size, smaller transforms spend more time on overhead. */
+#define COM_FFT_CONVOLUTION_MIN_SIZE 16
+
+/*
+ *  2D Fast Hartley Transform, used for convolution
+ */
+
+using fREAL = float;
+
+// returns next highest power of 2 of x, as well its log2 in L2
+static unsigned int nextPow2(unsigned int x, unsigned int *L2)
+{
+  unsigned int pw, x_notpow2 = x & (x - 1);
+  *L2 = 0;
+  while (x >>= 1) {
+    ++(*L2);
+  }
+  pw = 1 << (*L2);
+  if (x_notpow2) {
+    (*L2)++;
+    pw <<= 1;
+  }
+  return pw;
+}
+
+//------------------------------------------------------------------------------
+
+// from FXT library by Joerg Arndt, faster in order bitreversal
+// use: r = revbin_upd(r, h) where h = N>>1
+static unsigned int revbin_upd(unsigned int r, unsigned int h)
+{
+  while (!((r ^= h) & h)) {
+    h >>= 1;
+  }
+  return r;
+}
+//------------------------------------------------------------------------------
+static void FHT(fREAL *data, unsigned int M, unsigned int inverse)
+{
+  double tt, fc, dc, fs, ds, a = M_PI;
+  fREAL t1, t2;
+  int n2, bd, bl, istep, k, len = 1 << M, n = 1;
+
+  int i, j = 0;
+  unsigned int Nh = len >> 1;
+  for (i = 1; i < (len - 1); i++) {
+    j = revbin_upd(j, Nh);
+    if (j > i) {
+      t1 = data[i];
+      data[i] = data[j];
+      data[j] = t1;
+    }
+  }
+
+  do {
+    fREAL *data_n = &data[n];
+
+    istep = n << 1;
+    for (k = 0; k < len; k += istep) {
+      t1 = data_n[k];
+      data_n[k] = data[k] - t1;
+      data[k] += t1;
+    }
+
+    n2 = n >> 1;
+    if (n > 2) {
+      fc = dc = cos(a);
+      fs = ds = sqrt(1.0 - fc * fc);  // sin(a);
+      bd = n - 2;
+      for (bl = 1; bl < n2; bl++) {
+        fREAL *data_nbd = &data_n[bd];
+        fREAL *data_bd = &data[bd];
+        for (k = bl; k < len; k += istep) {
+          t1 = fc * (double)data_n[k] + fs * (double)data_nbd[k];
+          t2 = fs * (double)data_n[k] - fc * (double)data_nbd[k];
+          data_n[k] = data[k] - t1;
+          data_nbd[k] = data_bd[k] - t2;
+          data[k] += t1;
+          data_bd[k] += t2;
+        }
+        tt = fc * dc - fs * ds;
+        fs = fs * dc + fc * ds;
+        fc = tt;
+        bd -= 2;
+      }
+    }
+
+    if (n > 1) {
+      for (k = n2; k < len; k += istep) {
+        t1 = data_n[k];
+        data_n[k] = data[k] - t1;
+        data[k] += t1;
+      }
+    }
+
+    n = istep;
+    a *= 0.5;
+  } while (n < len);
+
+  if (inverse) {
+    fREAL sc = (fREAL)1 / (fREAL)len;
+    for (k = 0; k < len; k++) {
+      data[k] *= sc;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+/* 2D Fast Hartley Transform, Mx/My -> log2 of width/height,
+ * nzp -> the row where zero pad data starts,
+ * inverse -> see above */
+static void FHT2D(
+    fREAL *data, unsigned int Mx, unsigned int My, unsigned int nzp, unsigned int inverse)
+{
+  unsigned int i, j, Nx, Ny, maxy;
+
+  Nx = 1 << Mx;
+  Ny = 1 << My;
+
+  // rows (forward transform skips 0 pad data)
+  maxy = inverse ? Ny : nzp;
+  for (j = 0; j < maxy; j++) {
+    FHT(&data[Nx * j], Mx, inverse);
+  }
+
+  // transpose data
+  if (Nx == Ny) {  // square
+    for (j = 0; j < Ny; j++) {
+      for (i = j + 1; i < Nx; i++) {
+        unsigned int op = i + (j << Mx), np = j + (i << My);
+        SWAP(fREAL, data[op], data[np]);
+      }
+    }
+  }
+  else {  // rectangular
+    unsigned int k, Nym = Ny - 1, stm = 1 << (Mx + My);
+    for (i = 0; stm > 0; i++) {
+#define PRED(k) (((k & Nym) << Mx) + (k >> My))
+      for (j = PRED(i); j > i; j = PRED(j)) {
+        /* pass */
+      }
+      if (j < i) {
+        continue;
+      }
+      for (k = i, j = PRED(i); j != i; k = j, j = PRED(j), stm--) {
+        SWAP(fREAL, data[j], data[k]);
+      }
+#undef PRED
+      stm--;
+    }
+  }
+
+  SWAP(unsigned int, Nx, Ny);
+  SWAP(unsigned int, Mx, My);
+
+  // now columns == transposed rows
+  for (j = 0; j < Ny; j++) {
+    FHT(&data[Nx * j], Mx, inverse);
+  }
+
+  // finalize
+  for (j = 0; j <= (Ny >> 1); j++) {
+    unsigned int jm = (Ny - j) & (Ny - 1);
+    unsigned int ji = j << Mx;
+    unsigned int jmi = jm << Mx;
+    for (i = 0; i <= (Nx >> 1); i++) {
+      unsigned int im = (Nx - i) & (Nx - 1);
+      fREAL A = data[ji + i];
+      fREAL B = data[jmi + i];
+      fREAL C = data[ji + im];
+      fREAL D = data[jmi + im];
+      fREAL E = (fREAL)0.5 * ((A + D) - (B + C));
+      data[ji + i] = A - E;
+      data[jmi + i] = B + E;
+      data[ji + im] = C + E;
+      data[jmi + im] = D - E;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+/* 2D convolution calc, d1 *= d2, M/N - > log2 of width/height */
+static void fht_convolve(fREAL *d1, const fREAL *d2, unsigned int M, unsigned int N)
+{
+  fREAL a, b;
+  unsigned int i, j, k, L, mj, mL;
+  unsigned int m = 1 << M, n = 1 << N;
+  unsigned int m2 = 1 << (M - 1), n2 = 1 << (N - 1);
+  unsigned int mn2 = m << (N - 1);
+
+  d1[0] *= d2[0];
+  d1[mn2] *= d2[mn2];
+  d1[m2] *= d2[m2];
+  d1[m2 + mn2] *= d2[m2 + mn2];
+  for (i = 1; i < m2; i++) {
+    k = m - i;
+    a = d1[i] * d2[i] - d1[k] * d2[k];
+    b = d1[k] * d2[i] + d1[i] * d2[k];
+    d1[i] = (b + a) * (fREAL)0.5;
+    d1[k] = (b - a) * (fREAL)0.5;
+    a = d1[i + mn2] * d2[i + mn2] - d1[k + mn2] * d2[k + mn2];
+    b = d1[k + mn2] * d2[i + mn2] + d1[i + mn2] * d2[k + mn2];
+    d1[i + mn2] = (b + a) * (fREAL)0.5;
+    d1[k + mn2] = (b - a) * (fREAL)0.5;
+  }
+  for (j = 1; j < n2; j++) {
+    L = n - j;
+    mj = j << M;
+    mL = L << M;
+    a = d1[mj] * d2[mj] - d1[mL] * d2[mL];
+    b = d1[mL] * d2[mj] + d1[mj] * d2[mL];
+    d1[mj] = (b + a) * (fREAL)0.5;
+    d1[mL] = (b - a) * (fREAL)0.5;
+    a = d1[m2 + mj] * d2[m2 + mj] - d1[m2 + mL] * d2[m2 + mL];
+    b = d1[m2 + mL] * d2[m2 + mj] + d1[m2 + mj] * d2[m2 + mL];
+    d1[m2 + mj] = (b + a) * (fREAL)0.5;
+    d1[m2 + mL] = (b - a) * (fREAL)0.5;
+  }
+  for (i = 1; i < m2; i++) {
+    k = m - i;
+    for (j = 1; j < n2; j++) {
+      L = n - j;
+      mj = j << M;
+      mL = L << M;
+      a = d1[i + mj] * d2[i + mj] - d1[k + mL] * d2[k + mL];
+      b = d1[k + mL] * d2[i + mj] + d1[i + mj] * d2[k + mL];
+      d1[i + mj] = (b + a) * (fREAL)0.5;
+      d1[k + mL] = (b - a) * (fREAL)0.5;
+      a = d1[i + mL] * d2[i + mL] - d1[k + mj] * d2[k + mj];
+      b = d1[k + mj] * d2[i + mL] + d1[i + mL] * d2[k + mj];
+      d1[i + mL] = (b + a) * (fREAL)0.5;
+      d1[k + mj] = (b - a) * (fREAL)0.5;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+/* Transformed kernel, shared by all blocks and all convolutions with the same kernel. */
+struct KernelSpectrum {
+  uint64_t key;
+  /* One spectrum per kernel channel, null when the channel is zero. */
+  std::vector<fREAL *> channels;
+
+  ~KernelSpectrum()
+  {
+    for (fREAL *channel : channels) {
+      if (channel) {
+        MEM_freeN(channel);
+      }
+    }
+  }
+};
+
+static ThreadMutex g_spectra_mutex = BLI_MUTEX_INITIALIZER;
+/* Most recently used first. */
+static std::list<std::shared_ptr<KernelSpectrum>> g_spectra;
+
+static std::shared_ptr<KernelSpectrum> get_kernel_spectrum(MemoryBuffer *kernel,
+                                                           int center_x,
+                                                           int center_y,
+                                                           unsigned int log2_w,
+                                                           unsigned int log2_h)
+{
+  const int kernel_width = kernel->getWidth();
+  const int kernel_height = kernel->getHeight();
+  const int num_channels = kernel->get_num_channels();
+  uint64_t key = ResultCache::hashBytes(
+      0, kernel->getBuffer(), sizeof(float) * kernel_width * kernel_height * num_channels);
+  key = ResultCache::hashCombine(key, kernel_width);
+  key = ResultCache::hashCombine(key, kernel_height);
+  key = ResultCache::hashCombine(key, num_channels);
+  key = ResultCache::hashCombine(key, center_x);
+  key = ResultCache::hashCombine(key, center_y);
+  key = ResultCache::hashCombine(key, log2_w);
+  key = ResultCache::hashCombine(key, log2_h);
+
+  BLI_mutex_lock(&g_spectra_mutex);
+  for (std::list<std::shared_ptr<KernelSpectrum>>::iterator it = g_spectra.begin();
+       it != g_spectra.end();
+       ++it) {
+    if ((*it)->key == key) {
+      std::shared_ptr<KernelSpectrum> spectrum = *it;
+      g_spectra.erase(it);
+      g_spectra.push_front(spectrum);
+      BLI_mutex_unlock(&g_spectra_mutex);
+      return spectrum;
+    }
+  }
+  BLI_mutex_unlock(&g_spectra_mutex);
+
+  const unsigned int w2 = 1 << log2_w;
+  const unsigned int h2 = 1 << log2_h;
+  std::shared_ptr<KernelSpectrum> spectrum = std::make_shared<KernelSpectrum>();
+  spectrum->key = key;
+  spectrum->channels.resize(num_channels, nullptr);
+
+  const float *kernel_buffer = kernel->getBuffer();
+  for (int ch = 0; ch < num_channels; ch++) {
+    fREAL *data = (fREAL *)MEM_callocN(w2 * h2 * sizeof(fREAL), "FFTConvolution spectrum");
+    bool is_zero = true;
+    /* Mirrored around the center and wrapped, so the convolution of a block that starts at
+     * zero gives the output of the pixels it covers starting at zero too. */
+    for (int y = 0; y < kernel_height; y++) {
+      fREAL *row = &data[((center_y - y) & (h2 - 1)) * w2];
+      const float *elem = &kernel_buffer[y * kernel_width * num_channels + ch];
+      for (int x = 0; x < kernel_width; x++, elem += num_channels) {
+        row[(center_x - x) & (w2 - 1)] = *elem;
+        is_zero &= *elem == 0.0f;
+      }
+    }
+    if (is_zero) {
+      MEM_freeN(data);
+      continue;
+    }
+    FHT2D(data, log2_w, log2_h, h2, 0);
+    spectrum->channels[ch] = data;
+  }
+
+  BLI_mutex_lock(&g_spectra_mutex);
+  g_spectra.push_front(spectrum);
+  while (g_spectra.size() > COM_FFT_CONVOLUTION_CACHE_SIZE) {
+    g_spectra.pop_back();
+  }
+  BLI_mutex_unlock(&g_spectra_mutex);
+  return spectrum;
+}
+
+void FFTConvolution::clearCache()
+{
+  BLI_mutex_lock(&g_spectra_mutex);
+  g_spectra.clear();
+  BLI_mutex_unlock(&g_spectra_mutex);
+}
+
+//------------------------------------------------------------------------------
+
+struct ConvolveData {
+  const KernelSpectrum *spectrum;
+  const float *input;
+  float *output;
+  int width, height, num_channels;
+  int kernel_width, kernel_height, kernel_channels;
+  int center_x, center_y;
+  unsigned int log2_w, log2_h;
+  /* Size of the input blocks. */
+  int block_width, block_height;
+  /* Blocks of a pass, every other block in both directions starting at the offset. */
+  int offset_x, offset_y;
+  int pass_blocks_x;
+  /* Used for normalizing, summed area table per kernel channel. */
+  double *kernel_sums;
+};
+
+static void convolve_block_task(void *__restrict userdata,
+                                const int iter,
+                                const TaskParallelTLS *__restrict /*tls*/)
+{
+  const ConvolveData *cd = (const ConvolveData *)userdata;
+  const unsigned int w2 = 1 << cd->log2_w;
+  const unsigned int h2 = 1 << cd->log2_h;
+  const int block_x = (cd->offset_x + 2 * (iter % cd->pass_blocks_x)) * cd->block_width;
+  const int block_y = (cd->offset_y + 2 * (iter / cd->pass_blocks_x)) * cd->block_height;
+  const int block_width = min_ii(cd->block_width, cd->width - block_x);
+  const int block_height = min_ii(cd->block_height, cd->height - block_y);
+
+  fREAL *data = (fREAL *)MEM_mallocN(w2 * h2 * sizeof(fREAL), "FFTConvolution block");
+
+  for (int ch = 0; ch < cd->num_channels; ch++) {
+    const fREAL *spectrum = cd->spectrum->channels[cd->kernel_channels == 1 ? 0 : ch];
+    if (spectrum == nullptr) {
+      continue;
+    }
+
+    memset(data, 0, w2 * h2 * sizeof(fREAL));
+    for (int y = 0; y < block_height; y++) {
+      fREAL *row = &data[y * w2];
+      const float *elem = &cd->input[((block_y + y) * cd->width + block_x) * cd->num_channels +
+                                     ch];
+      for (int x = 0; x < block_width; x++, elem += cd->num_channels) {
+        row[x] = *elem;
+      }
+    }
+
+    /* FHT2D transposes the data, the inverse transform puts it back in order. */
+    FHT2D(data, cd->log2_w, cd->log2_h, block_height, 0);
+    fht_convolve(data, spectrum, cd->log2_h, cd->log2_w);
+    FHT2D(data, cd->log2_h, cd->log2_w, 0, 1);
+
+    /* Overlap-add, the result of a block reaches over its neighbors by the kernel size. */
+    const int ymin = max_ii(block_y + cd->center_y - cd->kernel_height + 1, 0);
+    const int ymax = min_ii(block_y + block_height + cd->center_y, cd->height);
+    const int xmin = max_ii(block_x + cd->center_x - cd->kernel_width + 1, 0);
+    const int xmax = min_ii(block_x + block_width + cd->center_x, cd->width);
+    for (int y = ymin; y < ymax; y++) {
+      const fREAL *row = &data[((y - block_y) & (h2 - 1)) * w2];
+      float *elem = &cd->output[(y * cd->width + xmin) * cd->num_channels + ch];
+      for (int x = xmin; x < xmax; x++, elem += cd->num_channels) {
+        *elem += row[(x - block_x) & (w2 - 1)];
+      }
+    }
+  }
+
+  MEM_freeN(data);
+}
+
+static void normalize_row_task(void *__restrict userdata,
+                               const int y,
+                               const TaskParallelTLS *__restrict /*tls*/)
+{
+  const ConvolveData *cd = (const ConvolveData *)userdata;
+  const int sums_width = cd->kernel_width + 1;
+  const int sums_size = sums_width * (cd->kernel_height + 1);
+
+  /* Kernel rows that overlap the input. */
+  const int j0 = max_ii(cd->center_y - y, 0);
+  const int j1 = min_ii(cd->height - y + cd->center_y, cd->kernel_height);
+
+  float *elem = &cd->output[y * cd->width * cd->num_channels];
+  for (int x = 0; x < cd->width; x++) {
+    const int i0 = max_ii(cd->center_x - x, 0);
+    const int i1 = min_ii(cd->width - x + cd->center_x, cd->kernel_width);
+    for (int ch = 0; ch < cd->num_channels; ch++, elem++) {
+      const double *sums = &cd->kernel_sums[(cd->kernel_channels == 1 ? 0 : ch) * sums_size];
+      const double weight = sums[j1 * sums_width + i1] - sums[j0 * sums_width + i1] -
+                            sums[j1 * sums_width + i0] + sums[j0 * sums_width + i0];
+      if (weight != 0.0) {
+        *elem = (float)(*elem / weight);
+      }
+    }
+  }
+}
+
+MemoryBuffer *FFTConvolution::apply(
+    MemoryBuffer *input, MemoryBuffer *kernel, int center_x, int center_y, bool normalize)
+{
+  BLI_assert(ELEM(kernel->get_num_channels(), 1, input->get_num_channels()));
+
+  MemoryBuffer *output = new MemoryBuffer(input->get_data_type(), input->getRect());
+  output->clear();
+
+  ConvolveData cd;
+  cd.input = input->getBuffer();
+  cd.output = output->getBuffer();
+  cd.width = input->getWidth();
+  cd.height = input->getHeight();
+  cd.num_channels = input->get_num_channels();
+  cd.kernel_width = kernel->getWidth();
+  cd.kernel_height = kernel->getHeight();
+  cd.kernel_channels = kernel->get_num_channels();
+  cd.center_x = center_x;
+  cd.center_y = center_y;
+  cd.kernel_sums = nullptr;
+
+  /* The result of a block is as large as the block and the kernel together, make room for a
+   * block at least as large as the kernel. */
+  nextPow2(max_ii(2 * cd.kernel_width - 1, COM_FFT_CONVOLUTION_MIN_SIZE), &cd.log2_w);
+  nextPow2(max_ii(2 * cd.kernel_height - 1, COM_FFT_CONVOLUTION_MIN_SIZE), &cd.log2_h);
+  cd.block_width = (1 << cd.log2_w) + 1 - cd.kernel_width;
+  cd.block_height = (1 << cd.log2_h) + 1 - cd.kernel_height;
+
+  std::shared_ptr<KernelSpectrum> spectrum = get_kernel_spectrum(
+      kernel, center_x, center_y, cd.log2_w, cd.log2_h);
+  cd.spectrum = spectrum.get();
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  /* Results of blocks two apart don't overlap, so every pass adds blocks in parallel. */
+  const int num_blocks_x = (cd.width + cd.block_width - 1) / cd.block_width;
+  const int num_blocks_y = (cd.height + cd.block_height - 1) / cd.block_height;
+  for (int pass = 0; pass < 4; pass++) {
+    cd.offset_x = pass & 1;
+    cd.offset_y = pass >> 1;
+    cd.pass_blocks_x = (num_blocks_x - cd.offset_x + 1) / 2;
+    const int pass_blocks_y = (num_blocks_y - cd.offset_y + 1) / 2;
+    if (cd.pass_blocks_x > 0 && pass_blocks_y > 0) {
+      BLI_task_parallel_range(
+          0, cd.pass_blocks_x * pass_blocks_y, &cd, convolve_block_task, &settings);
+    }
+  }
+
+  if (normalize) {
+    /* Summed area tables give the weight of the kernel elements inside the input. */
+    const int sums_width = cd.kernel_width + 1;
+    const int sums_size = sums_width * (cd.kernel_height + 1);
+    cd.kernel_sums = (double *)MEM_callocN(sizeof(double) * sums_size * cd.kernel_channels,
+                                           "FFTConvolution kernel sums");
+    const float *kernel_buffer = kernel->getBuffer();
+    for (int ch = 0; ch < cd.kernel_channels; ch++) {
+      double *sums = &cd.kernel_sums[ch * sums_size];
+      for (int y = 0; y < cd.kernel_height; y++) {
+        const float *elem = &kernel_buffer[y * cd.kernel_width * cd.kernel_channels + ch];
+        double row_sum = 0.0;
+        for (int x = 0; x < cd.kernel_width; x++, elem += cd.kernel_channels) {
+          row_sum += *elem;
+          sums[(y + 1) * sums_width + x + 1] = sums[y * sums_width + x + 1] + row_sum;
+        }
+      }
+    }
+    BLI_task_parallel_range(0, cd.height, &cd, normalize_row_task, &settings);
+    MEM_freeN(cd.kernel_sums);
+  }
+
+  return output;
+}
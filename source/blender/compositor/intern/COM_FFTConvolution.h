@@ -0,0 +1,70 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#pragma once
+
+#include "COM_MemoryBuffer.h"
+
+/* Kernels with fewer elements are faster to apply directly. */
+#define COM_FFT_CONVOLUTION_MIN_KERNEL_AREA (32 * 32)
+
+/**
+ * \brief convolution of whole buffers in the frequency domain.
+ *
+ * Buffers are split in blocks that are transformed with a Fast Hartley Transform, multiplied with
+ * the spectrum of the kernel and added back together with their overlap (overlap-add). Blocks are
+ * calculated in parallel. Spectra of kernels are cached, so applying the same kernel again (the
+ * next frame, another channel or view) only transforms the blocks of the input.
+ *
+ * Results match direct summation over the kernel where pixels outside of the input are skipped:
+ *
+ *     output(x, y) = sum(kernel(i, j) * input(x + i - center_x, y + j - center_y))
+ *
+ * \see GaussianBokehBlurOperation, BokehBlurOperation, GlareFogGlowOperation
+ * \ingroup Execution
+ */
+class FFTConvolution {
+ public:
+  /**
+   * \brief apply \a kernel to all channels of \a input
+   * \param kernel: single channel kernel used for every channel, or one channel per channel of
+   * the input. The rect of the kernel starts at zero.
+   * \param center_x, center_y: element of the kernel aligned with the output pixel.
+   * \param normalize: divide by the sum of the kernel elements that overlap the input, like
+   * direct implementations that skip pixels outside of the input and divide by their weights.
+   * \return new buffer with the rect and data type of \a input
+   */
+  static MemoryBuffer *apply(MemoryBuffer *input,
+                             MemoryBuffer *kernel,
+                             int center_x,
+                             int center_y,
+                             bool normalize);
+
+  /**
+   * \brief is applying a kernel of this size faster in the frequency domain
+   */
+  static bool isEfficient(int kernel_width, int kernel_height)
+  {
+    return kernel_width * kernel_height >= COM_FFT_CONVOLUTION_MIN_KERNEL_AREA;
+  }
+
+  /**
+   * \brief free the cached kernel spectra
+   */
+  static void clearCache();
+};
@@ -0,0 +1,798 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#include "COM_FullFrameExecution.h"
+
+#include <cstring>
+#include <typeinfo>
+
+#include "BLI_rect.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+#include "BLT_translation.h"
+
+#include "COM_BufferOperation.h"
+#include "COM_ReadBufferOperation.h"
+#include "COM_ResultCache.h"
+#include "COM_WriteBufferOperation.h"
+
+#ifdef WITH_CXX_GUARDEDALLOC
+#  include "MEM_guardedalloc.h"
+#endif
+
+/* Number of rows of an area calculated by a single task. */
+#define COM_FULL_FRAME_ROWS_PER_TASK 16
+
+/* Number of elements calculated by a single NodeOperation.executeRow call. */
+#define COM_ROW_LENGTH 128
+/* Rows of fused inputs are kept on the stack, these limit its size. */
+#define COM_ROW_MAX_INPUTS 4
+#define COM_ROW_MAX_FUSED_DEPTH 8
+
+FullFrameExecution::FullFrameExecution(const CompositorContext &context,
+                                       const std::vector<NodeOperation *> &operations)
+    : m_context(context), m_operations(operations)
+{
+  this->m_operationsFinished = 0;
+  this->m_numberOfOperations = 0;
+  /* Renders don't reuse results, keeping them would only take memory. */
+  this->m_useCache = !context.isRendering() && context.getbNodeTree()->cache_limit > 0;
+  this->m_contextHash = 0;
+}
+
+FullFrameExecution::~FullFrameExecution()
+{
+  unlinkBufferOperations();
+  for (std::map<NodeOperation *, OperationData>::iterator it = m_data.begin(); it != m_data.end();
+       ++it) {
+    BufferOperation *buffer_operation = it->second.buffer_operation;
+    if (buffer_operation) {
+      if (!it->second.in_cache) {
+        delete buffer_operation->getBuffer();
+      }
+      delete buffer_operation;
+    }
+  }
+}
+
+/* Operations that are calculated into a buffer of their own. Read buffer operations already
+ * read from a buffer and are linked directly. */
+bool FullFrameExecution::isBuffered(const NodeOperation *operation)
+{
+  return operation->getNumberOfOutputSockets() > 0 && !operation->isReadBufferOperation();
+}
+
+/* Operation calculating the buffer read by an input socket, nullptr when the socket doesn't read
+ * a buffer of this execution. */
+static NodeOperation *get_buffered_input(NodeOperation *operation, unsigned int index)
+{
+  NodeOperationInput *input = operation->getInputSocket(index);
+  if (!input->isConnected()) {
+    return nullptr;
+  }
+  BufferOperation *buffer_operation = dynamic_cast<BufferOperation *>(
+      &input->getLink()->getOperation());
+  return buffer_operation ? buffer_operation->getOperation() : nullptr;
+}
+
+static int get_num_channels(DataType datatype)
+{
+  switch (datatype) {
+    case COM_DT_VALUE:
+      return COM_NUM_CHANNELS_VALUE;
+    case COM_DT_VECTOR:
+      return COM_NUM_CHANNELS_VECTOR;
+    case COM_DT_COLOR:
+    default:
+      return COM_NUM_CHANNELS_COLOR;
+  }
+}
+
+bool FullFrameExecution::isOutput(NodeOperation *operation) const
+{
+  if (!operation->isOutputOperation(m_context.isRendering())) {
+    return false;
+  }
+  /* Same selection as the tiled execution: only high priority outputs in fast calculation. */
+  return !m_context.isFastCalculation() || operation->getRenderPriority() == COM_PRIORITY_HIGH;
+}
+
+void FullFrameExecution::linkBufferOperations()
+{
+  for (unsigned int index = 0; index < m_operations.size(); index++) {
+    OperationData &data = m_data[m_operations[index]];
+    BLI_rcti_init(&data.area, 0, 0, 0, 0);
+    data.has_area = false;
+    data.buffer_operation = nullptr;
+    data.has_complex_reader = false;
+    data.readers = 0;
+    data.required = false;
+    data.key = 0;
+    data.cacheable = false;
+    data.in_cache = false;
+    data.calculated = false;
+    data.use_rows = false;
+    data.fused = false;
+    data.fused_depth = 0;
+  }
+
+  for (unsigned int index = 0; index < m_operations.size(); index++) {
+    NodeOperation *operation = m_operations[index];
+    for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+      NodeOperationInput *input = operation->getInputSocket(i);
+      if (!input->isConnected()) {
+        continue;
+      }
+      NodeOperation *input_operation = &input->getLink()->getOperation();
+      if (!isBuffered(input_operation)) {
+        continue;
+      }
+
+      OperationData &data = m_data[input_operation];
+      if (data.buffer_operation == nullptr) {
+        data.buffer_operation = new BufferOperation(input_operation);
+        data.buffer_operation->setbNodeTree(m_context.getbNodeTree());
+      }
+      if (operation->isComplex()) {
+        data.has_complex_reader = true;
+      }
+      m_links.push_back(std::make_pair(input, input->getLink()));
+      input->setLink(data.buffer_operation->getOutputSocket());
+    }
+  }
+}
+
+void FullFrameExecution::unlinkBufferOperations()
+{
+  for (unsigned int index = 0; index < m_links.size(); index++) {
+    m_links[index].first->setLink(m_links[index].second);
+  }
+  m_links.clear();
+}
+
+void FullFrameExecution::addAreaOfInterest(NodeOperation *operation, const rcti *area)
+{
+  rcti bounds;
+  rcti clamped;
+  BLI_rcti_init(&bounds, 0, operation->getWidth(), 0, operation->getHeight());
+  if (!BLI_rcti_isect(area, &bounds, &clamped)) {
+    /* The operation is still needed, its readers only sample outside of it. */
+    BLI_rcti_init(&clamped, 0, 0, 0, 0);
+  }
+
+  OperationData &data = m_data[operation];
+  if (!data.has_area || BLI_rcti_is_empty(&data.area)) {
+    data.area = clamped;
+    data.has_area = true;
+  }
+  else if (!BLI_rcti_is_empty(&clamped)) {
+    BLI_rcti_union(&data.area, &clamped);
+  }
+}
+
+void FullFrameExecution::determineAreasOfInterest()
+{
+  for (unsigned int index = 0; index < m_operations.size(); index++) {
+    NodeOperation *operation = m_operations[index];
+    if (isOutput(operation)) {
+      rcti area;
+      BLI_rcti_init(&area, 0, operation->getWidth(), 0, operation->getHeight());
+      addAreaOfInterest(operation, &area);
+    }
+  }
+
+  /* Readers come after their inputs, so walking backwards every operation knows its whole area
+   * of interest before passing it on to its inputs. */
+  for (int index = m_operations.size() - 1; index >= 0; index--) {
+    NodeOperation *operation = m_operations[index];
+    OperationData &data = m_data[operation];
+    if (!data.has_area) {
+      continue;
+    }
+
+    if (operation->isReadBufferOperation()) {
+      WriteBufferOperation *write_operation =
+          ((ReadBufferOperation *)operation)->getMemoryProxy()->getWriteBufferOperation();
+      rcti area;
+      BLI_rcti_init(&area, 0, write_operation->getWidth(), 0, write_operation->getHeight());
+      addAreaOfInterest(write_operation, &area);
+      continue;
+    }
+
+    for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+      NodeOperationInput *input = operation->getInputSocket(i);
+      if (!input->isConnected()) {
+        continue;
+      }
+      NodeOperation *input_operation = &input->getLink()->getOperation();
+      BufferOperation *buffer_operation = dynamic_cast<BufferOperation *>(input_operation);
+      if (buffer_operation) {
+        buffer_operation->resetAreaOfInterest();
+      }
+      else if (input_operation->isReadBufferOperation()) {
+        /* Read buffers don't report areas, the buffers they read are calculated entirely. */
+        rcti area;
+        BLI_rcti_init(&area, 0, input_operation->getWidth(), 0, input_operation->getHeight());
+        addAreaOfInterest(input_operation, &area);
+      }
+    }
+
+    rcti output;
+    operation->determineDependingAreaOfInterest(&data.area, nullptr, &output);
+
+    for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+      NodeOperationInput *input = operation->getInputSocket(i);
+      if (!input->isConnected()) {
+        continue;
+      }
+      BufferOperation *buffer_operation = dynamic_cast<BufferOperation *>(
+          &input->getLink()->getOperation());
+      if (buffer_operation == nullptr) {
+        continue;
+      }
+      NodeOperation *input_operation = buffer_operation->getOperation();
+      rcti area;
+      if (!buffer_operation->getAreaOfInterest(&area)) {
+        /* The operation didn't pass its area on to this input, don't guess what it reads. */
+        BLI_rcti_init(&area, 0, input_operation->getWidth(), 0, input_operation->getHeight());
+      }
+      addAreaOfInterest(input_operation, &area);
+    }
+  }
+}
+
+/* Operations reading data from outside of the node tree, the data isn't part of their key. */
+static bool is_volatile(const NodeOperation *operation)
+{
+  return operation->isInputOperation() && !operation->isSetOperation() &&
+         !operation->isReadBufferOperation();
+}
+
+uint64_t FullFrameExecution::determineKey(NodeOperation *operation)
+{
+  OperationData &data = m_data[operation];
+  if (!operation->isCacheable()) {
+    return 0;
+  }
+
+  const char *type_name = typeid(*operation).name();
+  uint64_t key = ResultCache::hashBytes(m_contextHash, type_name, strlen(type_name));
+  key = ResultCache::hashCombine(key, operation->getNodeHash());
+  key = ResultCache::hashCombine(key, operation->getWidth());
+  key = ResultCache::hashCombine(key, operation->getHeight());
+
+  if (operation->isReadBufferOperation()) {
+    WriteBufferOperation *write_operation =
+        ((ReadBufferOperation *)operation)->getMemoryProxy()->getWriteBufferOperation();
+    const uint64_t write_key = m_data[write_operation].key;
+    return write_key ? ResultCache::hashCombine(key, write_key) : 0;
+  }
+
+  if (operation->getNumberOfOutputSockets() > 0) {
+    key = ResultCache::hashCombine(key, operation->getOutputSocket()->getDataType());
+  }
+
+  if (operation->isSetOperation()) {
+    /* Constant values are set on the operation and not part of the node hash. */
+    float elem[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    operation->readSampled(elem, 0, 0, COM_PS_NEAREST);
+    return ResultCache::hashBytes(key, elem, sizeof(elem));
+  }
+
+  if (is_volatile(operation)) {
+    if (data.buffer_operation == nullptr) {
+      return 0;
+    }
+    calculateOperation(operation);
+    data.calculated = true;
+    return ResultCache::hashCombine(key,
+                                    ResultCache::hashBuffer(data.buffer_operation->getBuffer()));
+  }
+
+  for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+    NodeOperationInput *input = operation->getInputSocket(i);
+    if (!input->isConnected()) {
+      continue;
+    }
+    NodeOperation *input_operation = &input->getLink()->getOperation();
+    BufferOperation *buffer_operation = dynamic_cast<BufferOperation *>(input_operation);
+    if (buffer_operation) {
+      input_operation = buffer_operation->getOperation();
+    }
+    const uint64_t input_key = m_data[input_operation].key;
+    if (input_key == 0) {
+      return 0;
+    }
+    key = ResultCache::hashCombine(key, input_key);
+  }
+  return key;
+}
+
+void FullFrameExecution::determineKeys()
+{
+  m_contextHash = ResultCache::hashContext(m_context);
+
+  /* Inputs come before their readers, so their keys are known. */
+  for (unsigned int index = 0; index < m_operations.size(); index++) {
+    NodeOperation *operation = m_operations[index];
+    OperationData &data = m_data[operation];
+    if (!data.has_area) {
+      continue;
+    }
+    data.key = determineKey(operation);
+
+    /* Constants and volatile results are cheap or can't be reused, only cache the others. */
+    data.cacheable = data.key != 0 && data.buffer_operation != nullptr && !data.calculated &&
+                     !operation->isSetOperation();
+    if (!data.cacheable) {
+      continue;
+    }
+
+    MemoryBuffer *buffer = ResultCache::lookup(data.key, &data.area);
+    if (buffer) {
+      data.buffer_operation->setBuffer(buffer);
+      data.in_cache = true;
+      data.calculated = true;
+    }
+  }
+}
+
+void FullFrameExecution::determineRequiredOperations()
+{
+  for (unsigned int index = 0; index < m_operations.size(); index++) {
+    NodeOperation *operation = m_operations[index];
+    if (isOutput(operation)) {
+      m_data[operation].required = true;
+    }
+  }
+
+  /* Results found in the cache don't need their inputs. */
+  for (int index = m_operations.size() - 1; index >= 0; index--) {
+    NodeOperation *operation = m_operations[index];
+    OperationData &data = m_data[operation];
+    if (!data.required || data.in_cache) {
+      continue;
+    }
+
+    if (operation->isReadBufferOperation()) {
+      WriteBufferOperation *write_operation =
+          ((ReadBufferOperation *)operation)->getMemoryProxy()->getWriteBufferOperation();
+      m_data[write_operation].required = true;
+      continue;
+    }
+
+    for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+      NodeOperationInput *input = operation->getInputSocket(i);
+      if (!input->isConnected()) {
+        continue;
+      }
+      NodeOperation *input_operation = &input->getLink()->getOperation();
+      BufferOperation *buffer_operation = dynamic_cast<BufferOperation *>(input_operation);
+      if (buffer_operation) {
+        input_operation = buffer_operation->getOperation();
+        m_data[input_operation].readers++;
+      }
+      m_data[input_operation].required = true;
+    }
+  }
+
+  /* Volatile results calculated for their keys that turned out not to be needed. */
+  for (unsigned int index = 0; index < m_operations.size(); index++) {
+    OperationData &data = m_data[m_operations[index]];
+    if (data.buffer_operation && data.readers == 0) {
+      freeBuffer(data);
+    }
+  }
+}
+
+/* Rows of the output line up with rows of every input when the inputs are constants or have the
+ * same resolution. */
+bool FullFrameExecution::canUseRows(NodeOperation *operation) const
+{
+  if (!operation->isPointwise() || !isBuffered(operation) ||
+      operation->getNumberOfInputSockets() > COM_ROW_MAX_INPUTS) {
+    return false;
+  }
+  for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+    NodeOperation *input_operation = get_buffered_input(operation, i);
+    if (input_operation == nullptr) {
+      return false;
+    }
+    const bool single_elem = input_operation->isSetOperation() &&
+                             !getData(input_operation).has_complex_reader;
+    if (!single_elem && (input_operation->getWidth() != operation->getWidth() ||
+                         input_operation->getHeight() != operation->getHeight())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FullFrameExecution::canFuse(NodeOperation *operation, NodeOperation *reader) const
+{
+  const OperationData &data = getData(operation);
+  const OperationData &reader_data = getData(reader);
+  if (!data.required || data.in_cache || data.calculated || data.buffer_operation == nullptr ||
+      data.has_complex_reader || data.readers != 1) {
+    return false;
+  }
+  if (!reader_data.use_rows || reader_data.fused_depth >= COM_ROW_MAX_FUSED_DEPTH) {
+    return false;
+  }
+  return operation->getWidth() == reader->getWidth() &&
+         operation->getHeight() == reader->getHeight() && canUseRows(operation);
+}
+
+void FullFrameExecution::determineFusedOperations()
+{
+  /* Walking backwards readers are known to be calculated in rows before their inputs are fused
+   * into them, a chain of pointwise operations ends up fused into its last operation. */
+  for (int index = m_operations.size() - 1; index >= 0; index--) {
+    NodeOperation *operation = m_operations[index];
+    OperationData &data = m_data[operation];
+    if (!data.required || data.in_cache || data.calculated) {
+      continue;
+    }
+    data.use_rows = canUseRows(operation);
+    if (!data.use_rows) {
+      continue;
+    }
+
+    for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+      NodeOperation *input_operation = get_buffered_input(operation, i);
+      if (!canFuse(input_operation, operation)) {
+        continue;
+      }
+      OperationData &input_data = m_data[input_operation];
+      input_data.fused = true;
+      input_data.fused_depth = data.fused_depth + 1;
+      /* The result is never stored as a whole. */
+      input_data.cacheable = false;
+    }
+  }
+}
+
+struct CalculateAreaData {
+  FullFrameExecution *execution;
+  NodeOperation *operation;
+  MemoryBuffer *output;
+  MemoryBuffer **inputs;
+  const rcti *area;
+  const bNodeTree *btree;
+};
+
+static void calculate_area_task(void *__restrict userdata,
+                                const int iter,
+                                const TaskParallelTLS *__restrict /*tls*/)
+{
+  CalculateAreaData *data = (CalculateAreaData *)userdata;
+  const bNodeTree *btree = data->btree;
+  if (btree->test_break && btree->test_break(btree->tbh)) {
+    return;
+  }
+
+  rcti rect = *data->area;
+  rect.ymin = data->area->ymin + iter * COM_FULL_FRAME_ROWS_PER_TASK;
+  rect.ymax = min(rect.ymin + COM_FULL_FRAME_ROWS_PER_TASK, data->area->ymax);
+  data->execution->calculateArea(data->operation, data->output, data->inputs, &rect);
+}
+
+/* Lookup that doesn't insert, so it can be used by the threads calculating an operation. */
+const FullFrameExecution::OperationData &FullFrameExecution::getData(
+    NodeOperation *operation) const
+{
+  return m_data.find(operation)->second;
+}
+
+void FullFrameExecution::calculateRow(
+    NodeOperation *operation, float *output, int x, int y, int length) const
+{
+  const float *inputs[COM_ROW_MAX_INPUTS];
+  int input_strides[COM_ROW_MAX_INPUTS];
+  float rows[COM_ROW_MAX_INPUTS][COM_ROW_LENGTH * COM_NUM_CHANNELS_COLOR];
+
+  for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+    NodeOperation *input_operation = get_buffered_input(operation, i);
+    const OperationData &input_data = getData(input_operation);
+    if (input_data.fused) {
+      calculateRow(input_operation, rows[i], x, y, length);
+      inputs[i] = rows[i];
+      input_strides[i] = get_num_channels(input_operation->getOutputSocket()->getDataType());
+    }
+    else {
+      MemoryBuffer *buffer = input_data.buffer_operation->getBuffer();
+      inputs[i] = buffer->get_elem(x, y);
+      input_strides[i] = buffer->elem_stride();
+    }
+  }
+
+  operation->executeRow(output, inputs, input_strides, length);
+}
+
+void FullFrameExecution::calculateArea(NodeOperation *operation,
+                                       MemoryBuffer *output,
+                                       MemoryBuffer **inputs,
+                                       const rcti *area)
+{
+  rcti rect = *area;
+
+  /* Outputs and write buffers store their results themselves. */
+  if (output == nullptr) {
+    operation->executeRegion(&rect, 0);
+    return;
+  }
+
+  if (getData(operation).use_rows) {
+    for (int y = rect.ymin; y < rect.ymax; y++) {
+      for (int x = rect.xmin; x < rect.xmax; x += COM_ROW_LENGTH) {
+        calculateRow(operation, output->get_elem(x, y), x, y, min(COM_ROW_LENGTH, rect.xmax - x));
+      }
+    }
+    return;
+  }
+
+  if (operation->supportsFullFrame()) {
+    /* Loops over the input buffers require them to be aligned with the output. */
+    bool has_inputs = true;
+    for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+      if (inputs[i] == nullptr || (!inputs[i]->is_single_elem() &&
+                                   (inputs[i]->getWidth() != output->getWidth() ||
+                                    inputs[i]->getHeight() != output->getHeight()))) {
+        has_inputs = false;
+      }
+    }
+    if (has_inputs) {
+      operation->executeFullFrame(output, &rect, inputs);
+      return;
+    }
+  }
+
+  const int num_channels = output->get_num_channels();
+  if (operation->isComplex()) {
+    void *data = operation->initializeTileData(&rect);
+    for (int y = rect.ymin; y < rect.ymax; y++) {
+      float *elem = output->get_elem(rect.xmin, y);
+      for (int x = rect.xmin; x < rect.xmax; x++) {
+        operation->read(elem, x, y, data);
+        elem += num_channels;
+      }
+    }
+    if (data) {
+      operation->deinitializeTileData(&rect, data);
+    }
+  }
+  else {
+    for (int y = rect.ymin; y < rect.ymax; y++) {
+      float *elem = output->get_elem(rect.xmin, y);
+      for (int x = rect.xmin; x < rect.xmax; x++) {
+        operation->readSampled(elem, x, y, COM_PS_NEAREST);
+        elem += num_channels;
+      }
+    }
+  }
+}
+
+void FullFrameExecution::calculateOperation(NodeOperation *operation)
+{
+  OperationData &data = m_data[operation];
+  if (!data.has_area || operation->isReadBufferOperation()) {
+    return;
+  }
+
+  MemoryBuffer *output = nullptr;
+  if (isBuffered(operation)) {
+    const DataType datatype = operation->getOutputSocket()->getDataType();
+    rcti rect;
+    if (operation->isSetOperation() && !data.has_complex_reader) {
+      /* Constants are stored once, complex readers access buffers directly so they get a
+       * buffer of the whole resolution like any other operation. */
+      BLI_rcti_init(&rect, 0, 1, 0, 1);
+      output = new MemoryBuffer(datatype, &rect);
+      output->set_single_elem(true);
+      float elem[4];
+      operation->readSampled(elem, 0, 0, COM_PS_NEAREST);
+      memcpy(output->getBuffer(), elem, sizeof(float) * output->get_num_channels());
+      data.buffer_operation->setBuffer(output);
+      return;
+    }
+
+    BLI_rcti_init(&rect, 0, operation->getWidth(), 0, operation->getHeight());
+    output = new MemoryBuffer(datatype, &rect);
+    if (!BLI_rcti_compare(&rect, &data.area)) {
+      /* Readers sampling outside of their area of interest read black. */
+      output->clear();
+    }
+  }
+
+  std::vector<MemoryBuffer *> inputs(operation->getNumberOfInputSockets(), nullptr);
+  for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+    NodeOperationInput *input = operation->getInputSocket(i);
+    if (input->isConnected()) {
+      BufferOperation *buffer_operation = dynamic_cast<BufferOperation *>(
+          &input->getLink()->getOperation());
+      if (buffer_operation) {
+        inputs[i] = buffer_operation->getBuffer();
+      }
+    }
+  }
+
+  CalculateAreaData task_data;
+  task_data.execution = this;
+  task_data.operation = operation;
+  task_data.output = output;
+  task_data.inputs = inputs.data();
+  task_data.area = &data.area;
+  task_data.btree = m_context.getbNodeTree();
+
+  if (operation->isSingleThreaded()) {
+    calculateArea(operation, output, inputs.data(), &data.area);
+  }
+  else {
+    const int height = max(BLI_rcti_size_y(&data.area), 0);
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(0,
+                            (height + COM_FULL_FRAME_ROWS_PER_TASK - 1) /
+                                COM_FULL_FRAME_ROWS_PER_TASK,
+                            &task_data,
+                            calculate_area_task,
+                            &settings);
+  }
+
+  if (output) {
+    data.buffer_operation->setBuffer(output);
+  }
+}
+
+void FullFrameExecution::freeInputBuffers(NodeOperation *operation)
+{
+  for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+    NodeOperationInput *input = operation->getInputSocket(i);
+    if (!input->isConnected()) {
+      continue;
+    }
+    BufferOperation *buffer_operation = dynamic_cast<BufferOperation *>(
+        &input->getLink()->getOperation());
+    if (buffer_operation == nullptr) {
+      continue;
+    }
+    OperationData &data = m_data[buffer_operation->getOperation()];
+    if (data.fused) {
+      /* Calculated together with this operation, so done with its inputs as well. */
+      freeInputBuffers(buffer_operation->getOperation());
+    }
+    data.readers--;
+    if (data.readers == 0) {
+      freeBuffer(data);
+    }
+  }
+}
+
+void FullFrameExecution::freeBuffer(OperationData &data)
+{
+  if (!data.in_cache) {
+    delete data.buffer_operation->getBuffer();
+  }
+  data.buffer_operation->setBuffer(nullptr);
+}
+
+void FullFrameExecution::updateProgress()
+{
+  const bNodeTree *btree = m_context.getbNodeTree();
+  btree->progress(btree->prh, (float)m_operationsFinished / (float)m_numberOfOperations);
+
+  char buf[128];
+  BLI_snprintf(buf,
+               sizeof(buf),
+               TIP_("Compositing | Operation %u-%u"),
+               m_operationsFinished,
+               m_numberOfOperations);
+  btree->stats_draw(btree->sdh, buf);
+}
+
+void FullFrameExecution::execute()
+{
+  const bNodeTree *btree = m_context.getbNodeTree();
+  unsigned int index;
+
+  linkBufferOperations();
+
+  /* Same initialization order as the tiled execution: read buffers need their memory proxies
+   * allocated by the write buffers. */
+  for (index = 0; index < m_operations.size(); index++) {
+    NodeOperation *operation = m_operations[index];
+    if (operation->isWriteBufferOperation()) {
+      operation->setbNodeTree(btree);
+      operation->initExecution();
+    }
+  }
+  for (index = 0; index < m_operations.size(); index++) {
+    NodeOperation *operation = m_operations[index];
+    if (operation->isReadBufferOperation()) {
+      ((ReadBufferOperation *)operation)->updateMemoryBuffer();
+    }
+  }
+  for (index = 0; index < m_operations.size(); index++) {
+    NodeOperation *operation = m_operations[index];
+    if (!operation->isWriteBufferOperation()) {
+      operation->setbNodeTree(btree);
+      operation->initExecution();
+    }
+  }
+
+  /* Areas of interest may depend on settings read in initExecution. */
+  determineAreasOfInterest();
+  const size_t cache_limit = (size_t)btree->cache_limit * 1024 * 1024;
+  if (m_useCache) {
+    ResultCache::beginExecution(cache_limit);
+    determineKeys();
+  }
+  else {
+    /* Renders don't store results but keep those of editing within the limit of the tree,
+     * without a limit the results of earlier executions are freed. */
+    ResultCache::trim(m_context.isRendering() ? cache_limit : 0);
+  }
+  determineRequiredOperations();
+  determineFusedOperations();
+  for (index = 0; index < m_operations.size(); index++) {
+    if (m_data[m_operations[index]].required) {
+      m_numberOfOperations++;
+    }
+  }
+
+  for (index = 0; index < m_operations.size(); index++) {
+    if (btree->test_break && btree->test_break(btree->tbh)) {
+      break;
+    }
+    NodeOperation *operation = m_operations[index];
+    OperationData &data = m_data[operation];
+    if (!data.required) {
+      continue;
+    }
+    if (data.in_cache) {
+      ResultCache::addHit();
+    }
+    else if (data.fused) {
+      /* Calculated by its reader. */
+    }
+    else if (!data.calculated) {
+      calculateOperation(operation);
+      data.calculated = true;
+      freeInputBuffers(operation);
+
+      /* Results of cancelled executions are incomplete. */
+      if (data.cacheable && !(btree->test_break && btree->test_break(btree->tbh))) {
+        ResultCache::addMiss();
+        data.in_cache = ResultCache::store(
+            data.key, data.buffer_operation->getBuffer(), &data.area);
+      }
+    }
+
+    m_operationsFinished++;
+    updateProgress();
+  }
+
+  btree->stats_draw(btree->sdh, TIP_("Compositing | De-initializing execution"));
+  for (index = 0; index < m_operations.size(); index++) {
+    m_operations[index]->deinitExecution();
+  }
+  unlinkBufferOperations();
+}
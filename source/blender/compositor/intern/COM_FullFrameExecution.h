@@ -0,0 +1,144 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#pragma once
+
+#include "COM_CompositorContext.h"
+#include "COM_NodeOperation.h"
+
+#include <map>
+#include <vector>
+
+class BufferOperation;
+
+/**
+ * \brief Full-frame execution model.
+ *
+ * Instead of pulling tiles of pixels through execution groups, every operation is calculated
+ * into a MemoryBuffer of its own before the operations reading it are calculated:
+ * - operations are visited in topological order (see NodeOperationBuilder.sort_operations).
+ * - the links between operations are replaced by BufferOperation's that read the calculated
+ *   buffers, so all existing operations can be used unchanged.
+ * - the area of interest of every operation is determined backwards from the outputs, using
+ *   NodeOperation.determineDependingAreaOfInterest, only these areas are calculated.
+ * - operations that support it calculate their areas in tight loops over the input buffers
+ *   (NodeOperation.executeFullFrame), others are evaluated pixel by pixel.
+ * - pointwise operations calculate rows of pixels at once (NodeOperation.executeRow). A pointwise
+ *   operation read by a single pointwise operation of the same size is fused into its reader: it
+ *   gets no buffer, its rows are calculated on the stack right before the reader needs them.
+ * - the buffer of an operation is freed as soon as its last reader has been calculated.
+ * - when editing with a cache limit, results are kept in the ResultCache. Operations found in
+ *   the cache are not calculated, neither are inputs only they need, so only the part of the
+ *   tree affected by a change is calculated again.
+ *
+ * Explicit ReadBufferOperation/WriteBufferOperation pairs are kept, their write buffers are
+ * calculated over their whole resolution.
+ * \see CompositorContext.getExecutionModel
+ */
+class FullFrameExecution {
+ private:
+  struct OperationData {
+    /** Area that readers need, valid when has_area is set. */
+    rcti area;
+    bool has_area;
+    /** Stand-in the readers of this operation are linked to. */
+    BufferOperation *buffer_operation;
+    /** The buffer needs to cover the whole resolution, as a complex operation reads it. */
+    bool has_complex_reader;
+    /** Number of input sockets that still have to read the buffer. */
+    int readers;
+    /** Needed by an output, directly or through other operations. */
+    bool required;
+    /** Key of the result in the ResultCache, zero when the result can't be identified. */
+    uint64_t key;
+    /** The result may be stored in the ResultCache. */
+    bool cacheable;
+    /** The buffer is owned by the ResultCache. */
+    bool in_cache;
+    /** The buffer has been calculated already, while determining the keys. */
+    bool calculated;
+    /** Calculated in rows with NodeOperation.executeRow. */
+    bool use_rows;
+    /** Calculated row by row by its reader, the operation has no buffer. */
+    bool fused;
+    /** Number of fused operations between this operation and the reader that has a buffer. */
+    int fused_depth;
+  };
+
+  const CompositorContext &m_context;
+  const std::vector<NodeOperation *> &m_operations;
+
+  std::map<NodeOperation *, OperationData> m_data;
+
+  /** Original links, restored after execution. */
+  std::vector<std::pair<NodeOperationInput *, NodeOperationOutput *>> m_links;
+
+  /** Keep results in the ResultCache between executions. */
+  bool m_useCache;
+  uint64_t m_contextHash;
+
+  unsigned int m_operationsFinished;
+  unsigned int m_numberOfOperations;
+
+ public:
+  FullFrameExecution(const CompositorContext &context,
+                     const std::vector<NodeOperation *> &operations);
+  ~FullFrameExecution();
+
+  /**
+   * \brief calculate all output operations
+   * \note operations are initialized and deinitialized here as well
+   */
+  void execute();
+
+  /**
+   * \brief calculate a part of the area of interest of an operation
+   * \note called from multiple threads at once
+   * \param output: buffer of the operation, nullptr for outputs and write buffers
+   */
+  void calculateArea(NodeOperation *operation,
+                     MemoryBuffer *output,
+                     MemoryBuffer **inputs,
+                     const rcti *area);
+
+ private:
+  static bool isBuffered(const NodeOperation *operation);
+  bool isOutput(NodeOperation *operation) const;
+
+  void linkBufferOperations();
+  void unlinkBufferOperations();
+  void determineAreasOfInterest();
+  void addAreaOfInterest(NodeOperation *operation, const rcti *area);
+  void determineKeys();
+  uint64_t determineKey(NodeOperation *operation);
+  void determineRequiredOperations();
+  bool canUseRows(NodeOperation *operation) const;
+  bool canFuse(NodeOperation *operation, NodeOperation *reader) const;
+  void determineFusedOperations();
+
+  const OperationData &getData(NodeOperation *operation) const;
+  void calculateOperation(NodeOperation *operation);
+  void calculateRow(NodeOperation *operation, float *output, int x, int y, int length) const;
+  void freeInputBuffers(NodeOperation *operation);
+  void freeBuffer(OperationData &data);
+  void updateProgress();
+
+#ifdef WITH_CXX_GUARDEDALLOC
+  MEM_CXX_CLASS_ALLOC_FUNCS("COM:FullFrameExecution")
+#endif
+};
@@ -62,6 +62,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, r
       sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
   this->m_state = COM_MB_ALLOCATED;
   this->m_datatype = memoryProxy->getDataType();
+  this->m_is_single_elem = false;
 }
 
 MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
@@ -76,6 +77,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
       sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
   this->m_state = COM_MB_TEMPORARILY;
   this->m_datatype = memoryProxy->getDataType();
+  this->m_is_single_elem = false;
 }
 MemoryBuffer::MemoryBuffer(DataType dataType, rcti *rect)
 {
@@ -90,6 +92,7 @@ MemoryBuffer::MemoryBuffer(DataType dataType, rcti *rect)
       sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
   this->m_state = COM_MB_TEMPORARILY;
   this->m_datatype = dataType;
+  this->m_is_single_elem = false;
 }
 MemoryBuffer *MemoryBuffer::duplicate()
 {
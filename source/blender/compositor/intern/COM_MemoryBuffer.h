@@ -94,6 +94,12 @@ class MemoryBuffer {
   int m_width;
   int m_height;
 
+  /**
+   * \brief the buffer holds a single element that stands for every pixel of the operation.
+   * Only used by full-frame execution for constant operations.
+   */
+  bool m_is_single_elem;
+
  public:
   /**
    * \brief construct new MemoryBuffer for a chunk
@@ -128,6 +134,11 @@ class MemoryBuffer {
     return this->m_num_channels;
   }
 
+  DataType get_data_type() const
+  {
+    return this->m_datatype;
+  }
+
   /**
    * \brief get the data of this MemoryBuffer
    * \note buffer should already be available in memory
@@ -137,6 +148,41 @@ class MemoryBuffer {
     return this->m_buffer;
   }
 
+  /**
+   * \brief does this buffer hold a single element for every pixel
+   */
+  bool is_single_elem() const
+  {
+    return this->m_is_single_elem;
+  }
+
+  void set_single_elem(bool single_elem)
+  {
+    BLI_assert(!single_elem || (this->m_width == 1 && this->m_height == 1));
+    this->m_is_single_elem = single_elem;
+  }
+
+  /**
+   * \brief get a pointer to the element at x, y.
+   * \note x, y must be inside the rect of the buffer, unless it is a single element buffer.
+   */
+  float *get_elem(int x, int y)
+  {
+    if (this->m_is_single_elem) {
+      return this->m_buffer;
+    }
+    return &this->m_buffer[((y - this->m_rect.ymin) * this->m_width + (x - this->m_rect.xmin)) *
+                           this->m_num_channels];
+  }
+
+  /**
+   * \brief number of floats between two horizontally neighboring elements
+   */
+  int elem_stride() const
+  {
+    return this->m_is_single_elem ? 0 : this->m_num_channels;
+  }
+
   /**
    * \brief after execution the state will be set to available by calling this method
    */
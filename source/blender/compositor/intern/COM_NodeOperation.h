@@ -102,6 +102,31 @@ class NodeOperation : public SocketReader {
    */
   bool m_openCL;
 
+  /**
+   * \brief does this operation implement executeFullFrame.
+   * Other operations are evaluated per pixel during full-frame execution.
+   */
+  bool m_fullFrame;
+
+  /**
+   * \brief does this operation implement executeRow.
+   * The output of a pointwise operation at a pixel only depends on the inputs at the same pixel.
+   */
+  bool m_pointwise;
+
+  /**
+   * \brief identifies the node and settings this operation was converted from.
+   * Zero for operations added by the NodeOperationBuilder.
+   * \see ResultCache
+   */
+  uint64_t m_nodeHash;
+
+  /**
+   * \brief can the results of this operation be kept in the ResultCache.
+   * Cleared for operations depending on data that isn't part of their key.
+   */
+  bool m_cacheable;
+
   /**
    * \brief mutex reference for very special node initializations
    * \note only use when you really know what you are doing.
@@ -243,6 +268,35 @@ class NodeOperation : public SocketReader {
                              list<cl_kernel> * /*clKernelsToCleanUp*/)
   {
   }
+  /**
+   * \brief calculate an area of the output during full-frame execution
+   * \note only called when supportsFullFrame is set, otherwise the executePixel methods are used
+   * \ingroup execution
+   * \param output: buffer of this operation covering its whole resolution
+   * \param area: the area of the output to calculate
+   * \param inputs: buffers of the input operations, one for every input socket
+   */
+  virtual void executeFullFrame(MemoryBuffer * /*output*/,
+                                const rcti * /*area*/,
+                                MemoryBuffer ** /*inputs*/)
+  {
+  }
+  /**
+   * \brief calculate a row of elements during full-frame execution
+   * \note only called when isPointwise is set
+   * \ingroup execution
+   * \param output: contiguous elements of this operation
+   * \param inputs: first element of every input socket
+   * \param input_strides: floats between two elements of an input, zero for a single element
+   * \param length: number of elements in the row
+   * \see RowKernels
+   */
+  virtual void executeRow(float * /*output*/,
+                          const float ** /*inputs*/,
+                          const int * /*input_strides*/,
+                          int /*length*/)
+  {
+  }
   virtual void deinitExecution();
 
   bool isResolutionSet()
@@ -276,6 +330,42 @@ class NodeOperation : public SocketReader {
     return this->m_complex;
   }
 
+  void setNodeHash(uint64_t nodeHash)
+  {
+    this->m_nodeHash = nodeHash;
+  }
+  uint64_t getNodeHash() const
+  {
+    return this->m_nodeHash;
+  }
+
+  void setCacheable(bool cacheable)
+  {
+    this->m_cacheable = cacheable;
+  }
+  bool isCacheable() const
+  {
+    return this->m_cacheable;
+  }
+
+  /**
+   * \brief can this operation calculate whole areas at once during full-frame execution
+   * \see NodeOperation.executeFullFrame
+   */
+  bool supportsFullFrame() const
+  {
+    return this->m_fullFrame;
+  }
+
+  /**
+   * \brief can this operation calculate rows of pixels from rows of its inputs
+   * \see NodeOperation.executeRow
+   */
+  bool isPointwise() const
+  {
+    return this->m_pointwise;
+  }
+
   virtual bool isSetOperation() const
   {
     return false;
@@ -420,6 +510,22 @@ class NodeOperation : public SocketReader {
     this->m_openCL = openCL;
   }
 
+  /**
+   * \brief set if this NodeOperation implements executeFullFrame
+   */
+  void setFullFrameSupport(bool fullFrame)
+  {
+    this->m_fullFrame = fullFrame;
+  }
+
+  /**
+   * \brief set if this NodeOperation implements executeRow
+   */
+  void setPointwise(bool pointwise)
+  {
+    this->m_pointwise = pointwise;
+  }
+
   /* allow the DebugInfo class to look at internals */
   friend class DebugInfo;
 
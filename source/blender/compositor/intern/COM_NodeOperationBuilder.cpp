@@ -28,6 +28,7 @@
 #include "COM_NodeOperation.h"
 #include "COM_PreviewOperation.h"
 #include "COM_ReadBufferOperation.h"
+#include "COM_ResultCache.h"
 #include "COM_SetColorOperation.h"
 #include "COM_SetValueOperation.h"
 #include "COM_SetVectorOperation.h"
@@ -56,9 +57,19 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
     Node *node = (Node *)m_graph.nodes()[index];
 
     m_current_node = node;
+    const unsigned int first_operation = m_operations.size();
 
     DebugInfo::node_to_operations(node);
     node->convertToOperations(converter, *m_context);
+
+    /* identify the operations of the node for the result cache */
+    const bNode *b_node = node->getbNode();
+    const uint64_t node_hash = ResultCache::hashNode(b_node);
+    for (unsigned int i = first_operation; i < m_operations.size(); i++) {
+      NodeOperation *op = m_operations[i];
+      op->setNodeHash(ResultCache::hashCombine(node_hash, i - first_operation));
+      op->setCacheable(ResultCache::isCacheable(b_node, op));
+    }
   }
 
   m_current_node = nullptr;
@@ -104,8 +115,13 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 
   determineResolutions();
 
-  /* surround complex ops with read/write buffer */
-  add_complex_operation_buffers();
+  const bool full_frame = m_context->getExecutionModel() == COM_EM_FULL_FRAME;
+
+  /* surround complex ops with read/write buffer,
+   * full-frame execution calculates every operation into a buffer already */
+  if (!full_frame) {
+    add_complex_operation_buffers();
+  }
 
   /* links not available from here on */
   /* XXX make m_links a local variable to avoid confusion! */
@@ -113,11 +129,14 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 
   prune_operations();
 
-  /* ensure topological (link-based) order of nodes */
-  /*sort_operations();*/ /* not needed yet */
-
-  /* create execution groups */
-  group_operations();
+  if (full_frame) {
+    /* ensure topological (link-based) order of nodes, operations are calculated in this order */
+    sort_operations();
+  }
+  else {
+    /* create execution groups */
+    group_operations();
+  }
 
   /* transfer resulting operations to the system */
   system->set_operations(m_operations, m_groups);
@@ -666,6 +685,13 @@ static void sort_operations_recursive(NodeOperationBuilder::Operations &sorted,
     }
   }
 
+  /* read buffers depend on their write buffer */
+  if (op->isReadBufferOperation()) {
+    ReadBufferOperation *read_op = (ReadBufferOperation *)op;
+    MemoryProxy *memproxy = read_op->getMemoryProxy();
+    sort_operations_recursive(sorted, visited, memproxy->getWriteBufferOperation());
+  }
+
   sorted.push_back(op);
 }
 
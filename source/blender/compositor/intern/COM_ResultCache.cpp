@@ -0,0 +1,319 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#include "COM_ResultCache.h"
+#include "COM_NodeOperation.h"
+
+#include <cstring>
+#include <map>
+
+#include "BLI_listbase.h"
+#include "BLI_rect.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_color_types.h"
+#include "DNA_node_types.h"
+
+#include "BKE_node.h"
+
+#include "MEM_guardedalloc.h"
+
+struct CacheEntry {
+  MemoryBuffer *buffer;
+  /** Part of the buffer that holds calculated pixels. */
+  rcti area;
+  size_t size;
+  /** Execution that used the entry last. */
+  unsigned int last_used;
+};
+
+static std::map<uint64_t, CacheEntry> g_entries;
+static size_t g_size = 0;
+static size_t g_limit = 0;
+static unsigned int g_execution = 0;
+static int g_hits = 0;
+static int g_misses = 0;
+
+static size_t buffer_size(MemoryBuffer *buffer)
+{
+  return sizeof(float) * buffer->get_num_channels() * buffer->getWidth() * buffer->getHeight();
+}
+
+static void remove_entry(std::map<uint64_t, CacheEntry>::iterator it)
+{
+  g_size -= it->second.size;
+  delete it->second.buffer;
+  g_entries.erase(it);
+}
+
+/* Evict least recently used entries not used by the current execution. */
+static bool evict_until(size_t size)
+{
+  while (g_size > size) {
+    std::map<uint64_t, CacheEntry>::iterator oldest = g_entries.end();
+    for (std::map<uint64_t, CacheEntry>::iterator it = g_entries.begin(); it != g_entries.end();
+         ++it) {
+      if (it->second.last_used != g_execution &&
+          (oldest == g_entries.end() || it->second.last_used < oldest->second.last_used)) {
+        oldest = it;
+      }
+    }
+    if (oldest == g_entries.end()) {
+      return false;
+    }
+    remove_entry(oldest);
+  }
+  return true;
+}
+
+void ResultCache::beginExecution(size_t limit)
+{
+  trim(limit);
+  resetStatistics();
+}
+
+void ResultCache::trim(size_t limit)
+{
+  /* Entries of the previous execution can be evicted too. */
+  g_execution++;
+  g_limit = limit;
+  evict_until(limit);
+}
+
+MemoryBuffer *ResultCache::lookup(uint64_t key, const rcti *area)
+{
+  std::map<uint64_t, CacheEntry>::iterator it = g_entries.find(key);
+  if (it == g_entries.end() || !BLI_rcti_inside_rcti(&it->second.area, area)) {
+    return nullptr;
+  }
+  it->second.last_used = g_execution;
+  return it->second.buffer;
+}
+
+bool ResultCache::store(uint64_t key, MemoryBuffer *buffer, const rcti *area)
+{
+  std::map<uint64_t, CacheEntry>::iterator it = g_entries.find(key);
+  if (it != g_entries.end()) {
+    if (it->second.last_used == g_execution) {
+      /* Still read by the current execution. */
+      return false;
+    }
+    remove_entry(it);
+  }
+
+  const size_t size = buffer_size(buffer);
+  if (size > g_limit || !evict_until(g_limit - size)) {
+    return false;
+  }
+
+  CacheEntry entry;
+  entry.buffer = buffer;
+  entry.area = *area;
+  entry.size = size;
+  entry.last_used = g_execution;
+  g_entries[key] = entry;
+  g_size += size;
+  return true;
+}
+
+void ResultCache::clear()
+{
+  while (!g_entries.empty()) {
+    remove_entry(g_entries.begin());
+  }
+  BLI_assert(g_size == 0);
+}
+
+void ResultCache::resetStatistics()
+{
+  g_hits = 0;
+  g_misses = 0;
+}
+
+void ResultCache::addHit()
+{
+  g_hits++;
+}
+
+void ResultCache::addMiss()
+{
+  g_misses++;
+}
+
+void ResultCache::getStatistics(int *r_hits, int *r_misses)
+{
+  *r_hits = g_hits;
+  *r_misses = g_misses;
+}
+
+uint64_t ResultCache::hashCombine(uint64_t hash, uint64_t value)
+{
+  return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 12) + (hash >> 4));
+}
+
+uint64_t ResultCache::hashBytes(uint64_t hash, const void *data, size_t len)
+{
+  /* FNV-1a over 64 bit words, this has to be fast for hashing whole images. */
+  const unsigned char *bytes = (const unsigned char *)data;
+  uint64_t word;
+  hash ^= 0xcbf29ce484222325ULL;
+  while (len >= sizeof(word)) {
+    memcpy(&word, bytes, sizeof(word));
+    hash = (hash ^ word) * 0x100000001b3ULL;
+    bytes += sizeof(word);
+    len -= sizeof(word);
+  }
+  while (len > 0) {
+    hash = (hash ^ *bytes) * 0x100000001b3ULL;
+    bytes++;
+    len--;
+  }
+  return hash ^ (hash >> 29);
+}
+
+bool ResultCache::isCacheable(const bNode *bnode, const NodeOperation *operation)
+{
+  if (bnode == nullptr || bnode->id == nullptr || operation->isInputOperation()) {
+    return true;
+  }
+  /* These nodes only read their ID in input operations, which are keyed by their results. */
+  return ELEM(bnode->type,
+              CMP_NODE_IMAGE,
+              CMP_NODE_R_LAYERS,
+              CMP_NODE_MOVIECLIP,
+              CMP_NODE_MASK,
+              CMP_NODE_VIEWER,
+              CMP_NODE_SPLITVIEWER,
+              CMP_NODE_COMPOSITE);
+}
+
+static uint64_t hash_curve_mapping(uint64_t hash, const CurveMapping *cumap)
+{
+  hash = ResultCache::hashCombine(hash, cumap->flag);
+  hash = ResultCache::hashCombine(hash, cumap->preset);
+  hash = ResultCache::hashBytes(hash, &cumap->clipr, sizeof(cumap->clipr));
+  hash = ResultCache::hashBytes(hash, cumap->black, sizeof(cumap->black));
+  hash = ResultCache::hashBytes(hash, cumap->white, sizeof(cumap->white));
+  hash = ResultCache::hashCombine(hash, cumap->tone);
+  for (int i = 0; i < CM_TOT; i++) {
+    const CurveMap *cuma = &cumap->cm[i];
+    hash = ResultCache::hashCombine(hash, cuma->totpoint);
+    hash = ResultCache::hashBytes(hash, cuma->ext_in, sizeof(cuma->ext_in));
+    hash = ResultCache::hashBytes(hash, cuma->ext_out, sizeof(cuma->ext_out));
+    for (int a = 0; a < cuma->totpoint; a++) {
+      /* Point selection doesn't change the curve. */
+      const CurveMapPoint *point = &cuma->curve[a];
+      hash = ResultCache::hashBytes(hash, &point->x, sizeof(float[2]));
+      hash = ResultCache::hashCombine(hash, point->flag & ~CUMA_SELECT);
+    }
+  }
+  return hash;
+}
+
+uint64_t ResultCache::hashNode(const bNode *bnode)
+{
+  if (bnode == nullptr) {
+    return 0;
+  }
+
+  /* Only settings, not the selection, location or other UI state. */
+  uint64_t hash = hashBytes(0, bnode->idname, strlen(bnode->idname));
+  hash = hashCombine(hash, bnode->type);
+  hash = hashCombine(hash, bnode->flag & NODE_MUTED);
+  hash = hashCombine(hash, (uint64_t)bnode->custom1);
+  hash = hashCombine(hash, (uint64_t)bnode->custom2);
+  hash = hashBytes(hash, &bnode->custom3, sizeof(float));
+  hash = hashBytes(hash, &bnode->custom4, sizeof(float));
+  hash = hashCombine(hash, (uint64_t)(uintptr_t)bnode->id);
+
+  if (bnode->storage) {
+    if (ELEM(bnode->type,
+             CMP_NODE_CURVE_RGB,
+             CMP_NODE_CURVE_VEC,
+             CMP_NODE_TIME,
+             CMP_NODE_HUECORRECT)) {
+      /* Curves are duplicated with the node tree, hash their points instead of pointers. */
+      hash = hash_curve_mapping(hash, (const CurveMapping *)bnode->storage);
+    }
+    else if (bnode->type == CMP_NODE_CRYPTOMATTE) {
+      /* The matte string is duplicated with the node tree, and may be reallocated at the same
+       * address after editing it, hash its contents instead of the pointer. */
+      const NodeCryptomatte *crypto = (const NodeCryptomatte *)bnode->storage;
+      hash = hashBytes(hash, crypto->add, sizeof(crypto->add));
+      hash = hashBytes(hash, crypto->remove, sizeof(crypto->remove));
+      hash = hashCombine(hash, crypto->num_inputs);
+      if (crypto->matte_id) {
+        hash = hashBytes(hash, crypto->matte_id, strlen(crypto->matte_id));
+      }
+    }
+    else {
+      /* Other storage only holds settings, or pointers to original data that is not
+       * duplicated with the tree (the scene of image users). */
+      hash = hashBytes(hash, bnode->storage, MEM_allocN_len(bnode->storage));
+    }
+  }
+
+  /* Some nodes read unlinked input values while converting. */
+  LISTBASE_FOREACH (const bNodeSocket *, sock, &bnode->inputs) {
+    if (sock->default_value) {
+      hash = hashBytes(hash, sock->default_value, MEM_allocN_len(sock->default_value));
+    }
+  }
+  return hash;
+}
+
+uint64_t ResultCache::hashContext(const CompositorContext &context)
+{
+  uint64_t hash = hashCombine(0, context.getFramenumber());
+  hash = hashCombine(hash, context.getQuality());
+  hash = hashCombine(hash, context.isRendering());
+  hash = hashCombine(hash, context.isFastCalculation());
+
+  const RenderData *rd = context.getRenderData();
+  if (rd) {
+    hash = hashCombine(hash, rd->size);
+    hash = hashCombine(hash, rd->xsch);
+    hash = hashCombine(hash, rd->ysch);
+  }
+  if (context.getViewName()) {
+    hash = hashBytes(hash, context.getViewName(), strlen(context.getViewName()));
+  }
+
+  const ColorManagedViewSettings *view_settings = context.getViewSettings();
+  if (view_settings) {
+    hash = hashCombine(hash, view_settings->flag);
+    hash = hashBytes(hash, view_settings->look, sizeof(view_settings->look));
+    hash = hashBytes(hash, view_settings->view_transform, sizeof(view_settings->view_transform));
+    hash = hashBytes(hash, &view_settings->exposure, sizeof(float));
+    hash = hashBytes(hash, &view_settings->gamma, sizeof(float));
+    if (view_settings->curve_mapping) {
+      hash = hash_curve_mapping(hash, view_settings->curve_mapping);
+    }
+  }
+  const ColorManagedDisplaySettings *display_settings = context.getDisplaySettings();
+  if (display_settings) {
+    hash = hashBytes(
+        hash, display_settings->display_device, sizeof(display_settings->display_device));
+  }
+  return hash;
+}
+
+uint64_t ResultCache::hashBuffer(MemoryBuffer *buffer)
+{
+  return hashBytes(0, buffer->getBuffer(), buffer_size(buffer));
+}
@@ -0,0 +1,90 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#pragma once
+
+#include "BLI_sys_types.h"
+
+#include "COM_CompositorContext.h"
+#include "COM_MemoryBuffer.h"
+
+class NodeOperation;
+struct bNode;
+
+/**
+ * \brief results of operations kept between executions of the compositor.
+ *
+ * Results are identified by a key hashing everything they depend on: the type and node settings
+ * of the operation, its resolution, the context and the keys of its inputs. Operations reading
+ * external data (images, render layers, ...) are calculated on every execution and keyed by the
+ * content of their result instead.
+ * Tweaking a node therefore changes the keys of that node and the nodes after it only, all other
+ * results can be reused by the next execution.
+ *
+ * Entries used by the current execution are never evicted, other entries are evicted least
+ * recently used first to stay within the memory limit.
+ * \note only accessed from the compositor execution, which is serialized by COM_execute.
+ * \see FullFrameExecution
+ * \ingroup Memory
+ */
+class ResultCache {
+ public:
+  /**
+   * \brief start of an execution, evict entries until the cache fits \a limit bytes
+   */
+  static void beginExecution(size_t limit);
+
+  /**
+   * \brief evict entries until the cache fits \a limit bytes, for executions not using the cache
+   */
+  static void trim(size_t limit);
+
+  /**
+   * \brief find the result of \a key covering \a area, the buffer stays owned by the cache.
+   */
+  static MemoryBuffer *lookup(uint64_t key, const rcti *area);
+
+  /**
+   * \brief try to add the result of \a key calculated over \a area.
+   * \return true when the cache took ownership of the buffer
+   */
+  static bool store(uint64_t key, MemoryBuffer *buffer, const rcti *area);
+
+  /**
+   * \brief free all entries
+   */
+  static void clear();
+
+  static void resetStatistics();
+  static void addHit();
+  static void addMiss();
+  static void getStatistics(int *r_hits, int *r_misses);
+
+  /**
+   * \brief can results of \a operation, converted from \a bnode, be cached.
+   * Data of ID's linked by nodes is not part of the keys.
+   */
+  static bool isCacheable(const struct bNode *bnode, const NodeOperation *operation);
+
+  /* Key construction. */
+  static uint64_t hashCombine(uint64_t hash, uint64_t value);
+  static uint64_t hashBytes(uint64_t hash, const void *data, size_t len);
+  static uint64_t hashNode(const struct bNode *bnode);
+  static uint64_t hashContext(const CompositorContext &context);
+  static uint64_t hashBuffer(MemoryBuffer *buffer);
+};
@@ -0,0 +1,116 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#include "COM_RowKernels.h"
+
+#include "BLI_system.h"
+
+#define COM_ROW_KERNEL_ARCH row_kernels_default
+#include "COM_RowKernels_impl.h"
+
+#ifdef WITH_COMPOSITOR_AVX2
+namespace row_kernels_avx2 {
+void fill_row_kernels(RowKernelFunc table[COM_RK_NUM]);
+}
+#endif
+
+struct RowKernelTable {
+  RowKernelFunc kernels[COM_RK_ISA_NUM][COM_RK_NUM];
+  RowKernelISA best_isa;
+
+  RowKernelTable()
+  {
+    for (int isa = 0; isa < COM_RK_ISA_NUM; isa++) {
+      for (int type = 0; type < COM_RK_NUM; type++) {
+        kernels[isa][type] = nullptr;
+      }
+    }
+    row_kernels_default::fill_row_kernels(kernels[COM_RK_ISA_DEFAULT]);
+    best_isa = COM_RK_ISA_DEFAULT;
+#ifdef WITH_COMPOSITOR_AVX2
+    if (BLI_cpu_support_avx2()) {
+      row_kernels_avx2::fill_row_kernels(kernels[COM_RK_ISA_AVX2]);
+      best_isa = COM_RK_ISA_AVX2;
+    }
+#endif
+  }
+};
+
+static const RowKernelTable &row_kernel_table()
+{
+  /* Initialized once by the first thread getting here. */
+  static RowKernelTable table;
+  return table;
+}
+
+RowKernelFunc RowKernels::get(RowKernelType type)
+{
+  const RowKernelTable &table = row_kernel_table();
+  return table.kernels[table.best_isa][type];
+}
+
+RowKernelFunc RowKernels::get(RowKernelType type, RowKernelISA isa)
+{
+  return row_kernel_table().kernels[isa][type];
+}
+
+const char *RowKernels::getName(RowKernelType type)
+{
+  switch (type) {
+    case COM_RK_MIX_ADD:
+      return "Mix Add";
+    case COM_RK_MIX_BLEND:
+      return "Mix Blend";
+    case COM_RK_MIX_MULTIPLY:
+      return "Mix Multiply";
+    case COM_RK_MIX_SUBTRACT:
+      return "Mix Subtract";
+    case COM_RK_MATH_ADD:
+      return "Math Add";
+    case COM_RK_MATH_SUBTRACT:
+      return "Math Subtract";
+    case COM_RK_MATH_MULTIPLY:
+      return "Math Multiply";
+    case COM_RK_MATH_DIVIDE:
+      return "Math Divide";
+    case COM_RK_MATH_MINIMUM:
+      return "Math Minimum";
+    case COM_RK_MATH_MAXIMUM:
+      return "Math Maximum";
+    case COM_RK_VALUE_TO_COLOR:
+      return "Value to Color";
+    case COM_RK_COLOR_TO_VALUE:
+      return "Color to Value";
+    case COM_RK_NUM:
+      break;
+  }
+  return "";
+}
+
+const char *RowKernels::getISAName(RowKernelISA isa)
+{
+  switch (isa) {
+    case COM_RK_ISA_DEFAULT:
+      return "Default";
+    case COM_RK_ISA_AVX2:
+      return "AVX2";
+    case COM_RK_ISA_NUM:
+      break;
+  }
+  return "";
+}
@@ -0,0 +1,92 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#pragma once
+
+/* Flags changing the behavior of the row kernels. */
+#define COM_ROW_CLAMP 1
+#define COM_ROW_VALUE_ALPHA_MULTIPLY 2
+
+/**
+ * \brief calculate a row of elements of a pointwise operation.
+ * \param output: contiguous elements of the output.
+ * \param inputs: first element of every input.
+ * \param input_strides: number of floats between two elements of an input,
+ * zero when the input holds a single element for the whole row.
+ * \param length: number of elements in the row.
+ * \param flags: COM_ROW_CLAMP, COM_ROW_VALUE_ALPHA_MULTIPLY.
+ */
+typedef void (*RowKernelFunc)(
+    float *output, const float **inputs, const int *input_strides, int length, int flags);
+
+/**
+ * \brief operations that have a vectorized row kernel.
+ *
+ * Mix kernels take a value factor and two colors, math kernels two values.
+ */
+typedef enum RowKernelType {
+  COM_RK_MIX_ADD,
+  COM_RK_MIX_BLEND,
+  COM_RK_MIX_MULTIPLY,
+  COM_RK_MIX_SUBTRACT,
+  COM_RK_MATH_ADD,
+  COM_RK_MATH_SUBTRACT,
+  COM_RK_MATH_MULTIPLY,
+  COM_RK_MATH_DIVIDE,
+  COM_RK_MATH_MINIMUM,
+  COM_RK_MATH_MAXIMUM,
+  COM_RK_VALUE_TO_COLOR,
+  COM_RK_COLOR_TO_VALUE,
+  COM_RK_NUM,
+} RowKernelType;
+
+/**
+ * \brief instruction sets the row kernels are compiled for.
+ */
+typedef enum RowKernelISA {
+  /** \brief the instruction set of the build (SSE2 on x86-64) */
+  COM_RK_ISA_DEFAULT,
+  COM_RK_ISA_AVX2,
+  COM_RK_ISA_NUM,
+} RowKernelISA;
+
+/**
+ * \brief vectorized kernels for pointwise operations.
+ *
+ * Kernels are compiled for every instruction set in RowKernelISA. The best one supported by the
+ * CPU is selected once at runtime.
+ *
+ * \see NodeOperation.executeRow
+ * \ingroup Execution
+ */
+class RowKernels {
+ public:
+  /**
+   * \brief get the kernel of the best instruction set the CPU supports
+   */
+  static RowKernelFunc get(RowKernelType type);
+
+  /**
+   * \brief get the kernel for a specific instruction set
+   * \return nullptr when the instruction set isn't compiled in or not supported by the CPU
+   */
+  static RowKernelFunc get(RowKernelType type, RowKernelISA isa);
+
+  static const char *getName(RowKernelType type);
+  static const char *getISAName(RowKernelISA isa);
+};
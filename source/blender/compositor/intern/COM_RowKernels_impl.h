@@ -0,0 +1,525 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+/* Row kernels, included by a translation unit for every instruction set after defining
+ * COM_ROW_KERNEL_ARCH to a namespace name. Each instruction set gets its own namespace so the
+ * different builds of the same functions don't clash when linking.
+ *
+ * Only include headers without inline code here, anything inline compiled with AVX2 enabled
+ * could end up being used by the other translation units. */
+
+#ifndef COM_ROW_KERNEL_ARCH
+#  error "COM_ROW_KERNEL_ARCH must be defined before including COM_RowKernels_impl.h"
+#endif
+
+#include "COM_RowKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define COM_ROW_KERNEL_SSE2
+#  include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#endif
+
+namespace COM_ROW_KERNEL_ARCH {
+
+/* -------------------------------------------------------------------- */
+/** \name Vector Types
+ * \{ */
+
+#ifdef COM_ROW_KERNEL_SSE2
+struct vfloat4 {
+  __m128 m;
+
+  vfloat4() = default;
+  vfloat4(__m128 m) : m(m)
+  {
+  }
+  vfloat4(float f) : m(_mm_set1_ps(f))
+  {
+  }
+  static vfloat4 load(const float *p)
+  {
+    return _mm_loadu_ps(p);
+  }
+  void store(float *p) const
+  {
+    _mm_storeu_ps(p, m);
+  }
+};
+
+static inline vfloat4 operator+(vfloat4 a, vfloat4 b)
+{
+  return _mm_add_ps(a.m, b.m);
+}
+static inline vfloat4 operator-(vfloat4 a, vfloat4 b)
+{
+  return _mm_sub_ps(a.m, b.m);
+}
+static inline vfloat4 operator*(vfloat4 a, vfloat4 b)
+{
+  return _mm_mul_ps(a.m, b.m);
+}
+static inline vfloat4 operator/(vfloat4 a, vfloat4 b)
+{
+  return _mm_div_ps(a.m, b.m);
+}
+static inline vfloat4 vmin(vfloat4 a, vfloat4 b)
+{
+  return _mm_min_ps(a.m, b.m);
+}
+static inline vfloat4 vmax(vfloat4 a, vfloat4 b)
+{
+  return _mm_max_ps(a.m, b.m);
+}
+static inline vfloat4 safe_divide(vfloat4 a, vfloat4 b)
+{
+  return _mm_and_ps(_mm_cmpneq_ps(b.m, _mm_setzero_ps()), _mm_div_ps(a.m, b.m));
+}
+static inline vfloat4 color_alpha(vfloat4 c)
+{
+  return _mm_shuffle_ps(c.m, c.m, _MM_SHUFFLE(3, 3, 3, 3));
+}
+/* Alpha of the first color, RGB of the second. */
+static inline vfloat4 color_keep_alpha(vfloat4 rgb, vfloat4 c)
+{
+  const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+  return _mm_or_ps(_mm_and_ps(mask, c.m), _mm_andnot_ps(mask, rgb.m));
+}
+#else
+/* Plain version for CPUs without SSE2, left to the auto-vectorization of the compiler. */
+struct vfloat4 {
+  float v[4];
+
+  vfloat4() = default;
+  vfloat4(float f) : v{f, f, f, f}
+  {
+  }
+  static vfloat4 load(const float *p)
+  {
+    vfloat4 r;
+    for (int i = 0; i < 4; i++) {
+      r.v[i] = p[i];
+    }
+    return r;
+  }
+  void store(float *p) const
+  {
+    for (int i = 0; i < 4; i++) {
+      p[i] = v[i];
+    }
+  }
+};
+
+#  define VFLOAT4_OP(name, expr) \
+    static inline vfloat4 name(vfloat4 a, vfloat4 b) \
+    { \
+      vfloat4 r; \
+      for (int i = 0; i < 4; i++) { \
+        r.v[i] = expr; \
+      } \
+      return r; \
+    }
+VFLOAT4_OP(operator+, a.v[i] + b.v[i])
+VFLOAT4_OP(operator-, a.v[i] - b.v[i])
+VFLOAT4_OP(operator*, a.v[i] * b.v[i])
+VFLOAT4_OP(operator/, a.v[i] / b.v[i])
+VFLOAT4_OP(vmin, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+VFLOAT4_OP(vmax, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+VFLOAT4_OP(safe_divide, b.v[i] != 0.0f ? a.v[i] / b.v[i] : 0.0f)
+#  undef VFLOAT4_OP
+
+static inline vfloat4 color_alpha(vfloat4 c)
+{
+  return vfloat4(c.v[3]);
+}
+static inline vfloat4 color_keep_alpha(vfloat4 rgb, vfloat4 c)
+{
+  rgb.v[3] = c.v[3];
+  return rgb;
+}
+#endif
+
+#ifdef __AVX2__
+struct vfloat8 {
+  __m256 m;
+
+  vfloat8() = default;
+  vfloat8(__m256 m) : m(m)
+  {
+  }
+  vfloat8(float f) : m(_mm256_set1_ps(f))
+  {
+  }
+  static vfloat8 load(const float *p)
+  {
+    return _mm256_loadu_ps(p);
+  }
+  void store(float *p) const
+  {
+    _mm256_storeu_ps(p, m);
+  }
+};
+
+static inline vfloat8 operator+(vfloat8 a, vfloat8 b)
+{
+  return _mm256_add_ps(a.m, b.m);
+}
+static inline vfloat8 operator-(vfloat8 a, vfloat8 b)
+{
+  return _mm256_sub_ps(a.m, b.m);
+}
+static inline vfloat8 operator*(vfloat8 a, vfloat8 b)
+{
+  return _mm256_mul_ps(a.m, b.m);
+}
+static inline vfloat8 operator/(vfloat8 a, vfloat8 b)
+{
+  return _mm256_div_ps(a.m, b.m);
+}
+static inline vfloat8 vmin(vfloat8 a, vfloat8 b)
+{
+  return _mm256_min_ps(a.m, b.m);
+}
+static inline vfloat8 vmax(vfloat8 a, vfloat8 b)
+{
+  return _mm256_max_ps(a.m, b.m);
+}
+static inline vfloat8 safe_divide(vfloat8 a, vfloat8 b)
+{
+  return _mm256_and_ps(_mm256_cmp_ps(b.m, _mm256_setzero_ps(), _CMP_NEQ_UQ),
+                       _mm256_div_ps(a.m, b.m));
+}
+static inline vfloat8 color_alpha(vfloat8 c)
+{
+  return _mm256_permute_ps(c.m, _MM_SHUFFLE(3, 3, 3, 3));
+}
+static inline vfloat8 color_keep_alpha(vfloat8 rgb, vfloat8 c)
+{
+  return _mm256_blend_ps(rgb.m, c.m, 0x88);
+}
+#endif
+
+static inline float vmin(float a, float b)
+{
+  return a < b ? a : b;
+}
+static inline float vmax(float a, float b)
+{
+  return a > b ? a : b;
+}
+static inline float safe_divide(float a, float b)
+{
+  return b != 0.0f ? a / b : 0.0f;
+}
+
+template<typename T> static inline T clamp01(T a)
+{
+  return vmin(vmax(a, T(0.0f)), T(1.0f));
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Packs
+ *
+ * A pack is the number of elements handled by one iteration of a row kernel. Colors are stored
+ * interleaved, values of a mix factor are repeated for every channel of their pixel.
+ * \{ */
+
+/* One RGBA pixel. */
+struct ColorPack1 {
+  typedef vfloat4 T;
+  static const int size = 1;
+
+  static T load(const float *p, int /*stride*/)
+  {
+    return vfloat4::load(p);
+  }
+  static T load_factor(const float *p, int /*stride*/)
+  {
+    return vfloat4(p[0]);
+  }
+};
+
+#ifdef __AVX2__
+/* Two RGBA pixels. */
+struct ColorPack2 {
+  typedef vfloat8 T;
+  static const int size = 2;
+
+  static T load(const float *p, int stride)
+  {
+    if (stride == 0) {
+      return _mm256_broadcast_ps((const __m128 *)p);
+    }
+    return vfloat8::load(p);
+  }
+  static T load_factor(const float *p, int stride)
+  {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(p[0])),
+                                _mm_set1_ps(p[stride]),
+                                1);
+  }
+};
+
+struct ValuePack8 {
+  typedef vfloat8 T;
+  static const int size = 8;
+
+  static T load(const float *p, int stride)
+  {
+    return (stride == 0) ? vfloat8(p[0]) : vfloat8::load(p);
+  }
+};
+#endif
+
+struct ValuePack4 {
+  typedef vfloat4 T;
+  static const int size = 4;
+
+  static T load(const float *p, int stride)
+  {
+    return (stride == 0) ? vfloat4(p[0]) : vfloat4::load(p);
+  }
+};
+
+struct ValuePack1 {
+  typedef float T;
+  static const int size = 1;
+
+  static T load(const float *p, int /*stride*/)
+  {
+    return p[0];
+  }
+};
+
+static inline void store(float *p, float f)
+{
+  *p = f;
+}
+template<typename T> static inline void store(float *p, const T &v)
+{
+  v.store(p);
+}
+
+#ifdef __AVX2__
+typedef ColorPack2 ColorPack;
+typedef ValuePack8 ValuePack;
+#else
+typedef ColorPack1 ColorPack;
+typedef ValuePack4 ValuePack;
+#endif
+/* Remaining elements at the end of a row. */
+typedef ColorPack1 ColorTailPack;
+typedef ValuePack1 ValueTailPack;
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Kernels
+ * \{ */
+
+/* Inputs: factor value, color 1, color 2. Alpha of the output is the alpha of color 1. */
+template<typename Pack, typename Func>
+static int mix_range(float *output,
+                     const float **inputs,
+                     const int *input_strides,
+                     int start,
+                     int length,
+                     int flags,
+                     Func func)
+{
+  int i = start;
+  for (; i + Pack::size <= length; i += Pack::size) {
+    typename Pack::T fac = Pack::load_factor(inputs[0] + i * input_strides[0], input_strides[0]);
+    typename Pack::T color1 = Pack::load(inputs[1] + i * input_strides[1], input_strides[1]);
+    typename Pack::T color2 = Pack::load(inputs[2] + i * input_strides[2], input_strides[2]);
+    if (flags & COM_ROW_VALUE_ALPHA_MULTIPLY) {
+      fac = fac * color_alpha(color2);
+    }
+    typename Pack::T result = color_keep_alpha(func(fac, color1, color2), color1);
+    if (flags & COM_ROW_CLAMP) {
+      result = clamp01(result);
+    }
+    store(output + i * 4, result);
+  }
+  return i;
+}
+
+template<typename Func>
+static void mix_row(float *output,
+                    const float **inputs,
+                    const int *input_strides,
+                    int length,
+                    int flags,
+                    Func func)
+{
+  int i = mix_range<ColorPack>(output, inputs, input_strides, 0, length, flags, func);
+  mix_range<ColorTailPack>(output, inputs, input_strides, i, length, flags, func);
+}
+
+/* Inputs: two values. */
+template<typename Pack, typename Func>
+static int math_range(float *output,
+                      const float **inputs,
+                      const int *input_strides,
+                      int start,
+                      int length,
+                      int flags,
+                      Func func)
+{
+  int i = start;
+  for (; i + Pack::size <= length; i += Pack::size) {
+    typename Pack::T a = Pack::load(inputs[0] + i * input_strides[0], input_strides[0]);
+    typename Pack::T b = Pack::load(inputs[1] + i * input_strides[1], input_strides[1]);
+    typename Pack::T result = func(a, b);
+    if (flags & COM_ROW_CLAMP) {
+      result = clamp01(result);
+    }
+    store(output + i, result);
+  }
+  return i;
+}
+
+template<typename Func>
+static void math_row(float *output,
+                     const float **inputs,
+                     const int *input_strides,
+                     int length,
+                     int flags,
+                     Func func)
+{
+  int i = math_range<ValuePack>(output, inputs, input_strides, 0, length, flags, func);
+  math_range<ValueTailPack>(output, inputs, input_strides, i, length, flags, func);
+}
+
+static void mix_add(
+    float *output, const float **inputs, const int *input_strides, int length, int flags)
+{
+  mix_row(output, inputs, input_strides, length, flags, [](auto fac, auto color1, auto color2) {
+    return color1 + fac * color2;
+  });
+}
+
+static void mix_blend(
+    float *output, const float **inputs, const int *input_strides, int length, int flags)
+{
+  mix_row(output, inputs, input_strides, length, flags, [](auto fac, auto color1, auto color2) {
+    return (decltype(fac)(1.0f) - fac) * color1 + fac * color2;
+  });
+}
+
+static void mix_multiply(
+    float *output, const float **inputs, const int *input_strides, int length, int flags)
+{
+  mix_row(output, inputs, input_strides, length, flags, [](auto fac, auto color1, auto color2) {
+    return color1 * ((decltype(fac)(1.0f) - fac) + fac * color2);
+  });
+}
+
+static void mix_subtract(
+    float *output, const float **inputs, const int *input_strides, int length, int flags)
+{
+  mix_row(output, inputs, input_strides, length, flags, [](auto fac, auto color1, auto color2) {
+    return color1 - fac * color2;
+  });
+}
+
+static void math_add(
+    float *output, const float **inputs, const int *input_strides, int length, int flags)
+{
+  math_row(output, inputs, input_strides, length, flags, [](auto a, auto b) { return a + b; });
+}
+
+static void math_subtract(
+    float *output, const float **inputs, const int *input_strides, int length, int flags)
+{
+  math_row(output, inputs, input_strides, length, flags, [](auto a, auto b) { return a - b; });
+}
+
+static void math_multiply(
+    float *output, const float **inputs, const int *input_strides, int length, int flags)
+{
+  math_row(output, inputs, input_strides, length, flags, [](auto a, auto b) { return a * b; });
+}
+
+static void math_divide(
+    float *output, const float **inputs, const int *input_strides, int length, int flags)
+{
+  math_row(output, inputs, input_strides, length, flags, [](auto a, auto b) {
+    return safe_divide(a, b);
+  });
+}
+
+static void math_minimum(
+    float *output, const float **inputs, const int *input_strides, int length, int flags)
+{
+  math_row(
+      output, inputs, input_strides, length, flags, [](auto a, auto b) { return vmin(a, b); });
+}
+
+static void math_maximum(
+    float *output, const float **inputs, const int *input_strides, int length, int flags)
+{
+  math_row(
+      output, inputs, input_strides, length, flags, [](auto a, auto b) { return vmax(a, b); });
+}
+
+/* Conversions are plain loops, vectorized by the compiler for the instruction set. */
+static void value_to_color(
+    float *output, const float **inputs, const int *input_strides, int length, int /*flags*/)
+{
+  const float *value = inputs[0];
+  const int stride = input_strides[0];
+  for (int i = 0; i < length; i++, value += stride, output += 4) {
+    output[0] = output[1] = output[2] = value[0];
+    output[3] = 1.0f;
+  }
+}
+
+static void color_to_value(
+    float *output, const float **inputs, const int *input_strides, int length, int /*flags*/)
+{
+  const float *color = inputs[0];
+  const int stride = input_strides[0];
+  for (int i = 0; i < length; i++, color += stride) {
+    output[i] = (color[0] + color[1] + color[2]) / 3.0f;
+  }
+}
+
+/** \} */
+
+void fill_row_kernels(RowKernelFunc table[COM_RK_NUM])
+{
+  table[COM_RK_MIX_ADD] = mix_add;
+  table[COM_RK_MIX_BLEND] = mix_blend;
+  table[COM_RK_MIX_MULTIPLY] = mix_multiply;
+  table[COM_RK_MIX_SUBTRACT] = mix_subtract;
+  table[COM_RK_MATH_ADD] = math_add;
+  table[COM_RK_MATH_SUBTRACT] = math_subtract;
+  table[COM_RK_MATH_MULTIPLY] = math_multiply;
+  table[COM_RK_MATH_DIVIDE] = math_divide;
+  table[COM_RK_MATH_MINIMUM] = math_minimum;
+  table[COM_RK_MATH_MAXIMUM] = math_maximum;
+  table[COM_RK_VALUE_TO_COLOR] = value_to_color;
+  table[COM_RK_COLOR_TO_VALUE] = color_to_value;
+}
+
+}  // namespace COM_ROW_KERNEL_ARCH
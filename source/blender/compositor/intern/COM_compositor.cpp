@@ -24,7 +24,9 @@
 #include "BKE_scene.h"
 
 #include "COM_ExecutionSystem.h"
+#include "COM_FFTConvolution.h"
 #include "COM_MovieDistortionOperation.h"
+#include "COM_ResultCache.h"
 #include "COM_WorkScheduler.h"
 #include "COM_compositor.h"
 #include "clew.h"
@@ -83,6 +85,7 @@ void COM_execute(RenderData *rd,
   /* set progress bar to 0% and status to init compositing */
   editingtree->progress(editingtree->prh, 0.0);
   editingtree->stats_draw(editingtree->sdh, IFACE_("Compositing"));
+  ResultCache::resetStatistics();
 
   bool twopass = (editingtree->flag & NTREE_TWO_PASS) && !rendering;
   /* initialize execution system */
@@ -105,14 +108,28 @@ void COM_execute(RenderData *rd,
   system->execute();
   delete system;
 
+  ResultCache::getStatistics(&editingtree->cache_hits, &editingtree->cache_misses);
+
   BLI_mutex_unlock(&s_compositorMutex);
 }
 
+void COM_clearCaches()
+{
+  if (is_compositorMutex_init) {
+    BLI_mutex_lock(&s_compositorMutex);
+    ResultCache::clear();
+    FFTConvolution::clearCache();
+    BLI_mutex_unlock(&s_compositorMutex);
+  }
+}
+
 void COM_deinitialize()
 {
   if (is_compositorMutex_init) {
     BLI_mutex_lock(&s_compositorMutex);
     WorkScheduler::deinitialize();
+    ResultCache::clear();
+    FFTConvolution::clearCache();
     is_compositorMutex_init = false;
     BLI_mutex_unlock(&s_compositorMutex);
     BLI_mutex_end(&s_compositorMutex);
@@ -18,6 +18,8 @@
 
 #include "COM_BokehBlurOperation.h"
 #include "BLI_math.h"
+#include "BLI_rect.h"
+#include "COM_FFTConvolution.h"
 #include "COM_OpenCLDevice.h"
 
 #include "RE_pipeline.h"
@@ -39,6 +41,8 @@ BokehBlurOperation::BokehBlurOperation()
   this->m_inputBoundingBoxReader = nullptr;
 
   this->m_extend_bounds = false;
+  this->m_useFFT = false;
+  this->m_convolved = nullptr;
 }
 
 void *BokehBlurOperation::initializeTileData(rcti * /*rect*/)
@@ -47,11 +51,32 @@ void *BokehBlurOperation::initializeTileData(rcti * /*rect*/)
   if (!this->m_sizeavailable) {
     updateSize();
   }
-  void *buffer = getInputOperation(0)->initializeTileData(nullptr);
+  MemoryBuffer *buffer = (MemoryBuffer *)getInputOperation(0)->initializeTileData(nullptr);
+  if (this->m_useFFT && this->m_convolved == nullptr) {
+    updateConvolved(buffer);
+  }
   unlockMutex();
   return buffer;
 }
 
+void BokehBlurOperation::updateConvolved(MemoryBuffer *inputBuffer)
+{
+  /* Same samples of the bokeh image as executePixel. */
+  const int pixelSize = getPixelSize();
+  const float m = this->m_bokehDimension / pixelSize;
+  rcti kernelRect;
+  BLI_rcti_init(&kernelRect, 0, 2 * pixelSize, 0, 2 * pixelSize);
+  MemoryBuffer kernel(COM_DT_COLOR, &kernelRect);
+  for (int j = 0; j < 2 * pixelSize; j++) {
+    for (int i = 0; i < 2 * pixelSize; i++) {
+      float u = this->m_bokehMidX - (i - pixelSize) * m;
+      float v = this->m_bokehMidY - (j - pixelSize) * m;
+      this->m_inputBokehProgram->readSampled(kernel.get_elem(i, j), u, v, COM_PS_NEAREST);
+    }
+  }
+  this->m_convolved = FFTConvolution::apply(inputBuffer, &kernel, pixelSize, pixelSize, true);
+}
+
 void BokehBlurOperation::initExecution()
 {
   initMutex();
@@ -68,6 +93,19 @@ void BokehBlurOperation::initExecution()
   this->m_bokehMidY = height / 2.0f;
   this->m_bokehDimension = dimension / 2.0f;
   QualityStepHelper::initExecution(COM_QH_INCREASE);
+
+  /* Large kernels are faster to apply in the frequency domain. Only when the size is known in
+   * advance, the whole input is requested then. */
+  if (this->m_sizeavailable) {
+    const int pixelSize = getPixelSize();
+    this->m_useFFT = getStep() == 1 && FFTConvolution::isEfficient(2 * pixelSize, 2 * pixelSize);
+  }
+}
+
+int BokehBlurOperation::getPixelSize()
+{
+  const float max_dim = max(this->getWidth(), this->getHeight());
+  return this->m_size * max_dim / 100.0f;
 }
 
 void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
@@ -77,15 +115,17 @@ void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
   float bokeh[4];
 
   this->m_inputBoundingBoxReader->readSampled(tempBoundingBox, x, y, COM_PS_NEAREST);
-  if (tempBoundingBox[0] > 0.0f) {
+  if (tempBoundingBox[0] > 0.0f && this->m_convolved) {
+    this->m_convolved->read(output, x, y);
+  }
+  else if (tempBoundingBox[0] > 0.0f) {
     float multiplier_accum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
     MemoryBuffer *inputBuffer = (MemoryBuffer *)data;
     float *buffer = inputBuffer->getBuffer();
     int bufferwidth = inputBuffer->getWidth();
     int bufferstartx = inputBuffer->getRect()->xmin;
     int bufferstarty = inputBuffer->getRect()->ymin;
-    const float max_dim = max(this->getWidth(), this->getHeight());
-    int pixelSize = this->m_size * max_dim / 100.0f;
+    int pixelSize = getPixelSize();
     zero_v4(color_accum);
 
     if (pixelSize < 2) {
@@ -132,6 +172,10 @@ void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 
 void BokehBlurOperation::deinitExecution()
 {
+  if (this->m_convolved) {
+    delete this->m_convolved;
+    this->m_convolved = nullptr;
+  }
   deinitMutex();
   this->m_inputProgram = nullptr;
   this->m_inputBokehProgram = nullptr;
@@ -146,7 +190,10 @@ bool BokehBlurOperation::determineDependingAreaOfInterest(rcti *input,
   rcti bokehInput;
   const float max_dim = max(this->getWidth(), this->getHeight());
 
-  if (this->m_sizeavailable) {
+  if (this->m_useFFT) {
+    BLI_rcti_init(&newInput, 0, this->getWidth(), 0, this->getHeight());
+  }
+  else if (this->m_sizeavailable) {
     newInput.xmax = input->xmax + (this->m_size * max_dim / 100.0f);
     newInput.xmin = input->xmin - (this->m_size * max_dim / 100.0f);
     newInput.ymax = input->ymax + (this->m_size * max_dim / 100.0f);
@@ -33,6 +33,12 @@ class BokehBlurOperation : public NodeOperation, public QualityStepHelper {
   float m_bokehMidY;
   float m_bokehDimension;
   bool m_extend_bounds;
+  /* Large kernels are applied at once in the frequency domain. */
+  bool m_useFFT;
+  MemoryBuffer *m_convolved;
+
+  int getPixelSize();
+  void updateConvolved(MemoryBuffer *inputBuffer);
 
  public:
   BokehBlurOperation();
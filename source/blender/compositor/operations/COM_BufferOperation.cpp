@@ -0,0 +1,101 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#include "COM_BufferOperation.h"
+
+BufferOperation::BufferOperation(NodeOperation *operation)
+{
+  this->addOutputSocket(operation->getOutputSocket()->getDataType());
+  unsigned int resolution[2] = {operation->getWidth(), operation->getHeight()};
+  this->setResolution(resolution);
+  this->m_operation = operation;
+  this->m_buffer = nullptr;
+  this->m_hasAreaOfInterest = false;
+}
+
+bool BufferOperation::getAreaOfInterest(rcti *r_area) const
+{
+  if (!this->m_hasAreaOfInterest) {
+    return false;
+  }
+  *r_area = this->m_areaOfInterest;
+  return true;
+}
+
+void *BufferOperation::initializeTileData(rcti * /*rect*/)
+{
+  return this->m_buffer;
+}
+
+void BufferOperation::executePixelSampled(float output[4],
+                                          float x,
+                                          float y,
+                                          PixelSampler sampler)
+{
+  if (this->m_buffer->is_single_elem()) {
+    memcpy(output, this->m_buffer->getBuffer(), sizeof(float) * m_buffer->get_num_channels());
+  }
+  else if (sampler == COM_PS_NEAREST) {
+    this->m_buffer->read(output, x, y);
+  }
+  else {
+    this->m_buffer->readBilinear(output, x, y);
+  }
+}
+
+void BufferOperation::executePixel(float output[4], int x, int y, void * /*chunkData*/)
+{
+  if (this->m_buffer->is_single_elem()) {
+    memcpy(output, this->m_buffer->getBuffer(), sizeof(float) * m_buffer->get_num_channels());
+  }
+  else {
+    this->m_buffer->read(output, x, y);
+  }
+}
+
+void BufferOperation::executePixelFiltered(
+    float output[4], float x, float y, float dx[2], float dy[2])
+{
+  if (this->m_buffer->is_single_elem()) {
+    memcpy(output, this->m_buffer->getBuffer(), sizeof(float) * m_buffer->get_num_channels());
+  }
+  else {
+    const float uv[2] = {x, y};
+    const float deriv[2][2] = {{dx[0], dx[1]}, {dy[0], dy[1]}};
+    this->m_buffer->readEWA(output, uv, deriv);
+  }
+}
+
+bool BufferOperation::determineDependingAreaOfInterest(rcti *input,
+                                                       ReadBufferOperation * /*readOperation*/,
+                                                       rcti *output)
+{
+  /* Only record while determining the areas of interest, before the buffer is calculated.
+   * Some readers also ask for their areas while being calculated from multiple threads. */
+  if (this->m_buffer == nullptr) {
+    if (this->m_hasAreaOfInterest) {
+      BLI_rcti_union(&this->m_areaOfInterest, input);
+    }
+    else {
+      this->m_areaOfInterest = *input;
+      this->m_hasAreaOfInterest = true;
+    }
+  }
+  BLI_rcti_init(output, input->xmin, input->xmax, input->ymin, input->ymax);
+  return true;
+}
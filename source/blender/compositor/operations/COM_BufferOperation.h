@@ -0,0 +1,77 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#pragma once
+
+#include "COM_NodeOperation.h"
+
+/**
+ * \brief Stand-in for an input operation during full-frame execution.
+ *
+ * Readers are relinked to a BufferOperation that reads the already calculated MemoryBuffer of
+ * the operation it replaces, so the existing pixel methods of the readers can be used unchanged.
+ * It also records the areas the readers need, which is used to size the calculation of the
+ * replaced operation.
+ * \see FullFrameExecution
+ */
+class BufferOperation : public NodeOperation {
+ private:
+  NodeOperation *m_operation;
+  MemoryBuffer *m_buffer;
+  rcti m_areaOfInterest;
+  bool m_hasAreaOfInterest;
+
+ public:
+  BufferOperation(NodeOperation *operation);
+
+  /**
+   * \brief the operation this buffer stands in for
+   */
+  NodeOperation *getOperation() const
+  {
+    return this->m_operation;
+  }
+
+  void setBuffer(MemoryBuffer *buffer)
+  {
+    this->m_buffer = buffer;
+  }
+  MemoryBuffer *getBuffer() const
+  {
+    return this->m_buffer;
+  }
+
+  void resetAreaOfInterest()
+  {
+    this->m_hasAreaOfInterest = false;
+  }
+
+  /**
+   * \brief get the union of the areas requested since the last reset
+   * \return false when nothing was requested
+   */
+  bool getAreaOfInterest(rcti *r_area) const;
+
+  void *initializeTileData(rcti *rect);
+  void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executePixel(float output[4], int x, int y, void *chunkData);
+  void executePixelFiltered(float output[4], float x, float y, float dx[2], float dy[2]);
+  bool determineDependingAreaOfInterest(rcti *input,
+                                        ReadBufferOperation *readOperation,
+                                        rcti *output);
+};
@@ -26,6 +26,7 @@ ChangeHSVOperation::ChangeHSVOperation()
   this->addInputSocket(COM_DT_VALUE);
   this->addOutputSocket(COM_DT_COLOR);
   this->m_inputOperation = nullptr;
+  this->setPointwise(true);
 }
 
 void ChangeHSVOperation::initExecution()
@@ -68,3 +69,31 @@ void ChangeHSVOperation::executePixelSampled(float output[4],
   output[2] = inputColor1[2] * value[0];
   output[3] = inputColor1[3];
 }
+
+void ChangeHSVOperation::executeRow(float *output,
+                                    const float **inputs,
+                                    const int *input_strides,
+                                    int length)
+{
+  const float *color = inputs[0];
+  const float *hue = inputs[1];
+  const float *saturation = inputs[2];
+  const float *value = inputs[3];
+  for (int i = 0; i < length; i++) {
+    output[0] = color[0] + (hue[0] - 0.5f);
+    if (output[0] > 1.0f) {
+      output[0] -= 1.0f;
+    }
+    else if (output[0] < 0.0f) {
+      output[0] += 1.0f;
+    }
+    output[1] = color[1] * saturation[0];
+    output[2] = color[2] * value[0];
+    output[3] = color[3];
+    output += 4;
+    color += input_strides[0];
+    hue += input_strides[1];
+    saturation += input_strides[2];
+    value += input_strides[3];
+  }
+}
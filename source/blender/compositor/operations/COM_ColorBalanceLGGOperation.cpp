@@ -44,6 +44,7 @@ ColorBalanceLGGOperation::ColorBalanceLGGOperation()
   this->m_inputValueOperation = nullptr;
   this->m_inputColorOperation = nullptr;
   this->setResolutionInputSocketIndex(1);
+  this->setPointwise(true);
 }
 
 void ColorBalanceLGGOperation::initExecution()
@@ -79,6 +80,28 @@ void ColorBalanceLGGOperation::executePixelSampled(float output[4],
   output[3] = inputColor[3];
 }
 
+void ColorBalanceLGGOperation::executeRow(float *output,
+                                          const float **inputs,
+                                          const int *input_strides,
+                                          int length)
+{
+  const float *value = inputs[0];
+  const float *color = inputs[1];
+  for (int i = 0; i < length; i++) {
+    const float fac = min(1.0f, value[0]);
+    const float mfac = 1.0f - fac;
+    for (int c = 0; c < 3; c++) {
+      output[c] = mfac * color[c] +
+                  fac * colorbalance_lgg(
+                            color[c], this->m_lift[c], this->m_gamma_inv[c], this->m_gain[c]);
+    }
+    output[3] = color[3];
+    output += 4;
+    value += input_strides[0];
+    color += input_strides[1];
+  }
+}
+
 void ColorBalanceLGGOperation::deinitExecution()
 {
   this->m_inputValueOperation = nullptr;
@@ -17,6 +17,7 @@
  */
 
 #include "COM_ConvertOperation.h"
+#include "COM_RowKernels.h"
 
 #include "IMB_colormanagement.h"
 
@@ -41,6 +42,7 @@ ConvertValueToColorOperation::ConvertValueToColorOperation() : ConvertBaseOperat
 {
   this->addInputSocket(COM_DT_VALUE);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setPointwise(true);
 }
 
 void ConvertValueToColorOperation::executePixelSampled(float output[4],
@@ -54,12 +56,21 @@ void ConvertValueToColorOperation::executePixelSampled(float output[4],
   output[3] = 1.0f;
 }
 
+void ConvertValueToColorOperation::executeRow(float *output,
+                                              const float **inputs,
+                                              const int *input_strides,
+                                              int length)
+{
+  RowKernels::get(COM_RK_VALUE_TO_COLOR)(output, inputs, input_strides, length, 0);
+}
+
 /* ******** Color to Value ******** */
 
 ConvertColorToValueOperation::ConvertColorToValueOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->setPointwise(true);
 }
 
 void ConvertColorToValueOperation::executePixelSampled(float output[4],
@@ -72,12 +83,21 @@ void ConvertColorToValueOperation::executePixelSampled(float output[4],
   output[0] = (inputColor[0] + inputColor[1] + inputColor[2]) / 3.0f;
 }
 
+void ConvertColorToValueOperation::executeRow(float *output,
+                                              const float **inputs,
+                                              const int *input_strides,
+                                              int length)
+{
+  RowKernels::get(COM_RK_COLOR_TO_VALUE)(output, inputs, input_strides, length, 0);
+}
+
 /* ******** Color to BW ******** */
 
 ConvertColorToBWOperation::ConvertColorToBWOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->setPointwise(true);
 }
 
 void ConvertColorToBWOperation::executePixelSampled(float output[4],
@@ -90,6 +110,17 @@ void ConvertColorToBWOperation::executePixelSampled(float output[4],
   output[0] = IMB_colormanagement_get_luminance(inputColor);
 }
 
+void ConvertColorToBWOperation::executeRow(float *output,
+                                           const float **inputs,
+                                           const int *input_strides,
+                                           int length)
+{
+  const float *in = inputs[0];
+  for (int i = 0; i < length; i++, in += input_strides[0]) {
+    output[i] = IMB_colormanagement_get_luminance(in);
+  }
+}
+
 /* ******** Color to Vector ******** */
 
 ConvertColorToVectorOperation::ConvertColorToVectorOperation() : ConvertBaseOperation()
@@ -305,6 +336,7 @@ ConvertRGBToHSVOperation::ConvertRGBToHSVOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setPointwise(true);
 }
 
 void ConvertRGBToHSVOperation::executePixelSampled(float output[4],
@@ -318,12 +350,25 @@ void ConvertRGBToHSVOperation::executePixelSampled(float output[4],
   output[3] = inputColor[3];
 }
 
+void ConvertRGBToHSVOperation::executeRow(float *output,
+                                          const float **inputs,
+                                          const int *input_strides,
+                                          int length)
+{
+  const float *in = inputs[0];
+  for (int i = 0; i < length; i++, in += input_strides[0], output += 4) {
+    rgb_to_hsv_v(in, output);
+    output[3] = in[3];
+  }
+}
+
 /* ******** HSV to RGB ******** */
 
 ConvertHSVToRGBOperation::ConvertHSVToRGBOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setPointwise(true);
 }
 
 void ConvertHSVToRGBOperation::executePixelSampled(float output[4],
@@ -340,6 +385,21 @@ void ConvertHSVToRGBOperation::executePixelSampled(float output[4],
   output[3] = inputColor[3];
 }
 
+void ConvertHSVToRGBOperation::executeRow(float *output,
+                                          const float **inputs,
+                                          const int *input_strides,
+                                          int length)
+{
+  const float *in = inputs[0];
+  for (int i = 0; i < length; i++, in += input_strides[0], output += 4) {
+    hsv_to_rgb_v(in, output);
+    output[0] = max_ff(output[0], 0.0f);
+    output[1] = max_ff(output[1], 0.0f);
+    output[2] = max_ff(output[2], 0.0f);
+    output[3] = in[3];
+  }
+}
+
 /* ******** Premul to Straight ******** */
 
 ConvertPremulToStraightOperation::ConvertPremulToStraightOperation() : ConvertBaseOperation()
@@ -36,6 +36,7 @@ class ConvertValueToColorOperation : public ConvertBaseOperation {
   ConvertValueToColorOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 
 class ConvertColorToValueOperation : public ConvertBaseOperation {
@@ -43,6 +44,7 @@ class ConvertColorToValueOperation : public ConvertBaseOperation {
   ConvertColorToValueOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 
 class ConvertColorToBWOperation : public ConvertBaseOperation {
@@ -50,6 +52,7 @@ class ConvertColorToBWOperation : public ConvertBaseOperation {
   ConvertColorToBWOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 
 class ConvertColorToVectorOperation : public ConvertBaseOperation {
@@ -127,6 +130,7 @@ class ConvertRGBToHSVOperation : public ConvertBaseOperation {
   ConvertRGBToHSVOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 
 class ConvertHSVToRGBOperation : public ConvertBaseOperation {
@@ -134,6 +138,7 @@ class ConvertHSVToRGBOperation : public ConvertBaseOperation {
   ConvertHSVToRGBOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 
 class ConvertPremulToStraightOperation : public ConvertBaseOperation {
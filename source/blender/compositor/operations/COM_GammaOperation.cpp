@@ -26,6 +26,7 @@ GammaOperation::GammaOperation()
   this->addOutputSocket(COM_DT_COLOR);
   this->m_inputProgram = nullptr;
   this->m_inputGammaProgram = nullptr;
+  this->setPointwise(true);
 }
 void GammaOperation::initExecution()
 {
@@ -49,6 +50,25 @@ void GammaOperation::executePixelSampled(float output[4], float x, float y, Pixe
   output[3] = inputValue[3];
 }
 
+void GammaOperation::executeRow(float *output,
+                                const float **inputs,
+                                const int *input_strides,
+                                int length)
+{
+  const float *color = inputs[0];
+  const float *gamma = inputs[1];
+  for (int i = 0; i < length; i++) {
+    /* check for negative to avoid nan's */
+    output[0] = color[0] > 0.0f ? powf(color[0], gamma[0]) : color[0];
+    output[1] = color[1] > 0.0f ? powf(color[1], gamma[0]) : color[1];
+    output[2] = color[2] > 0.0f ? powf(color[2], gamma[0]) : color[2];
+    output[3] = color[3];
+    output += 4;
+    color += input_strides[0];
+    gamma += input_strides[1];
+  }
+}
+
 void GammaOperation::deinitExecution()
 {
   this->m_inputProgram = nullptr;
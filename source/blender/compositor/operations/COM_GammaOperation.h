@@ -36,6 +36,11 @@ class GammaOperation : public NodeOperation {
    */
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
 
+  /**
+   * the inner loop of this program for full-frame execution
+   */
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
+
   /**
    * Initialize the execution
    */
@@ -18,6 +18,8 @@
 
 #include "COM_GaussianBokehBlurOperation.h"
 #include "BLI_math.h"
+#include "BLI_rect.h"
+#include "COM_FFTConvolution.h"
 #include "MEM_guardedalloc.h"
 
 #include "RE_pipeline.h"
@@ -25,6 +27,8 @@
 GaussianBokehBlurOperation::GaussianBokehBlurOperation() : BlurBaseOperation(COM_DT_COLOR)
 {
   this->m_gausstab = nullptr;
+  this->m_convolved = nullptr;
+  this->m_useFFT = false;
 }
 
 void *GaussianBokehBlurOperation::initializeTileData(rcti * /*rect*/)
@@ -33,7 +37,16 @@ void *GaussianBokehBlurOperation::initializeTileData(rcti * /*rect*/)
   if (!this->m_sizeavailable) {
     updateGauss();
   }
-  void *buffer = getInputOperation(0)->initializeTileData(nullptr);
+  MemoryBuffer *buffer = (MemoryBuffer *)getInputOperation(0)->initializeTileData(nullptr);
+  if (this->m_useFFT && this->m_convolved == nullptr) {
+    const int ddwidth = 2 * this->m_radx + 1;
+    const int ddheight = 2 * this->m_rady + 1;
+    rcti kernelRect;
+    BLI_rcti_init(&kernelRect, 0, ddwidth, 0, ddheight);
+    MemoryBuffer kernel(COM_DT_VALUE, &kernelRect);
+    memcpy(kernel.getBuffer(), this->m_gausstab, sizeof(float) * ddwidth * ddheight);
+    this->m_convolved = FFTConvolution::apply(buffer, &kernel, this->m_radx, this->m_rady, true);
+  }
   unlockMutex();
   return buffer;
 }
@@ -46,6 +59,10 @@ void GaussianBokehBlurOperation::initExecution()
 
   if (this->m_sizeavailable) {
     updateGauss();
+    /* Large kernels are faster to apply in the frequency domain. Only when the size is known in
+     * advance, otherwise not the whole input is requested. */
+    this->m_useFFT = getStep() == 1 &&
+                     FFTConvolution::isEfficient(2 * this->m_radx + 1, 2 * this->m_rady + 1);
   }
 }
 
@@ -112,6 +129,11 @@ void GaussianBokehBlurOperation::updateGauss()
 
 void GaussianBokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 {
+  if (this->m_convolved) {
+    this->m_convolved->read(output, x, y);
+    return;
+  }
+
   float tempColor[4];
   tempColor[0] = 0;
   tempColor[1] = 0;
@@ -159,6 +181,11 @@ void GaussianBokehBlurOperation::deinitExecution()
     this->m_gausstab = nullptr;
   }
 
+  if (this->m_convolved) {
+    delete this->m_convolved;
+    this->m_convolved = nullptr;
+  }
+
   deinitMutex();
 }
 
@@ -26,6 +26,9 @@ class GaussianBokehBlurOperation : public BlurBaseOperation {
  private:
   float *m_gausstab;
   int m_radx, m_rady;
+  /* Result of large kernels, calculated at once in the frequency domain. */
+  MemoryBuffer *m_convolved;
+  bool m_useFFT;
   void updateGauss();
 
  public:
@@ -84,6 +84,14 @@ void MathAddOperation::executePixelSampled(float output[4], float x, float y, Pi
   clampIfNeeded(output);
 }
 
+void MathAddOperation::executeRow(float *output,
+                                  const float **inputs,
+                                  const int *input_strides,
+                                  int length)
+{
+  executeRowKernel(COM_RK_MATH_ADD, output, inputs, input_strides, length);
+}
+
 void MathSubtractOperation::executePixelSampled(float output[4],
                                                 float x,
                                                 float y,
@@ -100,6 +108,14 @@ void MathSubtractOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathSubtractOperation::executeRow(float *output,
+                                       const float **inputs,
+                                       const int *input_strides,
+                                       int length)
+{
+  executeRowKernel(COM_RK_MATH_SUBTRACT, output, inputs, input_strides, length);
+}
+
 void MathMultiplyOperation::executePixelSampled(float output[4],
                                                 float x,
                                                 float y,
@@ -116,6 +132,14 @@ void MathMultiplyOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathMultiplyOperation::executeRow(float *output,
+                                       const float **inputs,
+                                       const int *input_strides,
+                                       int length)
+{
+  executeRowKernel(COM_RK_MATH_MULTIPLY, output, inputs, input_strides, length);
+}
+
 void MathDivideOperation::executePixelSampled(float output[4],
                                               float x,
                                               float y,
@@ -137,6 +161,14 @@ void MathDivideOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathDivideOperation::executeRow(float *output,
+                                     const float **inputs,
+                                     const int *input_strides,
+                                     int length)
+{
+  executeRowKernel(COM_RK_MATH_DIVIDE, output, inputs, input_strides, length);
+}
+
 void MathSineOperation::executePixelSampled(float output[4],
                                             float x,
                                             float y,
@@ -356,6 +388,14 @@ void MathMinimumOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathMinimumOperation::executeRow(float *output,
+                                      const float **inputs,
+                                      const int *input_strides,
+                                      int length)
+{
+  executeRowKernel(COM_RK_MATH_MINIMUM, output, inputs, input_strides, length);
+}
+
 void MathMaximumOperation::executePixelSampled(float output[4],
                                                float x,
                                                float y,
@@ -372,6 +412,14 @@ void MathMaximumOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathMaximumOperation::executeRow(float *output,
+                                      const float **inputs,
+                                      const int *input_strides,
+                                      int length)
+{
+  executeRowKernel(COM_RK_MATH_MAXIMUM, output, inputs, input_strides, length);
+}
+
 void MathRoundOperation::executePixelSampled(float output[4],
                                              float x,
                                              float y,
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "COM_NodeOperation.h"
+#include "COM_RowKernels.h"
 
 /**
  * this program converts an input color to an output value.
@@ -43,6 +44,18 @@ class MathBaseOperation : public NodeOperation {
 
   void clampIfNeeded(float color[4]);
 
+  /**
+   * Row loop shared by the math operations that have a vectorized kernel.
+   */
+  void executeRowKernel(RowKernelType type,
+                        float *output,
+                        const float **inputs,
+                        const int *input_strides,
+                        int length)
+  {
+    RowKernels::get(type)(output, inputs, input_strides, length, m_useClamp ? COM_ROW_CLAMP : 0);
+  }
+
  public:
   /**
    * the inner loop of this program
@@ -74,29 +87,37 @@ class MathAddOperation : public MathBaseOperation {
  public:
   MathAddOperation() : MathBaseOperation()
   {
+    this->setPointwise(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 class MathSubtractOperation : public MathBaseOperation {
  public:
   MathSubtractOperation() : MathBaseOperation()
   {
+    this->setPointwise(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 class MathMultiplyOperation : public MathBaseOperation {
  public:
   MathMultiplyOperation() : MathBaseOperation()
   {
+    this->setPointwise(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 class MathDivideOperation : public MathBaseOperation {
  public:
   MathDivideOperation() : MathBaseOperation()
   {
+    this->setPointwise(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 class MathSineOperation : public MathBaseOperation {
  public:
@@ -181,15 +202,19 @@ class MathMinimumOperation : public MathBaseOperation {
  public:
   MathMinimumOperation() : MathBaseOperation()
   {
+    this->setPointwise(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 class MathMaximumOperation : public MathBaseOperation {
  public:
   MathMaximumOperation() : MathBaseOperation()
   {
+    this->setPointwise(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 class MathRoundOperation : public MathBaseOperation {
  public:
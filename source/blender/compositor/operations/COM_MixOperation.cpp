@@ -99,7 +99,7 @@ void MixBaseOperation::deinitExecution()
 
 MixAddOperation::MixAddOperation()
 {
-  /* pass */
+  this->setPointwise(true);
 }
 
 void MixAddOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -124,11 +124,19 @@ void MixAddOperation::executePixelSampled(float output[4], float x, float y, Pix
   clampIfNeeded(output);
 }
 
+void MixAddOperation::executeRow(float *output,
+                                 const float **inputs,
+                                 const int *input_strides,
+                                 int length)
+{
+  executeRowKernel(COM_RK_MIX_ADD, output, inputs, input_strides, length);
+}
+
 /* ******** Mix Blend Operation ******** */
 
 MixBlendOperation::MixBlendOperation()
 {
-  /* pass */
+  this->setPointwise(true);
 }
 
 void MixBlendOperation::executePixelSampled(float output[4],
@@ -158,6 +166,14 @@ void MixBlendOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MixBlendOperation::executeRow(float *output,
+                                   const float **inputs,
+                                   const int *input_strides,
+                                   int length)
+{
+  executeRowKernel(COM_RK_MIX_BLEND, output, inputs, input_strides, length);
+}
+
 /* ******** Mix Burn Operation ******** */
 
 MixColorBurnOperation::MixColorBurnOperation()
@@ -676,7 +692,7 @@ void MixLinearLightOperation::executePixelSampled(float output[4],
 
 MixMultiplyOperation::MixMultiplyOperation()
 {
-  /* pass */
+  this->setPointwise(true);
 }
 
 void MixMultiplyOperation::executePixelSampled(float output[4],
@@ -705,6 +721,14 @@ void MixMultiplyOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MixMultiplyOperation::executeRow(float *output,
+                                      const float **inputs,
+                                      const int *input_strides,
+                                      int length)
+{
+  executeRowKernel(COM_RK_MIX_MULTIPLY, output, inputs, input_strides, length);
+}
+
 /* ******** Mix Ovelray Operation ******** */
 
 MixOverlayOperation::MixOverlayOperation()
@@ -881,7 +905,7 @@ void MixSoftLightOperation::executePixelSampled(float output[4],
 
 MixSubtractOperation::MixSubtractOperation()
 {
-  /* pass */
+  this->setPointwise(true);
 }
 
 void MixSubtractOperation::executePixelSampled(float output[4],
@@ -909,6 +933,14 @@ void MixSubtractOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MixSubtractOperation::executeRow(float *output,
+                                      const float **inputs,
+                                      const int *input_strides,
+                                      int length)
+{
+  executeRowKernel(COM_RK_MIX_SUBTRACT, output, inputs, input_strides, length);
+}
+
 /* ******** Mix Value Operation ******** */
 
 MixValueOperation::MixValueOperation()
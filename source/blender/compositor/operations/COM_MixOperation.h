@@ -19,6 +19,7 @@
 #pragma once
 
 #include "COM_NodeOperation.h"
+#include "COM_RowKernels.h"
 
 /**
  * All this programs converts an input color to an output value.
@@ -43,6 +44,25 @@ class MixBaseOperation : public NodeOperation {
     }
   }
 
+  /**
+   * Row loop shared by the mix operations that have a vectorized kernel.
+   */
+  void executeRowKernel(RowKernelType type,
+                        float *output,
+                        const float **inputs,
+                        const int *input_strides,
+                        int length)
+  {
+    int flags = 0;
+    if (m_useClamp) {
+      flags |= COM_ROW_CLAMP;
+    }
+    if (m_valueAlphaMultiply) {
+      flags |= COM_ROW_VALUE_ALPHA_MULTIPLY;
+    }
+    RowKernels::get(type)(output, inputs, input_strides, length, flags);
+  }
+
  public:
   /**
    * Default constructor
@@ -84,12 +104,14 @@ class MixAddOperation : public MixBaseOperation {
  public:
   MixAddOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 
 class MixBlendOperation : public MixBaseOperation {
  public:
   MixBlendOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 
 class MixColorBurnOperation : public MixBaseOperation {
@@ -156,6 +178,7 @@ class MixMultiplyOperation : public MixBaseOperation {
  public:
   MixMultiplyOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 
 class MixOverlayOperation : public MixBaseOperation {
@@ -186,6 +209,7 @@ class MixSubtractOperation : public MixBaseOperation {
  public:
   MixSubtractOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRow(float *output, const float **inputs, const int *input_strides, int length);
 };
 
 class MixValueOperation : public MixBaseOperation {
@@ -0,0 +1,267 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "COM_ConvertOperation.h"
+#include "COM_MathBaseOperation.h"
+#include "COM_MixOperation.h"
+#include "COM_RowKernels.h"
+
+#define MAX_INPUTS 3
+/* Longer than a pack of every instruction set, with a tail. */
+#define MAX_LENGTH 129
+
+static const int row_lengths[] = {1, 7, MAX_LENGTH};
+
+/* Input that has a different element at every x, or a single element for the whole row. */
+class RowTestInputOperation : public NodeOperation {
+ private:
+  const float *m_data;
+  int m_channels;
+  bool m_singleElem;
+
+ public:
+  RowTestInputOperation(DataType datatype, const float *data, bool single_elem)
+  {
+    this->addOutputSocket(datatype);
+    this->m_data = data;
+    this->m_channels = (datatype == COM_DT_VALUE) ? COM_NUM_CHANNELS_VALUE :
+                                                    COM_NUM_CHANNELS_COLOR;
+    this->m_singleElem = single_elem;
+  }
+
+  void executePixelSampled(float output[4], float x, float /*y*/, PixelSampler /*sampler*/)
+  {
+    const float *elem = this->m_data + (this->m_singleElem ? 0 : (int)x * this->m_channels);
+    /* Value readers only pass a single float. */
+    for (int i = 0; i < this->m_channels; i++) {
+      output[i] = elem[i];
+    }
+  }
+
+  const float *getRow() const
+  {
+    return this->m_data;
+  }
+  int getStride() const
+  {
+    return this->m_singleElem ? 0 : this->m_channels;
+  }
+};
+
+static int get_num_channels(DataType datatype)
+{
+  return (datatype == COM_DT_VALUE) ? COM_NUM_CHANNELS_VALUE : COM_NUM_CHANNELS_COLOR;
+}
+
+/* Operation calculated by a row kernel, with the settings matching the kernel flags. */
+static NodeOperation *create_operation(RowKernelType type, int flags)
+{
+  MixBaseOperation *mix = nullptr;
+  MathBaseOperation *math = nullptr;
+
+  switch (type) {
+    case COM_RK_MIX_ADD:
+      mix = new MixAddOperation();
+      break;
+    case COM_RK_MIX_BLEND:
+      mix = new MixBlendOperation();
+      break;
+    case COM_RK_MIX_MULTIPLY:
+      mix = new MixMultiplyOperation();
+      break;
+    case COM_RK_MIX_SUBTRACT:
+      mix = new MixSubtractOperation();
+      break;
+    case COM_RK_MATH_ADD:
+      math = new MathAddOperation();
+      break;
+    case COM_RK_MATH_SUBTRACT:
+      math = new MathSubtractOperation();
+      break;
+    case COM_RK_MATH_MULTIPLY:
+      math = new MathMultiplyOperation();
+      break;
+    case COM_RK_MATH_DIVIDE:
+      math = new MathDivideOperation();
+      break;
+    case COM_RK_MATH_MINIMUM:
+      math = new MathMinimumOperation();
+      break;
+    case COM_RK_MATH_MAXIMUM:
+      math = new MathMaximumOperation();
+      break;
+    case COM_RK_VALUE_TO_COLOR:
+      /* Conversions ignore the flags. */
+      return new ConvertValueToColorOperation();
+    case COM_RK_COLOR_TO_VALUE:
+      return new ConvertColorToValueOperation();
+    case COM_RK_NUM:
+      break;
+  }
+
+  if (mix) {
+    mix->setUseClamp(flags & COM_ROW_CLAMP);
+    mix->setUseValueAlphaMultiply(flags & COM_ROW_VALUE_ALPHA_MULTIPLY);
+    return mix;
+  }
+  if (math) {
+    math->setUseClamp(flags & COM_ROW_CLAMP);
+    return math;
+  }
+  return nullptr;
+}
+
+/* Values outside of the [0, 1] range so clamping matters, and zeros to test divisions. */
+static void fill_input(float *data, int size, int seed)
+{
+  for (int i = 0; i < size; i++) {
+    data[i] = (float)((i * 7 + seed * 3) % 23) * 0.1f - 0.5f;
+  }
+}
+
+static void link_input(NodeOperation *operation, int index, NodeOperation *input)
+{
+  operation->getInputSocket(index)->setLink(input->getOutputSocket());
+}
+
+static void expect_row_matches_pixels(NodeOperation *operation, const float *row, int length)
+{
+  const int channels = get_num_channels(operation->getOutputSocket()->getDataType());
+  for (int x = 0; x < length; x++) {
+    float expected[4];
+    operation->readSampled(expected, x, 0, COM_PS_NEAREST);
+    for (int c = 0; c < channels; c++) {
+      EXPECT_NEAR(row[x * channels + c], expected[c], 1e-5f) << "x " << x << ", channel " << c;
+    }
+  }
+}
+
+/* Every kernel of every instruction set against executePixelSampled of its operation, with
+ * constant inputs and lengths that leave tails for every pack size. */
+TEST(compositor_row_kernels, MatchPixelSampled)
+{
+  float data[MAX_INPUTS][MAX_LENGTH * 4];
+  for (int i = 0; i < MAX_INPUTS; i++) {
+    fill_input(data[i], MAX_LENGTH * 4, i);
+  }
+
+  for (int type = 0; type < COM_RK_NUM; type++) {
+    for (int isa = 0; isa < COM_RK_ISA_NUM; isa++) {
+      RowKernelFunc kernel = RowKernels::get((RowKernelType)type, (RowKernelISA)isa);
+      if (kernel == nullptr) {
+        continue;
+      }
+      for (int flags = 0; flags <= (COM_ROW_CLAMP | COM_ROW_VALUE_ALPHA_MULTIPLY); flags++) {
+        NodeOperation *operation = create_operation((RowKernelType)type, flags);
+        const int num_inputs = operation->getNumberOfInputSockets();
+
+        /* All inputs varying, then each input a single element in turn. */
+        for (int single_input = -1; single_input < num_inputs; single_input++) {
+          RowTestInputOperation *input_operations[MAX_INPUTS];
+          const float *inputs[MAX_INPUTS];
+          int input_strides[MAX_INPUTS];
+          for (int i = 0; i < num_inputs; i++) {
+            input_operations[i] = new RowTestInputOperation(
+                operation->getInputSocket(i)->getDataType(), data[i], i == single_input);
+            link_input(operation, i, input_operations[i]);
+            inputs[i] = input_operations[i]->getRow();
+            input_strides[i] = input_operations[i]->getStride();
+          }
+          operation->initExecution();
+
+          for (int length : row_lengths) {
+            SCOPED_TRACE(testing::Message()
+                         << RowKernels::getName((RowKernelType)type) << " ("
+                         << RowKernels::getISAName((RowKernelISA)isa) << "), flags " << flags
+                         << ", single input " << single_input << ", length " << length);
+            float output[MAX_LENGTH * 4];
+            kernel(output, inputs, input_strides, length, flags);
+            expect_row_matches_pixels(operation, output, length);
+          }
+
+          operation->deinitExecution();
+          for (int i = 0; i < num_inputs; i++) {
+            delete input_operations[i];
+          }
+        }
+        delete operation;
+      }
+    }
+  }
+}
+
+/* Same as FullFrameExecution.calculateRow with every pointwise input fused. */
+static void calculate_fused_row(NodeOperation *operation, float *output, int length)
+{
+  const float *inputs[MAX_INPUTS];
+  int input_strides[MAX_INPUTS];
+  float rows[MAX_INPUTS][MAX_LENGTH * 4];
+
+  for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+    NodeOperation *input_operation = &operation->getInputSocket(i)->getLink()->getOperation();
+    if (input_operation->isPointwise()) {
+      calculate_fused_row(input_operation, rows[i], length);
+      inputs[i] = rows[i];
+      input_strides[i] = get_num_channels(input_operation->getOutputSocket()->getDataType());
+    }
+    else {
+      RowTestInputOperation *input = static_cast<RowTestInputOperation *>(input_operation);
+      inputs[i] = input->getRow();
+      input_strides[i] = input->getStride();
+    }
+  }
+
+  operation->executeRow(output, inputs, input_strides, length);
+}
+
+/* A chain of pointwise operations calculated row by row, against reading its last operation
+ * pixel by pixel. */
+TEST(compositor_row_kernels, FusedRows)
+{
+  float color1[MAX_LENGTH * 4], color2[MAX_LENGTH * 4];
+  float value[MAX_LENGTH], factor[MAX_LENGTH];
+  fill_input(color1, MAX_LENGTH * 4, 0);
+  fill_input(color2, MAX_LENGTH * 4, 1);
+  fill_input(value, MAX_LENGTH, 2);
+  fill_input(factor, MAX_LENGTH, 3);
+
+  for (int flags = 0; flags <= (COM_ROW_CLAMP | COM_ROW_VALUE_ALPHA_MULTIPLY); flags++) {
+    RowTestInputOperation color1_input(COM_DT_COLOR, color1, false);
+    RowTestInputOperation color2_input(COM_DT_COLOR, color2, false);
+    RowTestInputOperation value_input(COM_DT_VALUE, value, false);
+    RowTestInputOperation factor_input(COM_DT_VALUE, factor, false);
+    RowTestInputOperation constant_input(COM_DT_VALUE, value, true);
+
+    /* blend(factor, color1, value_to_color(divide(color_to_value(color2), value))) */
+    NodeOperation *to_value = create_operation(COM_RK_COLOR_TO_VALUE, flags);
+    NodeOperation *divide = create_operation(COM_RK_MATH_DIVIDE, flags);
+    NodeOperation *to_color = create_operation(COM_RK_VALUE_TO_COLOR, flags);
+    NodeOperation *blend = create_operation(COM_RK_MIX_BLEND, flags);
+    link_input(to_value, 0, &color2_input);
+    link_input(divide, 0, to_value);
+    link_input(divide, 1, &value_input);
+    link_input(divide, 2, &constant_input);
+    link_input(to_color, 0, divide);
+    link_input(blend, 0, &factor_input);
+    link_input(blend, 1, &color1_input);
+    link_input(blend, 2, to_color);
+
+    NodeOperation *operations[] = {to_value, divide, to_color, blend};
+    for (NodeOperation *operation : operations) {
+      operation->initExecution();
+    }
+
+    for (int length : row_lengths) {
+      SCOPED_TRACE(testing::Message() << "flags " << flags << ", length " << length);
+      float output[MAX_LENGTH * 4];
+      calculate_fused_row(blend, output, length);
+      expect_row_matches_pixels(blend, output, length);
+    }
+
+    for (NodeOperation *operation : operations) {
+      operation->deinitExecution();
+      delete operation;
+    }
+  }
+}
@@ -0,0 +1,95 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+
+#include "COM_RowKernels.h"
+
+#define NUM_PIXELS (1024 * 1024)
+#define ROW_LENGTH 128
+#define NUM_RUN_AVERAGED 20
+#define MAX_INPUTS 3
+
+/* Number of channels of the inputs and the output of a kernel. */
+static int kernel_channels(RowKernelType type, int *r_input_channels)
+{
+  switch (type) {
+    case COM_RK_MIX_ADD:
+    case COM_RK_MIX_BLEND:
+    case COM_RK_MIX_MULTIPLY:
+    case COM_RK_MIX_SUBTRACT:
+      r_input_channels[0] = 1;
+      r_input_channels[1] = r_input_channels[2] = 4;
+      return 4;
+    case COM_RK_VALUE_TO_COLOR:
+      r_input_channels[0] = 1;
+      r_input_channels[1] = r_input_channels[2] = 0;
+      return 4;
+    case COM_RK_COLOR_TO_VALUE:
+      r_input_channels[0] = 4;
+      r_input_channels[1] = r_input_channels[2] = 0;
+      return 1;
+    default:
+      r_input_channels[0] = r_input_channels[1] = 1;
+      r_input_channels[2] = 0;
+      return 1;
+  }
+}
+
+static void row_kernel_test(RowKernelType type, float **buffers, float *output)
+{
+  int input_strides[MAX_INPUTS];
+  const int output_channels = kernel_channels(type, input_strides);
+
+  for (int isa = 0; isa < COM_RK_ISA_NUM; isa++) {
+    const char *name = RowKernels::getName(type);
+    const char *isa_name = RowKernels::getISAName((RowKernelISA)isa);
+    RowKernelFunc kernel = RowKernels::get(type, (RowKernelISA)isa);
+    if (kernel == nullptr) {
+      printf("\t%s (%s): not supported\n", name, isa_name);
+      continue;
+    }
+
+    double averaged_timing = 0.0;
+    for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+      const double init_time = PIL_check_seconds_timer();
+      for (int i = 0; i < NUM_PIXELS; i += ROW_LENGTH) {
+        const float *inputs[MAX_INPUTS];
+        for (int input = 0; input < MAX_INPUTS; input++) {
+          inputs[input] = buffers[input] + i * input_strides[input];
+        }
+        kernel(output + i * output_channels, inputs, input_strides, ROW_LENGTH, COM_ROW_CLAMP);
+      }
+      averaged_timing += PIL_check_seconds_timer() - init_time;
+    }
+    averaged_timing /= NUM_RUN_AVERAGED;
+
+    printf("\t%s (%s): %.1f Mpixels/s\n", name, isa_name, NUM_PIXELS / averaged_timing * 1e-6);
+  }
+}
+
+TEST(compositor_row_kernels, All)
+{
+  float *buffers[MAX_INPUTS];
+  for (int input = 0; input < MAX_INPUTS; input++) {
+    buffers[input] = (float *)MEM_mallocN(sizeof(float) * 4 * NUM_PIXELS, __func__);
+    for (int i = 0; i < 4 * NUM_PIXELS; i++) {
+      buffers[input][i] = (float)((i * (input + 7)) % 1000) * 0.001f;
+    }
+  }
+  float *output = (float *)MEM_mallocN(sizeof(float) * 4 * NUM_PIXELS, __func__);
+
+  printf("\n========== STARTING row kernels ==========\n");
+  for (int type = 0; type < COM_RK_NUM; type++) {
+    row_kernel_test((RowKernelType)type, buffers, output);
+  }
+  printf("========== ENDED row kernels ==========\n\n");
+
+  MEM_freeN(output);
+  for (int input = 0; input < MAX_INPUTS; input++) {
+    MEM_freeN(buffers[input]);
+  }
+}
@@ -70,6 +70,7 @@ Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluati
       scene_cow(nullptr),
       is_active(false),
       is_evaluating(false),
+      evaluations_since_timing(0),
       is_render_pipeline_depsgraph(false)
 {
   BLI_spin_init(&lock);
@@ -235,6 +236,8 @@ void Depsgraph::clear_all_nodes()
   clear_id_nodes();
   delete time_source;
   time_source = nullptr;
+  /* Time the new operations on the next evaluation. */
+  evaluations_since_timing = 0;
 }
 
 ID *Depsgraph::get_cow_id(const ID *id_orig) const
@@ -157,6 +157,9 @@ struct Depsgraph {
 
   bool is_evaluating;
 
+  /* Number of evaluations since operations were last timed to update their critical paths. */
+  int evaluations_since_timing;
+
   /* Is set to truth for dependency graph which are used for post-processing (compositor and
    * sequencer).
    * Such dependency graph needs all view layers (so render pipeline can access names), but it
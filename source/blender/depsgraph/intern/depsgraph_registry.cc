@@ -23,6 +23,8 @@
 
 #include "intern/depsgraph_registry.h"
 
+#include <mutex>
+
 #include "BLI_utildefines.h"
 
 #include "intern/depsgraph.h"
@@ -36,15 +38,25 @@ static GraphRegistry &get_graph_registry()
   return graph_registry;
 }
 
+/* Graphs of a separate main may be created and freed from other threads (sequencer prefetch),
+ * while the graphs of another main are looked up. */
+static std::mutex &get_graph_registry_mutex()
+{
+  static std::mutex graph_registry_mutex;
+  return graph_registry_mutex;
+}
+
 void register_graph(Depsgraph *depsgraph)
 {
   Main *bmain = depsgraph->bmain;
+  std::lock_guard<std::mutex> lock(get_graph_registry_mutex());
   get_graph_registry().lookup_or_add_default(bmain).add_new(depsgraph);
 }
 
 void unregister_graph(Depsgraph *depsgraph)
 {
   Main *bmain = depsgraph->bmain;
+  std::lock_guard<std::mutex> lock(get_graph_registry_mutex());
   GraphRegistry &graph_registry = get_graph_registry();
   VectorSet<Depsgraph *> &graphs = graph_registry.lookup(bmain);
   graphs.remove(depsgraph);
@@ -57,6 +69,7 @@ void unregister_graph(Depsgraph *depsgraph)
 
 Span<Depsgraph *> get_all_registered_graphs(Main *bmain)
 {
+  std::lock_guard<std::mutex> lock(get_graph_registry_mutex());
   VectorSet<Depsgraph *> *graphs = get_graph_registry().lookup_ptr(bmain);
   if (graphs != nullptr) {
     return *graphs;
@@ -60,6 +60,10 @@ namespace {
 
 struct DepsgraphEvalState;
 
+/* Operations are timed every this many evaluations, timings change slowly and timing every
+ * operation adds up in big graphs. */
+const int TIMING_EVALUATION_INTERVAL = 8;
+
 void deg_task_run_func(TaskPool *pool, void *taskdata);
 
 template<typename ScheduleFunction, typename... ScheduleFunctionArgs>
@@ -73,6 +77,21 @@ void schedule_node_to_pool(OperationNode *node, const int UNUSED(thread_id), Tas
   BLI_task_pool_push(pool, deg_task_run_func, node, false, nullptr);
 }
 
+void schedule_node_to_vector(OperationNode *node,
+                             const int UNUSED(thread_id),
+                             Vector<OperationNode *> *nodes)
+{
+  nodes->append(node);
+}
+
+/* Order operations which are ready to be evaluated, longest critical path first. */
+void sort_by_critical_path(Vector<OperationNode *> &nodes)
+{
+  std::stable_sort(nodes.begin(), nodes.end(), [](OperationNode *a, OperationNode *b) {
+    return a->critical_path_time > b->critical_path_time;
+  });
+}
+
 /* Denotes which part of dependency graph is being evaluated. */
 enum class EvaluationStage {
   /* Stage 1: Only  Copy-on-Write operations are to be evaluated, prior to anything else.
@@ -93,6 +112,8 @@ enum class EvaluationStage {
 struct DepsgraphEvalState {
   Depsgraph *graph;
   bool do_stats;
+  /* Time operations to update their critical paths. */
+  bool do_timing;
   EvaluationStage stage;
   bool need_single_thread_pass;
 };
@@ -104,10 +125,20 @@ void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_nod
   /* Sanity checks. */
   BLI_assert(!operation_node->is_noop() && "NOOP nodes should not actually be scheduled");
   /* Perform operation. */
-  if (state->do_stats) {
+  if (state->do_stats || state->do_timing) {
     const double start_time = PIL_check_seconds_timer();
     operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += PIL_check_seconds_timer() - start_time;
+    const double time = PIL_check_seconds_timer() - start_time;
+    if (state->do_stats) {
+      operation_node->stats.current_time += time;
+    }
+    if (state->do_timing) {
+      /* Smooth out evaluations slowed down by other threads. */
+      const float average_time = operation_node->average_time;
+      operation_node->average_time = (average_time == 0.0f) ?
+                                         (float)time :
+                                         0.75f * average_time + 0.25f * (float)time;
+    }
   }
   else {
     operation_node->evaluate(depsgraph);
@@ -119,12 +150,26 @@ void deg_task_run_func(TaskPool *pool, void *taskdata)
   void *userdata_v = BLI_task_pool_user_data(pool);
   DepsgraphEvalState *state = (DepsgraphEvalState *)userdata_v;
 
-  /* Evaluate node. */
   OperationNode *operation_node = reinterpret_cast<OperationNode *>(taskdata);
-  evaluate_node(state, operation_node);
+  Vector<OperationNode *> ready_children;
+  while (operation_node != nullptr) {
+    /* Evaluate node. */
+    evaluate_node(state, operation_node);
 
-  /* Schedule children. */
-  schedule_children(state, operation_node, schedule_node_to_pool, pool);
+    /* Schedule children. The child on the longest critical path is evaluated by this task right
+     * away, the others are pushed to the pool longest path first, so idle threads pick up the
+     * longer chains before the short side-branches. */
+    ready_children.clear();
+    schedule_children(state, operation_node, schedule_node_to_vector, &ready_children);
+    if (ready_children.is_empty()) {
+      break;
+    }
+    sort_by_critical_path(ready_children);
+    for (int i = 1; i < ready_children.size(); i++) {
+      BLI_task_pool_push(pool, deg_task_run_func, ready_children[i], false, nullptr);
+    }
+    operation_node = ready_children[0];
+  }
 }
 
 bool check_operation_node_visible(OperationNode *op_node)
@@ -280,8 +325,15 @@ void schedule_graph(DepsgraphEvalState *state,
                     ScheduleFunction *schedule_function,
                     ScheduleFunctionArgs... schedule_function_args)
 {
+  /* Collect operations which are ready first, so the ones on the longest critical paths are
+   * started first. */
+  Vector<OperationNode *> ready_nodes;
   for (OperationNode *node : state->graph->operations) {
-    schedule_node(state, node, false, schedule_function, schedule_function_args...);
+    schedule_node(state, node, false, schedule_node_to_vector, &ready_nodes);
+  }
+  sort_by_critical_path(ready_nodes);
+  for (OperationNode *node : ready_nodes) {
+    schedule_function(node, 0, schedule_function_args...);
   }
 }
 
@@ -378,6 +430,7 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   DepsgraphEvalState state;
   state.graph = graph;
   state.do_stats = graph->debug.do_time_debug();
+  state.do_timing = graph->evaluations_since_timing == 0;
   state.need_single_thread_pass = false;
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
@@ -408,6 +461,11 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   if (state.do_stats) {
     deg_eval_stats_aggregate(graph);
   }
+  if (state.do_timing) {
+    deg_eval_stats_update_critical_paths(graph);
+  }
+  graph->evaluations_since_timing = (graph->evaluations_since_timing + 1) %
+                                    TIMING_EVALUATION_INTERVAL;
   /* Clear any uncleared tags - just in case. */
   deg_graph_clear_tags(graph);
   graph->is_evaluating = false;
@@ -26,6 +26,7 @@
 #include "BLI_utildefines.h"
 
 #include "intern/depsgraph.h"
+#include "intern/depsgraph_relation.h"
 
 #include "intern/node/deg_node.h"
 #include "intern/node/deg_node_component.h"
@@ -54,4 +55,54 @@ void deg_eval_stats_aggregate(Depsgraph *graph)
   }
 }
 
+/* Operations which were not timed yet still count, so chains of many operations are preferred
+ * over short ones before anything is known about them. */
+static const float min_operation_time = 1e-6f;
+
+static bool is_critical_path_relation(const Relation *rel)
+{
+  return rel->from->type == NodeType::OPERATION && rel->to->type == NodeType::OPERATION &&
+         (rel->flag & RELATION_FLAG_CYCLIC) == 0;
+}
+
+void deg_eval_stats_update_critical_paths(Depsgraph *graph)
+{
+  /* Operations are visited after all operations depending on them, starting with the ones
+   * nothing depends on. Cyclic relations are ignored, which leaves an acyclic graph. */
+  Map<OperationNode *, int> num_children_pending;
+  Vector<OperationNode *> queue;
+  for (OperationNode *op_node : graph->operations) {
+    int num_children = 0;
+    for (Relation *rel : op_node->outlinks) {
+      if (is_critical_path_relation(rel)) {
+        num_children++;
+      }
+    }
+    op_node->critical_path_time = 0.0f;
+    num_children_pending.add_new(op_node, num_children);
+    if (num_children == 0) {
+      queue.append(op_node);
+    }
+  }
+
+  while (!queue.is_empty()) {
+    OperationNode *op_node = queue.pop_last();
+    if (!op_node->is_noop()) {
+      op_node->critical_path_time += max(op_node->average_time, min_operation_time);
+    }
+    for (Relation *rel : op_node->inlinks) {
+      if (!is_critical_path_relation(rel)) {
+        continue;
+      }
+      OperationNode *parent = (OperationNode *)rel->from;
+      parent->critical_path_time = max(parent->critical_path_time, op_node->critical_path_time);
+      int &num_pending = num_children_pending.lookup(parent);
+      num_pending--;
+      if (num_pending == 0) {
+        queue.append(parent);
+      }
+    }
+  }
+}
+
 }  // namespace blender::deg
@@ -31,5 +31,8 @@ struct Depsgraph;
 /* Aggregate operation timings to overall component and ID nodes timing. */
 void deg_eval_stats_aggregate(Depsgraph *graph);
 
+/* Update critical paths of all operations from their average timings. */
+void deg_eval_stats_update_critical_paths(Depsgraph *graph);
+
 }  // namespace deg
 }  // namespace blender
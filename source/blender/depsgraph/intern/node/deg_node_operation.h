@@ -266,6 +266,12 @@ struct OperationNode : public Node {
   uint32_t num_links_pending;
   bool scheduled;
 
+  /* Evaluation time in seconds, smoothed over the evaluations the operation was timed in. */
+  float average_time;
+  /* Estimated time from the start of this operation until the longest chain of operations
+   * depending on it is evaluated. Operations with a longer critical path are scheduled first. */
+  float critical_path_time;
+
   /* Identifier for the operation being performed. */
   OperationCode opcode;
   int name_tag;
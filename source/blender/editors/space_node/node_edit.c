@@ -538,6 +538,7 @@ void ED_node_composit_default(const bContext *C, struct Scene *sce)
   sce->nodetree = ntreeAddTree(NULL, "Compositing Nodetree", ntreeType_Composite->idname);
 
   sce->nodetree->chunksize = 256;
+  sce->nodetree->cache_limit = 1024;
   sce->nodetree->edit_quality = NTREE_QUALITY_HIGH;
   sce->nodetree->render_quality = NTREE_QUALITY_HIGH;
 
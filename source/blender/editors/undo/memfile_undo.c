@@ -56,6 +56,12 @@
 
 #include <stdio.h>
 
+/**
+ * Compress the memory of steps older than the previous one,
+ * only the latest steps are used when writing new steps and are likely to be restored.
+ */
+#define USE_MEMFILE_COMPRESS_COLD_STEPS
+
 /* -------------------------------------------------------------------- */
 /** \name Implements ED Undo System
  * \{ */
@@ -65,6 +71,28 @@ typedef struct MemFileUndoStep {
   MemFileUndoData *data;
 } MemFileUndoStep;
 
+static void memfile_undosys_step_size_update(MemFileUndoStep *us)
+{
+  us->data->undo_size = us->data->memfile.size;
+  us->step.data_size = us->data->undo_size;
+}
+
+#ifdef USE_MEMFILE_COMPRESS_COLD_STEPS
+/**
+ * Only the step before \a us_prev becomes cold when a new step is pushed,
+ * older steps have been compressed by previous pushes.
+ */
+static void memfile_undosys_compress_cold_step(MemFileUndoStep *us_prev)
+{
+  UndoStep *us_cold_p = BKE_undosys_step_same_type_prev(&us_prev->step);
+  if (us_cold_p != NULL) {
+    MemFileUndoStep *us_cold = (MemFileUndoStep *)us_cold_p;
+    BLO_memfile_compress(&us_cold->data->memfile);
+    memfile_undosys_step_size_update(us_cold);
+  }
+}
+#endif
+
 static bool memfile_undosys_poll(bContext *C)
 {
   /* other poll functions must run first, this is a catch-all. */
@@ -100,6 +128,12 @@ static bool memfile_undosys_step_encode(struct bContext *UNUSED(C),
   us->data = BKE_memfile_undo_encode(bmain, us_prev ? us_prev->data : NULL);
   us->step.data_size = us->data->undo_size;
 
+#ifdef USE_MEMFILE_COMPRESS_COLD_STEPS
+  if (us_prev != NULL) {
+    memfile_undosys_compress_cold_step(us_prev);
+  }
+#endif
+
   /* Store the fact that we should not re-use old data with that undo step, and reset the Main
    * flag. */
   us->step.use_old_bmain_data = !bmain->use_memfile_full_barrier;
@@ -193,6 +227,11 @@ static void memfile_undosys_step_decode(struct bContext *C,
   MemFileUndoStep *us = (MemFileUndoStep *)us_p;
   BKE_memfile_undo_decode(us->data, undo_direction, use_old_bmain_data, C);
 
+#ifdef USE_MEMFILE_COMPRESS_COLD_STEPS
+  /* Reading decompressed the step. */
+  memfile_undosys_step_size_update(us);
+#endif
+
   for (UndoStep *us_iter = us_p->next; us_iter; us_iter = us_iter->next) {
     if (BKE_UNDOSYS_TYPE_IS_MEMFILE_SKIP(us_iter->type)) {
       continue;
@@ -266,6 +305,8 @@ static void memfile_undosys_step_free(UndoStep *us_p)
     if (us_next_p != NULL) {
       MemFileUndoStep *us_next = (MemFileUndoStep *)us_next_p;
       BLO_memfile_merge(&us->data->memfile, &us_next->data->memfile);
+      /* The next step now accounts for the data it shared with this one. */
+      memfile_undosys_step_size_update(us_next);
     }
   }
 
@@ -130,12 +130,19 @@ struct anim {
   AVFrame *pFrameRGB;
   AVFrame *pFrameDeinterlaced;
   struct SwsContext *img_convert_ctx;
+  /* Color conversion of horizontal bands in parallel, one context per band. */
+  struct SwsContext **img_convert_ctx_bands;
+  int img_convert_bands_num;
+  int img_convert_band_height;
   int videoStream;
 
   struct ImBuf *last_frame;
   int64_t last_pts;
   int64_t next_pts;
   AVPacket next_packet;
+
+  /* Decoding of upcoming frames in a background thread, see #ffmpeg_readahead_fetchibuf. */
+  struct AnimReadAhead *readahead;
 #endif
 
   char index_dir[768];
@@ -55,6 +55,8 @@
 
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "MEM_guardedalloc.h"
@@ -78,6 +80,7 @@
 
 #  include <libavcodec/avcodec.h>
 #  include <libavformat/avformat.h>
+#  include <libavutil/pixdesc.h>
 #  include <libavutil/rational.h>
 #  include <libswscale/swscale.h>
 
@@ -200,6 +203,7 @@ static void free_anim_avi(struct anim *anim)
 
 #ifdef WITH_FFMPEG
 static void free_anim_ffmpeg(struct anim *anim);
+static void ffmpeg_readahead_free(struct anim *anim);
 #endif
 
 void IMB_free_anim(struct anim *anim)
@@ -239,6 +243,11 @@ void IMB_close_anim_proxies(struct anim *anim)
     return;
   }
 
+#ifdef WITH_FFMPEG
+  /* Frames may be read ahead using the indices. */
+  ffmpeg_readahead_free(anim);
+#endif
+
   IMB_free_indices(anim);
 }
 
@@ -505,6 +514,129 @@ BLI_INLINE bool need_aligned_ffmpeg_buffer(struct anim *anim)
   return (anim->x & 31) != 0;
 }
 
+#  ifdef FFMPEG_SWSCALE_COLOR_SPACE_SUPPORT
+static void ffmpeg_sws_colorspace_setup(struct anim *anim, struct SwsContext *sws_ctx)
+{
+  /* The following for color space determination */
+  int srcRange, dstRange, brightness, contrast, saturation;
+  int *table;
+  const int *inv_table;
+
+  /* Try do detect if input has 0-255 YCbCR range (JFIF Jpeg MotionJpeg) */
+  if (!sws_getColorspaceDetails(sws_ctx,
+                                (int **)&inv_table,
+                                &srcRange,
+                                &table,
+                                &dstRange,
+                                &brightness,
+                                &contrast,
+                                &saturation)) {
+    srcRange = srcRange || anim->pCodecCtx->color_range == AVCOL_RANGE_JPEG;
+    inv_table = sws_getCoefficients(anim->pCodecCtx->colorspace);
+
+    if (sws_setColorspaceDetails(sws_ctx,
+                                 (int *)inv_table,
+                                 srcRange,
+                                 table,
+                                 dstRange,
+                                 brightness,
+                                 contrast,
+                                 saturation)) {
+      fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
+    }
+  }
+  else {
+    fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
+  }
+}
+#  endif
+
+static struct SwsContext *ffmpeg_sws_context_create(struct anim *anim,
+                                                    const int height,
+                                                    const int flags)
+{
+  struct SwsContext *sws_ctx = sws_getContext(anim->x,
+                                              height,
+                                              anim->pCodecCtx->pix_fmt,
+                                              anim->x,
+                                              height,
+                                              AV_PIX_FMT_RGBA,
+                                              flags,
+                                              NULL,
+                                              NULL,
+                                              NULL);
+
+#  ifdef FFMPEG_SWSCALE_COLOR_SPACE_SUPPORT
+  if (sws_ctx) {
+    ffmpeg_sws_colorspace_setup(anim, sws_ctx);
+  }
+#  endif
+
+  return sws_ctx;
+}
+
+/* Bands smaller than this aren't worth converting separately. */
+#  define FFMPEG_SWS_BAND_MIN_HEIGHT 64
+
+static void ffmpeg_sws_bands_free(struct anim *anim)
+{
+  if (anim->img_convert_ctx_bands == NULL) {
+    return;
+  }
+  for (int i = 0; i < anim->img_convert_bands_num; i++) {
+    if (anim->img_convert_ctx_bands[i]) {
+      sws_freeContext(anim->img_convert_ctx_bands[i]);
+    }
+  }
+  MEM_freeN(anim->img_convert_ctx_bands);
+  anim->img_convert_ctx_bands = NULL;
+  anim->img_convert_bands_num = 0;
+}
+
+/**
+ * Split color conversion into horizontal bands converted in parallel.
+ * Bands are aligned to the vertical chroma sub-sampling,
+ * so each band can be converted as an independent image with its own context.
+ */
+static void ffmpeg_sws_bands_init(struct anim *anim)
+{
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(anim->pCodecCtx->pix_fmt);
+
+  /* Flipping for big endian is done on the whole image, keep using a single context. */
+  if (ENDIAN_ORDER == B_ENDIAN) {
+    return;
+  }
+  if ((desc == NULL) ||
+      (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL))) {
+    return;
+  }
+
+  const int align = 1 << desc->log2_chroma_h;
+  int bands_num = MIN2(BLI_system_thread_count(), anim->y / FFMPEG_SWS_BAND_MIN_HEIGHT);
+  if (bands_num < 2) {
+    return;
+  }
+
+  const int band_height = (((anim->y + bands_num - 1) / bands_num + align - 1) / align) * align;
+  bands_num = (anim->y + band_height - 1) / band_height;
+
+  anim->img_convert_ctx_bands = MEM_callocN(sizeof(*anim->img_convert_ctx_bands) * bands_num,
+                                            "ffmpeg sws bands");
+  anim->img_convert_bands_num = bands_num;
+  anim->img_convert_band_height = band_height;
+
+  for (int i = 0; i < bands_num; i++) {
+    const int height = MIN2(band_height, anim->y - i * band_height);
+    anim->img_convert_ctx_bands[i] = ffmpeg_sws_context_create(
+        anim, height, SWS_FAST_BILINEAR | SWS_FULL_CHR_H_INT);
+    if (anim->img_convert_ctx_bands[i] == NULL) {
+      /* Fall back to converting the whole image at once. */
+      ffmpeg_sws_bands_free(anim);
+      return;
+    }
+  }
+}
+
 static int startffmpeg(struct anim *anim)
 {
   int i, video_stream_index;
@@ -518,13 +650,6 @@ static int startffmpeg(struct anim *anim)
   double frs_den;
   int streamcount;
 
-#  ifdef FFMPEG_SWSCALE_COLOR_SPACE_SUPPORT
-  /* The following for color space determination */
-  int srcRange, dstRange, brightness, contrast, saturation;
-  int *table;
-  const int *inv_table;
-#  endif
-
   if (anim == NULL) {
     return (-1);
   }
@@ -573,6 +698,10 @@ static int startffmpeg(struct anim *anim)
 
   pCodecCtx->workaround_bugs = 1;
 
+  /* Decode frames (or slices, depending on the codec) in parallel. */
+  pCodecCtx->thread_count = BLI_system_thread_count();
+  pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
   if (avcodec_open2(pCodecCtx, pCodec, NULL) < 0) {
     avformat_close_input(&pFormatCtx);
     return -1;
@@ -692,16 +821,8 @@ static int startffmpeg(struct anim *anim)
     anim->preseek = 0;
   }
 
-  anim->img_convert_ctx = sws_getContext(anim->x,
-                                         anim->y,
-                                         anim->pCodecCtx->pix_fmt,
-                                         anim->x,
-                                         anim->y,
-                                         AV_PIX_FMT_RGBA,
-                                         SWS_FAST_BILINEAR | SWS_PRINT_INFO | SWS_FULL_CHR_H_INT,
-                                         NULL,
-                                         NULL,
-                                         NULL);
+  anim->img_convert_ctx = ffmpeg_sws_context_create(
+      anim, anim->y, SWS_FAST_BILINEAR | SWS_PRINT_INFO | SWS_FULL_CHR_H_INT);
 
   if (!anim->img_convert_ctx) {
     fprintf(stderr, "Can't transform color space??? Bailing out...\n");
@@ -714,38 +835,50 @@ static int startffmpeg(struct anim *anim)
     return -1;
   }
 
-#  ifdef FFMPEG_SWSCALE_COLOR_SPACE_SUPPORT
-  /* Try do detect if input has 0-255 YCbCR range (JFIF Jpeg MotionJpeg) */
-  if (!sws_getColorspaceDetails(anim->img_convert_ctx,
-                                (int **)&inv_table,
-                                &srcRange,
-                                &table,
-                                &dstRange,
-                                &brightness,
-                                &contrast,
-                                &saturation)) {
-    srcRange = srcRange || anim->pCodecCtx->color_range == AVCOL_RANGE_JPEG;
-    inv_table = sws_getCoefficients(anim->pCodecCtx->colorspace);
-
-    if (sws_setColorspaceDetails(anim->img_convert_ctx,
-                                 (int *)inv_table,
-                                 srcRange,
-                                 table,
-                                 dstRange,
-                                 brightness,
-                                 contrast,
-                                 saturation)) {
-      fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
-    }
-  }
-  else {
-    fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
-  }
-#  endif
+  ffmpeg_sws_bands_init(anim);
 
   return 0;
 }
 
+typedef struct FFmpegConvertBandData {
+  struct anim *anim;
+  AVFrame *input;
+  /* Destination of the first row, rows are written bottom to top. */
+  uint8_t *dst;
+  int dst_stride;
+} FFmpegConvertBandData;
+
+static void ffmpeg_convert_band_cb(void *__restrict userdata,
+                                   const int band,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const FFmpegConvertBandData *data = userdata;
+  struct anim *anim = data->anim;
+  const AVFrame *input = data->input;
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(anim->pCodecCtx->pix_fmt);
+  const int planes_num = av_pix_fmt_count_planes(anim->pCodecCtx->pix_fmt);
+
+  const int y = band * anim->img_convert_band_height;
+  const int height = MIN2(anim->img_convert_band_height, anim->y - y);
+
+  const uint8_t *src[4] = {NULL, NULL, NULL, NULL};
+  for (int plane = 0; plane < planes_num; plane++) {
+    const int plane_y = ELEM(plane, 1, 2) ? (y >> desc->log2_chroma_h) : y;
+    src[plane] = input->data[plane] + (ptrdiff_t)plane_y * input->linesize[plane];
+  }
+
+  uint8_t *dst[4] = {data->dst - (ptrdiff_t)y * data->dst_stride, NULL, NULL, NULL};
+  const int dst_stride[4] = {-data->dst_stride, 0, 0, 0};
+
+  sws_scale(anim->img_convert_ctx_bands[band],
+            (const uint8_t *const *)src,
+            input->linesize,
+            0,
+            height,
+            dst,
+            dst_stride);
+}
+
 /* postprocess the image in anim->pFrame and do color conversion
  * and deinterlacing stuff.
  *
@@ -852,13 +985,28 @@ static void ffmpeg_postprocess(struct anim *anim)
     const int dstStride2[4] = {-dstStride[0], 0, 0, 0};
     uint8_t *dst2[4] = {dst[0] + (anim->y - 1) * dstStride[0], 0, 0, 0};
 
-    sws_scale(anim->img_convert_ctx,
-              (const uint8_t *const *)input->data,
-              input->linesize,
-              0,
-              anim->y,
-              dst2,
-              dstStride2);
+    if (anim->img_convert_ctx_bands) {
+      FFmpegConvertBandData data = {
+          .anim = anim,
+          .input = input,
+          .dst = dst2[0],
+          .dst_stride = dstStride[0],
+      };
+      TaskParallelSettings settings;
+      BLI_parallel_range_settings_defaults(&settings);
+      settings.min_iter_per_thread = 1;
+      BLI_task_parallel_range(
+          0, anim->img_convert_bands_num, &data, ffmpeg_convert_band_cb, &settings);
+    }
+    else {
+      sws_scale(anim->img_convert_ctx,
+                (const uint8_t *const *)input->data,
+                input->linesize,
+                0,
+                anim->y,
+                dst2,
+                dstStride2);
+    }
   }
 
   if (need_aligned_ffmpeg_buffer(anim)) {
@@ -1243,12 +1391,250 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
   return anim->last_frame;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Read-Ahead
+ *
+ * Once frames are requested in order (playback), upcoming frames are decoded by a background
+ * thread into a small queue, so decoding overlaps with everything else done for a frame.
+ * \{ */
+
+/* Number of decoded frames kept ahead of the last requested one. */
+#  define ANIM_READAHEAD_FRAMES 8
+/* Number of frames requested in order before reading ahead. */
+#  define ANIM_READAHEAD_SEQUENTIAL_MIN 2
+
+typedef struct AnimReadAhead {
+  /** Protects the state below (not the decoder), #AnimReadAhead.condition signals changes. */
+  ThreadMutex mutex;
+  ThreadCondition condition;
+  /** Held while decoding, by the thread or by requests for frames not in the queue. */
+  ThreadMutex decode_mutex;
+  ListBase threads;
+  bool thread_started;
+  bool stop;
+
+  /** Decode ahead when set, cleared when frames are requested out of order. */
+  bool active;
+  IMB_Timecode_Type tc;
+  /** Incremented when the queue is invalidated, to discard frames being decoded. */
+  int generation;
+  int position_last;
+  int sequential_num;
+  /** Next frame to decode and the one being decoded (-1 when idle). */
+  int position_next;
+  int position_decoding;
+
+  /** Decoded frames, with consecutive positions starting at #AnimReadAhead.positions[0]. */
+  ImBuf *ibufs[ANIM_READAHEAD_FRAMES];
+  int positions[ANIM_READAHEAD_FRAMES];
+  int ibufs_num;
+} AnimReadAhead;
+
+/* Call with #AnimReadAhead.mutex locked. */
+static void ffmpeg_readahead_clear(AnimReadAhead *readahead)
+{
+  for (int i = 0; i < readahead->ibufs_num; i++) {
+    IMB_freeImBuf(readahead->ibufs[i]);
+  }
+  readahead->ibufs_num = 0;
+  readahead->generation++;
+}
+
+/* Call with #AnimReadAhead.mutex locked, return a user of the frame at position or NULL. */
+static ImBuf *ffmpeg_readahead_pop(AnimReadAhead *readahead, int position)
+{
+  if (readahead->ibufs_num == 0) {
+    return NULL;
+  }
+
+  const int index = position - readahead->positions[0];
+  if (index < 0 || index >= readahead->ibufs_num) {
+    return NULL;
+  }
+
+  /* Skipped frames won't be requested anymore. */
+  for (int i = 0; i < index; i++) {
+    IMB_freeImBuf(readahead->ibufs[i]);
+  }
+
+  ImBuf *ibuf = readahead->ibufs[index];
+  const int remaining = readahead->ibufs_num - (index + 1);
+  memmove(&readahead->ibufs[0], &readahead->ibufs[index + 1], sizeof(ImBuf *) * remaining);
+  memmove(&readahead->positions[0], &readahead->positions[index + 1], sizeof(int) * remaining);
+  readahead->ibufs_num = remaining;
+
+  return ibuf;
+}
+
+static void *ffmpeg_readahead_thread(void *anim_v)
+{
+  struct anim *anim = anim_v;
+  AnimReadAhead *readahead = anim->readahead;
+
+  BLI_mutex_lock(&readahead->mutex);
+  while (!readahead->stop) {
+    if (!readahead->active || (readahead->ibufs_num == ANIM_READAHEAD_FRAMES) ||
+        (readahead->position_next >= anim->duration_in_frames)) {
+      BLI_condition_wait(&readahead->condition, &readahead->mutex);
+      continue;
+    }
+
+    const int position = readahead->position_next;
+    const int generation = readahead->generation;
+    const IMB_Timecode_Type tc = readahead->tc;
+    readahead->position_decoding = position;
+    BLI_mutex_unlock(&readahead->mutex);
+
+    BLI_mutex_lock(&readahead->decode_mutex);
+    ImBuf *ibuf = ffmpeg_fetchibuf(anim, position, tc);
+    if (ibuf) {
+      anim->curposition = position;
+    }
+    BLI_mutex_unlock(&readahead->decode_mutex);
+
+    BLI_mutex_lock(&readahead->mutex);
+    readahead->position_decoding = -1;
+    if (readahead->active && (generation == readahead->generation)) {
+      if (ibuf) {
+        readahead->ibufs[readahead->ibufs_num] = ibuf;
+        readahead->positions[readahead->ibufs_num] = position;
+        readahead->ibufs_num++;
+        readahead->position_next = position + 1;
+        ibuf = NULL;
+      }
+      else {
+        readahead->active = false;
+      }
+    }
+    if (ibuf) {
+      IMB_freeImBuf(ibuf);
+    }
+    BLI_condition_notify_all(&readahead->condition);
+  }
+  BLI_mutex_unlock(&readahead->mutex);
+
+  return NULL;
+}
+
+static void ffmpeg_readahead_free(struct anim *anim)
+{
+  AnimReadAhead *readahead = anim->readahead;
+  if (readahead == NULL) {
+    return;
+  }
+
+  if (readahead->thread_started) {
+    BLI_mutex_lock(&readahead->mutex);
+    readahead->stop = true;
+    BLI_condition_notify_all(&readahead->condition);
+    BLI_mutex_unlock(&readahead->mutex);
+    BLI_threadpool_end(&readahead->threads);
+  }
+
+  ffmpeg_readahead_clear(readahead);
+
+  BLI_mutex_end(&readahead->mutex);
+  BLI_mutex_end(&readahead->decode_mutex);
+  BLI_condition_end(&readahead->condition);
+  MEM_freeN(readahead);
+  anim->readahead = NULL;
+}
+
+/**
+ * Same as #ffmpeg_fetchibuf, using frames decoded ahead when available.
+ */
+static ImBuf *ffmpeg_readahead_fetchibuf(struct anim *anim, int position, IMB_Timecode_Type tc)
+{
+  if (anim->readahead == NULL) {
+    AnimReadAhead *readahead = MEM_callocN(sizeof(*readahead), __func__);
+    BLI_mutex_init(&readahead->mutex);
+    BLI_mutex_init(&readahead->decode_mutex);
+    BLI_condition_init(&readahead->condition);
+    readahead->position_last = -1;
+    readahead->position_decoding = -1;
+    anim->readahead = readahead;
+  }
+
+  AnimReadAhead *readahead = anim->readahead;
+  ImBuf *ibuf = NULL;
+
+  BLI_mutex_lock(&readahead->mutex);
+
+  if (readahead->active && (readahead->tc == tc)) {
+    /* The frame may be decoded right now. */
+    while ((readahead->position_decoding == position) && readahead->active) {
+      BLI_condition_wait(&readahead->condition, &readahead->mutex);
+    }
+    ibuf = ffmpeg_readahead_pop(readahead, position);
+  }
+
+  const bool is_sequential = (position == readahead->position_last + 1) && (readahead->tc == tc);
+  readahead->sequential_num = is_sequential ? readahead->sequential_num + 1 : 0;
+  readahead->position_last = position;
+
+  if (ibuf == NULL) {
+    /* Frames are requested in a different order, start over from this position. */
+    ffmpeg_readahead_clear(readahead);
+    readahead->active = false;
+    BLI_mutex_unlock(&readahead->mutex);
+
+    BLI_mutex_lock(&readahead->decode_mutex);
+    ibuf = ffmpeg_fetchibuf(anim, position, tc);
+    if (ibuf) {
+      anim->curposition = position;
+    }
+    BLI_mutex_unlock(&readahead->decode_mutex);
+
+    BLI_mutex_lock(&readahead->mutex);
+    if (ibuf && (readahead->sequential_num >= ANIM_READAHEAD_SEQUENTIAL_MIN)) {
+      readahead->active = true;
+      readahead->tc = tc;
+      readahead->position_next = position + 1;
+
+      if (!readahead->thread_started) {
+        BLI_threadpool_init(&readahead->threads, ffmpeg_readahead_thread, 1);
+        BLI_threadpool_insert(&readahead->threads, anim);
+        readahead->thread_started = true;
+      }
+    }
+  }
+
+  /* Wake the thread to replace the frames taken from the queue. */
+  BLI_condition_notify_all(&readahead->condition);
+  BLI_mutex_unlock(&readahead->mutex);
+
+  return ibuf;
+}
+
+/**
+ * The read-ahead thread opens and reads the time-code indices while decoding,
+ * hold the decoder when using them from other threads.
+ */
+static void ffmpeg_readahead_index_lock(struct anim *anim)
+{
+  if (anim->readahead) {
+    BLI_mutex_lock(&anim->readahead->decode_mutex);
+  }
+}
+
+static void ffmpeg_readahead_index_unlock(struct anim *anim)
+{
+  if (anim->readahead) {
+    BLI_mutex_unlock(&anim->readahead->decode_mutex);
+  }
+}
+
+/** \} */
+
 static void free_anim_ffmpeg(struct anim *anim)
 {
   if (anim == NULL) {
     return;
   }
 
+  /* Stop decoding before freeing the decoder. */
+  ffmpeg_readahead_free(anim);
+
   if (anim->pCodecCtx) {
     avcodec_close(anim->pCodecCtx);
     avformat_close_input(&anim->pFormatCtx);
@@ -1272,6 +1658,7 @@ static void free_anim_ffmpeg(struct anim *anim)
     av_frame_free(&anim->pFrameDeinterlaced);
 
     sws_freeContext(anim->img_convert_ctx);
+    ffmpeg_sws_bands_free(anim);
     IMB_freeImBuf(anim->last_frame);
     if (anim->next_packet.stream_index != -1) {
       av_free_packet(&anim->next_packet);
@@ -1396,7 +1783,13 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim,
     struct anim *proxy = IMB_anim_open_proxy(anim, preview_size);
 
     if (proxy) {
+#ifdef WITH_FFMPEG
+      ffmpeg_readahead_index_lock(anim);
+#endif
       position = IMB_anim_index_get_frame_index(anim, tc, position);
+#ifdef WITH_FFMPEG
+      ffmpeg_readahead_index_unlock(anim);
+#endif
 
       return IMB_anim_absolute(proxy, position, IMB_TC_NONE, IMB_PROXY_NONE);
     }
@@ -1429,10 +1822,8 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim,
 #endif
 #ifdef WITH_FFMPEG
     case ANIM_FFMPEG:
-      ibuf = ffmpeg_fetchibuf(anim, position, tc);
-      if (ibuf) {
-        anim->curposition = position;
-      }
+      /* Sets #anim.curposition while decoding. */
+      ibuf = ffmpeg_readahead_fetchibuf(anim, position, tc);
       filter_y = 0; /* done internally */
       break;
 #endif
@@ -1442,7 +1833,7 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim,
     if (filter_y) {
       IMB_filtery(ibuf);
     }
-    BLI_snprintf(ibuf->name, sizeof(ibuf->name), "%s.%04d", anim->name, anim->curposition + 1);
+    BLI_snprintf(ibuf->name, sizeof(ibuf->name), "%s.%04d", anim->name, position + 1);
   }
   return ibuf;
 }
@@ -1452,16 +1843,23 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim,
 int IMB_anim_get_duration(struct anim *anim, IMB_Timecode_Type tc)
 {
   struct anim_index *idx;
+  int duration;
   if (tc == IMB_TC_NONE) {
     return anim->duration_in_frames;
   }
 
+#ifdef WITH_FFMPEG
+  ffmpeg_readahead_index_lock(anim);
+#endif
+
   idx = IMB_anim_open_index(anim, tc);
-  if (!idx) {
-    return anim->duration_in_frames;
-  }
+  duration = idx ? IMB_indexer_get_duration(idx) : anim->duration_in_frames;
+
+#ifdef WITH_FFMPEG
+  ffmpeg_readahead_index_unlock(anim);
+#endif
 
-  return IMB_indexer_get_duration(idx);
+  return duration;
 }
 
 bool IMB_anim_get_fps(struct anim *anim, short *frs_sec, float *frs_sec_base, bool no_av_base)
@@ -1289,7 +1289,8 @@ void IMB_anim_set_index_dir(struct anim *anim, const char *dir)
   }
   BLI_strncpy(anim->index_dir, dir, sizeof(anim->index_dir));
 
-  IMB_free_indices(anim);
+  /* Also stops reading ahead, which uses the indices. */
+  IMB_close_anim_proxies(anim);
 }
 
 struct anim *IMB_anim_open_proxy(struct anim *anim, IMB_Proxy_Size preview_size)
@@ -449,7 +449,9 @@ typedef struct bNodeTree {
   short is_updating;
   /** Generic temporary flag for recursion check (DFS/BFS). */
   short done;
-  char _pad2[4];
+  /** Compositor execution model, see #eNodeTreeExecutionMode. */
+  short execution_mode;
+  char _pad2[2];
 
   /** Specific node type this tree is used for. */
   int nodetype DNA_DEPRECATED;
@@ -477,7 +479,11 @@ typedef struct bNodeTree {
    * in case multiple different editors are used and make context ambiguous.
    */
   bNodeInstanceKey active_viewer_key;
-  char _pad[4];
+  /** Memory limit in MB for operation results kept between compositor executions. */
+  int cache_limit;
+  /** Cache statistics of the last compositor execution. */
+  int cache_hits;
+  int cache_misses;
 
   /** Execution data.
    *
@@ -520,6 +526,14 @@ typedef struct bNodeTree {
 /* tree is localized copy, free when deleting node groups */
 /* #define NTREE_IS_LOCALIZED           (1 << 5) */
 
+/* ntree->execution_mode */
+typedef enum eNodeTreeExecutionMode {
+  /* Pull pixels through the operation graph one tile at a time. */
+  NTREE_EXECUTION_MODE_TILED = 0,
+  /* Render each operation into a whole buffer before its readers run. */
+  NTREE_EXECUTION_MODE_FULL_FRAME = 1,
+} eNodeTreeExecutionMode;
+
 /* ntree->update */
 typedef enum eNodeTreeUpdate {
   NTREE_UPDATE = 0xFFFF,             /* generic update flag (includes all others) */
@@ -31,6 +31,8 @@ typedef struct PackedFile {
   int size;
   int seek;
   void *data;
+  /** Run-time only, data left in the .blend file, see #BKE_packedfile_data_ensure. */
+  struct BlendDeferredData *deferred_data;
 } PackedFile;
 
 #ifdef __cplusplus
@@ -117,6 +117,21 @@ static const EnumPropertyItem node_chunksize_items[] = {
     {NTREE_CHUNKSIZE_1024, "1024", 0, "1024x1024", "Chunksize of 1024x1024"},
     {0, NULL, 0, NULL, NULL},
 };
+
+static const EnumPropertyItem node_execution_mode_items[] = {
+    {NTREE_EXECUTION_MODE_TILED,
+     "TILED",
+     0,
+     "Tiled",
+     "Pull pixels through the node tree in tiles, only calculating what each tile needs"},
+    {NTREE_EXECUTION_MODE_FULL_FRAME,
+     "FULL_FRAME",
+     0,
+     "Full Frame",
+     "Calculate each operation over its whole area of interest before the operations reading "
+     "it, freeing buffers as soon as they are not needed anymore"},
+    {0, NULL, 0, NULL, NULL},
+};
 #endif
 
 const EnumPropertyItem rna_enum_mapping_type_items[] = {
@@ -10010,6 +10025,33 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
   RNA_def_property_enum_items(prop, node_quality_items);
   RNA_def_property_ui_text(prop, "Edit Quality", "Quality when editing");
 
+  prop = RNA_def_property(srna, "execution_mode", PROP_ENUM, PROP_NONE);
+  RNA_def_property_enum_sdna(prop, NULL, "execution_mode");
+  RNA_def_property_enum_items(prop, node_execution_mode_items);
+  RNA_def_property_ui_text(prop, "Execution Mode", "Set how compositing is executed");
+  RNA_def_property_update(prop, NC_NODE | ND_DISPLAY, "rna_NodeTree_update");
+
+  prop = RNA_def_property(srna, "cache_limit", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, NULL, "cache_limit");
+  RNA_def_property_range(prop, 0, INT_MAX);
+  RNA_def_property_ui_text(prop,
+                           "Cache Limit",
+                           "Memory in MB used to keep node results between executions, so only "
+                           "nodes affected by a change are recalculated (Full Frame only, "
+                           "0 disables caching)");
+
+  prop = RNA_def_property(srna, "cache_hits", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, NULL, "cache_hits");
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+  RNA_def_property_ui_text(
+      prop, "Cache Hits", "Number of operations reused from the cache in the last execution");
+
+  prop = RNA_def_property(srna, "cache_misses", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, NULL, "cache_misses");
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+  RNA_def_property_ui_text(
+      prop, "Cache Misses", "Number of cacheable operations calculated in the last execution");
+
   prop = RNA_def_property(srna, "chunk_size", PROP_ENUM, PROP_NONE);
   RNA_def_property_enum_sdna(prop, NULL, "chunksize");
   RNA_def_property_enum_items(prop, node_chunksize_items);
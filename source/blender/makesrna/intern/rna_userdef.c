@@ -6027,6 +6027,13 @@ static void rna_def_userdef_filepaths(BlenderRNA *brna)
   RNA_def_property_ui_text(
       prop, "Compress File", "Enable file compression when saving .blend files");
 
+  prop = RNA_def_property(srna, "use_defer_packed_data", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", USER_FILE_DEFER_PACKED_DATA);
+  RNA_def_property_ui_text(prop,
+                           "Defer Packed Data",
+                           "Read the data of packed files when it is first used instead of when "
+                           "loading .blend files, which keeps loaded files open until then");
+
   prop = RNA_def_property(srna, "use_load_ui", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_boolean_negative_sdna(prop, NULL, "flag", USER_FILENOUI);
   RNA_def_property_ui_text(prop, "Load UI", "Load user interface setup when loading .blend files");
@@ -151,6 +151,9 @@ static void local_merge(Main *bmain, bNodeTree *localtree, bNodeTree *ntree)
   /* move over the compbufs and previews */
   BKE_node_preview_merge_tree(ntree, localtree, true);
 
+  ntree->cache_hits = localtree->cache_hits;
+  ntree->cache_misses = localtree->cache_misses;
+
   for (lnode = localtree->nodes.first; lnode; lnode = lnode->next) {
     if (ntreeNodeExists(ntree, lnode->new_node)) {
       if (ELEM(lnode->type, CMP_NODE_VIEWER, CMP_NODE_SPLITVIEWER)) {
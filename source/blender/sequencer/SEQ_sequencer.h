@@ -120,9 +120,14 @@ void BKE_sequence_iterator_end(SeqIterator *iter);
 
 typedef enum eSeqTaskId {
   SEQ_TASK_MAIN_RENDER,
+  /* Prefetch workers use consecutive IDs, starting with this one. */
   SEQ_TASK_PREFETCH_RENDER,
 } eSeqTaskId;
 
+/* Maximum number of frames rendered concurrently by prefetching. */
+#define SEQ_PREFETCH_WORKERS_MAX 8
+#define SEQ_TASK_ID_MAX (SEQ_TASK_PREFETCH_RENDER + SEQ_PREFETCH_WORKERS_MAX)
+
 typedef struct SeqRenderData {
   struct Main *bmain;
   struct Depsgraph *depsgraph;
@@ -3877,6 +3877,10 @@ static int early_out_text(Sequence *seq, float UNUSED(facf0), float UNUSED(facf1
   return EARLY_NO_INPUT;
 }
 
+/* Fonts keep their drawing state (size, buffer, position), so text strips rendered by
+ * concurrent prefetch workers must not draw at the same time. */
+static ThreadMutex text_effect_mutex = BLI_MUTEX_INITIALIZER;
+
 static ImBuf *do_text_effect(const SeqRenderData *context,
                              Sequence *seq,
                              float UNUSED(timeline_frame),
@@ -3897,6 +3901,8 @@ static ImBuf *do_text_effect(const SeqRenderData *context,
   int y_ofs, x, y;
   double proxy_size_comp;
 
+  BLI_mutex_lock(&text_effect_mutex);
+
   if (data->text_blf_id == SEQ_FONT_NOT_LOADED) {
     data->text_blf_id = -1;
 
@@ -4010,6 +4016,8 @@ static ImBuf *do_text_effect(const SeqRenderData *context,
 
   BLF_disable(font, BLF_WORD_WRAP);
 
+  BLI_mutex_unlock(&text_effect_mutex);
+
   return out;
 }
 
@@ -20,9 +20,17 @@
  * \ingroup bke
  */
 
+#include <fcntl.h> /* For open flags (O_BINARY, O_RDONLY). */
 #include <memory.h>
 #include <stddef.h>
 #include <time.h>
+#include <zstd.h>
+
+#ifndef WIN32
+#  include <unistd.h> /* For close. */
+#else
+#  include <io.h> /* For close. */
+#endif
 
 #include "MEM_guardedalloc.h"
 
@@ -41,6 +49,7 @@
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
 #include "BLI_path_util.h"
 #include "BLI_threads.h"
 
@@ -71,6 +80,8 @@
  * Entries are linked in order as they are put into cache.
  * Only permanent (is_temp_cache = 0) cache entries are linked.
  * Putting #SEQ_CACHE_STORE_FINAL_OUT will reset linking
+ * Each task (main render, prefetch workers) links its own entries, so that frames rendered
+ * concurrently do not end up in the same chain.
  *
  * Only entire frame can be freed to release resources for new entries (recycling).
  * Once again, this is to reduce number of iterations, but also more controllable than removing
@@ -86,7 +97,11 @@
  * For each cached non-temp image, image data and supplementary info are written to HDD.
  * Multiple(DCACHE_IMAGES_PER_FILE) images share the same file.
  * Each of these files contains header DiskCacheHeader followed by image data.
- * Zlib compression with user definable level can be used to compress image data(per image)
+ * Zstd compression with user definable level can be used to compress image data(per image).
+ * Codec is chosen per buffer type: float buffers are split into byte planes before compression,
+ * which compresses better and faster, because bytes of similar significance are grouped.
+ * Files are memory-mapped for reading, so that reads of different images do not block each
+ * other, and decompression reads directly from page cache.
  * Images are written in order in which they are rendered.
  * Overwriting of individual entry is not possible.
  * Stored images are deleted by invalidation, or when size of all files exceeds maximum
@@ -99,11 +114,20 @@
 /* <cache type>-<resolution X>x<resolution Y>-<rendersize>%(<view_id>)-<frame no>.dcf */
 #define DCACHE_FNAME_FORMAT "%d-%dx%d-%d%%(%d)-%d.dcf"
 #define DCACHE_IMAGES_PER_FILE 100
-#define DCACHE_CURRENT_VERSION 1
+#define DCACHE_CURRENT_VERSION 2
 #define COLORSPACE_NAME_MAX 64 /* XXX: defined in imb intern */
 
+/* Codec used for image data of #DiskCacheHeaderEntry. */
+enum {
+  DCACHE_CODEC_NONE = 0,
+  DCACHE_CODEC_ZSTD = 1,
+  /* Zstd, bytes of each float are stored in separate planes. */
+  DCACHE_CODEC_ZSTD_FLOAT_PLANES = 2,
+};
+
 typedef struct DiskCacheHeaderEntry {
   unsigned char encoding;
+  unsigned char codec;
   uint64_t frameno;
   uint64_t size_compressed;
   uint64_t size_raw;
@@ -119,7 +143,11 @@ typedef struct SeqDiskCache {
   Main *bmain;
   int64_t timestamp;
   ListBase files;
-  ThreadMutex read_write_mutex;
+  /* Reading locks for read, so images can be read in parallel. Anything changing files locks for
+   * write. */
+  ThreadRWMutex read_write_mutex;
+  /* Protects file list entries updated by readers. */
+  ThreadMutex read_update_mutex;
   size_t size_total;
 } SeqDiskCache;
 
@@ -143,7 +171,7 @@ typedef struct SeqCache {
   ThreadMutex iterator_mutex;
   struct BLI_mempool *keys_pool;
   struct BLI_mempool *items_pool;
-  struct SeqCacheKey *last_key;
+  struct SeqCacheKey *last_key[SEQ_TASK_ID_MAX]; /* Indexed by #eSeqTaskId. */
   size_t memory_used;
   SeqDiskCache *disk_cache;
 } SeqCache;
@@ -293,7 +321,7 @@ static void seq_disk_cache_delete_file(SeqDiskCache *disk_cache, DiskCacheFile *
 
 static bool seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache)
 {
-  BLI_mutex_lock(&disk_cache->read_write_mutex);
+  BLI_rw_mutex_lock(&disk_cache->read_write_mutex, THREAD_LOCK_WRITE);
   while (disk_cache->size_total > seq_disk_cache_size_limit()) {
     DiskCacheFile *oldest_file = seq_disk_cache_get_oldest_file(disk_cache);
 
@@ -312,7 +340,7 @@ static bool seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache)
 
     seq_disk_cache_delete_file(disk_cache, oldest_file);
   }
-  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+  BLI_rw_mutex_unlock(&disk_cache->read_write_mutex);
 
   return true;
 }
@@ -473,46 +501,150 @@ static void seq_disk_cache_invalidate(Scene *scene,
   int end;
   SeqDiskCache *disk_cache = scene->ed->cache->disk_cache;
 
-  BLI_mutex_lock(&disk_cache->read_write_mutex);
+  BLI_rw_mutex_lock(&disk_cache->read_write_mutex, THREAD_LOCK_WRITE);
 
   start = seq_changed->startdisp - DCACHE_IMAGES_PER_FILE;
   end = seq_changed->enddisp;
 
   seq_disk_cache_delete_invalid_files(disk_cache, scene, seq, invalidate_types, start, end);
 
-  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+  BLI_rw_mutex_unlock(&disk_cache->read_write_mutex);
 }
 
-static size_t deflate_imbuf_to_file(ImBuf *ibuf,
-                                    FILE *file,
-                                    int level,
-                                    DiskCacheHeaderEntry *header_entry)
+static int seq_disk_cache_codec_get(ImBuf *ibuf, int level)
 {
+  if (level == 0) {
+    return DCACHE_CODEC_NONE;
+  }
   if (ibuf->rect) {
-    return BLI_gzip_mem_to_file_at_pos(
-        ibuf->rect, header_entry->size_raw, file, header_entry->offset, level);
+    return DCACHE_CODEC_ZSTD;
   }
+  return DCACHE_CODEC_ZSTD_FLOAT_PLANES;
+}
+
+/* Store n-th byte of every float in n-th plane. */
+static void seq_disk_cache_float_planes_split(const uchar *src, uchar *dst, size_t size)
+{
+  const size_t plane_size = size / sizeof(float);
 
-  return BLI_gzip_mem_to_file_at_pos(
-      ibuf->rect_float, header_entry->size_raw, file, header_entry->offset, level);
+  for (size_t i = 0; i < plane_size; i++, src += sizeof(float)) {
+    for (size_t plane = 0; plane < sizeof(float); plane++) {
+      dst[plane * plane_size + i] = src[plane];
+    }
+  }
 }
 
-static size_t inflate_file_to_imbuf(ImBuf *ibuf, FILE *file, DiskCacheHeaderEntry *header_entry)
+static void seq_disk_cache_float_planes_join(const uchar *src, uchar *dst, size_t size)
 {
-  if (ibuf->rect) {
-    return BLI_ungzip_file_to_mem_at_pos(
-        ibuf->rect, header_entry->size_raw, file, header_entry->offset);
+  const size_t plane_size = size / sizeof(float);
+
+  for (size_t i = 0; i < plane_size; i++, dst += sizeof(float)) {
+    for (size_t plane = 0; plane < sizeof(float); plane++) {
+      dst[plane] = src[plane * plane_size + i];
+    }
+  }
+}
+
+static size_t seq_disk_cache_encode_imbuf(ImBuf *ibuf,
+                                          FILE *file,
+                                          int level,
+                                          DiskCacheHeaderEntry *header_entry)
+{
+  const size_t size_raw = header_entry->size_raw;
+  const void *data = ibuf->rect ? (void *)ibuf->rect : (void *)ibuf->rect_float;
+
+  header_entry->codec = seq_disk_cache_codec_get(ibuf, level);
+
+  if (BLI_fseek(file, header_entry->offset, SEEK_SET) != 0) {
+    return 0;
+  }
+
+  if (header_entry->codec == DCACHE_CODEC_NONE) {
+    return fwrite(data, 1, size_raw, file) == size_raw ? size_raw : 0;
+  }
+
+  uchar *planes = NULL;
+  if (header_entry->codec == DCACHE_CODEC_ZSTD_FLOAT_PLANES) {
+    planes = MEM_mallocN(size_raw, "SeqDiskCacheFloatPlanes");
+    seq_disk_cache_float_planes_split(data, planes, size_raw);
+    data = planes;
   }
 
-  return BLI_ungzip_file_to_mem_at_pos(
-      ibuf->rect_float, header_entry->size_raw, file, header_entry->offset);
+  const size_t size_bound = ZSTD_compressBound(size_raw);
+  void *compressed = MEM_mallocN(size_bound, "SeqDiskCacheCompressed");
+  size_t size_compressed = ZSTD_compress(compressed, size_bound, data, size_raw, level);
+
+  if (ZSTD_isError(size_compressed) ||
+      fwrite(compressed, 1, size_compressed, file) != size_compressed) {
+    size_compressed = 0;
+  }
+
+  MEM_freeN(compressed);
+  MEM_SAFE_FREE(planes);
+
+  return size_compressed;
 }
 
-static void seq_disk_cache_read_header(FILE *file, DiskCacheHeader *header)
+static bool seq_disk_cache_decode_imbuf(ImBuf *ibuf,
+                                        BLI_mmap_file *mmap_file,
+                                        DiskCacheHeaderEntry *header_entry)
 {
-  fseek(file, 0, 0);
-  fread(header, sizeof(*header), 1, file);
+  const size_t size_raw = header_entry->size_raw;
+  const size_t size_compressed = header_entry->size_compressed;
+  const size_t offset = header_entry->offset;
+  void *data = ibuf->rect ? (void *)ibuf->rect : (void *)ibuf->rect_float;
+
+  if (offset + size_compressed > BLI_mmap_get_length(mmap_file)) {
+    return false;
+  }
+
+  if (header_entry->codec == DCACHE_CODEC_NONE) {
+    return size_compressed == size_raw && BLI_mmap_read(mmap_file, data, offset, size_raw);
+  }
+
+  if (!ELEM(header_entry->codec, DCACHE_CODEC_ZSTD, DCACHE_CODEC_ZSTD_FLOAT_PLANES)) {
+    return false;
+  }
+
+  /* Decompress straight from mapped memory where possible. */
+  const char *memory = BLI_mmap_get_pointer(mmap_file);
+  void *compressed = NULL;
+  const void *src;
 
+  if (memory != NULL) {
+    src = memory + offset;
+  }
+  else {
+    compressed = MEM_mallocN(size_compressed, "SeqDiskCacheCompressed");
+    if (!BLI_mmap_read(mmap_file, compressed, offset, size_compressed)) {
+      MEM_freeN(compressed);
+      return false;
+    }
+    src = compressed;
+  }
+
+  uchar *planes = NULL;
+  void *dst = data;
+  if (header_entry->codec == DCACHE_CODEC_ZSTD_FLOAT_PLANES) {
+    planes = MEM_mallocN(size_raw, "SeqDiskCacheFloatPlanes");
+    dst = planes;
+  }
+
+  const size_t size = ZSTD_decompress(dst, size_raw, src, size_compressed);
+  bool ok = !ZSTD_isError(size) && size == size_raw && !BLI_mmap_any_io_error(mmap_file);
+
+  if (ok && planes != NULL) {
+    seq_disk_cache_float_planes_join(planes, data, size_raw);
+  }
+
+  MEM_SAFE_FREE(compressed);
+  MEM_SAFE_FREE(planes);
+
+  return ok;
+}
+
+static void seq_disk_cache_header_endian_switch(DiskCacheHeader *header)
+{
   for (int i = 0; i < DCACHE_IMAGES_PER_FILE; i++) {
     if ((ENDIAN_ORDER == B_ENDIAN) && header->entry[i].encoding == 0) {
       BLI_endian_switch_uint64(&header->entry[i].frameno);
@@ -523,6 +655,13 @@ static void seq_disk_cache_read_header(FILE *file, DiskCacheHeader *header)
   }
 }
 
+static void seq_disk_cache_read_header(FILE *file, DiskCacheHeader *header)
+{
+  fseek(file, 0, 0);
+  fread(header, sizeof(*header), 1, file);
+  seq_disk_cache_header_endian_switch(header);
+}
+
 static size_t seq_disk_cache_write_header(FILE *file, DiskCacheHeader *header)
 {
   fseek(file, 0, 0);
@@ -611,7 +750,7 @@ static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key
   memset(&header, 0, sizeof(header));
   seq_disk_cache_read_header(file, &header);
   int entry_index = seq_disk_cache_add_header_entry(key, ibuf, &header);
-  size_t bytes_written = deflate_imbuf_to_file(
+  size_t bytes_written = seq_disk_cache_encode_imbuf(
       ibuf, file, seq_disk_cache_compression_level(), &header.entry[entry_index]);
 
   if (bytes_written != 0) {
@@ -629,6 +768,7 @@ static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key
   return false;
 }
 
+/* Can be called from multiple threads at once, with read_write_mutex locked for read. */
 static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *key)
 {
   char path[FILE_MAX];
@@ -637,51 +777,65 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
   seq_disk_cache_get_file_path(disk_cache, key, path, sizeof(path));
   BLI_make_existing_file(path);
 
-  FILE *file = BLI_fopen(path, "rb");
-  if (!file) {
+  const int file = BLI_open(path, O_BINARY | O_RDONLY, 0);
+  if (file == -1) {
     return NULL;
   }
 
-  seq_disk_cache_read_header(file, &header);
+  BLI_mmap_file *mmap_file = BLI_mmap_open(file);
+  if (mmap_file == NULL) {
+    close(file);
+    return NULL;
+  }
+
+  if (!BLI_mmap_read(mmap_file, &header, 0, sizeof(header))) {
+    BLI_mmap_free(mmap_file);
+    close(file);
+    return NULL;
+  }
+  seq_disk_cache_header_endian_switch(&header);
   int entry_index = seq_disk_cache_get_header_entry(key, &header);
 
   /* Item not found. */
   if (entry_index < 0) {
-    fclose(file);
+    BLI_mmap_free(mmap_file);
+    close(file);
     return NULL;
   }
 
   ImBuf *ibuf;
   uint64_t size_char = (uint64_t)key->context.rectx * key->context.recty * 4;
   uint64_t size_float = (uint64_t)key->context.rectx * key->context.recty * 16;
-  size_t expected_size;
 
   if (header.entry[entry_index].size_raw == size_char) {
-    expected_size = size_char;
     ibuf = IMB_allocImBuf(key->context.rectx, key->context.recty, 32, IB_rect);
     IMB_colormanagement_assign_rect_colorspace(ibuf, header.entry[entry_index].colorspace_name);
   }
   else if (header.entry[entry_index].size_raw == size_float) {
-    expected_size = size_float;
     ibuf = IMB_allocImBuf(key->context.rectx, key->context.recty, 32, IB_rectfloat);
     IMB_colormanagement_assign_float_colorspace(ibuf, header.entry[entry_index].colorspace_name);
   }
   else {
-    fclose(file);
+    BLI_mmap_free(mmap_file);
+    close(file);
     return NULL;
   }
 
-  size_t bytes_read = inflate_file_to_imbuf(ibuf, file, &header.entry[entry_index]);
+  const bool ok = seq_disk_cache_decode_imbuf(ibuf, mmap_file, &header.entry[entry_index]);
+
+  BLI_mmap_free(mmap_file);
+  close(file);
 
   /* Sanity check. */
-  if (bytes_read != expected_size) {
-    fclose(file);
+  if (!ok) {
     IMB_freeImBuf(ibuf);
     return NULL;
   }
+
+  BLI_mutex_lock(&disk_cache->read_update_mutex);
   BLI_file_touch(path);
   seq_disk_cache_update_file(disk_cache, path);
-  fclose(file);
+  BLI_mutex_unlock(&disk_cache->read_update_mutex);
 
   return ibuf;
 }
@@ -812,7 +966,7 @@ static void seq_cache_put(SeqCache *cache, SeqCacheKey *key, ImBuf *ibuf)
 
   if (BLI_ghash_reinsert(cache->hash, key, item, seq_cache_keyfree, seq_cache_valfree)) {
     IMB_refImBuf(ibuf);
-    cache->last_key = key;
+    cache->last_key[key->task_id] = key;
     cache->memory_used += IMB_get_size_in_memory(ibuf);
   }
 }
@@ -830,6 +984,22 @@ static ImBuf *seq_cache_get(SeqCache *cache, SeqCacheKey *key)
   return NULL;
 }
 
+static void seq_cache_reset_linking(SeqCache *cache)
+{
+  memset(cache->last_key, 0, sizeof(cache->last_key));
+}
+
+/* Key is end of chain, that some task is still adding entries to. */
+static bool seq_cache_key_is_linking(SeqCache *cache, SeqCacheKey *key)
+{
+  for (int i = 0; i < SEQ_TASK_ID_MAX; i++) {
+    if (cache->last_key[i] == key) {
+      return true;
+    }
+  }
+  return false;
+}
+
 static void seq_cache_relink_keys(SeqCacheKey *link_next, SeqCacheKey *link_prev)
 {
   if (link_next) {
@@ -955,7 +1125,7 @@ static SeqCacheKey *seq_cache_get_item_for_removal(Scene *scene)
       continue;
     }
 
-    if (key->is_temp_cache || key->link_next != NULL) {
+    if (key->is_temp_cache || key->link_next != NULL || seq_cache_key_is_linking(cache, key)) {
       continue;
     }
 
@@ -1054,7 +1224,8 @@ static void seq_disk_cache_create(Main *bmain, Scene *scene)
 
   cache->disk_cache = MEM_callocN(sizeof(SeqDiskCache), "SeqDiskCache");
   cache->disk_cache->bmain = bmain;
-  BLI_mutex_init(&cache->disk_cache->read_write_mutex);
+  BLI_rw_mutex_init(&cache->disk_cache->read_write_mutex);
+  BLI_mutex_init(&cache->disk_cache->read_update_mutex);
   seq_disk_cache_handle_versioning(cache->disk_cache);
   seq_disk_cache_get_files(cache->disk_cache, seq_disk_cache_base_dir());
   cache->disk_cache->timestamp = scene->ed->disk_cache_timestamp;
@@ -1069,7 +1240,7 @@ static void seq_cache_create(Main *bmain, Scene *scene)
     cache->keys_pool = BLI_mempool_create(sizeof(SeqCacheKey), 0, 64, BLI_MEMPOOL_NOP);
     cache->items_pool = BLI_mempool_create(sizeof(SeqCacheItem), 0, 64, BLI_MEMPOOL_NOP);
     cache->hash = BLI_ghash_new(seq_cache_hashhash, seq_cache_hashcmp, "SeqCache hash");
-    cache->last_key = NULL;
+    seq_cache_reset_linking(cache);
     cache->bmain = bmain;
     BLI_mutex_init(&cache->iterator_mutex);
     scene->ed->cache = cache;
@@ -1125,7 +1296,8 @@ void BKE_sequencer_cache_destruct(Scene *scene)
 
   if (cache->disk_cache != NULL) {
     BLI_freelistN(&cache->disk_cache->files);
-    BLI_mutex_end(&cache->disk_cache->read_write_mutex);
+    BLI_rw_mutex_end(&cache->disk_cache->read_write_mutex);
+    BLI_mutex_end(&cache->disk_cache->read_update_mutex);
     MEM_freeN(cache->disk_cache);
   }
 
@@ -1158,7 +1330,7 @@ void BKE_sequencer_cache_cleanup(Scene *scene)
     BLI_ghashIterator_step(&gh_iter);
     BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
   }
-  cache->last_key = NULL;
+  seq_cache_reset_linking(cache);
   seq_cache_unlock(scene);
 }
 
@@ -1222,7 +1394,7 @@ void BKE_sequencer_cache_cleanup_sequence(Scene *scene,
       BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
     }
   }
-  cache->last_key = NULL;
+  seq_cache_reset_linking(cache);
   seq_cache_unlock(scene);
 }
 
@@ -1279,9 +1451,9 @@ struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
       seq_disk_cache_create(context->bmain, context->scene);
     }
 
-    BLI_mutex_lock(&cache->disk_cache->read_write_mutex);
+    BLI_rw_mutex_lock(&cache->disk_cache->read_write_mutex, THREAD_LOCK_READ);
     ibuf = seq_disk_cache_read_file(cache->disk_cache, &key);
-    BLI_mutex_unlock(&cache->disk_cache->read_write_mutex);
+    BLI_rw_mutex_unlock(&cache->disk_cache->read_write_mutex);
     if (ibuf) {
       if (key.type == SEQ_CACHE_STORE_FINAL_OUT) {
         BKE_sequencer_cache_put_if_possible(context, seq, timeline_frame, type, ibuf, 0.0f, true);
@@ -1320,8 +1492,8 @@ bool BKE_sequencer_cache_put_if_possible(const SeqRenderData *context,
     return true;
   }
 
-  seq_cache_set_temp_cache_linked(scene, scene->ed->cache->last_key);
-  scene->ed->cache->last_key = NULL;
+  seq_cache_set_temp_cache_linked(scene, scene->ed->cache->last_key[context->task_id]);
+  scene->ed->cache->last_key[context->task_id] = NULL;
   return false;
 }
 
@@ -1394,27 +1566,27 @@ void BKE_sequencer_cache_put(const SeqRenderData *context,
   /* Item stored for later use */
   if (flag & type) {
     key->is_temp_cache = false;
-    key->link_prev = cache->last_key;
+    key->link_prev = cache->last_key[key->task_id];
   }
 
-  SeqCacheKey *temp_last_key = cache->last_key;
+  SeqCacheKey *temp_last_key = cache->last_key[key->task_id];
   seq_cache_put(cache, key, i);
 
   /* Restore pointer to previous item as this one will be freed when stack is rendered. */
   if (key->is_temp_cache) {
-    cache->last_key = temp_last_key;
+    cache->last_key[key->task_id] = temp_last_key;
   }
 
   /* Set last_key's reference to this key so we can look up chain backwards.
    * Item is already put in cache, so cache->last_key points to current key.
    */
   if (flag & type && temp_last_key) {
-    temp_last_key->link_next = cache->last_key;
+    temp_last_key->link_next = cache->last_key[key->task_id];
   }
 
   /* Reset linking. */
   if (key->type == SEQ_CACHE_STORE_FINAL_OUT) {
-    cache->last_key = NULL;
+    cache->last_key[key->task_id] = NULL;
   }
 
   seq_cache_unlock(scene);
@@ -1425,9 +1597,9 @@ void BKE_sequencer_cache_put(const SeqRenderData *context,
         seq_disk_cache_create(context->bmain, context->scene);
       }
 
-      BLI_mutex_lock(&cache->disk_cache->read_write_mutex);
+      BLI_rw_mutex_lock(&cache->disk_cache->read_write_mutex, THREAD_LOCK_WRITE);
       seq_disk_cache_write_file(cache->disk_cache, key, i);
-      BLI_mutex_unlock(&cache->disk_cache->read_write_mutex);
+      BLI_rw_mutex_unlock(&cache->disk_cache->read_write_mutex);
       seq_disk_cache_enforce_limits(cache->disk_cache);
     }
   }
@@ -1460,7 +1632,7 @@ void BKE_sequencer_cache_iterate(struct Scene *scene,
     interrupt = callback_iter(userdata, key->seq, key->timeline_frame, key->type, key->cost);
   }
 
-  cache->last_key = NULL;
+  seq_cache_reset_linking(cache);
   seq_cache_unlock(scene);
 }
 
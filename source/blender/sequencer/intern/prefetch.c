@@ -34,6 +34,7 @@
 #include "DNA_windowmanager_types.h"
 
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_threads.h"
 
 #include "IMB_imbuf.h"
@@ -59,30 +60,67 @@
 #include "prefetch.h"
 #include "render.h"
 
+/* Number of frames FFmpeg decoding reads ahead of the last requested frame, see
+ * #ANIM_READAHEAD_FRAMES. */
+#define SEQ_PREFETCH_READAHEAD_FRAMES 8
+/* Number of consecutive frames handed out to a worker at once, so movie strips are decoded
+ * sequentially by each worker. Frames read ahead past the end of a run are discarded when the
+ * worker continues elsewhere, so runs span several read-ahead windows. */
+#define SEQ_PREFETCH_RUN_LENGTH (4 * SEQ_PREFETCH_READAHEAD_FRAMES)
+
+/* Frames are handed out to workers in runs of consecutive frames. Each worker renders with its
+ * own depsgraph and render context, so that several frames can be rendered at the same time. */
+typedef struct PrefetchWorker {
+  struct PrefetchJob *pfjob;
+  struct Scene *scene_eval;
+  struct Depsgraph *depsgraph;
+
+  /* context */
+  struct SeqRenderData context;
+  struct SeqRenderData context_cpy;
+
+  int index;
+
+  /* The depsgraph and context are built by the worker before rendering its first frame of a
+   * prefetch run, so workers that don't render don't need them. */
+  bool is_initialized;
+
+  /* Next frame of the run of frames claimed by this worker. */
+  float run_cfra;
+  int run_frames_left;
+} PrefetchWorker;
+
 typedef struct PrefetchJob {
   struct PrefetchJob *next, *prev;
 
   struct Main *bmain;
   struct Main *bmain_eval;
   struct Scene *scene;
-  struct Scene *scene_eval;
-  struct Depsgraph *depsgraph;
 
   ThreadMutex prefetch_suspend_mutex;
   ThreadCondition prefetch_suspend_cond;
+  /* Depsgraph building may write to original data, workers don't build at the same time. */
+  ThreadMutex depsgraph_mutex;
 
   ListBase threads;
-
-  /* context */
-  struct SeqRenderData context;
-  struct SeqRenderData context_cpy;
-  struct ListBase *seqbasep;
-  struct ListBase *seqbasep_cpy;
+  PrefetchWorker workers[SEQ_PREFETCH_WORKERS_MAX];
+  int workers_num;
 
   /* prefetch area */
   float cfra;
+  /* Offset of next frame to be handed out to a worker. */
   int num_frames_prefetched;
 
+  /* Resolution of the context prefetching was started for. */
+  int rectx, recty;
+  int preview_render_size;
+
+  /* Scheduling, protected by prefetch_suspend_mutex. */
+  float cost_avg;
+  int workers_running;
+  int workers_rendering;
+  int workers_waiting;
+
   /* control */
   bool running;
   bool waiting;
@@ -169,8 +207,10 @@ Sequence *BKE_sequencer_prefetch_get_original_sequence(Sequence *seq, Scene *sce
 SeqRenderData *BKE_sequencer_prefetch_get_original_context(const SeqRenderData *context)
 {
   PrefetchJob *pfjob = seq_prefetch_job_get(context->scene);
+  const int worker_index = context->task_id - SEQ_TASK_PREFETCH_RENDER;
 
-  return &pfjob->context;
+  BLI_assert(worker_index >= 0 && worker_index < pfjob->workers_num);
+  return &pfjob->workers[worker_index].context;
 }
 
 static bool seq_prefetch_is_cache_full(Scene *scene)
@@ -188,10 +228,6 @@ static float seq_prefetch_cfra(PrefetchJob *pfjob)
 {
   return pfjob->cfra + pfjob->num_frames_prefetched;
 }
-static AnimationEvalContext seq_prefetch_anim_eval_context(PrefetchJob *pfjob)
-{
-  return BKE_animsys_eval_context_construct(pfjob->depsgraph, seq_prefetch_cfra(pfjob));
-}
 
 void BKE_sequencer_prefetch_get_time_range(Scene *scene, int *start, int *end)
 {
@@ -201,37 +237,44 @@ void BKE_sequencer_prefetch_get_time_range(Scene *scene, int *start, int *end)
   *end = seq_prefetch_cfra(pfjob);
 }
 
-static void seq_prefetch_free_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_free_depsgraph(PrefetchWorker *worker)
 {
-  if (pfjob->depsgraph != NULL) {
-    DEG_graph_free(pfjob->depsgraph);
+  if (worker->depsgraph != NULL) {
+    DEG_graph_free(worker->depsgraph);
   }
-  pfjob->depsgraph = NULL;
-  pfjob->scene_eval = NULL;
+  worker->depsgraph = NULL;
+  worker->scene_eval = NULL;
 }
 
-static void seq_prefetch_update_depsgraph(PrefetchJob *pfjob)
-{
-  DEG_evaluate_on_framechange(pfjob->depsgraph, seq_prefetch_cfra(pfjob));
-}
-
-static void seq_prefetch_init_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_init_depsgraph(PrefetchWorker *worker, float cfra)
 {
+  PrefetchJob *pfjob = worker->pfjob;
   Main *bmain = pfjob->bmain_eval;
   Scene *scene = pfjob->scene;
   ViewLayer *view_layer = BKE_view_layer_default_render(scene);
 
-  pfjob->depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_RENDER);
-  DEG_debug_name_set(pfjob->depsgraph, "SEQUENCER PREFETCH");
+  BLI_mutex_lock(&pfjob->depsgraph_mutex);
+
+  seq_prefetch_free_depsgraph(worker);
+
+  worker->depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_RENDER);
+  DEG_debug_name_set(worker->depsgraph, "SEQUENCER PREFETCH");
 
   /* Make sure there is a correct evaluated scene pointer. */
-  DEG_graph_build_for_render_pipeline(pfjob->depsgraph);
+  DEG_graph_build_for_render_pipeline(worker->depsgraph);
 
   /* Update immediately so we have proper evaluated scene. */
-  seq_prefetch_update_depsgraph(pfjob);
+  DEG_evaluate_on_framechange(worker->depsgraph, cfra);
+
+  worker->scene_eval = DEG_get_evaluated_scene(worker->depsgraph);
+  worker->scene_eval->ed->cache_flag = 0;
 
-  pfjob->scene_eval = DEG_get_evaluated_scene(pfjob->depsgraph);
-  pfjob->scene_eval->ed->cache_flag = 0;
+  BLI_mutex_unlock(&pfjob->depsgraph_mutex);
+}
+
+static bool seq_prefetch_is_frame_in_area(PrefetchJob *pfjob, float cfra)
+{
+  return cfra >= pfjob->cfra && cfra < seq_prefetch_cfra(pfjob);
 }
 
 static void seq_prefetch_update_area(PrefetchJob *pfjob)
@@ -279,62 +322,56 @@ void BKE_sequencer_prefetch_stop(Scene *scene)
   pfjob->stop = true;
 
   while (pfjob->running) {
-    BLI_condition_notify_one(&pfjob->prefetch_suspend_cond);
+    BLI_condition_notify_all(&pfjob->prefetch_suspend_cond);
   }
 }
 
-static void seq_prefetch_update_context(const SeqRenderData *context)
+static void seq_prefetch_update_context(PrefetchWorker *worker)
 {
-  PrefetchJob *pfjob;
-  pfjob = seq_prefetch_job_get(context->scene);
+  PrefetchJob *pfjob = worker->pfjob;
 
   SEQ_render_new_render_data(pfjob->bmain_eval,
-                             pfjob->depsgraph,
-                             pfjob->scene_eval,
-                             context->rectx,
-                             context->recty,
-                             context->preview_render_size,
+                             worker->depsgraph,
+                             worker->scene_eval,
+                             pfjob->rectx,
+                             pfjob->recty,
+                             pfjob->preview_render_size,
                              false,
-                             &pfjob->context_cpy);
-  pfjob->context_cpy.is_prefetch_render = true;
-  pfjob->context_cpy.task_id = SEQ_TASK_PREFETCH_RENDER;
+                             &worker->context_cpy);
+  worker->context_cpy.is_prefetch_render = true;
+  worker->context_cpy.task_id = SEQ_TASK_PREFETCH_RENDER + worker->index;
 
   SEQ_render_new_render_data(pfjob->bmain,
-                             pfjob->depsgraph,
+                             worker->depsgraph,
                              pfjob->scene,
-                             context->rectx,
-                             context->recty,
-                             context->preview_render_size,
+                             pfjob->rectx,
+                             pfjob->recty,
+                             pfjob->preview_render_size,
                              false,
-                             &pfjob->context);
-  pfjob->context.is_prefetch_render = false;
+                             &worker->context);
+  worker->context.is_prefetch_render = false;
 
   /* Same ID as prefetch context, because context will be swapped, but we still
    * want to assign this ID to cache entries created in this thread.
-   * This is to allow "temp cache" work correctly for both threads.
+   * This is to allow "temp cache" work correctly for all threads.
    */
-  pfjob->context.task_id = SEQ_TASK_PREFETCH_RENDER;
+  worker->context.task_id = SEQ_TASK_PREFETCH_RENDER + worker->index;
 }
 
-static void seq_prefetch_update_scene(Scene *scene)
+/* Runs in the worker thread, the scene or context may have changed since the last run. */
+static void seq_prefetch_worker_init(PrefetchWorker *worker, float cfra)
 {
-  PrefetchJob *pfjob = seq_prefetch_job_get(scene);
-
-  if (!pfjob) {
-    return;
-  }
-
-  pfjob->scene = scene;
-  seq_prefetch_free_depsgraph(pfjob);
-  seq_prefetch_init_depsgraph(pfjob);
+  seq_prefetch_init_depsgraph(worker, cfra);
+  seq_prefetch_update_context(worker);
+  worker->is_initialized = true;
 }
 
 static void seq_prefetch_resume(Scene *scene)
 {
   PrefetchJob *pfjob = seq_prefetch_job_get(scene);
 
-  if (pfjob && pfjob->waiting) {
-    BLI_condition_notify_one(&pfjob->prefetch_suspend_cond);
+  if (pfjob && pfjob->workers_waiting > 0) {
+    BLI_condition_notify_all(&pfjob->prefetch_suspend_cond);
   }
 }
 
@@ -347,24 +384,27 @@ void BKE_sequencer_prefetch_free(Scene *scene)
 
   BKE_sequencer_prefetch_stop(scene);
 
-  BLI_threadpool_remove(&pfjob->threads, pfjob);
+  for (int i = 0; i < pfjob->workers_num; i++) {
+    BLI_threadpool_remove(&pfjob->threads, &pfjob->workers[i]);
+  }
   BLI_threadpool_end(&pfjob->threads);
   BLI_mutex_end(&pfjob->prefetch_suspend_mutex);
   BLI_condition_end(&pfjob->prefetch_suspend_cond);
-  seq_prefetch_free_depsgraph(pfjob);
+  for (int i = 0; i < pfjob->workers_num; i++) {
+    seq_prefetch_free_depsgraph(&pfjob->workers[i]);
+  }
+  BLI_mutex_end(&pfjob->depsgraph_mutex);
   BKE_main_free(pfjob->bmain_eval);
   MEM_freeN(pfjob);
   scene->ed->prefetch_job = NULL;
 }
 
-static bool seq_prefetch_do_skip_frame(Scene *scene)
+static bool seq_prefetch_do_skip_frame(PrefetchWorker *worker, float cfra)
 {
-  Editing *ed = scene->ed;
-  PrefetchJob *pfjob = seq_prefetch_job_get(scene);
-  float cfra = seq_prefetch_cfra(pfjob);
+  Editing *ed = worker->pfjob->scene->ed;
   Sequence *seq_arr[MAXSEQ + 1];
   int count = seq_get_shown_sequences(ed->seqbasep, cfra, 0, seq_arr);
-  SeqRenderData *ctx = &pfjob->context_cpy;
+  SeqRenderData *ctx = &worker->context_cpy;
   ImBuf *ibuf = NULL;
 
   /* Disable prefetching 3D scene strips, but check for disk cache. */
@@ -417,77 +457,172 @@ static bool seq_prefetch_do_skip_frame(Scene *scene)
   return false;
 }
 
-static bool seq_prefetch_need_suspend(PrefetchJob *pfjob)
+/* Number of workers allowed to render. During playback the main thread competes for the same
+ * cores, so use just as many workers as needed to keep ahead of playback with the measured cost
+ * of prefetched frames. Otherwise use all of them to fill the prefetched range quickly. */
+static int seq_prefetch_workers_active(PrefetchJob *pfjob)
 {
-  return seq_prefetch_is_cache_full(pfjob->scene) || seq_prefetch_is_scrubbing(pfjob->bmain) ||
-         (seq_prefetch_cfra(pfjob) >= pfjob->scene->r.efra);
+  if (seq_prefetch_is_playing(pfjob->bmain)) {
+    return clamp_i((int)ceilf(pfjob->cost_avg), 1, pfjob->workers_num);
+  }
+  return pfjob->workers_num;
 }
 
-static void seq_prefetch_do_suspend(PrefetchJob *pfjob)
+static bool seq_prefetch_need_suspend(PrefetchWorker *worker)
 {
-  BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
-  while (seq_prefetch_need_suspend(pfjob) &&
+  PrefetchJob *pfjob = worker->pfjob;
+
+  if (seq_prefetch_is_cache_full(pfjob->scene) || seq_prefetch_is_scrubbing(pfjob->bmain)) {
+    return true;
+  }
+
+  /* Workers finish the run they claimed before they are put to sleep. */
+  if (worker->run_frames_left > 0 && seq_prefetch_is_frame_in_area(pfjob, worker->run_cfra)) {
+    return false;
+  }
+
+  /* Avoid "collision" with main thread, but make sure to fetch at least few frames. Workers
+   * sleep until the main thread rendered past the prefetched frames, which resets the area. */
+  const float cfra = seq_prefetch_cfra(pfjob);
+  if (pfjob->num_frames_prefetched > 5 && (cfra - pfjob->scene->r.cfra) < 2) {
+    return true;
+  }
+
+  return (cfra > pfjob->scene->r.efra) || (worker->index >= seq_prefetch_workers_active(pfjob));
+}
+
+/* Must be called with prefetch_suspend_mutex locked. */
+static void seq_prefetch_do_suspend(PrefetchWorker *worker)
+{
+  PrefetchJob *pfjob = worker->pfjob;
+
+  while (seq_prefetch_need_suspend(worker) &&
          (pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) && !pfjob->stop) {
-    pfjob->waiting = true;
+    pfjob->workers_waiting++;
+    pfjob->waiting = (pfjob->workers_waiting == pfjob->workers_running);
     BLI_condition_wait(&pfjob->prefetch_suspend_cond, &pfjob->prefetch_suspend_mutex);
+    pfjob->workers_waiting--;
+    pfjob->waiting = false;
     seq_prefetch_update_area(pfjob);
   }
-  pfjob->waiting = false;
-  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
 }
 
-static void *seq_prefetch_frames(void *job)
+/* Returns false if frame was skipped. */
+static bool seq_prefetch_frame_render(PrefetchWorker *worker, float cfra, float *r_cost)
 {
-  PrefetchJob *pfjob = (PrefetchJob *)job;
-
-  while (seq_prefetch_cfra(pfjob) <= pfjob->scene->r.efra) {
-    pfjob->scene_eval->ed->prefetch_job = NULL;
-
-    seq_prefetch_update_depsgraph(pfjob);
-    AnimData *adt = BKE_animdata_from_id(&pfjob->context_cpy.scene->id);
-    AnimationEvalContext anim_eval_context = seq_prefetch_anim_eval_context(pfjob);
-    BKE_animsys_evaluate_animdata(
-        &pfjob->context_cpy.scene->id, adt, &anim_eval_context, ADT_RECALC_ALL, false);
-
-    /* This is quite hacky solution:
-     * We need cross-reference original scene with copy for cache.
-     * However depsgraph must not have this data, because it will try to kill this job.
-     * Scene copy don't reference original scene. Perhaps, this could be done by depsgraph.
-     * Set to NULL before return!
-     */
-    pfjob->scene_eval->ed->prefetch_job = pfjob;
+  PrefetchJob *pfjob = worker->pfjob;
+
+  worker->scene_eval->ed->prefetch_job = NULL;
+
+  DEG_evaluate_on_framechange(worker->depsgraph, cfra);
+  AnimData *adt = BKE_animdata_from_id(&worker->context_cpy.scene->id);
+  AnimationEvalContext anim_eval_context = BKE_animsys_eval_context_construct(worker->depsgraph,
+                                                                              cfra);
+  BKE_animsys_evaluate_animdata(
+      &worker->context_cpy.scene->id, adt, &anim_eval_context, ADT_RECALC_ALL, false);
+
+  /* This is quite hacky solution:
+   * We need cross-reference original scene with copy for cache.
+   * However depsgraph must not have this data, because it will try to kill this job.
+   * Scene copy don't reference original scene. Perhaps, this could be done by depsgraph.
+   * Set to NULL before return!
+   */
+  worker->scene_eval->ed->prefetch_job = pfjob;
 
-    if (seq_prefetch_do_skip_frame(pfjob->scene)) {
-      pfjob->num_frames_prefetched++;
-      continue;
-    }
+  if (seq_prefetch_do_skip_frame(worker, cfra)) {
+    return false;
+  }
 
-    ImBuf *ibuf = SEQ_render_give_ibuf(&pfjob->context_cpy, seq_prefetch_cfra(pfjob), 0);
-    BKE_sequencer_cache_free_temp_cache(
-        pfjob->scene, pfjob->context.task_id, seq_prefetch_cfra(pfjob));
-    IMB_freeImBuf(ibuf);
+  clock_t begin = seq_estimate_render_cost_begin();
+  ImBuf *ibuf = SEQ_render_give_ibuf(&worker->context_cpy, cfra, 0);
+  *r_cost = seq_estimate_render_cost_end(pfjob->scene, begin);
 
+  BKE_sequencer_cache_free_temp_cache(pfjob->scene, worker->context.task_id, cfra);
+  IMB_freeImBuf(ibuf);
+
+  return true;
+}
+
+static void *seq_prefetch_frames(void *job)
+{
+  PrefetchWorker *worker = (PrefetchWorker *)job;
+  PrefetchJob *pfjob = worker->pfjob;
+
+  BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
+  float cfra = seq_prefetch_cfra(pfjob);
+
+  while (true) {
     /* Suspend thread if there is nothing to be prefetched. */
-    seq_prefetch_do_suspend(pfjob);
+    seq_prefetch_do_suspend(worker);
 
-    /* Avoid "collision" with main thread, but make sure to fetch at least few frames */
-    if (pfjob->num_frames_prefetched > 5 &&
-        (seq_prefetch_cfra(pfjob) - pfjob->scene->r.cfra) < 2) {
+    if (!(pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) || pfjob->stop) {
       break;
     }
 
-    if (!(pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) || pfjob->stop) {
-      break;
+    /* The prefetch area may have been reset while rendering or suspended. */
+    if (worker->run_frames_left > 0 && !seq_prefetch_is_frame_in_area(pfjob, worker->run_cfra)) {
+      worker->run_frames_left = 0;
+    }
+
+    /* Claim a run at the end of the prefetched frames. Frames past the end or too close to the
+     * main thread suspend the worker rather than ending it, so it is resumed with the other
+     * workers. */
+    if (worker->run_frames_left == 0) {
+      if (seq_prefetch_need_suspend(worker)) {
+        continue;
+      }
+
+      cfra = seq_prefetch_cfra(pfjob);
+      worker->run_cfra = cfra;
+      worker->run_frames_left = min_ii(SEQ_PREFETCH_RUN_LENGTH,
+                                       (int)(pfjob->scene->r.efra - cfra) + 1);
+      pfjob->num_frames_prefetched += worker->run_frames_left;
+    }
+
+    cfra = worker->run_cfra;
+    worker->run_cfra += 1.0f;
+    worker->run_frames_left--;
+
+    pfjob->workers_rendering++;
+    const int workers_rendering = pfjob->workers_rendering;
+    BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
+
+    if (!worker->is_initialized) {
+      seq_prefetch_worker_init(worker, cfra);
+    }
+
+    float cost;
+    const bool rendered = seq_prefetch_frame_render(worker, cfra, &cost);
+
+    BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
+    pfjob->workers_rendering--;
+
+    /* Cost is based on CPU time of whole process, which includes frames rendered by other
+     * workers in the meantime. */
+    if (rendered) {
+      cost /= max_ii(workers_rendering, pfjob->workers_rendering + 1);
+      pfjob->cost_avg = interpf(cost, pfjob->cost_avg, 0.25f);
     }
 
     seq_prefetch_update_area(pfjob);
-    pfjob->num_frames_prefetched++;
   }
 
-  BKE_sequencer_cache_free_temp_cache(
-      pfjob->scene, pfjob->context.task_id, seq_prefetch_cfra(pfjob));
-  pfjob->running = false;
-  pfjob->scene_eval->ed->prefetch_job = NULL;
+  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
+
+  worker->run_frames_left = 0;
+  if (worker->is_initialized) {
+    BKE_sequencer_cache_free_temp_cache(pfjob->scene, worker->context.task_id, cfra);
+    worker->scene_eval->ed->prefetch_job = NULL;
+  }
+
+  BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
+  pfjob->workers_running--;
+  pfjob->waiting = (pfjob->workers_running > 0 &&
+                    pfjob->workers_waiting == pfjob->workers_running);
+  if (pfjob->workers_running == 0) {
+    pfjob->running = false;
+  }
+  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
 
   return NULL;
 }
@@ -501,29 +636,51 @@ static PrefetchJob *seq_prefetch_start(const SeqRenderData *context, float cfra)
       pfjob = (PrefetchJob *)MEM_callocN(sizeof(PrefetchJob), "PrefetchJob");
       context->scene->ed->prefetch_job = pfjob;
 
-      BLI_threadpool_init(&pfjob->threads, seq_prefetch_frames, 1);
+      /* Leave some threads for the main thread and for threaded effects. */
+      pfjob->workers_num = clamp_i(BLI_system_thread_count() / 2, 1, SEQ_PREFETCH_WORKERS_MAX);
+      for (int i = 0; i < pfjob->workers_num; i++) {
+        pfjob->workers[i].pfjob = pfjob;
+        pfjob->workers[i].index = i;
+      }
+
+      BLI_threadpool_init(&pfjob->threads, seq_prefetch_frames, pfjob->workers_num);
       BLI_mutex_init(&pfjob->prefetch_suspend_mutex);
       BLI_condition_init(&pfjob->prefetch_suspend_cond);
+      BLI_mutex_init(&pfjob->depsgraph_mutex);
 
       pfjob->bmain_eval = BKE_main_new();
-      pfjob->scene = context->scene;
-      seq_prefetch_init_depsgraph(pfjob);
     }
   }
   pfjob->bmain = context->bmain;
+  pfjob->scene = context->scene;
+  pfjob->rectx = context->rectx;
+  pfjob->recty = context->recty;
+  pfjob->preview_render_size = context->preview_render_size;
 
   pfjob->cfra = cfra;
   pfjob->num_frames_prefetched = 1;
 
+  /* Join workers of previous run, they have all finished at this point. */
+  for (int i = 0; i < pfjob->workers_num; i++) {
+    BLI_threadpool_remove(&pfjob->threads, &pfjob->workers[i]);
+  }
+
+  pfjob->workers_running = pfjob->workers_num;
+  pfjob->workers_rendering = 0;
+  pfjob->workers_waiting = 0;
   pfjob->waiting = false;
   pfjob->stop = false;
   pfjob->running = true;
 
-  seq_prefetch_update_scene(context->scene);
-  seq_prefetch_update_context(context);
+  /* Depsgraphs are rebuilt by the workers, only when they get frames to render. */
+  for (int i = 0; i < pfjob->workers_num; i++) {
+    pfjob->workers[i].is_initialized = false;
+    pfjob->workers[i].run_frames_left = 0;
+  }
 
-  BLI_threadpool_remove(&pfjob->threads, pfjob);
-  BLI_threadpool_insert(&pfjob->threads, pfjob);
+  for (int i = 0; i < pfjob->workers_num; i++) {
+    BLI_threadpool_insert(&pfjob->threads, &pfjob->workers[i]);
+  }
 
   return pfjob;
 }
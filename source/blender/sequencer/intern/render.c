@@ -28,6 +28,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "DNA_anim_types.h"
 #include "DNA_mask_types.h"
 #include "DNA_scene_types.h"
@@ -38,6 +40,8 @@
 #include "BLI_listbase.h"
 #include "BLI_path_util.h"
 
+#include "PIL_time.h"
+
 #include "BKE_anim_data.h"
 #include "BKE_animsys.h"
 #include "BKE_fcurve.h"
@@ -81,7 +85,10 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
                                      float timeline_frame,
                                      int chanshown);
 
-static ThreadMutex seq_render_mutex = BLI_MUTEX_INITIALIZER;
+static ThreadRWMutex seq_render_mutex = BLI_RWLOCK_INITIALIZER;
+/* Number of renders from the main thread waiting for #seq_render_mutex. Read-write locks may
+ * keep granting the lock to readers, so prefetch workers back off while this is set. */
+static int32_t seq_render_main_waiting = 0;
 SequencerDrawView sequencer_view3d_fn = NULL; /* NULL in background mode */
 
 /* -------------------------------------------------------------------- */
@@ -398,12 +405,12 @@ int seq_get_shown_sequences(ListBase *seqbasep,
 }
 
 /* Estimate time spent by the program rendering the strip */
-static clock_t seq_estimate_render_cost_begin(void)
+clock_t seq_estimate_render_cost_begin(void)
 {
   return clock();
 }
 
-static float seq_estimate_render_cost_end(Scene *scene, clock_t begin)
+float seq_estimate_render_cost_end(Scene *scene, clock_t begin)
 {
   clock_t end = clock();
   float time_spent = (float)(end - begin);
@@ -2038,7 +2045,19 @@ ImBuf *SEQ_render_give_ibuf(const SeqRenderData *context, float timeline_frame,
   float cost = 0;
 
   if (count && !out) {
-    BLI_mutex_lock(&seq_render_mutex);
+    /* Prefetch workers only share the lock with each other, every task links its own cache
+     * entries. Rendering from the main thread still excludes all of them. */
+    if (context->is_prefetch_render) {
+      while (atomic_add_and_fetch_int32(&seq_render_main_waiting, 0) > 0) {
+        PIL_sleep_ms(1);
+      }
+      BLI_rw_mutex_lock(&seq_render_mutex, THREAD_LOCK_READ);
+    }
+    else {
+      atomic_add_and_fetch_int32(&seq_render_main_waiting, 1);
+      BLI_rw_mutex_lock(&seq_render_mutex, THREAD_LOCK_WRITE);
+      atomic_sub_and_fetch_int32(&seq_render_main_waiting, 1);
+    }
     out = seq_render_strip_stack(context, &state, seqbasep, timeline_frame, chanshown);
     cost = seq_estimate_render_cost_end(context->scene, begin);
 
@@ -2060,7 +2079,7 @@ ImBuf *SEQ_render_give_ibuf(const SeqRenderData *context, float timeline_frame,
                                           cost,
                                           false);
     }
-    BLI_mutex_unlock(&seq_render_mutex);
+    BLI_rw_mutex_unlock(&seq_render_mutex);
   }
 
   BKE_sequencer_prefetch_start(context, timeline_frame, cost);
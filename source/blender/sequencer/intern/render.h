@@ -23,6 +23,8 @@
  * \ingroup sequencer
  */
 
+#include <time.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -73,6 +75,8 @@ struct ImBuf *seq_render_mask(const struct SeqRenderData *context,
                               float frame_index,
                               bool make_float);
 void seq_imbuf_assign_spaces(struct Scene *scene, struct ImBuf *ibuf);
+clock_t seq_estimate_render_cost_begin(void);
+float seq_estimate_render_cost_end(struct Scene *scene, clock_t begin);
 
 #ifdef __cplusplus
 }
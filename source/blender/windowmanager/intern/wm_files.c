@@ -118,6 +118,8 @@
 #include "UI_resources.h"
 #include "UI_view2d.h"
 
+#include "COM_compositor.h"
+
 /* only to report a missing engine */
 #include "RE_engine.h"
 
@@ -147,9 +149,12 @@ static void wm_history_file_write(void);
 /** \name Misc Utility Functions
  * \{ */
 
+static void wm_file_write_job_tag_modified(wmWindowManager *wm);
+
 void WM_file_tag_modified(void)
 {
   wmWindowManager *wm = G_MAIN->wm.first;
+  wm_file_write_job_tag_modified(wm);
   if (wm->file_saved) {
     wm->file_saved = 0;
     /* notifier that data changed, for save-over warning or header */
@@ -437,6 +442,16 @@ static void wm_init_userdef(Main *bmain)
  * we could support registering other file formats and their loaders.
  * \{ */
 
+/* Zstd frame or skippable frame, compressed blend files are checked by the blend file reader. */
+static bool wm_header_is_zstd(const char *header)
+{
+  const uchar *magic = (const uchar *)header;
+  if (magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD) {
+    return true;
+  }
+  return (magic[0] & 0xF0) == 0x50 && magic[1] == 0x2A && magic[2] == 0x4D && magic[3] == 0x18;
+}
+
 /* intended to check for non-blender formats but for now it only reads blends */
 static int wm_read_exotic(const char *name)
 {
@@ -459,7 +474,8 @@ static int wm_read_exotic(const char *name)
     else {
       len = gzread(gzfile, header, sizeof(header));
       gzclose(gzfile);
-      if (len == sizeof(header) && STREQLEN(header, "BLENDER", 7)) {
+      /* Files that aren't gzip compressed are read as they are. */
+      if (len == sizeof(header) && (STREQLEN(header, "BLENDER", 7) || wm_header_is_zstd(header))) {
         retval = BKE_READ_EXOTIC_OK_BLEND;
       }
       else {
@@ -547,6 +563,8 @@ static void wm_file_read_pre(bContext *C, bool use_data, bool UNUSED(use_userdef
   if (use_data) {
     BKE_callback_exec_null(CTX_data_main(C), BKE_CB_EVT_LOAD_PRE);
     BLI_timer_on_file_load();
+    /* Cached results refer to the node trees of the file being closed. */
+    COM_clearCaches();
   }
 
   /* Always do this as both startup and preferences may have loaded in many font's
@@ -722,7 +740,11 @@ bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
          * Further it's just confusing if a user loads a file and various preferences change. */
         &(const struct BlendFileReadParams){
             .is_startup = false,
-            .skip_flags = BLO_READ_SKIP_USERDEF,
+            /* Packed files that are never used do not need to be read at all. */
+            .skip_flags = BLO_READ_SKIP_USERDEF |
+                          ((G.background || (U.flag & USER_FILE_DEFER_PACKED_DATA)) ?
+                               BLO_READ_DEFER_PACKED_DATA :
+                               BLO_READ_SKIP_NONE),
         },
         reports);
 
@@ -1279,6 +1301,151 @@ static void wm_history_file_update(void)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Background File Write Job
+ *
+ * The file is serialized on the main thread (see #BLO_write_file_snapshot),
+ * writing it to disk runs as a job so editing can continue in the meantime.
+ * \{ */
+
+typedef struct FileWriteJob {
+  wmWindowManager *wm;
+  Main *bmain;
+  BlendFileWriteSnapshot *snapshot;
+  char filepath[FILE_MAX];
+  /** Stored once the file has been written (owned by the job). */
+  ImBuf *ibuf_thumb;
+  /** Auto-save doesn't run save callbacks or change the state of the current file. */
+  bool is_autosave;
+  bool do_history_file_update;
+  /** Only accessed by the job thread until the job has ended. */
+  ReportList reports;
+  bool success;
+  /** Data changed after the snapshot was taken, so the file isn't saved once it's written. */
+  bool is_modified;
+} FileWriteJob;
+
+static void wm_file_write_job_startjob(void *customdata,
+                                       short *UNUSED(stop),
+                                       short *do_update,
+                                       float *progress)
+{
+  FileWriteJob *fj = customdata;
+
+  /* Stopping is ignored on purpose, killing the job (when quitting or loading another file)
+   * waits for the file to be written instead of losing changes that were reported as saved. */
+  fj->success = BLO_write_file_snapshot_to_disk(fj->snapshot, progress, &fj->reports);
+  *do_update = true;
+}
+
+static void wm_file_write_job_endjob(void *customdata)
+{
+  FileWriteJob *fj = customdata;
+
+  BLO_write_file_snapshot_free(fj->snapshot);
+  fj->snapshot = NULL;
+
+  if (fj->is_autosave) {
+    /* Reports are printed into the console. */
+    return;
+  }
+
+  LISTBASE_FOREACH (Report *, report, &fj->reports.list) {
+    WM_report(report->type, report->message);
+  }
+
+  if (fj->success) {
+    /* prevent background mode scripts from clobbering history */
+    if (fj->do_history_file_update) {
+      wm_history_file_update();
+    }
+
+    BKE_callback_exec_null(fj->bmain, BKE_CB_EVT_SAVE_POST);
+
+    /* run this function after because the file cant be written before the blend is */
+    if (fj->ibuf_thumb) {
+      IMB_thumb_delete(fj->filepath, THB_FAIL); /* without this a failed thumb overrides */
+      fj->ibuf_thumb = IMB_thumb_create(
+          fj->filepath, THB_LARGE, THB_SOURCE_BLEND, fj->ibuf_thumb);
+    }
+
+    /* The file is only tagged as saved now, so quitting while it's written still warns. */
+    if (!fj->is_modified) {
+      WM_main_add_notifier(NC_WM | ND_FILESAVE, NULL);
+    }
+
+    WM_reportf(RPT_INFO, "Saved \"%s\"", BLI_path_basename(fj->filepath));
+  }
+  /* Otherwise the previous file is left untouched, the changes remain unsaved. */
+}
+
+static void wm_file_write_job_free(void *customdata)
+{
+  FileWriteJob *fj = customdata;
+
+  if (fj->snapshot) {
+    BLO_write_file_snapshot_free(fj->snapshot);
+  }
+  if (fj->ibuf_thumb) {
+    IMB_freeImBuf(fj->ibuf_thumb);
+  }
+  BKE_reports_clear(&fj->reports);
+  MEM_freeN(fj);
+}
+
+/**
+ * Wait for a file that's being written to be finished,
+ * so multiple jobs never write the same (temporary) file.
+ */
+static void wm_file_write_job_wait(wmWindowManager *wm)
+{
+  WM_jobs_kill_type(wm, wm, WM_JOB_TYPE_FILE_WRITE);
+}
+
+/** Changes made while the file is written aren't part of it. */
+static void wm_file_write_job_tag_modified(wmWindowManager *wm)
+{
+  FileWriteJob *fj = WM_jobs_customdata_from_type(wm, WM_JOB_TYPE_FILE_WRITE);
+  if (fj != NULL) {
+    fj->is_modified = true;
+  }
+}
+
+static FileWriteJob *wm_file_write_job_new(wmWindowManager *wm,
+                                           Main *bmain,
+                                           BlendFileWriteSnapshot *snapshot,
+                                           const char *filepath,
+                                           const bool is_autosave)
+{
+  FileWriteJob *fj = MEM_callocN(sizeof(*fj), __func__);
+  fj->wm = wm;
+  fj->bmain = bmain;
+  fj->snapshot = snapshot;
+  fj->is_autosave = is_autosave;
+  BLI_strncpy(fj->filepath, filepath, sizeof(fj->filepath));
+  BKE_reports_init(&fj->reports, is_autosave ? RPT_PRINT : RPT_STORE);
+  return fj;
+}
+
+static void wm_file_write_job_start(wmWindowManager *wm, wmWindow *win, FileWriteJob *fj)
+{
+  wmJob *wm_job = WM_jobs_get(wm,
+                              win,
+                              wm,
+                              fj->is_autosave ? "Auto Saving" : "Saving",
+                              WM_JOB_PROGRESS,
+                              WM_JOB_TYPE_FILE_WRITE);
+
+  WM_jobs_customdata_set(wm_job, fj, wm_file_write_job_free);
+  /* Refresh the window title as the file may not be saved after all. */
+  WM_jobs_timer(wm_job, 0.1, 0, NC_WM | ND_DATACHANGED);
+  WM_jobs_callbacks(wm_job, wm_file_write_job_startjob, NULL, NULL, wm_file_write_job_endjob);
+
+  WM_jobs_start(wm, wm_job);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Save Main Blend-File (internal)
  * \{ */
@@ -1412,12 +1579,16 @@ bool write_crash_blend(void)
 
 /**
  * \see #wm_homefile_write_exec wraps #BLO_write_file in a similar way.
+ *
+ * \param use_background_write: Only serialize the file, writing it to disk runs as a job.
+ * Callbacks, thumbnails and the "Saved" report follow once the file has been written.
  */
 static bool wm_file_write(bContext *C,
                           const char *filepath,
                           int fileflags,
                           eBLO_WritePathRemap remap_mode,
                           bool use_save_as_copy,
+                          bool use_background_write,
                           ReportList *reports)
 {
   Main *bmain = CTX_data_main(C);
@@ -1492,18 +1663,33 @@ static bool wm_file_write(bContext *C,
   /* XXX temp solution to solve bug, real fix coming (ton) */
   bmain->recovered = 0;
 
-  if (BLO_write_file(CTX_data_main(C),
-                     filepath,
-                     fileflags,
-                     &(const struct BlendFileWriteParams){
-                         .remap_mode = remap_mode,
-                         .use_save_versions = true,
-                         .use_save_as_copy = use_save_as_copy,
-                         .thumb = thumb,
-                     },
-                     reports)) {
-    const bool do_history_file_update = (G.background == false) &&
-                                        (CTX_wm_manager(C)->op_undo_depth == 0);
+  const struct BlendFileWriteParams params = {
+      .remap_mode = remap_mode,
+      .use_save_versions = true,
+      .use_save_as_copy = use_save_as_copy,
+      .thumb = thumb,
+  };
+  wmWindowManager *wm = CTX_wm_manager(C);
+  FileWriteJob *write_job = NULL;
+  bool success;
+
+  /* A previous save may still be writing to the same file. */
+  wm_file_write_job_wait(wm);
+
+  if (use_background_write) {
+    BlendFileWriteSnapshot *snapshot = BLO_write_file_snapshot(
+        bmain, filepath, fileflags, &params, reports);
+    if (snapshot) {
+      write_job = wm_file_write_job_new(wm, bmain, snapshot, filepath, false);
+    }
+    success = (write_job != NULL);
+  }
+  else {
+    success = BLO_write_file(bmain, filepath, fileflags, &params, reports);
+  }
+
+  if (success) {
+    const bool do_history_file_update = (G.background == false) && (wm->op_undo_depth == 0);
 
     if (use_save_as_copy == false) {
       G.relbase_valid = 1;
@@ -1514,21 +1700,30 @@ static bool wm_file_write(bContext *C,
 
     SET_FLAG_FROM_TEST(G.fileflags, fileflags & G_FILE_COMPRESS, G_FILE_COMPRESS);
 
-    /* prevent background mode scripts from clobbering history */
-    if (do_history_file_update) {
-      wm_history_file_update();
+    if (write_job) {
+      /* The remaining steps run once the file has been written. */
+      write_job->do_history_file_update = do_history_file_update;
+      write_job->ibuf_thumb = ibuf_thumb;
+      ibuf_thumb = NULL;
+      wm_file_write_job_start(wm, CTX_wm_window(C), write_job);
     }
+    else {
+      /* prevent background mode scripts from clobbering history */
+      if (do_history_file_update) {
+        wm_history_file_update();
+      }
 
-    BKE_callback_exec_null(bmain, BKE_CB_EVT_SAVE_POST);
+      BKE_callback_exec_null(bmain, BKE_CB_EVT_SAVE_POST);
 
-    /* run this function after because the file cant be written before the blend is */
-    if (ibuf_thumb) {
-      IMB_thumb_delete(filepath, THB_FAIL); /* without this a failed thumb overrides */
-      ibuf_thumb = IMB_thumb_create(filepath, THB_LARGE, THB_SOURCE_BLEND, ibuf_thumb);
-    }
+      /* run this function after because the file cant be written before the blend is */
+      if (ibuf_thumb) {
+        IMB_thumb_delete(filepath, THB_FAIL); /* without this a failed thumb overrides */
+        ibuf_thumb = IMB_thumb_create(filepath, THB_LARGE, THB_SOURCE_BLEND, ibuf_thumb);
+      }
 
-    /* Without this there is no feedback the file was saved. */
-    BKE_reportf(reports, RPT_INFO, "Saved \"%s\"", BLI_path_basename(filepath));
+      /* Without this there is no feedback the file was saved. */
+      BKE_reportf(reports, RPT_INFO, "Saved \"%s\"", BLI_path_basename(filepath));
+    }
 
     /* Success. */
     ok = true;
@@ -1619,12 +1814,13 @@ void wm_autosave_timer(Main *bmain, wmWindowManager *wm, wmTimer *UNUSED(wt))
 
   wm_autosave_location(filepath);
 
-  if (U.uiflag & USER_GLOBALUNDO) {
-    /* fast save of last undobuffer, now with UI */
-    struct MemFile *memfile = ED_undosys_stack_memfile_get_active(wm->undo_stack);
-    if (memfile) {
-      BLO_memfile_write_file(memfile, filepath);
-    }
+  /* Fast save of last undobuffer, now with UI.
+   * This fails when the undo buffer refers to data of packed files that weren't read yet. */
+  struct MemFile *memfile = (U.uiflag & USER_GLOBALUNDO) ?
+                                ED_undosys_stack_memfile_get_active(wm->undo_stack) :
+                                NULL;
+  if (memfile && BLO_memfile_write_file(memfile, filepath)) {
+    /* Pass. */
   }
   else {
     /* Save as regular blend file. */
@@ -1632,8 +1828,16 @@ void wm_autosave_timer(Main *bmain, wmWindowManager *wm, wmTimer *UNUSED(wt))
 
     ED_editors_flush_edits(bmain);
 
+    /* Only serialize the file here, it's written to disk without blocking the interface. */
+    wm_file_write_job_wait(wm);
+
     /* Error reporting into console. */
-    BLO_write_file(bmain, filepath, fileflags, &(const struct BlendFileWriteParams){0}, NULL);
+    BlendFileWriteSnapshot *snapshot = BLO_write_file_snapshot(
+        bmain, filepath, fileflags, &(const struct BlendFileWriteParams){0}, NULL);
+    if (snapshot) {
+      wm_file_write_job_start(
+          wm, wm->winactive, wm_file_write_job_new(wm, bmain, snapshot, filepath, true));
+    }
   }
   /* do timer after file write, just in case file write takes a long time */
   wm->autosavetimer = WM_event_add_timer(wm, NULL, TIMERAUTOSAVE, U.savetime * 60.0);
@@ -2738,7 +2942,12 @@ static int wm_save_as_mainfile_exec(bContext *C, wmOperator *op)
   /* set compression flag */
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "compress"), G_FILE_COMPRESS);
 
-  const bool ok = wm_file_write(C, path, fileflags, remap_mode, use_save_as_copy, op->reports);
+  /* Scripts expect the file to exist once the operator has finished. */
+  const bool use_background_write = (op->flag & OP_IS_INVOKE) && !G.background &&
+                                    !(!is_save_as && RNA_boolean_get(op->ptr, "exit"));
+
+  const bool ok = wm_file_write(
+      C, path, fileflags, remap_mode, use_save_as_copy, use_background_write, op->reports);
 
   if ((op->flag & OP_IS_INVOKE) == 0) {
     /* OP_IS_INVOKE is set when the operator is called from the GUI.
@@ -2751,7 +2960,10 @@ static int wm_save_as_mainfile_exec(bContext *C, wmOperator *op)
     return OPERATOR_CANCELLED;
   }
 
-  WM_event_add_notifier(C, NC_WM | ND_FILESAVE, NULL);
+  /* A file written in the background is tagged as saved once the write succeeded. */
+  if (!use_background_write) {
+    WM_event_add_notifier(C, NC_WM | ND_FILESAVE, NULL);
+  }
 
   if (!is_save_as && RNA_boolean_get(op->ptr, "exit")) {
     wm_exit_schedule_delayed(C);
@@ -493,10 +493,15 @@ void WM_exit_ex(bContext *C, const bool do_python)
 
         has_edited = ED_editors_flush_edits(bmain);
 
+        /* Writing the undo state fails when it refers to data of packed files that weren't
+         * read yet, write the current state then. */
         if ((has_edited &&
              BLO_write_file(
                  bmain, filename, fileflags, &(const struct BlendFileWriteParams){0}, NULL)) ||
-            (undo_memfile && BLO_memfile_write_file(undo_memfile, filename))) {
+            (undo_memfile && BLO_memfile_write_file(undo_memfile, filename)) ||
+            (!has_edited &&
+             BLO_write_file(
+                 bmain, filename, fileflags, &(const struct BlendFileWriteParams){0}, NULL))) {
           printf("Saved session recovery to '%s'\n", filename);
         }
       }
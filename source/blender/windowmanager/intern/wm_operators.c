@@ -44,6 +44,7 @@
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 #include "DNA_screen_types.h"
+#include "DNA_sequence_types.h"
 #include "DNA_userdef_types.h"
 #include "DNA_windowmanager_types.h"
 
@@ -82,6 +83,7 @@
 #include "GPU_matrix.h"
 #include "GPU_state.h"
 
+#include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
 
 #include "ED_fileselect.h"
@@ -3107,6 +3109,7 @@ enum {
   eRTAnimationStep = 4,
   eRTAnimationPlay = 5,
   eRTUndo = 6,
+  eRTMovieDecode = 7,
 };
 
 static const EnumPropertyItem redraw_timer_type_items[] = {
@@ -3117,9 +3120,50 @@ static const EnumPropertyItem redraw_timer_type_items[] = {
     {eRTAnimationStep, "ANIM_STEP", 0, "Anim Step", "Animation Steps"},
     {eRTAnimationPlay, "ANIM_PLAY", 0, "Anim Play", "Animation Playback"},
     {eRTUndo, "UNDO", 0, "Undo/Redo", "Undo/Redo"},
+    {eRTMovieDecode,
+     "MOVIE_DECODE",
+     0,
+     "Movie Decode",
+     "Decode the next frame of all movie strips (in the current meta-strip)"},
     {0, NULL, 0, NULL, NULL},
 };
 
+/* Open the movies of strips directly, to measure decoding without the sequencer cache. */
+static void redraw_timer_movies_open(Main *bmain, Scene *scene, ListBase *r_anims)
+{
+  if (scene->ed == NULL) {
+    return;
+  }
+
+  LISTBASE_FOREACH (Sequence *, seq, scene->ed->seqbasep) {
+    if (seq->type != SEQ_TYPE_MOVIE) {
+      continue;
+    }
+
+    char filepath[FILE_MAX];
+    BLI_join_dirfile(filepath, sizeof(filepath), seq->strip->dir, seq->strip->stripdata->name);
+    BLI_path_abs(filepath, BKE_main_blendfile_path(bmain));
+
+    const int ib_flags = IB_rect | ((seq->flag & SEQ_FILTERY) ? IB_animdeinterlace : 0);
+    struct anim *anim = IMB_open_anim(
+        filepath, ib_flags, seq->streamindex, seq->strip->colorspace_settings.name);
+    if (anim && IMB_anim_get_duration(anim, IMB_TC_NONE) > 0) {
+      BLI_addtail(r_anims, BLI_genericNodeN(anim));
+    }
+    else if (anim) {
+      IMB_free_anim(anim);
+    }
+  }
+}
+
+static void redraw_timer_movies_close(ListBase *anims)
+{
+  LISTBASE_FOREACH (LinkData *, link, anims) {
+    IMB_free_anim(link->data);
+  }
+  BLI_freelistN(anims);
+}
+
 static void redraw_timer_step(bContext *C,
                               Scene *scene,
                               struct Depsgraph *depsgraph,
@@ -3127,7 +3171,9 @@ static void redraw_timer_step(bContext *C,
                               ScrArea *area,
                               ARegion *region,
                               const int type,
-                              const int cfra)
+                              const int cfra,
+                              ListBase *movie_anims,
+                              const int step)
 {
   if (type == eRTDrawRegion) {
     if (region) {
@@ -3184,6 +3230,17 @@ static void redraw_timer_step(bContext *C,
       redraw_timer_window_swap(C);
     }
   }
+  else if (type == eRTMovieDecode) {
+    /* Frames are requested in order, as during playback. */
+    LISTBASE_FOREACH (LinkData *, link, movie_anims) {
+      struct anim *anim = link->data;
+      const int position = step % IMB_anim_get_duration(anim, IMB_TC_NONE);
+      ImBuf *ibuf = IMB_anim_absolute(anim, position, IMB_TC_NONE, IMB_PROXY_NONE);
+      if (ibuf) {
+        IMB_freeImBuf(ibuf);
+      }
+    }
+  }
   else { /* eRTUndo */
     /* Undo and redo, including depsgraph update since that can be a
      * significant part of the cost. */
@@ -3211,6 +3268,15 @@ static int redraw_timer_exec(bContext *C, wmOperator *op)
    */
   struct Depsgraph *depsgraph = CTX_data_depsgraph_pointer(C);
 
+  ListBase movie_anims = {NULL, NULL};
+  if (type == eRTMovieDecode) {
+    redraw_timer_movies_open(CTX_data_main(C), scene, &movie_anims);
+    if (BLI_listbase_is_empty(&movie_anims)) {
+      BKE_report(op->reports, RPT_ERROR, "No movie strips to decode");
+      return OPERATOR_CANCELLED;
+    }
+  }
+
   WM_cursor_wait(1);
 
   double time_start = PIL_check_seconds_timer();
@@ -3219,7 +3285,8 @@ static int redraw_timer_exec(bContext *C, wmOperator *op)
 
   int iter_steps = 0;
   for (int a = 0; a < iter; a++) {
-    redraw_timer_step(C, scene, depsgraph, win, area, region, type, cfra);
+    redraw_timer_step(
+        C, scene, depsgraph, win, area, region, type, cfra, &movie_anims, iter_steps);
     iter_steps += 1;
 
     if (time_limit != 0.0) {
@@ -3244,6 +3311,15 @@ static int redraw_timer_exec(bContext *C, wmOperator *op)
               time_delta,
               time_delta / iter_steps);
 
+  if (type == eRTMovieDecode) {
+    BKE_reportf(op->reports,
+                RPT_WARNING,
+                "%d movie(s) decoded at %.2f frames per second",
+                BLI_listbase_count(&movie_anims),
+                iter_steps / (time_delta / 1000.0));
+    redraw_timer_movies_close(&movie_anims);
+  }
+
   return OPERATOR_FINISHED;
 }
 
@@ -45,6 +45,36 @@ class TestBlendFileSaveLoadBasic(TestHelper):
 
         assert(orig_data == read_data)
 
+    def test_save_load_compressed(self):
+        bpy.ops.wm.read_factory_settings()
+
+        output_dir = self.args.output_dir
+        self.ensure_path(output_dir)
+
+        # Take care to keep the name unique so multiple test jobs can run at once.
+        output_path = os.path.join(output_dir, "blendfile_io_compressed.blend")
+
+        orig_data = self.blender_data_to_tuple(bpy.data, "orig_data compressed")
+
+        bpy.ops.wm.save_as_mainfile(filepath=output_path, check_existing=False, compress=True)
+
+        # Compressed files are written as zstd frames.
+        with open(output_path, "rb") as f:
+            assert(f.read(4) == b"\x28\xb5\x2f\xfd")
+
+        bpy.ops.wm.open_mainfile(filepath=output_path, load_ui=False)
+
+        read_data = self.blender_data_to_tuple(bpy.data, "read_data compressed")
+
+        assert(orig_data == read_data)
+
+        # Linking seeks into the file rather than reading all of it.
+        bpy.ops.wm.read_factory_settings()
+        with bpy.data.libraries.load(output_path, link=True) as (data_from, data_to):
+            data_to.meshes = data_from.meshes
+
+        assert(len(data_to.meshes) == len(data_from.meshes) != 0)
+
 
 TESTS = (
     TestBlendFileSaveLoadBasic,